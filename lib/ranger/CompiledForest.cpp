@@ -0,0 +1,223 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cmath>
+#include <deque>
+#include <utility>
+
+#include "CompiledForest.h"
+#include "utility.h"
+
+namespace ranger {
+
+constexpr size_t CompiledForestProbability::block_size;
+
+CompiledForestProbability::CompiledForestProbability(const std::string& forest_filename) {
+  loadFromFile(forest_filename);
+}
+
+void CompiledForestProbability::loadFromFile(const std::string& forest_filename) {
+  std::ifstream infile {forest_filename, std::ios::binary};
+  try {
+    loadFromFile(infile);
+  } catch (...) {
+    throw std::runtime_error("Could not read from input file: " + forest_filename + ".");
+  }
+}
+
+void CompiledForestProbability::loadFromFile(std::ifstream& infile) {
+  if (!infile.good()) throw std::runtime_error("Could not read from input file.");
+  *this = CompiledForestProbability {};
+  read_meta(infile, meta_info);
+
+  // Read treetype
+  TreeType treetype;
+  infile.read((char*) &treetype, sizeof(treetype));
+  if (treetype != TREE_PROBABILITY) {
+    throw std::runtime_error("Wrong treetype. Loaded file is not a probability estimation forest.");
+  }
+
+  // Read class_values
+  readVector1D(class_values, infile);
+
+  // Terminal nodes without class counts point at this block of zeros
+  terminal_class_probabilities.assign(class_values.size(), 0);
+
+  tree_roots.reserve(meta_info.num_trees);
+  tree_depths.reserve(meta_info.num_trees);
+  for (size_t i = 0; i < meta_info.num_trees; ++i) {
+    std::vector<std::vector<size_t>> tree_child_nodeIDs;
+    readVector2D(tree_child_nodeIDs, infile);
+    std::vector<size_t> tree_split_varIDs;
+    readVector1D(tree_split_varIDs, infile);
+    std::vector<double> tree_split_values;
+    readVector1D(tree_split_values, infile);
+    std::vector<size_t> terminal_nodes;
+    readVector1D(terminal_nodes, infile);
+    std::vector<std::vector<double>> terminal_class_counts;
+    readVector2D(terminal_class_counts, infile);
+    if (!infile) {
+      throw std::runtime_error("Unexpected end of forest file.");
+    }
+    appendTree(tree_child_nodeIDs, tree_split_varIDs, tree_split_values, terminal_nodes, terminal_class_counts);
+  }
+}
+
+size_t CompiledForestProbability::getClassIndex(double class_value) const {
+  return std::distance(class_values.cbegin(), std::find(class_values.cbegin(), class_values.cend(), class_value));
+}
+
+void CompiledForestProbability::appendTree(const std::vector<std::vector<size_t>>& tree_child_nodeIDs,
+    const std::vector<size_t>& tree_split_varIDs, const std::vector<double>& tree_split_values,
+    const std::vector<size_t>& terminal_nodes, const std::vector<std::vector<double>>& terminal_class_counts) {
+  const size_t num_nodes = tree_split_varIDs.size();
+  if (tree_child_nodeIDs.size() != 2 || tree_child_nodeIDs[0].size() != num_nodes
+      || tree_child_nodeIDs[1].size() != num_nodes || tree_split_values.size() != num_nodes
+      || terminal_nodes.size() != terminal_class_counts.size() || num_nodes == 0) {
+    throw std::runtime_error("Malformed tree in forest file.");
+  }
+  const size_t first_nodeID = split_varIDs.size();
+  if (first_nodeID + num_nodes > std::numeric_limits<uint32_t>::max()) {
+    throw std::runtime_error("Forest too large to compile.");
+  }
+  const auto& num_independent_variables = getNumIndependentVariables();
+  const auto& is_ordered = meta_info.ordered_variable_indicators;
+
+  split_varIDs.resize(first_nodeID + num_nodes, 0);
+  split_values.resize(first_nodeID + num_nodes, std::numeric_limits<double>::infinity());
+  child_nodeIDs.resize(2 * (first_nodeID + num_nodes));
+  terminal_offsets.resize(first_nodeID + num_nodes, 0);
+  is_ordered_split.resize(first_nodeID + num_nodes, true);
+
+  for (size_t nodeID = 0; nodeID < num_nodes; ++nodeID) {
+    const uint32_t compiled_nodeID = first_nodeID + nodeID;
+    const size_t left = tree_child_nodeIDs[0][nodeID], right = tree_child_nodeIDs[1][nodeID];
+    if (left == 0 && right == 0) {
+      // Terminal nodes loop back to themselves so traversal can run for a fixed number of steps
+      child_nodeIDs[2 * compiled_nodeID] = compiled_nodeID;
+      child_nodeIDs[2 * compiled_nodeID + 1] = compiled_nodeID;
+    } else {
+      if (left >= num_nodes || right >= num_nodes || tree_split_varIDs[nodeID] >= num_independent_variables) {
+        throw std::runtime_error("Malformed tree in forest file.");
+      }
+      split_varIDs[compiled_nodeID] = tree_split_varIDs[nodeID];
+      split_values[compiled_nodeID] = tree_split_values[nodeID];
+      child_nodeIDs[2 * compiled_nodeID] = first_nodeID + left;
+      child_nodeIDs[2 * compiled_nodeID + 1] = first_nodeID + right;
+      if (tree_split_varIDs[nodeID] < is_ordered.size() && !is_ordered[tree_split_varIDs[nodeID]]) {
+        is_ordered_split[compiled_nodeID] = false;
+        has_unordered_splits = true;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < terminal_nodes.size(); ++i) {
+    if (terminal_nodes[i] >= num_nodes || terminal_class_counts[i].size() > class_values.size()) {
+      throw std::runtime_error("Malformed tree in forest file.");
+    }
+    terminal_offsets[first_nodeID + terminal_nodes[i]] = terminal_class_probabilities.size();
+    terminal_class_probabilities.insert(terminal_class_probabilities.end(), terminal_class_counts[i].cbegin(),
+        terminal_class_counts[i].cend());
+    terminal_class_probabilities.resize(terminal_class_probabilities.size()
+        + (class_values.size() - terminal_class_counts[i].size()), 0);
+  }
+
+  // Depth of the deepest terminal node bounds the number of traversal steps
+  uint32_t depth = 0;
+  std::deque<std::pair<size_t, uint32_t>> queue {{0, 0}};
+  while (!queue.empty()) {
+    const auto node = queue.front();
+    queue.pop_front();
+    const size_t left = tree_child_nodeIDs[0][node.first], right = tree_child_nodeIDs[1][node.first];
+    if (left == 0 && right == 0) {
+      depth = std::max(depth, node.second);
+    } else {
+      if (node.second > num_nodes) {
+        throw std::runtime_error("Malformed tree in forest file.");
+      }
+      queue.emplace_back(left, node.second + 1);
+      queue.emplace_back(right, node.second + 1);
+    }
+  }
+  tree_roots.push_back(first_nodeID);
+  tree_depths.push_back(depth);
+}
+
+template <bool HasUnorderedSplits>
+void CompiledForestProbability::predictBlock(size_t tree_idx, const double* rows, size_t num_rows,
+    double* result) const {
+  const size_t num_cols = getNumIndependentVariables();
+  const size_t num_classes = class_values.size();
+  uint32_t nodes[block_size];
+  std::fill(nodes, nodes + num_rows, tree_roots[tree_idx]);
+  for (uint32_t level = 0; level < tree_depths[tree_idx]; ++level) {
+    // Independent samples are advanced together to hide the latency of the node table loads
+    for (size_t i = 0; i < num_rows; ++i) {
+      const uint32_t nodeID = nodes[i];
+      const double value = rows[i * num_cols + split_varIDs[nodeID]];
+      size_t go_right;
+      if (HasUnorderedSplits && !is_ordered_split[nodeID]) {
+        const size_t factorID = std::floor(value) - 1;
+        const size_t splitID = std::floor(split_values[nodeID]);
+        go_right = (splitID & (1ULL << factorID)) != 0;
+      } else {
+        // Same as Tree::predict: NaN goes right
+        go_right = !(value <= split_values[nodeID]);
+      }
+      nodes[i] = child_nodeIDs[2 * nodeID + go_right];
+    }
+  }
+  for (size_t i = 0; i < num_rows; ++i) {
+    const double* probabilities = terminal_class_probabilities.data() + terminal_offsets[nodes[i]];
+    double* row_result = result + i * num_classes;
+    for (size_t class_idx = 0; class_idx < num_classes; ++class_idx) {
+      row_result[class_idx] += probabilities[class_idx];
+    }
+  }
+}
+
+void CompiledForestProbability::predict(const double* rows, size_t num_rows, double* result) const {
+  const size_t num_cols = getNumIndependentVariables();
+  const size_t num_classes = class_values.size();
+  std::fill(result, result + num_rows * num_classes, 0.0);
+  if (num_cols == 0 || tree_roots.empty()) return;
+  // Tree-major order keeps each tree's node tables hot in cache while all rows are dropped down it
+  for (size_t tree_idx = 0; tree_idx < tree_roots.size(); ++tree_idx) {
+    for (size_t first_row = 0; first_row < num_rows; first_row += block_size) {
+      const size_t num_block_rows = std::min(block_size, num_rows - first_row);
+      if (has_unordered_splits) {
+        predictBlock<true>(tree_idx, rows + first_row * num_cols, num_block_rows, result + first_row * num_classes);
+      } else {
+        predictBlock<false>(tree_idx, rows + first_row * num_cols, num_block_rows, result + first_row * num_classes);
+      }
+    }
+  }
+  const double num_trees = tree_roots.size();
+  for (size_t i = 0; i < num_rows * num_classes; ++i) {
+    result[i] /= num_trees;
+  }
+}
+
+std::vector<double> CompiledForestProbability::predict(const std::vector<double>& rows) const {
+  const size_t num_cols = getNumIndependentVariables();
+  if (num_cols == 0 || rows.size() % num_cols != 0) {
+    throw std::runtime_error("Number of values does not match number of independent variables.");
+  }
+  const size_t num_rows = rows.size() / num_cols;
+  std::vector<double> result(num_rows * class_values.size());
+  predict(rows.data(), num_rows, result.data());
+  return result;
+}
+
+} // namespace ranger
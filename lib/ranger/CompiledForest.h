@@ -0,0 +1,97 @@
+/*-------------------------------------------------------------------------------
+ This file is part of ranger.
+
+ Copyright (c) [2014-2018] [Marvin N. Wright]
+
+ This software may be modified and distributed under the terms of the MIT license.
+
+ Please note that the C++ core of ranger is distributed under MIT license and the
+ R package "ranger" under GPL3 license.
+ #-------------------------------------------------------------------------------*/
+
+#ifndef COMPILEDFOREST_H_
+#define COMPILEDFOREST_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+
+#include "globals.h"
+#include "Forest.h"
+
+namespace ranger {
+
+// Prediction-only representation of a probability forest saved by ForestProbability.
+// All trees are flattened into contiguous struct-of-arrays node tables (absolute child
+// indices, terminal nodes loop back to themselves) so samples can be dropped down the
+// forest in blocks without pointer chasing or per-sample Data lookups.
+class CompiledForestProbability {
+public:
+  CompiledForestProbability() = default;
+
+  explicit CompiledForestProbability(const std::string& forest_filename);
+
+  CompiledForestProbability(const CompiledForestProbability&) = default;
+  CompiledForestProbability& operator=(const CompiledForestProbability&) = default;
+  CompiledForestProbability(CompiledForestProbability&&) = default;
+  CompiledForestProbability& operator=(CompiledForestProbability&&) = default;
+
+  ~CompiledForestProbability() = default;
+
+  void loadFromFile(const std::string& forest_filename);
+  void loadFromFile(std::ifstream& infile);
+
+  const Forest::MetaInfo& getMetaInfo() const {
+    return meta_info;
+  }
+  size_t getNumIndependentVariables() const {
+    return meta_info.independent_variable_names.size();
+  }
+  size_t getNumTrees() const {
+    return tree_roots.size();
+  }
+  size_t getNumNodes() const {
+    return split_varIDs.size();
+  }
+  const std::vector<double>& getClassValues() const {
+    return class_values;
+  }
+  // Index of class_value in getClassValues(), or getClassValues().size() if absent
+  size_t getClassIndex(double class_value) const;
+
+  // rows is row-major with getNumIndependentVariables() columns. result is row-major with
+  // getClassValues().size() columns and receives the class probabilities averaged over trees,
+  // as ForestProbability does for PredictionType::RESPONSE.
+  void predict(const double* rows, size_t num_rows, double* result) const;
+  std::vector<double> predict(const std::vector<double>& rows) const;
+
+private:
+  static constexpr size_t block_size = 16;
+
+  Forest::MetaInfo meta_info;
+  std::vector<double> class_values;
+
+  // Node tables, indexed by absolute node ID
+  std::vector<uint32_t> split_varIDs;
+  std::vector<double> split_values;
+  std::vector<uint32_t> child_nodeIDs; // left child at 2 * nodeID, right child at 2 * nodeID + 1
+  std::vector<uint32_t> terminal_offsets; // offset into terminal_class_probabilities
+  std::vector<uint8_t> is_ordered_split;
+
+  std::vector<double> terminal_class_probabilities;
+  std::vector<uint32_t> tree_roots, tree_depths;
+  bool has_unordered_splits = false;
+
+  void appendTree(const std::vector<std::vector<size_t>>& child_nodeIDs, const std::vector<size_t>& split_varIDs,
+      const std::vector<double>& split_values, const std::vector<size_t>& terminal_nodes,
+      const std::vector<std::vector<double>>& terminal_class_counts);
+
+  template <bool HasUnorderedSplits>
+  void predictBlock(size_t tree_idx, const double* rows, size_t num_rows, double* result) const;
+};
+
+} // namespace ranger
+
+#endif /* COMPILEDFOREST_H_ */
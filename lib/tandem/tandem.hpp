@@ -492,8 +492,62 @@ extract_exact_tandem_repeats_naive(const T& str, std::uint32_t min_period, const
     }
 }
 
+template <typename T>
+bool is_primitive(const T& str, const std::size_t pos, const std::uint32_t period) noexcept
+{
+    for (std::uint32_t divisor {1}; divisor < period; ++divisor) {
+        if (period % divisor == 0) {
+            const auto first = std::next(std::cbegin(str), pos);
+            if (std::equal(first, std::next(first, period - divisor), std::next(first, divisor))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Finds all maximal repetitions with primitive period in [min_period, max_period] by comparing each
+// position with the one max_period positions ahead. This is O(n * max_period), but much faster than
+// building a suffix array when max_period is small.
+template <typename T>
+std::vector<Repeat>
+extract_exact_tandem_repeats_direct(const T& str, const std::uint32_t min_period, const std::uint32_t max_period)
+{
+    std::vector<Repeat> result {};
+    const auto n = str.size();
+    for (auto period = min_period; period <= max_period && 2 * static_cast<std::size_t>(period) <= n; ++period) {
+        for (std::size_t i {0}; i + period < n; ) {
+            if (str[i] != str[i + period]) {
+                ++i;
+                continue;
+            }
+            auto j = i + 1;
+            while (j + period < n && str[j] == str[j + period]) ++j;
+            const auto length = j - i + period;
+            if (length >= 2 * period && is_primitive(str, i, period)) {
+                result.emplace_back(static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(length), period);
+            }
+            i = j + 1;
+        }
+    }
+    std::sort(std::begin(result), std::end(result), [] (const Repeat& lhs, const Repeat& rhs) noexcept {
+        return lhs.pos < rhs.pos || (lhs.pos == rhs.pos && lhs.length < rhs.length);
+    });
+    return result;
+}
+
 } // namespace detail
 
+/**
+ Which repeats are reported depends on max_period, as each range uses a different algorithm:
+ 
+ - max_period <= 3: homopolymer and dinucleotide runs are maximal; trinucleotide runs may not be.
+ - max_period <= 8: exactly the maximal repetitions with primitive period in [min_period, max_period].
+ - otherwise: the LZ algorithm, which may report non-maximal fragments of a repetition and may miss some.
+ 
+ Periods 4-8 used the LZ algorithm until the direct one was added, so callers with those periods now get
+ the maximal repetition containing each fragment previously reported, plus any repetitions it missed.
+ */
 template <typename T>
 std::vector<Repeat>
 extract_exact_tandem_repeats(const T& str,
@@ -507,6 +561,8 @@ extract_exact_tandem_repeats(const T& str,
     }
     if (max_period <= 3) { // The naive algorithm is faster in these cases
         return detail::extract_exact_tandem_repeats_naive(str, min_period, max_period);
+    } else if (max_period <= 8) { // Building the suffix array dominates for short periods
+        return detail::extract_exact_tandem_repeats_direct(str, min_period, max_period);
     } else {
         return detail::extract_exact_tandem_repeats_lz(str, min_period, max_period);
     }
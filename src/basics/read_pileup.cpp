@@ -6,132 +6,148 @@
 #include <iterator>
 #include <algorithm>
 #include <numeric>
+#include <cassert>
 
-#include "utils/append.hpp"
 #include "utils/mappable_algorithms.hpp"
 
 namespace octopus {
 
-ReadPileup::ReadPileup(ContigRegion::Position position)
-: summaries_ {}
-, region_ {position, position + 1}
-{
-    summaries_.reserve(3);
-    summaries_.emplace_back("$", ReadSummaries {});
-}
+constexpr char ReadPileups::insertion_base;
 
-const ContigRegion& ReadPileup::mapped_region() const noexcept
-{
-    return region_;
-}
+ReadPileups::ReadPileups(ContigRegion region)
+: region_ {region}
+, offsets_(size(region) + 1, 0)
+, depths_(size(region), 0)
+, bases_ {}
+, base_qualities_ {}
+{}
 
-unsigned ReadPileup::depth() const noexcept
+const ContigRegion& ReadPileups::mapped_region() const noexcept
 {
-    return std::accumulate(std::cbegin(summaries_), std::cend(summaries_), 0u,
-                           [] (auto curr, const auto& p) { return curr + p.second.size(); });
+    return region_;
 }
 
-unsigned ReadPileup::depth(const NucleotideSequence& sequence) const noexcept
+unsigned ReadPileups::depth(const Position position) const noexcept
 {
-    return this->summaries(sequence).size();
+    return depths_[index(position)];
 }
 
-void ReadPileup::add(const AlignedRead& read)
+ReadPileups::Column ReadPileups::column(const Position position) const noexcept
 {
-    const GenomicRegion region {contig_name(read), region_};
-    auto sequence = copy_sequence(read, region);
-    auto itr = std::find_if(std::next(std::begin(summaries_)), std::end(summaries_), [&] (const auto& p) { return p.first == sequence; });
-    if (itr == std::cend(summaries_)) {
-        summaries_.emplace_back(std::move(sequence), ReadSummaries {});
-        itr = std::prev(std::end(summaries_));
-    }
-    itr->second.push_back({copy_base_qualities(read, region), read.mapping_quality()});
+    const auto idx = index(position);
+    const auto offset = offsets_[idx];
+    return {bases_.data() + offset, base_qualities_.data() + offset, offsets_[idx + 1] - offset};
 }
 
-std::vector<ReadPileup::NucleotideSequence> ReadPileup::sequences() const
+unsigned ReadPileups::count(const Position position, const char base) const noexcept
 {
-    std::vector<NucleotideSequence> result {};
-    result.reserve(summaries_.size() - 1);
-    std::transform(std::next(std::cbegin(summaries_)), std::cend(summaries_), std::back_inserter(result),
-                   [] (const auto& p) { return p.first; });
-    return result;
+    const auto column = this->column(position);
+    return std::count(column.bases, column.bases + column.size, base);
 }
 
-const ReadPileup::ReadSummaries& ReadPileup::summaries(const NucleotideSequence& sequence) const
+std::size_t ReadPileups::index(const Position position) const noexcept
 {
-    const auto itr = std::find_if(std::next(std::cbegin(summaries_)), std::cend(summaries_), [&] (const auto& p) { return p.first == sequence; });
-    if (itr != std::cend(summaries_)) {
-        return itr->second;
-    } else {
-        return summaries_.front().second;
-    }
+    assert(region_.begin() <= position && position < region_.end());
+    return position - region_.begin();
 }
 
-std::vector<ReadPileup::BaseQuality> ReadPileup::base_qualities() const
-{
-    std::vector<BaseQuality> result {};
-    if (summaries_.size() == 1) return result;
-    result.reserve(depth());
-    for (const auto& p : summaries_) {
-        for (const auto& read : p.second) utils::append(read.base_qualities, result);
-    }
-    return result;
-}
+// ReadPileups::Builder
 
-std::vector<ReadPileup::BaseQuality> ReadPileup::base_qualities(const NucleotideSequence& sequence) const
-{
-    std::vector<BaseQuality> result {};
-    if (summaries_.size() == 1) return result;
-    const auto& summary = this->summaries(sequence);
-    result.reserve(summary.size());
-    for (const auto& read : summary) utils::append(read.base_qualities, result);
-    return result;
-}
+ReadPileups::Builder::Builder(ContigRegion region)
+: region_ {region}
+, observations_ {}
+, depths_(size(region), 0)
+{}
 
-std::vector<ReadPileup::BaseQuality> ReadPileup::base_qualities_not(const NucleotideSequence& sequence) const
+void ReadPileups::Builder::add(const AlignedRead& read)
 {
-    std::vector<BaseQuality> result {};
-    if (summaries_.size() == 1) return result;
-    result.reserve(depth());
-    std::for_each(std::next(std::cbegin(summaries_)), std::cend(summaries_), [&] (const auto& p) {
-        if (p.first != sequence) {
-            for (const auto& read : p.second) utils::append(read.base_qualities, result);
+    const auto& read_region = contig_region(read);
+    if (!overlaps(read_region, region_)) return;
+    const auto& sequence = read.sequence();
+    const auto& base_qualities = read.base_qualities();
+    if (size(read_region) <= 1) {
+        // copy_sequence returns the entire read sequence in this case
+        if (region_.begin() <= read_region.begin() && read_region.begin() < region_.end()) {
+            add(read_region.begin(), std::cbegin(sequence), sequence.size(), std::cbegin(base_qualities), false);
         }
-    });
-    return result;
+        return;
+    }
+    auto position = read_region.begin();
+    std::size_t sequence_offset {0}, insertion_size {0};
+    for (const auto& op : read.cigar()) {
+        if (!advances_reference(op)) {
+            if (advances_sequence(op)) {
+                insertion_size += op.size();
+                sequence_offset += op.size();
+            }
+            continue;
+        }
+        const auto op_end = position + op.size();
+        const auto is_sequence_op = advances_sequence(op);
+        if (op_end > region_.begin()) {
+            const auto first = std::max(position, region_.begin()), last = std::min(op_end, region_.end());
+            for (auto pileup_position = first; pileup_position < last; ++pileup_position) {
+                const auto op_offset = pileup_position - position;
+                auto num_bases = is_sequence_op ? std::size_t {1} : std::size_t {0};
+                auto base_offset = sequence_offset + (is_sequence_op ? op_offset : 0);
+                if (op_offset == 0) {
+                    num_bases += insertion_size;
+                    base_offset -= insertion_size;
+                }
+                add(pileup_position, std::next(std::cbegin(sequence), base_offset), num_bases,
+                    std::next(std::cbegin(base_qualities), base_offset), op_offset == 0 && insertion_size > 0);
+            }
+        }
+        position = op_end;
+        if (position >= region_.end()) break;
+        if (is_sequence_op) sequence_offset += op.size();
+        insertion_size = 0;
+    }
 }
 
-unsigned ReadPileup::sum_base_qualities(const NucleotideSequence& sequence) const
+ReadPileups ReadPileups::Builder::build() const
 {
-    const auto& sequence_summaries = this->summaries(sequence);
-    return std::accumulate(std::cbegin(sequence_summaries), std::cend(sequence_summaries), 0u,
-                           [] (auto curr, const ReadSummary& summary) {
-        return curr + std::accumulate(std::cbegin(summary.base_qualities), std::cend(summary.base_qualities), 0u);
-    });
+    ReadPileups result {region_};
+    result.depths_ = depths_;
+    for (const auto& observation : observations_) {
+        ++result.offsets_[observation.index + 1];
+    }
+    std::partial_sum(std::cbegin(result.offsets_), std::cend(result.offsets_), std::begin(result.offsets_));
+    result.bases_.resize(observations_.size());
+    result.base_qualities_.resize(observations_.size());
+    auto next_offsets = result.offsets_;
+    for (const auto& observation : observations_) {
+        const auto offset = next_offsets[observation.index]++;
+        result.bases_[offset] = observation.base;
+        result.base_qualities_[offset] = observation.base_quality;
+    }
+    return result;
 }
 
-namespace {
-
-auto pileup_overlap_range(std::vector<ReadPileup>& pileups, const AlignedRead& read)
+void ReadPileups::Builder::add(const Position position,
+                               const AlignedRead::NucleotideSequence::const_iterator first_base,
+                               const std::size_t num_bases,
+                               const AlignedRead::BaseQualityVector::const_iterator first_base_quality,
+                               const bool is_insertion)
 {
-    return overlap_range(std::begin(pileups), std::end(pileups), contig_region(read), BidirectionallySortedTag {});
+    const auto idx = static_cast<std::uint32_t>(position - region_.begin());
+    ++depths_[idx];
+    if (num_bases == 1 && !is_insertion) {
+        observations_.push_back({idx, *first_base, *first_base_quality});
+    } else {
+        std::for_each(first_base_quality, std::next(first_base_quality, num_bases), [&] (const auto base_quality) {
+            observations_.push_back({idx, insertion_base, base_quality});
+        });
+    }
 }
 
-} // namespace
-
 ReadPileups make_pileups(const ReadContainer& reads, const GenomicRegion& region)
 {
-    ReadPileups result {};
-    result.reserve(size(region));
-    for (auto position = region.begin(); position < region.end(); ++position) {
-        result.emplace_back(position);
-    }
+    ReadPileups::Builder builder {region.contig_region()};
     for (const AlignedRead& read : overlap_range(reads, region)) {
-        for (ReadPileup& pileup : pileup_overlap_range(result, read)) {
-            pileup.add(read);
-        }
+        builder.add(read);
     }
-    return result;
+    return builder.build();
 }
 
 } // namespace octopus
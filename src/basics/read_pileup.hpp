@@ -5,7 +5,8 @@
 #define read_pileup_hpp
 
 #include <vector>
-#include <utility>
+#include <cstddef>
+#include <cstdint>
 
 #include "config/common.hpp"
 #include "concepts/mappable.hpp"
@@ -15,54 +16,97 @@
 
 namespace octopus {
 
-class ReadPileup : public Mappable<ReadPileup>
+/*
+ Columnar pileup of read bases over a contiguous region. The base observations of every position are
+ stored contiguously in flat arrays (indexed by position offsets), rather than as per-read copies, so
+ positions can be scanned without allocation.
+
+ As with copy_sequence(read, region) for a single position, any inserted bases preceding a position are
+ observed at that position. Consecutive insertion operations form a single insertion, and every base of an
+ observation that includes inserted bases (the base aligned to the position too, if any) is recorded as
+ insertion_base. Each read base is therefore observed exactly once.
+ */
+class ReadPileups : public Mappable<ReadPileups>
 {
 public:
-    using NucleotideSequence = AlignedRead::NucleotideSequence;
-    using BaseQuality        = AlignedRead::BaseQuality;
-    using MappingQuality     = AlignedRead::MappingQuality;
-    
-    struct ReadSummary
+    using Position       = ContigRegion::Position;
+    using BaseQuality    = AlignedRead::BaseQuality;
+    using MappingQuality = AlignedRead::MappingQuality;
+
+    class Builder;
+
+    struct Column
     {
-        std::vector<BaseQuality> base_qualities;
-        MappingQuality mapping_quality;
+        const char* bases;
+        const BaseQuality* base_qualities;
+        std::size_t size;
     };
-    using ReadSummaries = std::vector<ReadSummary>;
-    
-    ReadPileup() = delete;
-    
-    ReadPileup(ContigRegion::Position position);
-    
-    ReadPileup(const ReadPileup&)            = default;
-    ReadPileup& operator=(const ReadPileup&) = default;
-    ReadPileup(ReadPileup&&)                 = default;
-    ReadPileup& operator=(ReadPileup&&)      = default;
-    
-    ~ReadPileup() = default;
-    
+
+    static constexpr char insertion_base {'+'};
+
+    ReadPileups() = delete;
+
+    ReadPileups(ContigRegion region);
+
+    ReadPileups(const ReadPileups&)            = default;
+    ReadPileups& operator=(const ReadPileups&) = default;
+    ReadPileups(ReadPileups&&)                 = default;
+    ReadPileups& operator=(ReadPileups&&)      = default;
+
+    ~ReadPileups() = default;
+
     const ContigRegion& mapped_region() const noexcept;
-    
-    unsigned depth() const noexcept;
-    unsigned depth(const NucleotideSequence& sequence) const noexcept;
-    
-    void add(const AlignedRead& read);
-    
-    std::vector<NucleotideSequence> sequences() const;
-    
-    const ReadSummaries& summaries(const NucleotideSequence& sequence) const;
-    
-    std::vector<BaseQuality> base_qualities() const;
-    std::vector<BaseQuality> base_qualities(const NucleotideSequence& sequence) const;
-    std::vector<BaseQuality> base_qualities_not(const NucleotideSequence& sequence) const;
-    
-    unsigned sum_base_qualities(const NucleotideSequence& sequence) const;
+
+    // Number of reads overlapping the position, including those with a deletion there
+    unsigned depth(Position position) const noexcept;
+
+    Column column(Position position) const noexcept;
+
+    unsigned count(Position position, char base) const noexcept;
 
 private:
-    std::vector<std::pair<NucleotideSequence, ReadSummaries>> summaries_;
     ContigRegion region_;
+    std::vector<std::uint32_t> offsets_, depths_;
+    std::vector<char> bases_;
+    std::vector<BaseQuality> base_qualities_;
+
+    std::size_t index(Position position) const noexcept;
 };
 
-using ReadPileups = std::vector<ReadPileup>;
+class ReadPileups::Builder
+{
+public:
+    Builder() = delete;
+
+    Builder(ContigRegion region);
+
+    Builder(const Builder&)            = default;
+    Builder& operator=(const Builder&) = default;
+    Builder(Builder&&)                 = default;
+    Builder& operator=(Builder&&)      = default;
+
+    ~Builder() = default;
+
+    // Adds the bases of the read overlapping the pileup region in a single pass over its cigar
+    void add(const AlignedRead& read);
+
+    ReadPileups build() const;
+
+private:
+    struct Observation
+    {
+        std::uint32_t index;
+        char base;
+        BaseQuality base_quality;
+    };
+
+    ContigRegion region_;
+    std::vector<Observation> observations_;
+    std::vector<std::uint32_t> depths_;
+
+    void add(Position position, AlignedRead::NucleotideSequence::const_iterator first_base, std::size_t num_bases,
+             AlignedRead::BaseQualityVector::const_iterator first_base_quality, bool is_insertion);
+};
 
 ReadPileups make_pileups(const ReadContainer& reads, const GenomicRegion& region);
 
@@ -19,6 +19,7 @@
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "utils/path_utils.hpp"
 #include "utils/read_stats.hpp"
@@ -42,6 +43,7 @@
 #include "io/pedigree/pedigree_reader.hpp"
 #include "io/variant/vcf_reader.hpp"
 #include "io/variant/vcf_writer.hpp"
+#include "io/variant/vcf_site_index.hpp"
 #include "exceptions/user_error.hpp"
 #include "exceptions/program_error.hpp"
 #include "exceptions/system_error.hpp"
@@ -263,6 +265,29 @@ MemoryFootprint get_target_read_buffer_size(const OptionMap& options)
     return options.at("target-read-buffer-memory").as<MemoryFootprint>();
 }
 
+boost::optional<MemoryFootprint> get_target_working_memory(const OptionMap& options)
+{
+    boost::optional<MemoryFootprint> result {};
+    if (is_set("target-working-memory", options)) {
+        result = options.at("target-working-memory").as<MemoryFootprint>();
+    }
+    return result;
+}
+
+boost::optional<MemoryFootprint> get_target_thread_working_memory(const OptionMap& options)
+{
+    auto result = get_target_working_memory(options);
+    if (result) {
+        static const MemoryFootprint min_target_memory {*parse_footprint("100M")};
+        auto num_threads = get_num_threads(options);
+        if (!num_threads) {
+            num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        result = MemoryFootprint {std::max(result->bytes() / *num_threads, min_target_memory.bytes())};
+    }
+    return result;
+}
+
 boost::optional<fs::path> get_debug_log_file_name(const OptionMap& options)
 {
     if (is_debug_mode(options)) {
@@ -726,7 +751,13 @@ ReadManager make_read_manager(const OptionMap& options)
 {
     auto read_paths = get_read_paths(options);
     const auto max_open_files = as_unsigned("max-open-read-files", options);
-    return ReadManager {std::move(read_paths), max_open_files};
+    const auto num_decoding_threads = as_unsigned("read-decoding-threads", options);
+    boost::optional<fs::path> manifest {};
+    if (is_set("read-manifest", options)) {
+        manifest = resolve_path(options.at("read-manifest").as<fs::path>(), options);
+    }
+    const auto num_threads = get_num_threads(options);
+    return ReadManager {std::move(read_paths), max_open_files, num_decoding_threads, std::move(manifest), num_threads ? *num_threads : 0};
 }
 
 bool denovo_candidate_variant_discovery_enabled(const OptionMap& options)
@@ -1294,6 +1325,11 @@ auto make_variant_generator_builder(const OptionMap& options, const boost::optio
                 vcf_options.min_quality = options.at("min-source-candidate-quality").as<Phred<double>>().score();
             }
             vcf_options.extract_filtered = options.at("use-filtered-source-candidates").as<bool>();
+            if (options.at("index-source-candidates").as<bool>() && !has_current_site_index(source_path)) {
+                logging::InfoLogger log {};
+                stream(log) << "Making site index for source candidates " << source_path;
+                make_site_index(VcfReader {source_path}, get_site_index_path(source_path));
+            }
             result.add_vcf_extractor(std::move(source_path), vcf_options);
         }
     }
@@ -1978,21 +2014,6 @@ auto get_normal_contamination_risk(const OptionMap& options)
     return result;
 }
 
-auto get_target_working_memory(const OptionMap& options)
-{
-    boost::optional<MemoryFootprint> result {};
-    if (is_set("target-working-memory", options)) {
-        static const MemoryFootprint min_target_memory {*parse_footprint("100M")};
-        result = options.at("target-working-memory").as<MemoryFootprint>();
-        auto num_threads = get_num_threads(options);
-        if (!num_threads) {
-            num_threads = std::thread::hardware_concurrency();
-        }
-        result = MemoryFootprint {std::max(result->bytes() / *num_threads, min_target_memory.bytes())};
-    }
-    return result;
-}
-
 bool is_experimental_caller(const std::string& caller) noexcept
 {
     return caller == "population" || caller == "polyclone" || caller == "cell";
@@ -2186,8 +2207,14 @@ CallerFactory make_caller_factory(const ReferenceGenome& reference, ReadPipe& re
     if (call_sites_only(options) && !is_call_filtering_requested(options)) {
         vc_builder.set_sites_only();
     }
-    const auto target_working_memory = get_target_working_memory(options);
+    const auto target_working_memory = get_target_thread_working_memory(options);
     if (target_working_memory) vc_builder.set_target_memory_footprint(*target_working_memory);
+    if (read_profile && read_profile->length_stats.mean > 0) {
+        // Reads overlapping a base cost their footprint spread over their length
+        const auto read_footprint_per_base = static_cast<double>(read_profile->depth_stats.combined.genome.all.mean)
+                                             * read_profile->memory_stats.mean.bytes() / read_profile->length_stats.mean;
+        vc_builder.set_read_footprint_per_base(read_footprint_per_base);
+    }
     vc_builder.set_execution_policy(get_thread_execution_policy(options));
     auto bad_region_detector = make_bad_region_detector(options, read_profile);
     if (bad_region_detector) {
@@ -2504,6 +2531,104 @@ bool annotate_filter_output(const OptionMap& options)
     return is_set("annotate-filtered-calls", options);
 }
 
+boost::optional<fs::path> get_checkpoint_directory(const OptionMap& options)
+{
+    if (is_set("checkpoint", options)) {
+        return resolve_path(options.at("checkpoint").as<fs::path>(), options);
+    }
+    return boost::none;
+}
+
+bool resume_requested(const OptionMap& options)
+{
+    return options.at("resume").as<bool>();
+}
+
+namespace {
+
+void hash_file_state(const fs::path& file, std::size_t& seed)
+{
+    boost::hash_combine(seed, file.string());
+    boost::system::error_code error {};
+    const auto file_size = fs::file_size(file, error);
+    if (!error) boost::hash_combine(seed, file_size);
+    const auto write_time = fs::last_write_time(file, error);
+    if (!error) boost::hash_combine(seed, write_time);
+}
+
+} // namespace
+
+std::size_t hash_calling_inputs(const OptionMap& options)
+{
+    // Options that have no effect on the calls that are made
+    static const std::vector<std::string> ignored_options {
+        "checkpoint", "resume", "debug", "trace", "max-open-read-files", "read-decoding-threads",
+        "read-manifest"
+    };
+    std::size_t result {0};
+    for (const auto& line : utils::split(to_string(options, false, false), '\n')) {
+        const auto label_end = line.find_first_of("=(");
+        if (line.size() > 2 && label_end != std::string::npos) {
+            const auto label = line.substr(2, label_end - 2);
+            if (std::find(std::cbegin(ignored_options), std::cend(ignored_options), label) != std::cend(ignored_options)) {
+                continue;
+            }
+        }
+        boost::hash_combine(result, line);
+    }
+    // Option values only record file names, so the state of the input files is also needed
+    hash_file_state(resolve_path(options.at("reference").as<fs::path>(), options), result);
+    for (const auto& read_path : get_read_paths(options, false)) {
+        hash_file_state(read_path, result);
+    }
+    return result;
+}
+
+boost::optional<ShardSpec> get_shard(const OptionMap& options)
+{
+    if (is_set("shard", options)) {
+        return options.at("shard").as<ShardSpec>();
+    }
+    return boost::none;
+}
+
+GenomicRegion::Size get_shard_overlap(const OptionMap& options)
+{
+    return as_unsigned("shard-overlap", options);
+}
+
+bool is_shard_merge_command(const OptionMap& options)
+{
+    return is_set("merge-shards", options);
+}
+
+class MissingShardFile : public MissingFileError
+{
+    std::string do_where() const override
+    {
+        return "get_shard_paths";
+    }
+public:
+    MissingShardFile(fs::path p) : MissingFileError {std::move(p), "shard"} {};
+};
+
+std::vector<fs::path> get_shard_paths(const OptionMap& options)
+{
+    std::vector<fs::path> result {};
+    if (is_set("merge-shards", options)) {
+        for (const auto& path : options.at("merge-shards").as<std::vector<fs::path>>()) {
+            auto resolved_path = resolve_path(path, options);
+            if (!fs::exists(resolved_path)) {
+                MissingShardFile e {resolved_path};
+                e.set_location_specified("the command line option '--merge-shards'");
+                throw e;
+            }
+            result.push_back(std::move(resolved_path));
+        }
+    }
+    return result;
+}
+
 boost::optional<fs::path> bamout_request(const OptionMap& options)
 {
     if (is_set("bamout", options)) {
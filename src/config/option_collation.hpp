@@ -39,6 +39,10 @@ boost::optional<unsigned> get_num_threads(const OptionMap& options);
 
 MemoryFootprint get_target_read_buffer_size(const OptionMap& options);
 
+boost::optional<MemoryFootprint> get_target_working_memory(const OptionMap& options);
+// Each thread's share of the target working memory, which caps the haplotypes a task considers
+boost::optional<MemoryFootprint> get_target_thread_working_memory(const OptionMap& options);
+
 ReferenceGenome make_reference(const OptionMap& options);
 
 InputRegionMap get_search_regions(const OptionMap& options, const ReferenceGenome& reference);
@@ -90,6 +94,16 @@ boost::optional<fs::path> get_output_path(const OptionMap& options);
 
 fs::path create_temp_file_directory(const OptionMap& options);
 
+boost::optional<fs::path> get_checkpoint_directory(const OptionMap& options);
+bool resume_requested(const OptionMap& options);
+// Hash of the options and input file states that determine the calls made
+std::size_t hash_calling_inputs(const OptionMap& options);
+
+boost::optional<ShardSpec> get_shard(const OptionMap& options);
+GenomicRegion::Size get_shard_overlap(const OptionMap& options);
+bool is_shard_merge_command(const OptionMap& options);
+std::vector<fs::path> get_shard_paths(const OptionMap& options);
+
 bool is_filter_training_mode(const OptionMap& options);
 
 boost::optional<fs::path> filter_request(const OptionMap& options);
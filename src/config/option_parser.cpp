@@ -91,11 +91,39 @@ OptionMap parse_options(const int argc, const char** argv)
     ("max-open-read-files",
      po::value<int>()->default_value(250),
      "Limits the number of read files that are open simultaneously")
+    
+    ("read-decoding-threads",
+     po::value<int>()->default_value(0),
+     "Number of extra threads shared by all open read files to decompress and decode reads, split between the two")
+    
+    ("read-manifest",
+     po::value<fs::path>(),
+     "File to cache read file headers in, so later runs with the same read files start faster")
 
     ("temp-directory-prefix",
      po::value<fs::path>()->default_value("octopus-temp"),
      "File name prefix of temporary directory for calling")
     
+    ("checkpoint",
+     po::value<fs::path>(),
+     "Directory to record completed calling windows in, so that an interrupted run can be resumed")
+    
+    ("resume",
+     po::bool_switch()->default_value(false),
+     "Resume an interrupted run from the calling windows recorded in the --checkpoint directory")
+    
+    ("shard",
+     po::value<ShardSpec>(),
+     "Only call the I'th of N contiguous shards of the search regions (I/N), which are balanced by the expected calling cost")
+    
+    ("shard-overlap",
+     po::value<int>()->default_value(2000),
+     "Number of bases either side of a shard that are also called, so that calls on shard boundaries can be resolved by --merge-shards")
+    
+    ("merge-shards",
+     po::value<std::vector<fs::path>>()->multitoken(),
+     "Merge the outputs of all shards of a --shard run into the --output file rather than calling")
+    
     ("reference,R",
      po::value<fs::path>()->required(),
      "Indexed FASTA format reference genome file to be analysed")
@@ -367,6 +395,12 @@ OptionMap parse_options(const int argc, const char** argv)
      po::bool_switch()->default_value(false),
      "Use variants from source VCF records that have been filtered")
     
+    ("index-source-candidates",
+     po::bool_switch()->default_value(false),
+     "Make a compact site index (written alongside each source candidate VCF with a '.sites' extension)"
+     " for source candidate files that do not have a current one. Indexed source candidates are extracted"
+     " without decoding the VCF, which is much faster for large files")
+    
     ("min-pileup-base-quality",
      po::value<int>()->default_value(20),
      "Only bases with quality above this value are considered for candidate generation")
@@ -1084,6 +1118,7 @@ void option_dependency(const OptionMap& vm, const std::string& given, const std:
 
 void check_reads_present(const OptionMap& vm)
 {
+    if (vm.count("merge-shards") == 1) return; // merging does not use reads
     if (vm.count("reads") == 0 && vm.count("reads-file") == 0) {
         throw MissingRequiredCommandLineArguement {std::vector<std::string> {"reads", "reads-file"}};
     }
@@ -1148,7 +1183,7 @@ po::parsed_options run(po::command_line_parser& parser)
 void validate(const OptionMap& vm)
 {
     const std::vector<std::string> positive_int_options {
-        "threads", "mask-low-quality-tails", "mask-tails", "soft-clip-mask-threshold", "mask-soft-clipped-boundary-bases",
+        "threads", "read-decoding-threads", "shard-overlap", "mask-low-quality-tails", "mask-tails", "soft-clip-mask-threshold", "mask-soft-clipped-boundary-bases",
         "min-mapping-quality", "good-base-quality", "min-good-bases", "min-read-length",
         "max-read-length", "min-base-quality", "max-variant-size",
         "num-fallback-kmers", "max-assemble-region-overlap", "assembler-mask-base-quality",
@@ -1169,6 +1204,8 @@ void validate(const OptionMap& vm)
     };
     conflicting_options(vm, "maternal-sample", "normal-sample");
     conflicting_options(vm, "paternal-sample", "normal-sample");
+    option_dependency(vm, "resume", "checkpoint");
+    conflicting_options(vm, "shard", "merge-shards");
     for (const auto& option : positive_int_options) {
         check_positive(option, vm);
     }
@@ -1611,6 +1648,27 @@ std::ostream& operator<<(std::ostream& os, const SampleDropoutConcentrationPair&
     return os;
 }
 
+std::istream& operator>>(std::istream& in, ShardSpec& shard)
+{
+    static const std::regex re {"(\\d+)/(\\d+)"};
+    std::string token;
+    in >> token;
+    std::smatch match;
+    if (std::regex_match(token, match, re)) {
+        shard.index = boost::lexical_cast<unsigned>(match.str(1));
+        shard.count = boost::lexical_cast<unsigned>(match.str(2));
+        if (shard.index > 0 && shard.index <= shard.count) return in;
+    }
+    using Error = po::validation_error;
+    throw Error {Error::kind_t::invalid_option_value, token, "shard"};
+}
+
+std::ostream& operator<<(std::ostream& os, const ShardSpec& shard)
+{
+    os << shard.index << '/' << shard.count;
+    return os;
+}
+
 namespace {
 
 template <typename T>
@@ -1737,6 +1795,8 @@ std::ostream& operator<<(std::ostream& os, const OptionMap& options)
             write_vector<SampleDropoutConcentrationPair>(options, label, os, bullet);
         } else if (is_type<ModelPosteriorPolicy>(value)) {
             os << options[label].as<ModelPosteriorPolicy>();
+        } else if (is_type<ShardSpec>(value)) {
+            os << options[label].as<ShardSpec>();
         } else {
             os << "UnknownType(" << ((boost::any)value.value()).type().name() << ")";
         }
@@ -49,6 +49,11 @@ struct SampleDropoutConcentrationPair
     float concentration;
 };
 
+struct ShardSpec
+{
+    unsigned index, count; // index is one-based
+};
+
 std::istream& operator>>(std::istream& in, ContigOutputOrder& order);
 std::ostream& operator<<(std::ostream& os, const ContigOutputOrder& order);
 std::istream& operator>>(std::istream& in, ContigPloidy& plodies);
@@ -77,6 +82,8 @@ std::istream& operator>>(std::istream& in, ModelPosteriorPolicy& policy);
 std::ostream& operator<<(std::ostream& os, const ModelPosteriorPolicy& policy);
 std::istream& operator>>(std::istream& in, SampleDropoutConcentrationPair& concentration);
 std::ostream& operator<<(std::ostream& os, const SampleDropoutConcentrationPair& concentration);
+std::istream& operator>>(std::istream& in, ShardSpec& shard);
+std::ostream& operator<<(std::ostream& os, const ShardSpec& shard);
 
 std::ostream& operator<<(std::ostream& os, const OptionMap& options);
 std::string to_string(const OptionMap& options, bool one_line = false, bool mark_modified = true);
@@ -182,9 +182,18 @@ public:
     friend void swap(MappableFlatMultiSet<M, A>& lhs, MappableFlatMultiSet<M, A>& rhs) noexcept;
     
 private:
+    using Position = typename RegionType<MappableType>::Position;
+    
     base_t elements_;
     bool is_bidirectionally_sorted_;
-    typename RegionType<MappableType>::Position max_element_size_;
+    Position max_element_size_;
+    // See update_running_max_ends. Empty if the elements are bidirectionally sorted.
+    std::vector<Position> max_ends_;
+    
+    void update_max_ends(size_type first_changed = 0);
+    template <typename MappableType_>
+    const_iterator find_first_possible_overlapped(const_iterator first, const_iterator last,
+                                                  const MappableType_& mappable) const;
 };
 
 template <typename MappableType, typename Allocator>
@@ -192,6 +201,7 @@ MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet()
 : elements_ {}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {}
+, max_ends_ {}
 {}
 
 template <typename MappableType, typename Allocator>
@@ -200,7 +210,10 @@ MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet(InputIterato
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {is_bidirectionally_sorted(elements_)}
 , max_element_size_ {elements_.empty() ? 0 : region_size(*largest_mappable(elements_))}
-{}
+, max_ends_ {}
+{
+    update_max_ends();
+}
 
 template <typename MappableType, typename Allocator>
 template <typename InputIterator>
@@ -208,7 +221,10 @@ MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet(ForwardSorte
 : elements_ {boost::container::ordered_range_t {}, first, second}
 , is_bidirectionally_sorted_ {is_bidirectionally_sorted(elements_)}
 , max_element_size_ {elements_.empty() ? 0 : region_size(*largest_mappable(elements_))}
-{}
+, max_ends_ {}
+{
+    update_max_ends();
+}
 
 template <typename MappableType, typename Allocator>
 template <typename InputIterator>
@@ -216,14 +232,20 @@ MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet(Bidirectiona
 : elements_ {boost::container::ordered_range_t {}, first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {elements_.empty() ? 0 : region_size(*largest_mappable(elements_))}
-{}
+, max_ends_ {}
+{
+    update_max_ends();
+}
 
 template <typename MappableType, typename Allocator>
 MappableFlatMultiSet<MappableType, Allocator>::MappableFlatMultiSet(std::initializer_list<MappableType> mappables)
 : elements_ {mappables}
 , is_bidirectionally_sorted_ {is_bidirectionally_sorted(elements_)}
 , max_element_size_ {elements_.empty() ? 0 : region_size(*largest_mappable(elements_))}
-{}
+, max_ends_ {}
+{
+    update_max_ends();
+}
 
 template <typename MappableType, typename Allocator>
 typename MappableFlatMultiSet<MappableType, Allocator>::iterator
@@ -384,6 +406,7 @@ MappableFlatMultiSet<MappableType, Allocator>::emplace(Args... args)
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*it));
+    update_max_ends(std::distance(std::cbegin(elements_), const_iterator {it}));
     return it;
 }
 
@@ -397,6 +420,7 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(const MappableType& m)
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*it));
+    update_max_ends(std::distance(std::cbegin(elements_), const_iterator {it}));
     return it;
 }
 
@@ -410,6 +434,7 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(MappableType&& m)
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*it));
+    update_max_ends(std::distance(std::cbegin(elements_), const_iterator {it}));
     return it;
 }
 
@@ -422,7 +447,8 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(const_iterator hint, const
         const auto overlapped = overlap_range(*it2);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(m));
+    max_element_size_ = std::max(max_element_size_, region_size(*it2));
+    update_max_ends(std::distance(std::cbegin(elements_), const_iterator {it2}));
     return it2;
 }
 
@@ -435,7 +461,8 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(const_iterator hint, Mappa
         const auto overlapped = overlap_range(*it2);
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
-    max_element_size_ = std::max(max_element_size_, region_size(m));
+    max_element_size_ = std::max(max_element_size_, region_size(*it2));
+    update_max_ends(std::distance(std::cbegin(elements_), const_iterator {it2}));
     return it2;
 }
 
@@ -450,6 +477,7 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(InputIterator first, Input
         if (is_bidirectionally_sorted_) {
             is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
         }
+        update_max_ends();
     }
 }
 
@@ -464,6 +492,7 @@ MappableFlatMultiSet<MappableType, Allocator>::insert(std::initializer_list<Mapp
     if (is_bidirectionally_sorted_ && !il.empty() ) {
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     }
+    update_max_ends();
     return result;
 }
 
@@ -473,6 +502,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const_iterator p)
 {
     if (p == cend()) return elements_.erase(p);
     const auto erased_size = region_size(*p);
+    const auto erased_idx = std::distance(std::cbegin(elements_), p);
     const auto result = elements_.erase(p);
     if (elements_.empty()) {
         max_element_size_ = 0;
@@ -482,6 +512,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const_iterator p)
             max_element_size_ = region_size(*largest_mappable(elements_));
         }
     }
+    update_max_ends(erased_idx);
     return result;
 }
 
@@ -490,6 +521,7 @@ typename MappableFlatMultiSet<MappableType, Allocator>::size_type
 MappableFlatMultiSet<MappableType, Allocator>::erase(const MappableType& m)
 {
     const auto m_size = region_size(m);
+    const auto erased_idx = std::distance(std::cbegin(elements_), const_iterator {elements_.lower_bound(m)});
     const auto result = elements_.erase(m);
     if (result > 0) {
         if (elements_.empty()) {
@@ -500,6 +532,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const MappableType& m)
                 max_element_size_ = region_size(*largest_mappable(elements_));
             }
         }
+        update_max_ends(erased_idx);
         return result;
     }
     return 0;
@@ -511,6 +544,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const_iterator first, const
 {
     if (first == last) return elements_.erase(first, last);
     const auto max_erased_size = region_size(*largest_mappable(first, last));
+    const auto erased_idx = std::distance(std::cbegin(elements_), first);
     const auto result = elements_.erase(first, last);
     if (elements_.empty()) {
         max_element_size_ = 0;
@@ -520,6 +554,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase(const_iterator first, const
             max_element_size_ = region_size(*largest_mappable(elements_));
         }
     }
+    update_max_ends(erased_idx);
     return result;
 }
 
@@ -555,6 +590,7 @@ MappableFlatMultiSet<MappableType, Allocator>::erase_all(InputIt first, InputIt
             max_element_size_ = 0;
             is_bidirectionally_sorted_ = true;
         }
+        update_max_ends();
     }
     return result;
 }
@@ -565,6 +601,7 @@ void MappableFlatMultiSet<MappableType, Allocator>::clear()
     elements_.clear();
     is_bidirectionally_sorted_ = true;
     max_element_size_ = 0;
+    max_ends_.clear();
 }
 
 template <typename MappableType, typename Allocator>
@@ -629,8 +666,7 @@ const MappableType& MappableFlatMultiSet<MappableType, Allocator>::rightmost() c
     if (is_bidirectionally_sorted_) {
         return last;
     } else {
-        using octopus::overlap_range;
-        const auto overlapped = overlap_range(cbegin(elements_), cend(elements_), last, max_element_size_);
+        const auto overlapped = overlap_range(last);
         return *rightmost_mappable(cbegin(overlapped), cend(overlapped));
     }
 }
@@ -644,7 +680,8 @@ MappableFlatMultiSet<MappableType, Allocator>::has_overlapped(const MappableType
     if (is_bidirectionally_sorted_) {
         return has_overlapped(std::begin(elements_), std::end(elements_), mappable, BidirectionallySortedTag {});
     }
-    return has_overlapped(std::begin(elements_), std::end(elements_), mappable);
+    return has_overlapped(find_first_possible_overlapped(std::cbegin(elements_), std::cend(elements_), mappable),
+                          std::cend(elements_), mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -657,7 +694,7 @@ MappableFlatMultiSet<MappableType, Allocator>::has_overlapped(const_iterator fir
     if (is_bidirectionally_sorted_) {
         return has_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return has_overlapped(first, last, mappable);
+    return has_overlapped(find_first_possible_overlapped(first, last, mappable), last, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -678,7 +715,7 @@ MappableFlatMultiSet<MappableType, Allocator>::count_overlapped(const_iterator f
     if (is_bidirectionally_sorted_) {
         return count_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return count_overlapped(first, last, mappable, max_element_size_);
+    return count_overlapped(find_first_possible_overlapped(first, last, mappable), last, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -699,7 +736,7 @@ MappableFlatMultiSet<MappableType, Allocator>::overlap_range(const_iterator firs
     if (is_bidirectionally_sorted_) {
         return overlap_range(first, last, mappable, BidirectionallySortedTag {});
     }
-    return overlap_range(first, last, mappable, max_element_size_);
+    return overlap_range(find_first_possible_overlapped(first, last, mappable), last, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -861,6 +898,28 @@ MappableFlatMultiSet<MappableType, Allocator>::shared_range(const_iterator first
     return make_shared_range(itr.base(), std::next(end).base(), mappable1, mappable2);
 }
 
+// private methods
+
+template <typename MappableType, typename Allocator>
+void MappableFlatMultiSet<MappableType, Allocator>::update_max_ends(size_type first_changed)
+{
+    if (is_bidirectionally_sorted_) {
+        max_ends_.clear();
+        return;
+    }
+    update_running_max_ends(std::cbegin(elements_), std::cend(elements_), max_ends_, first_changed);
+}
+
+template <typename MappableType, typename Allocator>
+template <typename MappableType_>
+typename MappableFlatMultiSet<MappableType, Allocator>::const_iterator
+MappableFlatMultiSet<MappableType, Allocator>::find_first_possible_overlapped(const_iterator first, const_iterator last,
+                                                                              const MappableType_& mappable) const
+{
+    const auto first_max_end = std::next(std::cbegin(max_ends_), std::distance(std::cbegin(elements_), first));
+    return octopus::find_first_possible_overlapped(first, last, first_max_end, mappable);
+}
+
 // non-member methods
 
 template <typename MappableType, typename Allocator>
@@ -885,6 +944,7 @@ void swap(MappableFlatMultiSet<MappableType, Allocator>& lhs,
     swap(lhs.elements_, rhs.elements_);
     swap(lhs.is_bidirectionally_sorted_, rhs.is_bidirectionally_sorted_);
     swap(lhs.max_element_size_, rhs.max_element_size_);
+    swap(lhs.max_ends_, rhs.max_ends_);
 }
 
 template <typename ForwardIterator, typename MappableType1, typename MappableType2, typename Allocator>
@@ -163,9 +163,18 @@ public:
     friend void swap(MappableFlatSet<M, A>& lhs, MappableFlatSet<M, A>& rhs) noexcept;
     
 private:
+    using Position = typename RegionType<MappableType>::Position;
+    
     base_t elements_;
     bool is_bidirectionally_sorted_;
-    typename RegionType<MappableType>::Position max_element_size_;
+    Position max_element_size_;
+    // See update_running_max_ends. Empty if the elements are bidirectionally sorted.
+    std::vector<Position> max_ends_;
+    
+    void update_max_ends(size_type first_changed = 0);
+    template <typename MappableType_>
+    const_iterator find_first_possible_overlapped(const_iterator first, const_iterator last,
+                                                  const MappableType_& mappable) const;
 };
 
 template <typename MappableType, typename Allocator>
@@ -173,6 +182,7 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet()
 : elements_ {}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
+, max_ends_ {}
 {}
 
 template <typename MappableType, typename Allocator>
@@ -181,12 +191,14 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(InputIterator first, I
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
+, max_ends_ {}
 {
     if (elements_.empty()) return;
     std::sort(std::begin(elements_), std::end(elements_));
     elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
     is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     max_element_size_ = region_size(*largest_mappable(elements_));
+    update_max_ends();
 }
 
 template <typename MappableType, typename Allocator>
@@ -195,11 +207,13 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(ForwardSortedTag, Inpu
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
+, max_ends_ {}
 {
     if (elements_.empty()) return;
     elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
     is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     max_element_size_ = region_size(*largest_mappable(elements_));
+    update_max_ends();
 }
 
 template <typename MappableType, typename Allocator>
@@ -208,6 +222,7 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(BidirectionallySortedT
 : elements_ {first, second}
 , is_bidirectionally_sorted_ {true}
 , max_element_size_ {0}
+, max_ends_ {}
 {
     if (elements_.empty()) return;
     elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
@@ -219,13 +234,15 @@ MappableFlatSet<MappableType, Allocator>::MappableFlatSet(std::initializer_list<
 :
 elements_ {mappables},
 is_bidirectionally_sorted_ {true},
-max_element_size_ {0}
+max_element_size_ {0},
+max_ends_ {}
 {
     if (elements_.empty()) return;
     std::sort(std::begin(elements_), std::end(elements_));
     elements_.erase(std::unique(std::begin(elements_), std::end(elements_)), std::end(elements_));
     is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     max_element_size_ = region_size(*largest_mappable(elements_));
+    update_max_ends();
 }
 
 template <typename MappableType, typename Allocator>
@@ -395,6 +412,7 @@ MappableFlatSet<MappableType, Allocator>::emplace(Args... args)
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*it));
+    update_max_ends(std::distance(std::begin(elements_), it));
     return std::make_pair(it, true);
 }
 
@@ -413,6 +431,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const MappableType& m)
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*it));
+    update_max_ends(std::distance(std::begin(elements_), it));
     return std::make_pair(it, true);
 }
 
@@ -431,6 +450,7 @@ MappableFlatSet<MappableType, Allocator>::insert(MappableType&& m)
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*it));
+    update_max_ends(std::distance(std::begin(elements_), it));
     return std::make_pair(it, true);
 }
 
@@ -484,6 +504,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, const Mapp
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(m));
+    update_max_ends(std::distance(std::begin(elements_), result));
     return result;
 }
 
@@ -536,6 +557,7 @@ MappableFlatSet<MappableType, Allocator>::insert(const_iterator hint, MappableTy
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(overlapped);
     }
     max_element_size_ = std::max(max_element_size_, region_size(*result));
+    update_max_ends(std::distance(std::begin(elements_), result));
     return result;
 }
 
@@ -560,6 +582,7 @@ void MappableFlatSet<MappableType, Allocator>::insert(InputIterator first, Input
     if (is_bidirectionally_sorted_) {
         is_bidirectionally_sorted_ = is_bidirectionally_sorted(elements_);
     }
+    update_max_ends();
 }
 
 template <typename MappableType, typename Allocator>
@@ -575,6 +598,7 @@ MappableFlatSet<MappableType, Allocator>::erase(const_iterator p)
 {
     if (p == cend()) return elements_.erase(p);
     const auto erased_size = region_size(*p);
+    const auto erased_idx = std::distance(std::cbegin(elements_), p);
     const auto result = elements_.erase(p);
     if (elements_.empty()) {
         max_element_size_ = 0;
@@ -584,6 +608,7 @@ MappableFlatSet<MappableType, Allocator>::erase(const_iterator p)
             max_element_size_ = region_size(*largest_mappable(elements_));
         }
     }
+    update_max_ends(erased_idx);
     return result;
 }
 
@@ -594,6 +619,7 @@ MappableFlatSet<MappableType, Allocator>::erase(const MappableType& m)
     const auto it = std::lower_bound(std::cbegin(elements_), std::cend(elements_), m);
     if (it != std::cend(elements_) && *it == m) {
         const auto m_size = region_size(m);
+        const auto erased_idx = std::distance(std::cbegin(elements_), it);
         elements_.erase(it);
         if (elements_.empty()) {
             max_element_size_ = 0;
@@ -603,6 +629,7 @@ MappableFlatSet<MappableType, Allocator>::erase(const MappableType& m)
                 max_element_size_ = region_size(*largest_mappable(elements_));
             }
         }
+        update_max_ends(erased_idx);
         return 1;
     }
     return 0;
@@ -614,6 +641,7 @@ MappableFlatSet<MappableType, Allocator>::erase(const_iterator first, const_iter
 {
     if (first == last) return elements_.erase(first, last);
     const auto max_erased_size = region_size(*largest_mappable(first, last));
+    const auto erased_idx = std::distance(std::cbegin(elements_), first);
     const auto result = elements_.erase(first, last);
     if (elements_.empty()) {
         max_element_size_ = 0;
@@ -623,6 +651,7 @@ MappableFlatSet<MappableType, Allocator>::erase(const_iterator first, const_iter
             max_element_size_ = region_size(*largest_mappable(elements_));
         }
     }
+    update_max_ends(erased_idx);
     return result;
 }
 
@@ -685,6 +714,7 @@ MappableFlatSet<MappableType, Allocator>::erase_all(BidirIt first, const BidirIt
             max_element_size_ = 0;
             is_bidirectionally_sorted_ = true;
         }
+        update_max_ends();
     }
     
     return num_erased;
@@ -696,6 +726,7 @@ void MappableFlatSet<MappableType, Allocator>::clear()
     elements_.clear();
     is_bidirectionally_sorted_ = true;
     max_element_size_ = 0;
+    max_ends_.clear();
 }
 
 template <typename MappableType, typename Allocator>
@@ -763,9 +794,7 @@ const MappableType& MappableFlatSet<MappableType, Allocator>::rightmost() const
     if (is_bidirectionally_sorted_) {
         return last;
     } else {
-        using octopus::overlap_range;
-        const auto overlapped = overlap_range(std::cbegin(elements_), std::cend(elements_), last,
-                                              max_element_size_);
+        const auto overlapped = overlap_range(last);
         return *rightmost_mappable(std::cbegin(overlapped), std::cend(overlapped));
     }
 }
@@ -779,7 +808,8 @@ MappableFlatSet<MappableType, Allocator>::has_overlapped(const MappableType_& ma
     if (is_bidirectionally_sorted_) {
         return has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable, BidirectionallySortedTag {});
     }
-    return has_overlapped(std::cbegin(elements_), std::cend(elements_), mappable);
+    return has_overlapped(find_first_possible_overlapped(std::cbegin(elements_), std::cend(elements_), mappable),
+                          std::cend(elements_), mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -792,7 +822,7 @@ MappableFlatSet<MappableType, Allocator>::has_overlapped(const_iterator first, c
     if (is_bidirectionally_sorted_) {
         return has_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return has_overlapped(first, last, mappable, max_element_size_);
+    return has_overlapped(find_first_possible_overlapped(first, last, mappable), last, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -813,7 +843,7 @@ MappableFlatSet<MappableType, Allocator>::count_overlapped(const_iterator first,
     if (is_bidirectionally_sorted_) {
         return count_overlapped(first, last, mappable, BidirectionallySortedTag {});
     }
-    return count_overlapped(first, last, mappable, max_element_size_);
+    return count_overlapped(find_first_possible_overlapped(first, last, mappable), last, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -834,7 +864,7 @@ MappableFlatSet<MappableType, Allocator>::overlap_range(const_iterator first, co
     if (is_bidirectionally_sorted_) {
         return overlap_range(first, last, mappable, BidirectionallySortedTag {});
     }
-    return overlap_range(first, last, mappable, max_element_size_);
+    return overlap_range(find_first_possible_overlapped(first, last, mappable), last, mappable);
 }
 
 template <typename MappableType, typename Allocator>
@@ -926,6 +956,28 @@ void MappableFlatSet<MappableType, Allocator>::erase_contained(const MappableTyp
     }
 }
 
+// private methods
+
+template <typename MappableType, typename Allocator>
+void MappableFlatSet<MappableType, Allocator>::update_max_ends(size_type first_changed)
+{
+    if (is_bidirectionally_sorted_) {
+        max_ends_.clear();
+        return;
+    }
+    update_running_max_ends(std::cbegin(elements_), std::cend(elements_), max_ends_, first_changed);
+}
+
+template <typename MappableType, typename Allocator>
+template <typename MappableType_>
+typename MappableFlatSet<MappableType, Allocator>::const_iterator
+MappableFlatSet<MappableType, Allocator>::find_first_possible_overlapped(const_iterator first, const_iterator last,
+                                                                         const MappableType_& mappable) const
+{
+    const auto first_max_end = std::next(std::cbegin(max_ends_), std::distance(std::cbegin(elements_), first));
+    return octopus::find_first_possible_overlapped(first, last, first_max_end, mappable);
+}
+
 // non-member methods
 
 template <typename MappableType, typename Allocator>
@@ -950,6 +1002,7 @@ void swap(MappableFlatSet<MappableType, Allocator>& lhs,
     swap(lhs.elements_, rhs.elements_);
     swap(lhs.is_bidirectionally_sorted_, rhs.is_bidirectionally_sorted_);
     swap(lhs.max_element_size_, rhs.max_element_size_);
+    swap(lhs.max_ends_, rhs.max_ends_);
 }
 
 } // namespace octopus
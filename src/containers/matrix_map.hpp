@@ -13,7 +13,21 @@
 #include <type_traits>
 #include <algorithm>
 #include <memory>
+#include <stdexcept>
+#include <cassert>
 
+/*
+ A dense two dimensional map. Key1s and Key2s are both assigned indices in insertion order, and the values
+ are stored row major (one row per Key1) in a single contiguous array. Values can therefore be accessed
+ either by key, which hashes the keys, or directly by index.
+ 
+ Iteration (over Key1s, and over the Key2s of each row) is in index order, which is insertion order unless
+ keys are erased: erasing a key moves the last key of the same dimension into its index, so indices other
+ than that of the last key are stable.
+ 
+ Rows are padded to a capacity that grows geometrically as Key2s are inserted with values, so filling a map
+ column by column takes amortised linear time. The value type must be default constructible for padding.
+ */
 template <typename Key1,
           typename Key2,
           typename T,
@@ -42,8 +56,9 @@ template <typename Key1,
         }
     };
     
-    using ValueMap = std::unordered_map<Key1, ValueContainerType, Hash1, KeyEqual1>;
-    using IndexSizeType = typename ValueMap::mapped_type::size_type;
+    using Key1ContainerType = std::vector<Key1>;
+    using IndexSizeType = typename ValueContainerType::size_type;
+    using Key1IndiceMap = std::unordered_map<Key1, IndexSizeType, Hash1, KeyEqual1>;
     using IndiceMap = std::unordered_map<std::reference_wrapper<const Key2>, IndexSizeType, Key2RefHash, Key2RefEqual>;
     
     using Key2Iterator  = typename Key2ContainerType::const_iterator;
@@ -58,14 +73,17 @@ public:
     MatrixMap()  = default;
     
     template <typename InputIt>
-    MatrixMap(InputIt first, InputIt last) : key2s_ {first, last}
+    MatrixMap(InputIt first, InputIt last) : key2s_ {first, last}, stride_ {key2s_.size()}
     {
         this->generate_indice_map();
     }
     
     MatrixMap(const MatrixMap& other)
-    : key2s_ {other.key2s_}
+    : key1s_ {other.key1s_}
+    , key1_indices_ {other.key1_indices_}
+    , key2s_ {other.key2s_}
     , values_ {other.values_}
+    , stride_ {other.stride_}
     {
         this->generate_indice_map();
     }
@@ -76,8 +94,11 @@ public:
             return *this;
         }
         
+        key1s_  = other.key1s_;
+        key1_indices_ = other.key1_indices_;
         key2s_  = other.key2s_;
         values_ = other.values_;
+        stride_ = other.stride_;
         
         this->regenerate_indice_map();
         
@@ -85,8 +106,11 @@ public:
     }
     
     MatrixMap(MatrixMap&& other)
-    : key2s_ {std::move(other.key2s_)}
+    : key1s_ {std::move(other.key1s_)}
+    , key1_indices_ {std::move(other.key1_indices_)}
+    , key2s_ {std::move(other.key2s_)}
     , values_ {std::move(other.values_)}
+    , stride_ {other.stride_}
     {
         this->generate_indice_map();
     }
@@ -97,8 +121,11 @@ public:
             return *this;
         }
         
+        key1s_  = std::move(other.key1s_);
+        key1_indices_ = std::move(other.key1_indices_);
         key2s_  = std::move(other.key2s_);
         values_ = std::move(other.values_);
+        stride_ = other.stride_;
         
         this->regenerate_indice_map();
         
@@ -109,18 +136,17 @@ public:
     
     T& operator()(const Key1& key1, const Key2& key2)
     {
-        return values_.at(key1)[key2_indices_.at(key2)];
+        return value(index1(key1), index2(key2));
     }
     
     const T& operator()(const Key1& key1, const Key2& key2) const
     {
-        return values_.at(key1)[key2_indices_.at(key2)];
+        return value(index1(key1), index2(key2));
     }
     
     InnerSlice operator()(const Key1& key) const
     {
-        const auto& key_values = values_.at(key);
-        return InnerSlice {std::cbegin(key_values), std::cend(key_values)};
+        return row(index1(key));
     }
     
     InnerMap operator[](const Key1& key) const
@@ -128,9 +154,47 @@ public:
         return InnerMap {this->begin(key), this->end(key), key2_indices_};
     }
     
+    // The stable indices of keys, which can be used to access values without hashing keys
+    
+    size_type index1(const Key1& key) const
+    {
+        return key1_indices_.at(key);
+    }
+    
+    size_type index2(const Key2& key) const
+    {
+        return key2_indices_.at(key);
+    }
+    
+    const Key1& key1(size_type i) const noexcept
+    {
+        return key1s_[i];
+    }
+    
+    const Key2& key2(size_type j) const noexcept
+    {
+        return key2s_[j];
+    }
+    
+    T& value(size_type i, size_type j) noexcept
+    {
+        return values_[i * stride_ + j];
+    }
+    
+    const T& value(size_type i, size_type j) const noexcept
+    {
+        return values_[i * stride_ + j];
+    }
+    
+    InnerSlice row(size_type i) const noexcept
+    {
+        const auto row_begin = std::next(std::cbegin(values_), i * stride_);
+        return InnerSlice {row_begin, std::next(row_begin, size2())};
+    }
+    
     bool empty1() const noexcept
     {
-        return values_.empty();
+        return key1s_.empty();
     }
     
     bool empty2() const noexcept
@@ -140,7 +204,7 @@ public:
     
     size_type size1() const noexcept
     {
-        return values_.size();
+        return key1s_.size();
     }
     
     size_type size2() const noexcept
@@ -150,26 +214,35 @@ public:
     
     void reserve1(size_type n)
     {
-        values_.reserve(n);
+        key1s_.reserve(n);
+        key1_indices_.reserve(n);
+        values_.reserve(n * stride_);
     }
     
     void reserve2(size_type n)
     {
-        key2s_.reserve(n);
+        if (key2s_.capacity() < n) {
+            key2s_.reserve(n);
+            this->regenerate_indice_map(); // the indice map keys reference key2s_
+        }
         key2_indices_.reserve(n);
+        if (n > stride_) this->restride(n);
     }
     
     void reserve(size_type n1, size_type n2)
     {
-        reserve1(n1);
         reserve2(n2);
+        reserve1(n1);
     }
     
     void clear() noexcept
     {
+        key1s_.clear();
+        key1_indices_.clear();
         key2s_.clear();
         values_.clear();
         key2_indices_.clear();
+        stride_ = 0;
     }
     
     template <typename InputIt>
@@ -177,33 +250,30 @@ public:
     {
         key2s_.assign(first, last);
         this->regenerate_indice_map();
-        if (!values_.empty()) {
-            values_.clear();
-            return true;
-        }
-        return false;;
+        const auto result = !key1s_.empty();
+        clear_values();
+        stride_ = size2();
+        return result;
     }
     
     template <typename K>
     bool push_back(K&& key)
     {
         this->push_back_reallocate(std::forward<K>(key));
-        if (!values_.empty()) {
-            values_.clear();
-            return true;
-        }
-        return false;
+        const auto result = !key1s_.empty();
+        clear_values();
+        update_stride();
+        return result;
     }
     
     template <typename... Args>
     bool emplace_back(Args&&... args)
     {
         this->emplace_back_reallocate(std::forward<Args>(args)...);
-        if (!values_.empty()) {
-            values_.clear();
-            return true;
-        }
-        return false;
+        const auto result = !key1s_.empty();
+        clear_values();
+        update_stride();
+        return result;
     }
     
     template <typename K, typename InputIt>
@@ -214,24 +284,29 @@ public:
                 " length to Key2 range in this MatrixMap"};
         }
         
-        return values_.emplace(std::piecewise_construct,
-                               std::forward_as_tuple<K>(std::forward<K>(key)),
-                               std::make_tuple(first, last)).second;
+        if (key1_indices_.count(key) != 0) {
+            return false;
+        }
+        key1_indices_.emplace(key, key1s_.size());
+        key1s_.push_back(std::forward<K>(key));
+        values_.insert(std::end(values_), first, last);
+        values_.resize(values_.size() + stride_ - size2());
+        return true;
     }
     
     template <typename K, typename InputIt>
     bool insert_or_assign_at(K&& key, InputIt first, InputIt last)
     {
-        if (values_.count(key) == 0) {
+        if (key1_indices_.count(key) == 0) {
             return insert_at(std::forward<K>(key), first, last);
         }
         
-        if (std::distance(first, last) != this->size2()) {
+        if (static_cast<std::size_t>(std::distance(first, last)) != this->size2()) {
             throw std::out_of_range {"MatrixMap::insert_at called with value range of different"
                 " length to Key2 range in this MatrixMap"};
         }
         
-        values_[std::forward<K>(key)].assign(first, last);
+        std::copy(first, last, std::next(std::begin(values_), index1(key) * stride_));
         
         return false;
     }
@@ -249,9 +324,7 @@ public:
         //            return false;
         //        }
         
-        for (auto& p : values_) {
-            p.second.push_back(*first++);
-        }
+        this->insert_column(first);
         
         this->push_back_reallocate(std::forward<K>(key));
         
@@ -261,22 +334,19 @@ public:
     template <typename K, typename InputIt>
     bool insert_or_assign_each(K&& key, InputIt first, InputIt last)
     {
-        if (std::distance(first, last) != this->size1()) {
+        if (static_cast<std::size_t>(std::distance(first, last)) != this->size1()) {
             throw std::out_of_range {"MatrixMap::insert_each called with value range of different"
                 " length to Key1 range in this MatrixMap"};
         }
         if (key2_indices_.count(key) == 0) {
-            for (auto& p : values_) {
-                p.second.push_back(*first++);
-            }
+            this->insert_column(first);
             this->push_back_reallocate(std::forward<K>(key));
             return true;
         }
         const auto index = key2_indices_[key];
-        for (auto& p : values_) {
-            p.second[index] = *first++;
+        for (size_type i {0}; i < size1(); ++i) {
+            value(i, index) = *first++;
         }
-        this->push_back_reallocate(std::forward<K>(key));
         return false;
     }
     
@@ -285,30 +355,52 @@ public:
         if (key2s_.empty()) {
             return;
         }
+        // The last column just becomes row padding
         key2_indices_.erase(key2s_.back());
         key2s_.pop_back();
-        for (auto& p : values_) {
-            p.second.pop_back();
-        }
     }
     
+    // Moves the last Key1 into the index of the erased key
     bool erase1(const Key1& key)
     {
-        return values_.erase(key) == 1;
+        const auto itr = key1_indices_.find(key);
+        if (itr == std::cend(key1_indices_)) {
+            return false;
+        }
+        const auto key_index = itr->second;
+        const auto last_index = size1() - 1;
+        key1_indices_.erase(itr);
+        if (key_index != last_index) {
+            const auto last_row_begin = std::next(std::begin(values_), last_index * stride_);
+            std::move(last_row_begin, std::next(last_row_begin, size2()), std::next(std::begin(values_), key_index * stride_));
+            key1_indices_[key1s_.back()] = key_index;
+            key1s_[key_index] = std::move(key1s_.back());
+        }
+        key1s_.pop_back();
+        values_.erase(std::next(std::begin(values_), last_index * stride_), std::end(values_));
+        return true;
     }
     
+    // Moves the last Key2 into the index of the erased key
     bool erase2(const Key2& key)
     {
-        if (key2_indices_.count(key) == 0) {
+        const auto itr = key2_indices_.find(key);
+        if (itr == std::cend(key2_indices_)) {
             return false;
         }
-        const auto key_index = key2_indices_[key];
-        for (auto& p : values_) {
-            p.second.erase(std::next(std::begin(p.second), key_index));
+        const auto key_index = itr->second;
+        const auto last_index = size2() - 1;
+        // The indice map keys reference key2s_, so must be removed before the keys are moved
+        key2_indices_.erase(itr);
+        if (key_index != last_index) {
+            key2_indices_.erase(key2s_.back());
+            for (size_type i {0}; i < size1(); ++i) {
+                value(i, key_index) = std::move(value(i, last_index));
+            }
+            key2s_[key_index] = std::move(key2s_.back());
+            key2_indices_.emplace(key2s_[key_index], key_index);
         }
-        const auto it = key2s_.erase(std::next(std::begin(key2s_), key_index));
-        key2_indices_.erase(key);
-        std::for_each(it, std::end(key2s_), [this] (const auto& key) { --key2_indices_[key]; });
+        key2s_.pop_back();
         return true;
     }
     
@@ -338,10 +430,55 @@ public:
     }
     
 private:
+    Key1ContainerType key1s_;
+    Key1IndiceMap key1_indices_;
     Key2ContainerType key2s_;
-    ValueMap values_;
+    ValueContainerType values_;
+    IndexSizeType stride_ = 0; // the allocated length of each row, at least size2()
     IndiceMap key2_indices_;
     
+    void clear_values() noexcept
+    {
+        key1s_.clear();
+        key1_indices_.clear();
+        values_.clear();
+    }
+    
+    // Moves the values into rows of the given length
+    void restride(const IndexSizeType stride)
+    {
+        assert(stride >= size2());
+        if (!key1s_.empty()) {
+            ValueContainerType values {};
+            values.reserve(size1() * stride);
+            for (size_type i {0}; i < size1(); ++i) {
+                const auto row_begin = std::next(std::begin(values_), i * stride_);
+                values.insert(std::end(values), std::make_move_iterator(row_begin),
+                              std::make_move_iterator(std::next(row_begin, size2())));
+                values.resize(values.size() + stride - size2());
+            }
+            values_ = std::move(values);
+        }
+        stride_ = stride;
+    }
+    
+    // Must be called before the new Key2 is added
+    template <typename InputIt>
+    void insert_column(InputIt first)
+    {
+        const auto index = size2();
+        if (index == stride_) this->restride(std::max(2 * stride_, IndexSizeType {1}));
+        for (size_type i {0}; i < size1(); ++i, ++first) {
+            value(i, index) = *first;
+        }
+    }
+    
+    // Keys added without values clear the values, so rows can be re-strided for free
+    void update_stride() noexcept
+    {
+        if (key1s_.empty()) stride_ = std::max(stride_, size2());
+    }
+    
     void generate_indice_map()
     {
         key2_indices_.reserve(key2s_.size());
@@ -452,12 +589,14 @@ public:
     
     ZipIterator begin(const Key1& key) const
     {
-        return ZipIterator {std::begin(key2s_), std::begin(values_.at(key))};
+        const auto row = this->row(index1(key));
+        return ZipIterator {std::begin(key2s_), row.begin()};
     }
     
     ZipIterator end(const Key1& key) const
     {
-        return ZipIterator {std::end(key2s_), std::end(values_.at(key))};
+        const auto row = this->row(index1(key));
+        return ZipIterator {std::end(key2s_), row.end()};
     }
     
     ZipIterator cbegin(const Key1& key) const
@@ -470,9 +609,6 @@ public:
         return end(key);
     }
     
-private:
-    using ValueMapIterator = typename ValueMap::const_iterator;
-    
 public:
     class InnerMap
     {
@@ -512,6 +648,12 @@ public:
             return *std::next(begin_.value_itr_, key2_indices_.get().at(key));
         }
         
+        // The value of the Key2 with the given index
+        const T& value(IndexSizeType index) const
+        {
+            return *std::next(begin_.value_itr_, index);
+        }
+        
     private:
         ZipIterator begin_, end_;
         std::reference_wrapper<const IndiceMap> key2_indices_;
@@ -528,38 +670,32 @@ public:
         
         Iterator() = delete;
         
-        explicit Iterator(ValueMapIterator map_itr, Key2Iterator key2_begin_itr,
-                          const IndiceMap& key2_indices)
-        : map_itr_ {map_itr}
-        , key2_begin_itr_ {key2_begin_itr}
-        , key2_indices_ {key2_indices}
+        explicit Iterator(const MatrixMap& map, IndexSizeType index)
+        : map_ {map}
+        , index_ {index}
         {}
         
         ~Iterator() = default;
         
         Iterator& operator++()
         {
-            map_itr_++;
+            ++index_;
             return *this;
         }
         
         value_type operator*() const
         {
-            ZipIterator zip1 {key2_begin_itr_, std::begin(map_itr_->second)};
-            ZipIterator zip2 {std::next(key2_begin_itr_, key2_indices_.get().size()), std::end(map_itr_->second)};
-            return std::make_pair(std::ref(map_itr_->first), InnerMap {std::move(zip1), std::move(zip2), key2_indices_});
+            return std::make_pair(std::cref(map_.get().key1(index_)), inner_map());
         }
         
         auto operator->() const
         {
-            ZipIterator zip1 {key2_begin_itr_, std::begin(map_itr_->second)};
-            ZipIterator zip2 {std::next(key2_begin_itr_, key2_indices_.get().size()), std::end(map_itr_->second)};
-            return std::make_unique<value_type>(map_itr_->first, InnerMap {std::move(zip1), std::move(zip2), key2_indices_});
+            return std::make_unique<value_type>(map_.get().key1(index_), inner_map());
         }
         
         friend bool operator==(const Iterator& lhs, const Iterator& rhs)
         {
-            return lhs.map_itr_ == rhs.map_itr_;
+            return lhs.index_ == rhs.index_;
         }
         
         friend bool operator!=(const Iterator& lhs, const Iterator& rhs)
@@ -568,13 +704,21 @@ public:
         }
         
     private:
-        ValueMapIterator map_itr_;
-        Key2Iterator key2_begin_itr_;
-        std::reference_wrapper<const IndiceMap> key2_indices_;
+        std::reference_wrapper<const MatrixMap> map_;
+        IndexSizeType index_;
+        
+        InnerMap inner_map() const
+        {
+            const auto& map = map_.get();
+            const auto row = map.row(index_);
+            return InnerMap {ZipIterator {std::cbegin(map.key2s_), row.begin()},
+                             ZipIterator {std::cend(map.key2s_), row.end()},
+                             map.key2_indices_};
+        }
     };
     
-    Iterator begin() const { return Iterator {std::cbegin(values_), std::begin(key2s_), key2_indices_}; }
-    Iterator end() const { return Iterator {std::cend(values_), std::begin(key2s_), key2_indices_}; }
+    Iterator begin() const { return Iterator {*this, 0}; }
+    Iterator end() const { return Iterator {*this, size1()}; }
     Iterator cbegin() const { return begin(); }
     Iterator cend() const { return end(); }
 };
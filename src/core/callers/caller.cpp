@@ -11,6 +11,7 @@
 #include <cassert>
 #include <iostream>
 #include <limits>
+#include <numeric>
 
 #include "concepts/mappable.hpp"
 #include "basics/aligned_template.hpp"
@@ -143,14 +144,25 @@ auto convert_to_vcf(std::deque<CallWrapper>&& calls, const VcfRecordFactory& fac
     return result;
 }
 
+MemoryFootprint calculate_footprint(const ReadMap& reads) noexcept
+{
+    return std::accumulate(std::cbegin(reads), std::cend(reads), MemoryFootprint {0},
+                           [] (auto curr, const auto& p) noexcept { return curr + octopus::footprint(p.second); });
+}
+
 } // namespace
 
 std::deque<VcfRecord> Caller::call(const GenomicRegion& call_region, ProgressMeter& progress_meter) const
 {
     ReadPipe::Report reads_report {};
     ReadMap reads;
+    // Holding off here defers the rest of the task until other tasks release enough working memory
+    boost::optional<MemoryGovernor::Reservation> reads_reservation {};
     if (candidate_generator_.requires_reads()) {
-        reads = read_pipe_.get().fetch_reads(expand(call_region, 100), reads_report);
+        const auto fetch_region = expand(call_region, 100);
+        reads_reservation = reserve_read_memory(fetch_region);
+        reads = read_pipe_.get().fetch_reads(fetch_region, reads_report);
+        update_read_memory(reads_reservation, reads);
         add_reads(reads, candidate_generator_);
         if (!refcalls_requested() && all_empty(reads)) {
             if (debug_log_) stream(*debug_log_) << "Stopping early as no reads found in call region " << call_region;
@@ -167,7 +179,9 @@ std::deque<VcfRecord> Caller::call(const GenomicRegion& call_region, ProgressMet
     }
     if (!candidate_generator_.requires_reads()) {
         // as we didn't fetch them earlier
+        reads_reservation = reserve_read_memory(call_region);
         reads = read_pipe_.get().fetch_reads(call_region, reads_report);
+        update_read_memory(reads_reservation, reads);
     }
     std::vector<GenomicRegion> likely_difficult_regions {};
     if (bad_region_detector_ && has_coverage(reads)) {
@@ -363,6 +377,13 @@ TemplateMap copy_overlapped(const TemplateMap& templates, const GenomicRegion& r
     return result;
 }
 
+MemoryFootprint calculate_footprint(const MappableBlock<Haplotype>& haplotypes) noexcept
+{
+    return std::accumulate(std::cbegin(haplotypes), std::cend(haplotypes), MemoryFootprint {0},
+                           [] (auto curr, const Haplotype& haplotype) noexcept {
+                               return curr + MemoryFootprint {sizeof(Haplotype) + sequence_size(haplotype)}; });
+}
+
 bool has_coverage(const boost::variant<ReadMap, TemplateMap>& reads)
 {
     return boost::apply_visitor([] (const auto& reads) { return octopus::has_coverage(reads); }, reads);
@@ -456,7 +477,11 @@ Caller::call_variants(const GenomicRegion& call_region,
             if (debug_log_) stream(*debug_log_) << "Skipping active region " << active_region << " as there are no active reads";
             continue;
         }
-        if (debug_log_) stream(*debug_log_) << "There are " << count_reads(active_reads) << " active reads in " << active_region;
+        const auto num_active_reads = count_reads(active_reads);
+        if (debug_log_) stream(*debug_log_) << "There are " << num_active_reads << " active reads in " << active_region;
+        const auto haplotype_reservation = reserve_memory(MemoryGovernor::Stage::haplotypes, calculate_footprint(haplotypes));
+        const auto likelihood_reservation = reserve_memory(MemoryGovernor::Stage::likelihoods,
+                                                           estimate_likelihood_footprint(haplotypes.size(), num_active_reads));
         if (!compute_haplotype_likelihoods(haplotype_likelihoods, active_region, haplotypes, candidates, active_reads)) {
             haplotype_generator.clear_progress();
             haplotype_likelihoods.clear();
@@ -474,8 +499,12 @@ Caller::call_variants(const GenomicRegion& call_region,
                 insert_sorted(*reference_haplotype_itr, protected_haplotypes);
             }
         }
-        auto has_removal_impact = filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods, protected_haplotypes);
+        const auto max_haplotypes = calculate_max_haplotypes(num_active_reads);
+        auto has_removal_impact = filter_haplotypes(haplotypes, haplotype_generator, haplotype_likelihoods,
+                                                    protected_haplotypes, max_haplotypes);
         if (haplotypes.empty()) continue;
+        const auto genotype_reservation = reserve_memory(MemoryGovernor::Stage::genotypes,
+                                                         estimate_genotype_footprint(haplotypes.size()));
         const auto caller_latents = infer_latents(haplotypes, haplotype_likelihoods);
         if (trace_log_) {
             debug::print_haplotype_posteriors(stream(*trace_log_), *caller_latents->haplotype_posteriors());
@@ -527,6 +556,15 @@ boost::optional<MemoryFootprint> Caller::target_max_memory() const noexcept
     return parameters_.target_max_memory;
 }
 
+boost::optional<ThreadPool&> Caller::workers() const noexcept
+{
+    if (parameters_.workers) {
+        return *parameters_.workers;
+    } else {
+        return boost::none;
+    }
+}
+
 ExecutionPolicy Caller::exucution_policy() const noexcept
 {
     return parameters_.execution_policy;
@@ -595,13 +633,97 @@ void Caller::remove_duplicates(HaplotypeBlock& haplotypes) const
     }
 }
 
+boost::optional<MemoryGovernor::Reservation>
+Caller::reserve_memory(const MemoryGovernor::Stage stage, const MemoryFootprint footprint) const
+{
+    // Memory for these stages is needed to make progress, so is accounted even if over budget
+    boost::optional<MemoryGovernor::Reservation> result {};
+    if (parameters_.memory_governor) {
+        result = parameters_.memory_governor->force_reserve(stage, footprint);
+    }
+    return result;
+}
+
+boost::optional<MemoryGovernor::Reservation> Caller::reserve_read_memory(const GenomicRegion& region) const
+{
+    // Reads are reserved before they are fetched so a task is deferred before it allocates them
+    boost::optional<MemoryGovernor::Reservation> result {};
+    if (parameters_.memory_governor && parameters_.read_footprint_per_base) {
+        const auto estimate = static_cast<std::size_t>(size(region) * *parameters_.read_footprint_per_base);
+        result = parameters_.memory_governor->reserve(MemoryGovernor::Stage::reads, estimate);
+    }
+    return result;
+}
+
+void Caller::update_read_memory(boost::optional<MemoryGovernor::Reservation>& reservation, const ReadMap& reads) const
+{
+    if (!parameters_.memory_governor) return;
+    const auto footprint = calculate_footprint(reads);
+    if (reservation) {
+        // Replace the estimate with the real footprint, which is already allocated
+        reservation->release();
+        reservation = parameters_.memory_governor->force_reserve(MemoryGovernor::Stage::reads, footprint);
+    } else {
+        // Without an estimate the task can only be deferred once its reads are fetched
+        reservation = parameters_.memory_governor->reserve(MemoryGovernor::Stage::reads, footprint);
+    }
+}
+
+MemoryFootprint Caller::estimate_likelihood_footprint(const std::size_t num_haplotypes, const std::size_t num_reads) const noexcept
+{
+    return num_haplotypes * num_reads * sizeof(HaplotypeLikelihoodArray::LogProbability);
+}
+
+MemoryFootprint Caller::estimate_genotype_footprint(const std::size_t num_haplotypes) const noexcept
+{
+    const auto ploidy = max_callable_ploidy();
+    const auto num_genotypes = num_genotypes_noexcept(num_haplotypes, ploidy);
+    const auto genotype_bytes = sizeof(Genotype<IndexedHaplotype<>>) + ploidy * sizeof(IndexedHaplotype<>)
+                                + samples_.size() * sizeof(double);
+    if (!num_genotypes || *num_genotypes > std::numeric_limits<std::size_t>::max() / genotype_bytes) {
+        return std::numeric_limits<std::size_t>::max();
+    }
+    return *num_genotypes * genotype_bytes;
+}
+
+unsigned Caller::calculate_max_haplotypes(const std::size_t num_reads) const
+{
+    // The cap only depends on this task's share of the configured budget, not on the current usage of
+    // other tasks, so calls are reproducible for any thread scheduling
+    if (!parameters_.target_max_memory) return parameters_.max_haplotypes;
+    const auto budget = *parameters_.target_max_memory;
+    const auto fits = [&] (const unsigned num_haplotypes) {
+        const auto genotype_footprint = estimate_genotype_footprint(num_haplotypes);
+        return genotype_footprint <= budget
+               && estimate_likelihood_footprint(num_haplotypes, num_reads) <= budget - genotype_footprint;
+    };
+    if (fits(parameters_.max_haplotypes)) return parameters_.max_haplotypes;
+    // Keep enough haplotypes to represent a few distinct genotypes
+    const auto min_haplotypes = std::min(parameters_.max_haplotypes, 2 * max_callable_ploidy());
+    auto result = min_haplotypes;
+    for (auto hi = parameters_.max_haplotypes; result < hi;) {
+        const auto mid = result + (hi - result + 1) / 2;
+        if (fits(mid)) {
+            result = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (debug_log_) {
+        stream(*debug_log_) << "Reducing max haplotypes to " << result << " to fit the target working memory of "
+                            << budget;
+    }
+    return result;
+}
+
 bool Caller::filter_haplotypes(HaplotypeBlock& haplotypes,
                                HaplotypeGenerator& haplotype_generator,
                                HaplotypeLikelihoodArray& haplotype_likelihoods,
-                               const std::deque<Haplotype>& protected_haplotypes) const
+                               const std::deque<Haplotype>& protected_haplotypes,
+                               const unsigned max_haplotypes) const
 {
     bool has_removal_impact {false};
-    auto removed_haplotypes = filter(haplotypes, haplotype_likelihoods, protected_haplotypes);
+    auto removed_haplotypes = filter(haplotypes, haplotype_likelihoods, protected_haplotypes, max_haplotypes);
     std::sort(std::begin(haplotypes), std::end(haplotypes));
     if (haplotypes.empty()) {
         // This can only happen if all haplotypes have equal likelihood
@@ -1168,11 +1290,12 @@ bool Caller::compute_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_l
 std::vector<Haplotype>
 Caller::filter(HaplotypeBlock& haplotypes,
                const HaplotypeLikelihoodArray& haplotype_likelihoods,
-               const std::deque<Haplotype>& protected_haplotypes) const
+               const std::deque<Haplotype>& protected_haplotypes,
+               const unsigned max_haplotypes) const
 {
     std::vector<Haplotype> removed_haplotypes {};
     if (protected_haplotypes.empty()) {
-        removed_haplotypes = filter_to_n(haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes);
+        removed_haplotypes = filter_to_n(haplotypes, samples_, haplotype_likelihoods, max_haplotypes);
     } else {
         if (debug_log_) {
             stream(*debug_log_) << "Protecting " << protected_haplotypes.size() << " haplotypes from filtering";
@@ -1188,7 +1311,7 @@ Caller::filter(HaplotypeBlock& haplotypes,
         std::set_intersection(std::cbegin(haplotypes), std::cend(haplotypes),
                               std::cbegin(protected_haplotypes), std::cend(protected_haplotypes),
                               std::back_inserter(protected_copies));
-        removed_haplotypes = filter_to_n(removable_haplotypes, samples_, haplotype_likelihoods, parameters_.max_haplotypes);
+        removed_haplotypes = filter_to_n(removable_haplotypes, samples_, haplotype_likelihoods, max_haplotypes);
         haplotypes = std::move(removable_haplotypes);
         std::sort(std::begin(haplotypes), std::end(haplotypes));
         merge_unique(std::move(protected_copies), haplotypes);
@@ -1374,31 +1497,16 @@ std::vector<Allele> Caller::generate_reference_alleles(const GenomicRegion& regi
     return generate_reference_alleles(region, {});
 }
 
-namespace {
-
-auto overlap_range(std::vector<ReadPileup>& pileups, const AlignedRead& read)
-{
-    return overlap_range(std::begin(pileups), std::end(pileups), contig_region(read), BidirectionallySortedTag {});
-}
-
-} // namespace
-
 auto make_pileups(const std::vector<AlignedRead>& reads, const Genotype<Haplotype>& genotype, const GenomicRegion& region)
 {
     const auto realignments = assign_and_realign(reads, genotype);
-    ReadPileups result {};
-    result.reserve(size(region));
-    for (auto position = region.begin(); position < region.end(); ++position) {
-        result.emplace_back(position);
-    }
+    ReadPileups::Builder result {region.contig_region()};
     for (const auto& p : realignments) {
         for (const auto& read : p.second) {
-            for (ReadPileup& pileup : overlap_range(result, read)) {
-                pileup.add(read);
-            }
+            result.add(read);
         }
     }
-    return result;
+    return result.build();
 }
 
 ReadPileups make_pileups(const ReadContainer& reads, const Genotype<Haplotype>& genotype, const GenomicRegion& region)
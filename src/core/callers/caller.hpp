@@ -31,6 +31,8 @@
 #include "io/reference/reference_genome.hpp"
 #include "readpipe/read_pipe.hpp"
 #include "utils/memory_footprint.hpp"
+#include "utils/memory_governor.hpp"
+#include "utils/thread_pool.hpp"
 #include "logging/progress_meter.hpp"
 #include "logging/logging.hpp"
 
@@ -70,7 +72,10 @@ public:
         ModelPosteriorPolicy model_posterior_policy;
         bool protect_reference_haplotype;
         boost::optional<MemoryFootprint> target_max_memory;
+        boost::optional<MemoryGovernor&> memory_governor;
+        boost::optional<double> read_footprint_per_base; // expected bytes of reads per reference base
         ExecutionPolicy execution_policy;
+        std::shared_ptr<ThreadPool> workers; // shared by all callers for concurrent model evaluation
         ReadLinkageType read_linkage;
         bool try_early_phase_detection;
     };
@@ -150,6 +155,7 @@ protected:
     
     boost::optional<MemoryFootprint> target_max_memory() const noexcept;
     ExecutionPolicy exucution_policy() const noexcept;
+    boost::optional<ThreadPool&> workers() const noexcept;
 
 private:
     virtual std::unique_ptr<Latents>
@@ -190,7 +196,7 @@ private:
     VcfRecordFactory make_record_factory(const ReadMap& reads) const;
     std::vector<Haplotype>
     filter(HaplotypeBlock& haplotypes, const HaplotypeLikelihoodArray& haplotype_likelihoods,
-           const std::deque<Haplotype>& protected_haplotypes) const;
+           const std::deque<Haplotype>& protected_haplotypes, unsigned max_haplotypes) const;
     bool compute_haplotype_likelihoods(HaplotypeLikelihoodArray& haplotype_likelihoods, const GenomicRegion& active_region,
                                        const HaplotypeBlock& haplotypes, const MappableFlatSet<Variant>& candidates,
                                        const boost::variant<ReadMap, TemplateMap>& active_reads) const;
@@ -209,9 +215,15 @@ private:
                                     boost::optional<GenomicRegion>& backtrack_region,
                                     HaplotypeGenerator& haplotype_generator) const;
     void remove_duplicates(HaplotypeBlock& haplotypes) const;
+    boost::optional<MemoryGovernor::Reservation> reserve_memory(MemoryGovernor::Stage stage, MemoryFootprint footprint) const;
+    boost::optional<MemoryGovernor::Reservation> reserve_read_memory(const GenomicRegion& region) const;
+    void update_read_memory(boost::optional<MemoryGovernor::Reservation>& reservation, const ReadMap& reads) const;
+    MemoryFootprint estimate_likelihood_footprint(std::size_t num_haplotypes, std::size_t num_reads) const noexcept;
+    MemoryFootprint estimate_genotype_footprint(std::size_t num_haplotypes) const noexcept;
+    unsigned calculate_max_haplotypes(std::size_t num_reads) const;
     bool filter_haplotypes(HaplotypeBlock& haplotypes, HaplotypeGenerator& haplotype_generator,
                            HaplotypeLikelihoodArray& haplotype_likelihoods,
-                           const std::deque<Haplotype>& protected_haplotypes) const;
+                           const std::deque<Haplotype>& protected_haplotypes, unsigned max_haplotypes) const;
     bool is_saturated(const HaplotypeBlock& haplotypes, const Latents& latents) const;
     unsigned count_probable_haplotypes(const Caller::Latents::HaplotypeProbabilityMap& haplotype_posteriors) const;
     void filter_haplotypes(bool prefilter_had_removal_impact, const HaplotypeBlock& haplotypes,
@@ -129,12 +129,30 @@ CallerBuilder& CallerBuilder::set_target_memory_footprint(MemoryFootprint memory
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_memory_governor(MemoryGovernor& governor) noexcept
+{
+    params_.general.memory_governor = governor;
+    return *this;
+}
+
+CallerBuilder& CallerBuilder::set_read_footprint_per_base(double bytes) noexcept
+{
+    params_.general.read_footprint_per_base = bytes;
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_execution_policy(ExecutionPolicy policy) noexcept
 {
     params_.general.execution_policy = policy;
     return *this;
 }
 
+CallerBuilder& CallerBuilder::set_workers(std::shared_ptr<ThreadPool> workers) noexcept
+{
+    params_.general.workers = std::move(workers);
+    return *this;
+}
+
 CallerBuilder& CallerBuilder::set_read_linkage(ReadLinkageType linkage) noexcept
 {
     params_.general.read_linkage = linkage;
@@ -396,13 +414,16 @@ std::unique_ptr<Caller> CallerBuilder::build(const ContigName& contig) const
 
 Caller::Components CallerBuilder::make_components() const
 {
+    Phaser::Config phaser_config {};
+    phaser_config.min_phase_quality = params_.min_phase_score;
+    phaser_config.workers = params_.general.workers;
     return {
         components_.reference,
         components_.read_pipe,
         components_.variant_generator_builder.build(components_.reference),
         components_.haplotype_generator_builder,
         components_.likelihood_model,
-        Phaser {Phaser::Config {Phaser::GenotypeMatchType::exact, params_.min_phase_score}},
+        Phaser {phaser_config},
         components_.bad_region_detector
     };
 }
@@ -54,7 +54,10 @@ public:
     CallerBuilder& set_sites_only() noexcept;
     CallerBuilder& set_reference_haplotype_protection(bool b) noexcept;
     CallerBuilder& set_target_memory_footprint(MemoryFootprint memory) noexcept;
+    CallerBuilder& set_memory_governor(MemoryGovernor& governor) noexcept;
+    CallerBuilder& set_read_footprint_per_base(double bytes) noexcept;
     CallerBuilder& set_execution_policy(ExecutionPolicy policy) noexcept;
+    CallerBuilder& set_workers(std::shared_ptr<ThreadPool> workers) noexcept;
     CallerBuilder& set_read_linkage(ReadLinkageType linkage) noexcept;
     CallerBuilder& set_bad_region_detector(BadRegionDetector detector) noexcept;
     
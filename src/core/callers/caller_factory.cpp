@@ -26,6 +26,18 @@ CallerFactory& CallerFactory::set_read_pipe(ReadPipe& read_pipe) noexcept
     return *this;
 }
 
+CallerFactory& CallerFactory::set_memory_governor(MemoryGovernor& governor) noexcept
+{
+    template_builder_.set_memory_governor(governor);
+    return *this;
+}
+
+CallerFactory& CallerFactory::set_workers(std::shared_ptr<ThreadPool> workers) noexcept
+{
+    template_builder_.set_workers(std::move(workers));
+    return *this;
+}
+
 std::unique_ptr<Caller> CallerFactory::make(const ContigName& contig) const
 {
     return template_builder_.build(contig);
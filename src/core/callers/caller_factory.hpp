@@ -15,6 +15,8 @@ namespace octopus {
 
 class ReferenceGenome;
 class ReadPipe;
+class MemoryGovernor;
+class ThreadPool;
 
 class CallerFactory
 {
@@ -34,6 +36,8 @@ public:
     
     CallerFactory& set_reference(const ReferenceGenome& reference) noexcept;
     CallerFactory& set_read_pipe(ReadPipe& read_pipe) noexcept;
+    CallerFactory& set_memory_governor(MemoryGovernor& governor) noexcept;
+    CallerFactory& set_workers(std::shared_ptr<ThreadPool> workers) noexcept;
     
     std::unique_ptr<Caller> make(const ContigName& contig) const;
     
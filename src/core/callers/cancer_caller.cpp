@@ -13,6 +13,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <limits>
+#include <future>
 
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -142,10 +143,16 @@ CancerCaller::infer_latents(const HaplotypeBlock& haplotypes,
     set_model_priors(*result);
     generate_germline_genotypes(*result, result->indexed_haplotypes_);
     if (debug_log_) stream(*debug_log_) << "There are " << result->germline_genotypes_.size() << " candidate germline genotypes";
-    evaluate_germline_model(*result, haplotype_likelihoods);
-    evaluate_cnv_model(*result, haplotype_likelihoods);
+    if (workers()) {
+        evaluate_models_concurrently(*result, haplotype_likelihoods, *workers());
+    } else {
+        evaluate_germline_model(*result, haplotype_likelihoods);
+        evaluate_cnv_model(*result, haplotype_likelihoods);
+        if (haplotypes.size() > 1) {
+            fit_somatic_model(*result, haplotype_likelihoods);
+        }
+    }
     if (haplotypes.size() > 1) {
-        fit_somatic_model(*result, haplotype_likelihoods);
         evaluate_noise_model(*result, haplotype_likelihoods);
         set_model_posteriors(*result);
     }
@@ -168,6 +175,14 @@ void CancerCaller::set_cancer_genotype_prior_model(Latents& latents) const
 }
 
 void CancerCaller::fit_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    fit_somatic_model(latents, [&] (Latents& latents) {
+        generate_cancer_genotypes(latents, haplotype_likelihoods);
+        evaluate_somatic_model(latents, haplotype_likelihoods);
+    });
+}
+
+void CancerCaller::fit_somatic_model(Latents& latents, const SomaticModelFitter& fitter) const
 {
     set_cancer_genotype_prior_model(latents);
     latents.max_evidence_somatic_model_index_ = 0;
@@ -177,9 +192,8 @@ void CancerCaller::fit_somatic_model(Latents& latents, const HaplotypeLikelihood
     for (unsigned somatic_ploidy {1}; somatic_ploidy <= parameters_.max_somatic_haplotypes; ++somatic_ploidy) {
         if (debug_log_) stream(*debug_log_) << "Fitting somatic model with somatic ploidy " << somatic_ploidy;
         latents.inferred_somatic_ploidy_ = somatic_ploidy;
-        generate_cancer_genotypes(latents, haplotype_likelihoods);
+        fitter(latents);
         if (debug_log_) stream(*debug_log_) << "There are " << latents.cancer_genotypes_.size() << " candidate cancer genotypes";
-        evaluate_somatic_model(latents, haplotype_likelihoods);
         latents.somatic_model_posteriors_.push_back(latents.somatic_model_inferences_.back().approx_log_evidence);
         if (debug_log_) stream(*debug_log_) << "Evidence for somatic model with somatic ploidy "
                              << somatic_ploidy << " is " << latents.somatic_model_posteriors_.back();
@@ -203,6 +217,69 @@ void CancerCaller::fit_somatic_model(Latents& latents, const HaplotypeLikelihood
     if (debug_log_) stream(*debug_log_) << "Best somatic model has somatic ploidy " << latents.inferred_somatic_ploidy_;
 }
 
+bool CancerCaller::can_fit_somatic_models_independently(const Latents& latents) const
+{
+    // Otherwise the cancer genotypes for each somatic ploidy are seeded from the previous fit
+    const auto num_haplotypes = latents.indexed_haplotypes_.size();
+    const auto max_possible_cancer_genotypes = num_haplotypes * latents.germline_genotypes_.size();
+    return num_haplotypes > 1 && (!parameters_.max_genotypes || max_possible_cancer_genotypes <= *parameters_.max_genotypes);
+}
+
+void CancerCaller::evaluate_models_concurrently(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                                ThreadPool& workers) const
+{
+    // The germline model is evaluated on pooled likelihoods, so the CNV model can use haplotype_likelihoods directly.
+    // Prior models cache state and likelihood arrays are primed by sample, so the first somatic fit gets its own copy.
+    // Only the first somatic ploidy is fitted speculatively as it is needed whenever there is more than one haplotype;
+    // higher ploidies are fitted lazily in order, as each depends on the evidence of the previous one.
+    std::unique_ptr<GenotypePriorModel> cnv_prior_model {};
+    std::future<SomaticModelFit> first_somatic_model_fit {};
+    std::future<CNVModel::InferredLatents> cnv_model_inferences {};
+    try {
+        if (latents.haplotypes_.get().size() > 1 && can_fit_somatic_models_independently(latents)) {
+            // The reference is only accessed on this thread
+            auto germline_prior_model = make_germline_prior_model(latents.haplotypes_);
+            germline_prior_model->prime(latents.haplotypes_);
+            first_somatic_model_fit = workers.push([this, &latents, germline_prior_model = std::move(germline_prior_model),
+                                                    likelihoods = haplotype_likelihoods.copy_likelihoods()] () {
+                CancerGenotypePriorModel prior_model {*germline_prior_model, SomaticMutationModel {parameters_.somatic_mutation_model_params}};
+                SomaticModelFit result {};
+                result.genotypes = generate_all_cancer_genotypes(latents.germline_genotypes_, latents.indexed_haplotypes_, 1);
+                result.inferences = evaluate_somatic_model(prior_model, result.genotypes, 1, latents.haplotypes_, likelihoods);
+                return result;
+            });
+        }
+        cnv_prior_model = make_germline_prior_model(latents.haplotypes_);
+        cnv_prior_model->prime(latents.haplotypes_);
+        cnv_model_inferences = workers.push([&] () {
+            return evaluate_cnv_model(*cnv_prior_model, latents, haplotype_likelihoods);
+        });
+        evaluate_germline_model(latents, haplotype_likelihoods);
+        latents.cnv_model_inferences_ = cnv_model_inferences.get();
+        if (latents.haplotypes_.get().size() > 1) {
+            if (first_somatic_model_fit.valid()) {
+                fit_somatic_model(latents, [&] (Latents& latents) {
+                    if (latents.inferred_somatic_ploidy_ == 1) {
+                        auto fit = first_somatic_model_fit.get();
+                        latents.cancer_genotypes_.push_back(std::move(fit.genotypes));
+                        latents.somatic_model_inferences_.push_back(std::move(fit.inferences));
+                    } else {
+                        generate_cancer_genotypes(latents, haplotype_likelihoods);
+                        evaluate_somatic_model(latents, haplotype_likelihoods);
+                    }
+                });
+            } else {
+                fit_somatic_model(latents, haplotype_likelihoods);
+            }
+        }
+    } catch (...) {
+        // Pending tasks refer to this frame
+        if (cnv_model_inferences.valid()) cnv_model_inferences.wait();
+        if (first_somatic_model_fit.valid()) first_somatic_model_fit.wait();
+        throw;
+    }
+}
+
 static double calculate_model_posterior(const double normal_germline_model_log_evidence,
                                         const double normal_dummy_model_log_evidence)
 {
@@ -511,32 +588,49 @@ void CancerCaller::evaluate_germline_model(Latents& latents, const HaplotypeLike
 void CancerCaller::evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
 {
     assert(!latents.germline_genotypes_.empty() && latents.germline_prior_model_);
-    auto cnv_model_priors = get_cnv_model_priors(*latents.germline_prior_model_);
+    latents.cnv_model_inferences_ = evaluate_cnv_model(*latents.germline_prior_model_, latents, haplotype_likelihoods);
+}
+
+CancerCaller::CNVModel::InferredLatents
+CancerCaller::evaluate_cnv_model(const GenotypePriorModel& prior_model, const Latents& latents,
+                                 const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    auto cnv_model_priors = get_cnv_model_priors(prior_model);
     CNVModel::AlgorithmParameters params {};
     if (parameters_.max_vb_seeds) params.max_seeds = *parameters_.max_vb_seeds;
     params.target_max_memory = this->target_max_memory();
     params.execution_policy = this->exucution_policy();
     CNVModel cnv_model {samples_, cnv_model_priors, params};
     cnv_model.prime(latents.haplotypes_);
-    latents.cnv_model_inferences_ = cnv_model.evaluate(latents.germline_genotypes_,  haplotype_likelihoods);
+    return cnv_model.evaluate(latents.germline_genotypes_,  haplotype_likelihoods);
 }
 
 void CancerCaller::evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const
 {
     assert(latents.germline_prior_model_ && !latents.cancer_genotypes_.empty() && !latents.cancer_genotypes_.back().empty());
     assert(latents.cancer_genotype_prior_model_);
-    auto somatic_model_priors = get_somatic_model_priors(*latents.cancer_genotype_prior_model_, latents.inferred_somatic_ploidy_);
+    latents.somatic_model_inferences_.push_back(evaluate_somatic_model(*latents.cancer_genotype_prior_model_, latents.cancer_genotypes_.back(),
+                                                                       latents.inferred_somatic_ploidy_, latents.haplotypes_,
+                                                                       haplotype_likelihoods));
+}
+
+CancerCaller::SomaticModel::InferredLatents
+CancerCaller::evaluate_somatic_model(CancerGenotypePriorModel& prior_model, const CancerGenotypeVector& genotypes,
+                                     const unsigned somatic_ploidy, const HaplotypeBlock& haplotypes,
+                                     const HaplotypeLikelihoodArray& haplotype_likelihoods) const
+{
+    auto somatic_model_priors = get_somatic_model_priors(prior_model, somatic_ploidy);
     SomaticModel::AlgorithmParameters params {};
     if (parameters_.max_vb_seeds) params.max_seeds = *parameters_.max_vb_seeds;
     params.target_max_memory = this->target_max_memory();
     params.execution_policy = this->exucution_policy();
     SomaticModel model {samples_, somatic_model_priors, params};
-    assert(latents.cancer_genotype_prior_model_->germline_model().is_primed());
-    if (!latents.cancer_genotype_prior_model_->mutation_model().is_primed()) {
-        latents.cancer_genotype_prior_model_->mutation_model().prime(latents.haplotypes_);
+    assert(prior_model.germline_model().is_primed());
+    if (!prior_model.mutation_model().is_primed()) {
+        prior_model.mutation_model().prime(haplotypes);
     }
-    model.prime(latents.haplotypes_);
-    latents.somatic_model_inferences_.push_back(model.evaluate(latents.cancer_genotypes_.back(), haplotype_likelihoods));
+    model.prime(haplotypes);
+    return model.evaluate(genotypes, haplotype_likelihoods);
 }
 
 auto get_high_posterior_genotypes(const MappableBlock<CancerGenotype<IndexedHaplotype<>>>& genotypes,
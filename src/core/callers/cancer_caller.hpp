@@ -151,16 +151,36 @@ private:
     void generate_cancer_genotypes(Latents& latents, const MappableBlock<Genotype<IndexedHaplotype<>>>& germline_genotypes) const;
     bool has_high_normal_contamination_risk(const Latents& latents) const;
     
+    struct SomaticModelFit
+    {
+        CancerGenotypeVector genotypes;
+        SomaticModel::InferredLatents inferences;
+    };
+    
+    // Adds the cancer genotypes and somatic model inferences for latents.inferred_somatic_ploidy_
+    using SomaticModelFitter = std::function<void(Latents&)>;
+    
     void evaluate_germline_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     void evaluate_cnv_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    CNVModel::InferredLatents
+    evaluate_cnv_model(const GenotypePriorModel& prior_model, const Latents& latents,
+                       const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     void evaluate_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    SomaticModel::InferredLatents
+    evaluate_somatic_model(CancerGenotypePriorModel& prior_model, const CancerGenotypeVector& genotypes,
+                           unsigned somatic_ploidy, const HaplotypeBlock& haplotypes,
+                           const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
     void evaluate_noise_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    void evaluate_models_concurrently(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods,
+                                      ThreadPool& workers) const;
+    bool can_fit_somatic_models_independently(const Latents& latents) const;
     
     void set_model_priors(Latents& latents) const;
     void set_model_posteriors(Latents& latents) const;
 
     void set_cancer_genotype_prior_model(Latents& latents) const;
     void fit_somatic_model(Latents& latents, const HaplotypeLikelihoodArray& haplotype_likelihoods) const;
+    void fit_somatic_model(Latents& latents, const SomaticModelFitter& fitter) const;
     
     std::unique_ptr<GenotypePriorModel> make_germline_prior_model(const HaplotypeBlock& haplotypes) const;
     CNVModel::Priors get_cnv_model_priors(const GenotypePriorModel& prior_model) const;
@@ -9,6 +9,8 @@
 #include <algorithm>
 #include <functional>
 #include <exception>
+#include <memory>
+#include <thread>
 
 #include "config/config.hpp"
 #include "config/option_collation.hpp"
@@ -75,6 +77,11 @@ const InputRegionMap& GenomeCallingComponents::search_regions() const noexcept
     return components_.regions;
 }
 
+const boost::optional<Shard>& GenomeCallingComponents::shard() const noexcept
+{
+    return components_.shard;
+}
+
 const std::vector<GenomicRegion::ContigName>& GenomeCallingComponents::contigs() const noexcept
 {
     return components_.contigs;
@@ -100,6 +107,33 @@ std::size_t GenomeCallingComponents::read_buffer_size() const noexcept
     return components_.read_buffer_size;
 }
 
+boost::optional<const MemoryGovernor&> GenomeCallingComponents::memory_governor() const noexcept
+{
+    if (components_.memory_governor) {
+        return *components_.memory_governor;
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<CheckpointJournal&> GenomeCallingComponents::checkpoint_journal() noexcept
+{
+    if (components_.checkpoint_journal) {
+        return *components_.checkpoint_journal;
+    } else {
+        return boost::none;
+    }
+}
+
+boost::optional<const CheckpointJournal&> GenomeCallingComponents::checkpoint_journal() const noexcept
+{
+    if (components_.checkpoint_journal) {
+        return *components_.checkpoint_journal;
+    } else {
+        return boost::none;
+    }
+}
+
 const boost::optional<GenomeCallingComponents::Path>& GenomeCallingComponents::temp_directory() const noexcept
 {
     return components_.temp_directory;
@@ -319,6 +353,23 @@ auto get_contigs(const InputRegionMap& regions, const ReferenceGenome& reference
     return result;
 }
 
+boost::optional<Shard> make_calling_shard(const options::OptionMap& options, const InputRegionMap& search_regions,
+                                          const ReferenceGenome& reference, const ReadManager& rm)
+{
+    const auto shard = options::get_shard(options);
+    if (!shard) return boost::none;
+    const auto contigs = get_contigs(search_regions, reference, options::get_contig_output_order(options));
+    return make_shard(shard->index, shard->count, search_regions, contigs, reference, rm);
+}
+
+InputRegionMap get_calling_search_regions(const options::OptionMap& options, const InputRegionMap& search_regions,
+                                          const ReferenceGenome& reference, const boost::optional<Shard>& shard)
+{
+    if (!shard) return search_regions;
+    const auto contigs = get_contigs(search_regions, reference, options::get_contig_output_order(options));
+    return get_shard_regions(*shard, search_regions, contigs, options::get_shard_overlap(options));
+}
+
 template <typename Container>
 bool is_in_file_samples(const SampleName& sample, const Container& file_samples)
 {
@@ -420,6 +471,8 @@ auto profile_reads_helper(const std::vector<SampleName>& samples,
 {
     ReadSetProfileConfig config {};
     config.fragment_size = options::max_read_length(options);
+    const auto num_threads = options::get_num_threads(options);
+    config.max_threads = num_threads ? *num_threads : std::max(std::thread::hardware_concurrency(), 1u);
     if (samples.size() == 1) {
         auto result = profile_reads(samples, reference, input_regions, source, config);
         if (result) result->depth_stats.sample.clear(); // no need to keep this duplicate info
@@ -567,6 +620,27 @@ boost::optional<const T&> optional_cref(const boost::optional<T>& v)
     }
 }
 
+std::unique_ptr<CheckpointJournal> make_checkpoint_journal(const options::OptionMap& options)
+{
+    const auto checkpoint_directory = options::get_checkpoint_directory(options);
+    if (checkpoint_directory) {
+        const auto mode = options::resume_requested(options) ? CheckpointJournal::Mode::resume : CheckpointJournal::Mode::create;
+        return std::make_unique<CheckpointJournal>(*checkpoint_directory, options::hash_calling_inputs(options), mode);
+    } else {
+        return nullptr;
+    }
+}
+
+std::unique_ptr<MemoryGovernor> make_memory_governor(const options::OptionMap& options)
+{
+    const auto target_working_memory = options::get_target_working_memory(options);
+    if (target_working_memory) {
+        return std::make_unique<MemoryGovernor>(*target_working_memory);
+    } else {
+        return nullptr;
+    }
+}
+
 } // namespace
 
 GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, ReadManager&& read_manager,
@@ -574,10 +648,12 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
 : reference {std::move(reference)}
 , read_manager {std::move(read_manager)}
 , samples {extract_samples(options, this->read_manager)}
-, regions {get_search_regions(options, this->reference, this->read_manager)}
+, unsharded_regions {get_search_regions(options, this->reference, this->read_manager)}
+, shard {make_calling_shard(options, this->unsharded_regions, this->reference, this->read_manager)}
+, regions {get_calling_search_regions(options, this->unsharded_regions, this->reference, this->shard)}
 , contigs {get_contigs(this->regions, this->reference, options::get_contig_output_order(options))}
 , ploidies {options::get_ploidy_map(options)}
-, reads_profile {profile_reads_helper(this->samples, this->reference, this->regions, this->read_manager, this->ploidies, options)}
+, reads_profile {profile_reads_helper(this->samples, this->reference, this->unsharded_regions, this->read_manager, this->ploidies, options)}
 , read_pipe {options::make_read_pipe(this->read_manager, this->reference, this->samples, options)}
 , haplotype_likelihood_model {options::make_calling_haplotype_likelihood_model(options, optional_cref(this->reads_profile))}
 , realignment_haplotype_likelihood_model {options::make_realignment_haplotype_likelihood_model(haplotype_likelihood_model, optional_cref(this->reads_profile), options)}
@@ -588,6 +664,7 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
 , num_threads {options::get_num_threads(options)}
 , read_buffer_footprint {options::get_target_read_buffer_size(options)}
 , read_buffer_size {}
+, memory_governor {make_memory_governor(options)}
 , progress_meter {regions}
 , pedigree {options::get_pedigree(options, samples)}
 , sites_only {options::call_sites_only(options)}
@@ -600,7 +677,10 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
     drop_unused_samples(this->samples, this->read_manager);
     setup_progress_meter(options);
     set_read_buffer_size(options);
+    if (memory_governor) caller_factory.set_memory_governor(*memory_governor);
     setup_filter_read_pipe(options);
+    setup_read_pipe_workers();
+    setup_caller_workers();
     filter_request = options::filter_request(options);
     if (filter_request && !all_samples_in_vcf(samples, *filter_request)) {
         throw InputVCFError {*filter_request};
@@ -609,6 +689,7 @@ GenomeCallingComponents::Components::Components(ReferenceGenome&& reference, Rea
     try {
         call_filter_factory = options::make_call_filter_factory(this->reference, this->read_pipe, options, this->temp_directory);
         setup_writers(options);
+        checkpoint_journal = make_checkpoint_journal(options);
     } catch (...) {
         if (temp_directory) fs::remove_all(*temp_directory);
         throw;
@@ -671,6 +752,32 @@ void GenomeCallingComponents::Components::setup_filter_read_pipe(const options::
     }
 }
 
+void GenomeCallingComponents::Components::setup_read_pipe_workers()
+{
+    // The read pipe batches samples by file, so there is at most one batch per file
+    const auto num_files = read_manager.paths().size();
+    if (samples.size() > 1 && num_files > 1) {
+        const auto max_threads = num_threads ? *num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+        const auto num_workers = std::min({static_cast<std::size_t>(max_threads), samples.size(), num_files});
+        if (num_workers > 1) {
+            auto workers = std::make_shared<ThreadPool>(num_workers);
+            read_pipe.set_workers(workers);
+            if (filter_read_pipe) filter_read_pipe->set_workers(std::move(workers));
+        }
+    }
+}
+
+void GenomeCallingComponents::Components::setup_caller_workers()
+{
+    // Shared by all callers so concurrent model evaluation is bounded by --threads however many windows are in flight
+    if (!num_threads || *num_threads > 1) {
+        const auto max_threads = num_threads ? *num_threads : std::max(std::thread::hardware_concurrency(), 1u);
+        if (max_threads > 1) {
+            caller_factory.set_workers(std::make_shared<ThreadPool>(max_threads));
+        }
+    }
+}
+
 void GenomeCallingComponents::update_dependents() noexcept
 {
     components_.read_pipe.set_read_manager(components_.read_manager);
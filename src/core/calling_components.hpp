@@ -26,7 +26,10 @@
 #include "core/csr/filters/variant_call_filter_factory.hpp"
 #include "core/tools/bam_realigner.hpp"
 #include "core/tools/indel_profiler.hpp"
+#include "core/checkpoint_journal.hpp"
+#include "core/sharding.hpp"
 #include "utils/memory_footprint.hpp"
+#include "utils/memory_governor.hpp"
 #include "utils/input_reads_profiler.hpp"
 #include "logging/progress_meter.hpp"
 
@@ -56,11 +59,15 @@ public:
     const ReadPipe& read_pipe() const noexcept;
     const std::vector<SampleName>& samples() const noexcept;
     const InputRegionMap& search_regions() const noexcept;
+    const boost::optional<Shard>& shard() const noexcept;
     const std::vector<GenomicRegion::ContigName>& contigs() const noexcept;
     VcfWriter& output() noexcept;
     const VcfWriter& output() const noexcept;
     MemoryFootprint read_buffer_footprint() const noexcept;
     std::size_t read_buffer_size() const noexcept;
+    boost::optional<const MemoryGovernor&> memory_governor() const noexcept;
+    boost::optional<CheckpointJournal&> checkpoint_journal() noexcept;
+    boost::optional<const CheckpointJournal&> checkpoint_journal() const noexcept;
     const boost::optional<Path>& temp_directory() const noexcept;
     boost::optional<unsigned> num_threads() const noexcept;
     const HaplotypeLikelihoodModel& haplotype_likelihood_model() const noexcept;
@@ -100,6 +107,10 @@ private:
         ReferenceGenome reference;
         ReadManager read_manager;
         std::vector<SampleName> samples;
+        // Anything estimated from the data, like the reads profile, uses all the search regions
+        // so that every shard is called with the same parameters as an unsharded run
+        InputRegionMap unsharded_regions;
+        boost::optional<Shard> shard;
         InputRegionMap regions;
         std::vector<GenomicRegion::ContigName> contigs;
         PloidyMap ploidies;
@@ -114,6 +125,7 @@ private:
         boost::optional<unsigned> num_threads;
         MemoryFootprint read_buffer_footprint;
         std::size_t read_buffer_size;
+        std::unique_ptr<MemoryGovernor> memory_governor;
         ProgressMeter progress_meter;
         boost::optional<Pedigree> pedigree;
         bool sites_only;
@@ -127,11 +139,14 @@ private:
         // exception handling easier.
         boost::optional<Path> temp_directory;
         std::unique_ptr<VariantCallFilterFactory> call_filter_factory;
+        std::unique_ptr<CheckpointJournal> checkpoint_journal;
         
         void setup_progress_meter(const options::OptionMap& options);
         void set_read_buffer_size(const options::OptionMap& options);
         void setup_writers(const options::OptionMap& options);
         void setup_filter_read_pipe(const options::OptionMap& options);
+        void setup_read_pipe_workers();
+        void setup_caller_workers();
     };
     
     Components components_;
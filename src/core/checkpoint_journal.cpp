@@ -0,0 +1,276 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "checkpoint_journal.hpp"
+
+#include <sstream>
+#include <iterator>
+#include <utility>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_header.hpp"
+#include "io/variant/vcf_record.hpp"
+#include "utils/string_utils.hpp"
+#include "logging/logging.hpp"
+#include "exceptions/user_error.hpp"
+#include "exceptions/malformed_file_error.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+
+namespace octopus {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::string journal_name {"octopus-checkpoint"};
+const std::string journal_version {"1"};
+
+class MalformedCheckpointJournal : public MalformedFileError
+{
+    std::string do_where() const override
+    {
+        return "CheckpointJournal";
+    }
+public:
+    MalformedCheckpointJournal(CheckpointJournal::Path file) : MalformedFileError {std::move(file), "checkpoint journal"} {}
+};
+
+class UnwritableCheckpointJournal : public UnwritableFileError
+{
+    std::string do_where() const override
+    {
+        return "CheckpointJournal";
+    }
+public:
+    UnwritableCheckpointJournal(CheckpointJournal::Path file) : UnwritableFileError {std::move(file), "checkpoint journal"} {}
+};
+
+class InconsistentCheckpoint : public UserError
+{
+    std::string do_where() const override
+    {
+        return "CheckpointJournal";
+    }
+
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "The checkpoint in " << directory_ << " was made with different inputs or options to this run";
+        return ss.str();
+    }
+
+    std::string do_help() const override
+    {
+        return "Rerun with the same inputs and options as the interrupted run, or remove the --resume option to start again";
+    }
+
+    CheckpointJournal::Path directory_;
+public:
+    InconsistentCheckpoint(CheckpointJournal::Path directory) : directory_ {std::move(directory)} {}
+};
+
+auto to_string(const std::size_t hash)
+{
+    std::ostringstream ss {};
+    ss << std::hex << hash;
+    return ss.str();
+}
+
+} // namespace
+
+CheckpointJournal::CheckpointJournal(Path directory, const std::size_t inputs_hash, const Mode mode)
+: directory_ {std::move(directory)}
+, path_ {directory_ / "journal"}
+, inputs_hash_ {inputs_hash}
+, is_resumed_ {false}
+, progress_ {}
+, journal_ {}
+, mutex_ {}
+{
+    boost::system::error_code error {};
+    fs::create_directories(directory_, error);
+    if (error) throw UnwritableCheckpointJournal {path_};
+    if (mode == Mode::resume) {
+        if (fs::exists(path_)) {
+            load();
+            is_resumed_ = true;
+        } else {
+            logging::WarningLogger warn_log {};
+            stream(warn_log) << "No checkpoint journal found in " << directory_ << ", calling will start from the beginning";
+        }
+    }
+    rewrite();
+}
+
+const CheckpointJournal::Path& CheckpointJournal::directory() const noexcept
+{
+    return directory_;
+}
+
+bool CheckpointJournal::is_resumed() const noexcept
+{
+    return is_resumed_;
+}
+
+CheckpointJournal::ContigProgress CheckpointJournal::progress(const ContigName& contig) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    const auto itr = progress_.find(contig);
+    return itr != std::cend(progress_) ? itr->second : ContigProgress {};
+}
+
+void CheckpointJournal::record_calls_file(const ContigName& contig, Path calls_file)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    write_line("file\t" + contig + "\t" + calls_file.string());
+    progress_[contig].calls_file = std::move(calls_file);
+}
+
+void CheckpointJournal::record_window(const GenomicRegion& window, const std::size_t num_records)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    auto& progress = progress_[window.contig_name()];
+    progress.end = window.end();
+    progress.num_records += num_records;
+    write_line("window\t" + window.contig_name() + "\t" + std::to_string(window.begin()) + "\t"
+               + std::to_string(window.end()) + "\t" + std::to_string(progress.num_records));
+}
+
+void CheckpointJournal::clear()
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    journal_.close();
+    boost::system::error_code error {};
+    fs::remove(path_, error);
+    for (const auto& p : progress_) {
+        if (p.second.calls_file) {
+            fs::remove(*p.second.calls_file, error);
+            auto index_file = *p.second.calls_file;
+            index_file += ".csi";
+            fs::remove(index_file, error);
+        }
+    }
+    progress_.clear();
+}
+
+// private methods
+
+void CheckpointJournal::load()
+{
+    std::ifstream journal {path_.string()};
+    std::string line {};
+    std::getline(journal, line);
+    const auto header = utils::split(line, '\t');
+    if (header.size() != 3 || header[0] != journal_name || header[1] != journal_version) {
+        MalformedCheckpointJournal error {path_};
+        error.set_reason("the journal header is missing or was made by an incompatible version");
+        throw error;
+    }
+    if (header[2] != to_string(inputs_hash_)) {
+        throw InconsistentCheckpoint {directory_};
+    }
+    // An unterminated final line was interrupted before it was completely written, so is ignored
+    while (std::getline(journal, line) && !journal.eof()) {
+        const auto fields = utils::split(line, '\t');
+        try {
+            if (fields.size() == 3 && fields[0] == "file") {
+                progress_[fields[1]].calls_file = fields[2];
+                continue;
+            } else if (fields.size() == 5 && fields[0] == "window") {
+                auto& progress = progress_[fields[1]];
+                progress.end = std::stoul(fields[3]);
+                progress.num_records = std::stoull(fields[4]);
+                continue;
+            }
+        } catch (const std::logic_error&) {}
+        MalformedCheckpointJournal error {path_};
+        error.set_reason("the journal contains an unrecognised line: " + line);
+        throw error;
+    }
+    for (auto itr = std::begin(progress_); itr != std::end(progress_);) {
+        if (itr->second.calls_file) {
+            ++itr;
+        } else {
+            itr = progress_.erase(itr);
+        }
+    }
+}
+
+void CheckpointJournal::rewrite()
+{
+    // The compacted journal replaces the old one in a single step so that it is never left incomplete
+    auto tmp_path = path_;
+    tmp_path += ".tmp";
+    {
+        std::ofstream journal {tmp_path.string()};
+        journal << journal_name << '\t' << journal_version << '\t' << to_string(inputs_hash_) << '\n';
+        for (const auto& p : progress_) {
+            if (p.second.calls_file) {
+                journal << "file\t" << p.first << '\t' << p.second.calls_file->string() << '\n';
+                journal << "window\t" << p.first << "\t0\t" << p.second.end << '\t' << p.second.num_records << '\n';
+            }
+        }
+        if (!journal) throw UnwritableCheckpointJournal {tmp_path};
+    }
+    boost::system::error_code error {};
+    fs::rename(tmp_path, path_, error);
+    if (error) throw UnwritableCheckpointJournal {path_};
+    journal_.open(path_.string(), std::ios::app);
+    if (!journal_) throw UnwritableCheckpointJournal {path_};
+}
+
+void CheckpointJournal::write_line(const std::string& line)
+{
+    journal_ << line << '\n';
+    journal_.flush();
+    if (!journal_) throw UnwritableCheckpointJournal {path_};
+}
+
+// non member methods
+
+void remove_recorded_windows(InputRegionMap::mapped_type& regions, const CheckpointJournal::ContigProgress& progress)
+{
+    if (progress.end == 0) return;
+    InputRegionMap::mapped_type remaining_regions {};
+    for (const auto& region : regions) {
+        if (region.end() > progress.end) {
+            if (region.begin() < progress.end) {
+                remaining_regions.emplace(region.contig_name(), progress.end, region.end());
+            } else {
+                remaining_regions.insert(region);
+            }
+        }
+    }
+    regions = std::move(remaining_regions);
+}
+
+VcfWriter restore_temp_output_file(const CheckpointJournal::Path& calls_file, const std::size_t num_records)
+{
+    auto old_calls_file = calls_file;
+    old_calls_file += ".old";
+    // If there is already an old file then a previous restore was interrupted
+    if (!fs::exists(old_calls_file)) {
+        if (!fs::exists(calls_file)) {
+            throw std::runtime_error {"Could not find checkpointed calls file " + calls_file.string()};
+        }
+        fs::rename(calls_file, old_calls_file);
+    }
+    VcfReader old_calls {old_calls_file};
+    VcfWriter result {calls_file, old_calls.fetch_header()};
+    std::size_t num_restored {0};
+    for (auto p = old_calls.iterate(); p.first != p.second && num_restored < num_records; ++p.first, ++num_restored) {
+        result << *p.first;
+    }
+    if (num_restored < num_records) {
+        throw std::runtime_error {"Checkpointed calls file " + calls_file.string() + " is missing recorded calls"};
+    }
+    result.close();
+    old_calls.close();
+    fs::remove(old_calls_file);
+    return result;
+}
+
+} // namespace octopus
@@ -0,0 +1,91 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef checkpoint_journal_hpp
+#define checkpoint_journal_hpp
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <fstream>
+#include <mutex>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "io/variant/vcf_writer.hpp"
+
+namespace octopus {
+
+/*
+ Append-only record of the calling windows whose calls have been written to the temporary calls file
+ of their contig. Windows are written in order, so the progress of each contig is just the end of the
+ last written window and the number of records written up to it. The journal is tagged with a hash of
+ the calling inputs and options so that a run can only be resumed with the same configuration.
+ */
+class CheckpointJournal
+{
+public:
+    using Path       = boost::filesystem::path;
+    using ContigName = GenomicRegion::ContigName;
+    using Position   = GenomicRegion::Position;
+
+    enum class Mode { create, resume };
+
+    struct ContigProgress
+    {
+        boost::optional<Path> calls_file = boost::none;
+        Position end = 0;
+        std::size_t num_records = 0;
+    };
+
+    CheckpointJournal() = delete;
+
+    CheckpointJournal(Path directory, std::size_t inputs_hash, Mode mode);
+
+    CheckpointJournal(const CheckpointJournal&)            = delete;
+    CheckpointJournal& operator=(const CheckpointJournal&) = delete;
+    CheckpointJournal(CheckpointJournal&&)                 = delete;
+    CheckpointJournal& operator=(CheckpointJournal&&)      = delete;
+
+    ~CheckpointJournal() = default;
+
+    const Path& directory() const noexcept;
+
+    bool is_resumed() const noexcept;
+
+    ContigProgress progress(const ContigName& contig) const;
+
+    void record_calls_file(const ContigName& contig, Path calls_file);
+    // Must be called in window order for each contig, once the window's calls are on disk
+    void record_window(const GenomicRegion& window, std::size_t num_records);
+
+    // Removes the journal and all recorded calls files
+    void clear();
+
+private:
+    Path directory_, path_;
+    std::size_t inputs_hash_;
+    bool is_resumed_;
+    std::unordered_map<ContigName, ContigProgress> progress_;
+    std::ofstream journal_;
+    mutable std::mutex mutex_;
+
+    void load();
+    void rewrite();
+    void write_line(const std::string& line);
+};
+
+// Windows are proposed from the start of the remaining search region, so removing the recorded
+// windows reproduces the remaining windows of the interrupted run
+void remove_recorded_windows(InputRegionMap::mapped_type& regions, const CheckpointJournal::ContigProgress& progress);
+
+// Truncates the calls file to its first num_records records. Any calls after the recorded windows are
+// from an interrupted window, so are dropped. The returned writer is closed.
+VcfWriter restore_temp_output_file(const CheckpointJournal::Path& calls_file, std::size_t num_records);
+
+} // namespace octopus
+
+#endif
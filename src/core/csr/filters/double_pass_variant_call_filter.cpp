@@ -63,11 +63,11 @@ DoublePassVariantCallFilter::make_registration_pass(const VcfReader& source, con
     auto annotated_vcf = get_temp_measure_annotated_vcf(source, filtered_header);
     std::size_t record_idx {0};
     if (can_measure_multiple_blocks()) {
-        for (auto p = source.iterate(); p.first != p.second;) {
-            const auto blocks = read_next_blocks(p.first, p.second, samples);
-            record(blocks, record_idx, filtered_header, samples, annotated_vcf);
+        auto p = source.iterate();
+        measure_blocks(p.first, p.second, samples, [&] (const auto& blocks, const auto& measures) {
+            record(blocks, measures, record_idx, filtered_header, samples, annotated_vcf);
             for (const auto& block : blocks) record_idx += block.size();
-        }
+        });
     } else if (can_measure_single_call()) {
         auto p = source.iterate();
         std::for_each(std::move(p.first), std::move(p.second),
@@ -99,10 +99,10 @@ void DoublePassVariantCallFilter::record(const CallBlock& block, const std::size
     record(block, measure(block), record_idx, dest_header, samples, annotated_vcf);
 }
 
-void DoublePassVariantCallFilter::record(const std::vector<CallBlock>& blocks, std::size_t record_idx, const VcfHeader& dest_header,
+void DoublePassVariantCallFilter::record(const std::vector<CallBlock>& blocks, const std::vector<MeasureBlock>& measures,
+                                         std::size_t record_idx, const VcfHeader& dest_header,
                                          const SampleList& samples, OptionalVcfWriter& annotated_vcf) const
 {
-    const auto measures = measure(blocks);
     assert(measures.size() == blocks.size());
     for (auto tup : boost::combine(blocks, measures)) {
         const auto& block = tup.get<0>();
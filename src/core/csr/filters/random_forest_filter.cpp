@@ -16,8 +16,6 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem/operations.hpp>
 
-#include "ranger/ForestProbability.h"
-
 #include "utils/concat.hpp"
 #include "utils/append.hpp"
 #include "utils/maths.hpp"
@@ -100,8 +98,33 @@ progress
 }
 {}
 
+class MalformedForestFile : public MalformedFileError
+{
+    std::string do_where() const override { return "RandomForestFilter"; }
+    std::string do_help() const override
+    {
+        return "make sure the forest was trained with the same measures and in the same order as the prediction measures";
+    }
+public:
+    MalformedForestFile(boost::filesystem::path file) : MalformedFileError {std::move(file)} {}
+};
+
 namespace {
 
+auto compile_forests(const std::vector<RandomForestFilter::Path>& forest_paths)
+{
+    std::vector<ranger::CompiledForestProbability> result {};
+    result.reserve(forest_paths.size());
+    for (const auto& path : forest_paths) {
+        try {
+            result.emplace_back(path.string());
+        } catch (const std::runtime_error& e) {
+            throw MalformedForestFile {path};
+        }
+    }
+    return result;
+}
+
 auto concat(const std::vector<std::vector<MeasureWrapper>>& measures)
 {
     std::vector<MeasureWrapper> result {};
@@ -127,19 +150,23 @@ RandomForestFilter::RandomForestFilter(FacetFactory facet_factory,
                                concat(concat(forest_measures), chooser_measures),
                                std::move(output_config), threading, std::move(temp_directory), progress}
 , forest_paths_ {std::move(ranger_forests)}
+, forests_ {compile_forests(forest_paths_)}
 , chooser_ {std::move(chooser)}
 , forest_measure_info_ {}
 , num_chooser_measures_ {chooser_measures.size()}
 , options_ {std::move(options)}
-, threading_ {threading}
 , num_records_ {0}
 , data_buffer_ {}
 {
-    forest_measure_info_.reserve(ranger_forests.size());
+    forest_measure_info_.reserve(forest_paths_.size());
     std::size_t index {0};
-    for (const auto& measures : forest_measures) {
-        forest_measure_info_.push_back({index, measures.size()});
-        index += measures.size();
+    for (std::size_t forest_idx {0}; forest_idx < forest_measures.size(); ++forest_idx) {
+        const auto num_measures = forest_measures[forest_idx].size();
+        if (forests_[forest_idx].getNumIndependentVariables() != num_measures) {
+            throw MalformedForestFile {forest_paths_[forest_idx]};
+        }
+        forest_measure_info_.push_back({index, num_measures});
+        index += num_measures;
     }
 }
 
@@ -151,11 +178,6 @@ std::string RandomForestFilter::do_name() const
 const std::string RandomForestFilter::genotype_quality_name_ = "RFGQ";
 const std::string RandomForestFilter::call_quality_name_ = "RFGQ_ALL";
 
-std::unique_ptr<ranger::Forest> RandomForestFilter::make_forest() const
-{
-    return std::make_unique<ranger::ForestProbability>();
-}
-
 boost::optional<std::string> RandomForestFilter::genotype_quality_name() const
 {
     return genotype_quality_name_;
@@ -189,11 +211,9 @@ std::int8_t RandomForestFilter::choose_forest(const MeasureVector& measures) con
     return chooser_(chooser_measures);
 }
 
-template <typename T>
-static void write_line(const std::vector<T>& data, std::ostream& out)
+static void write_row(const std::vector<double>& data, std::ostream& out)
 {
-    std::copy(std::cbegin(data), std::prev(std::cend(data)), std::ostream_iterator<T> {out, " "});
-    out << data.back() << '\n';
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(double));
 }
 
 void RandomForestFilter::prepare_for_registration(const SampleList& samples) const
@@ -201,20 +221,12 @@ void RandomForestFilter::prepare_for_registration(const SampleList& samples) con
     const auto num_forests = forest_paths_.size();
     data_.resize(num_forests);
     for (std::size_t forest_idx {0}; forest_idx < num_forests; ++forest_idx) {
-        const auto& info = forest_measure_info_[forest_idx];
-        std::vector<std::string> data_header {};
-        const auto first_measure = std::next(std::cbegin(measures_), info.start_index);
-        data_header.reserve(info.number + 1);
-        std::transform(first_measure, std::next(first_measure, info.number),
-                       std::back_inserter(data_header), [] (const auto& measure) { return measure.name(); });
-        data_header.push_back("TP");
         data_[forest_idx].reserve(samples.size());
         for (const auto& sample : samples) {
             auto data_path = temp_directory();
             Path fname {"octopus_ranger_temp_forest_data_" + std::to_string(forest_idx) + "_" + sample + ".dat"};
             data_path /= fname;
-            data_[forest_idx].emplace_back(data_path.string(), data_path);
-            write_line(data_header, data_[forest_idx].back().handle);
+            data_[forest_idx].emplace_back(std::ofstream {data_path.string(), std::ios::binary}, data_path);
         }
     }
     data_buffer_.resize(num_forests);
@@ -282,11 +294,6 @@ void check_nan(const std::vector<double>& values)
     }
 }
 
-void skip_lines(std::istream& in, int n = 1)
-{
-    for (; n > 0; --n) in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-}
-
 } // namespace
 
 void RandomForestFilter::record(const std::size_t call_idx, std::size_t sample_idx, MeasureVector measures) const
@@ -302,9 +309,8 @@ void RandomForestFilter::record(const std::size_t call_idx, std::size_t sample_i
         std::transform(first_measure, std::next(first_measure, info.number),
                        std::next(std::cbegin(this->measures_), info.start_index),
                        std::back_inserter(buffer), cast_to_double);
-        buffer.push_back(0); // dummy TP value
         check_nan(buffer);
-        write_line(buffer, data_[forest_idx][sample_idx].handle);
+        write_row(buffer, data_[forest_idx][sample_idx].handle);
         buffer.clear();
     } else {
         hard_filtered_record_indices_.push_back(call_idx);
@@ -324,85 +330,59 @@ void RandomForestFilter::close_data_files() const
 
 namespace {
 
-bool read_header(std::ifstream& prediction_file)
-{
-    skip_lines(prediction_file);
-    std::string order;
-    std::getline(prediction_file, order);
-    skip_lines(prediction_file);
-    return order.front() == '1';
-}
+// Rows are streamed through the forest in chunks to keep memory bounded
+constexpr std::size_t prediction_chunk_size {4096};
 
-static double get_prob_false(std::string& prediction_line, const bool tp_first)
+double get_prob_false(const ranger::CompiledForestProbability& forest, const double* class_probabilities)
 {
-    using std::cbegin; using std::cend;
-    if (tp_first) {
-        prediction_line.erase(cbegin(prediction_line), std::next(std::find(cbegin(prediction_line), cend(prediction_line), ' ')));
-        prediction_line.erase(std::find(cbegin(prediction_line), cend(prediction_line), ' '), cend(prediction_line));
-    } else {
-        prediction_line.erase(std::find(cbegin(prediction_line), cend(prediction_line), ' '), cend(prediction_line));
+    // Training data labels true positives 1 and false positives 0
+    const auto false_class_idx = forest.getClassIndex(0);
+    if (false_class_idx < forest.getClassValues().size()) {
+        return class_probabilities[false_class_idx];
     }
-    return boost::lexical_cast<double>(prediction_line);
+    const auto true_class_idx = forest.getClassIndex(1);
+    return true_class_idx < forest.getClassValues().size() ? 1.0 - class_probabilities[true_class_idx] : 0.0;
 }
-    
-} // namespace
 
-class MalformedForestFile : public MalformedFileError
-{
-    std::string do_where() const override { return "RandomForestFilter"; }
-    std::string do_help() const override
-    {
-        return "make sure the forest was trained with the same measures and in the same order as the prediction measures";
-    }
-public:
-    MalformedForestFile(boost::filesystem::path file) : MalformedFileError {std::move(file)} {}
-};
+} // namespace
 
 void RandomForestFilter::prepare_for_classification(boost::optional<Log>& log) const
 {
     close_data_files();
     if (num_records_ == 0) return;
-    const Path ranger_prefix {temp_directory() / "octopus_ranger_temp"};
-    const Path ranger_prediction_fname {ranger_prefix.string() + ".prediction"};
     data_buffer_.resize(1);
     auto& predictions = data_buffer_[0];
     predictions.resize(num_records_);
     const auto num_samples = choices_.size();
+    std::vector<double> rows {}, class_probabilities {};
     for (std::size_t forest_idx {0}; forest_idx < forest_paths_.size(); ++forest_idx) {
+        const auto& forest = forests_[forest_idx];
+        const auto num_measures = forest_measure_info_[forest_idx].number;
+        const auto num_classes = forest.getClassValues().size();
+        rows.resize(prediction_chunk_size * num_measures);
+        class_probabilities.resize(prediction_chunk_size * num_classes);
         for (std::size_t sample_idx {0}; sample_idx < num_samples; ++sample_idx) {
             auto forest_choice_itr = std::find(std::cbegin(choices_[sample_idx]), std::cend(choices_[sample_idx]), forest_idx);
             if (forest_choice_itr != std::cend(choices_[sample_idx])) {
                 const auto& file = data_[forest_idx][sample_idx];
-                std::vector<std::string> tmp {}, cat_vars {};
-                const auto ranger_threads = threading_.max_threads ? *threading_.max_threads : 1u;
-                const auto forest = make_forest();
-                try {
-                    forest->initCpp("", ranger::MemoryMode::MEM_DOUBLE, file.path.string(), 0, ranger_prefix.string(),
-                                    1000, nullptr, 12, ranger_threads, forest_paths_[forest_idx].string(), ranger::ImportanceMode::IMP_GINI, 1, "",
-                                    tmp, "", true, cat_vars, false, ranger::SplitRule::LOGRANK, "", false, 1.0,
-                                    ranger::DEFAULT_ALPHA, ranger::DEFAULT_MINPROP, false,
-                                    ranger::PredictionType::RESPONSE, ranger::DEFAULT_NUM_RANDOM_SPLITS, ranger::DEFAULT_MAXDEPTH);
-                } catch (const std::runtime_error& e) {
-                    throw MalformedForestFile {forest_paths_[forest_idx]};
-                }
-                forest->run(false, false);
-                forest->writePredictionFile();
-                std::ifstream prediction_file {ranger_prediction_fname.string()};
-                const auto tp_first = read_header(prediction_file);
-                std::string line;
-                while (std::getline(prediction_file, line)) {
-                    if (!line.empty()) {
-                        const auto record_idx = std::distance(std::cbegin(choices_[sample_idx]), forest_choice_itr);
-                        predictions[record_idx].push_back(get_prob_false(line, tp_first));
+                std::ifstream data_file {file.path.string(), std::ios::binary};
+                while (data_file) {
+                    data_file.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(double));
+                    const auto num_rows = static_cast<std::size_t>(data_file.gcount()) / (num_measures * sizeof(double));
+                    if (num_rows == 0) break;
+                    forest.predict(rows.data(), num_rows, class_probabilities.data());
+                    for (std::size_t row_idx {0}; row_idx < num_rows; ++row_idx) {
                         assert(forest_choice_itr != std::cend(choices_[sample_idx]));
+                        const auto record_idx = std::distance(std::cbegin(choices_[sample_idx]), forest_choice_itr);
+                        predictions[record_idx].push_back(get_prob_false(forest, class_probabilities.data() + row_idx * num_classes));
                         forest_choice_itr = std::find(std::next(forest_choice_itr), std::cend(choices_[sample_idx]), forest_idx);
                     }
                 }
+                data_file.close();
                 boost::filesystem::remove(file.path);
             }
         }
     }
-    boost::filesystem::remove(ranger_prediction_fname);
     data_.clear();
     data_.shrink_to_fit();
     choices_.clear();
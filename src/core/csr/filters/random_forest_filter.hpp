@@ -14,7 +14,7 @@
 #include <boost/optional.hpp>
 #include <boost/filesystem.hpp>
 
-#include "ranger/Forest.h"
+#include "ranger/CompiledForest.h"
 
 #include "basics/phred.hpp"
 #include "double_pass_variant_call_filter.hpp"
@@ -78,12 +78,11 @@ private:
     };
     
     std::vector<Path> forest_paths_;
-    std::vector<std::unique_ptr<ranger::Forest>> forests_;
+    std::vector<ranger::CompiledForestProbability> forests_;
     std::function<std::int8_t(std::vector<Measure::ResultType>)> chooser_;
     std::vector<ForestMeasureInfo> forest_measure_info_;
     std::size_t num_chooser_measures_;
     Options options_;
-    ConcurrencyPolicy threading_;
     
     mutable std::vector<std::vector<File>> data_;
     mutable std::size_t num_records_;
@@ -111,7 +110,6 @@ private:
     virtual bool is_soft_filtered(const ClassificationList& sample_classifications, boost::optional<Phred<double>> joint_quality,
                                   const MeasureVector& measures, std::vector<std::string>& reasons) const override;
     
-    std::unique_ptr<ranger::Forest> make_forest() const;
     boost::optional<std::string> genotype_quality_name() const override;
     std::int8_t choose_forest(const MeasureVector& measures) const;
     void prepare_for_registration(const SampleList& samples) const override;
@@ -31,9 +31,10 @@ void SinglePassVariantCallFilter::filter(const VcfReader& source, VcfWriter& des
     if (progress_) progress_->start();
     const auto samples = source.fetch_header().samples();
     if (can_measure_multiple_blocks()) {
-        for (auto p = source.iterate(); p.first != p.second;) {
-            filter(read_next_blocks(p.first, p.second, samples), dest, dest_header, samples);
-        }
+        auto p = source.iterate();
+        measure_blocks(p.first, p.second, samples, [&] (const auto& blocks, const auto& measures) {
+            filter(blocks, measures, dest, dest_header, samples);
+        });
     } else if (can_measure_single_call()) {
         auto p = source.iterate();
         std::for_each(std::move(p.first), std::move(p.second), [&] (const VcfRecord& call) { filter(call, dest, dest_header, samples); });
@@ -55,9 +56,9 @@ void SinglePassVariantCallFilter::filter(const CallBlock& block, VcfWriter& dest
     filter(block, measure(block), dest, dest_header, samples);
 }
 
-void SinglePassVariantCallFilter::filter(const std::vector<CallBlock>& blocks, VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
+void SinglePassVariantCallFilter::filter(const std::vector<CallBlock>& blocks, const std::vector<MeasureBlock>& measures,
+                                         VcfWriter& dest, const VcfHeader& dest_header, const SampleList& samples) const
 {
-    const auto measures = measure(blocks);
     assert(measures.size() == blocks.size());
     for (auto tup : boost::combine(blocks, measures)) {
         filter(tup.get<0>(), tup.get<1>(), dest, dest_header, samples);
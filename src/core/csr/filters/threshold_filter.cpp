@@ -111,6 +111,16 @@ VariantCallFilter::Classification ThresholdVariantCallFilter::classify(const Mea
     }
 }
 
+bool ThresholdVariantCallFilter::can_hard_filter_without_facets(const VcfRecord& call, const MeasureVector& measures) const
+{
+    // Missing measures pass all thresholds, so only the evaluated measures can fail here
+    if (hard_thresholds_.empty() || call.num_samples() == 0) return false;
+    for (std::size_t sample_idx {0}; sample_idx < call.num_samples(); ++sample_idx) {
+        if (passes_all_hard_filters(get_sample_values(measures, measures_, sample_idx))) return false;
+    }
+    return true;
+}
+
 bool ThresholdVariantCallFilter::passes_all_hard_filters(const MeasureVector& measures) const
 {
     return passes_all_filters(std::cbegin(measures), std::next(std::cbegin(measures), hard_thresholds_.size()),
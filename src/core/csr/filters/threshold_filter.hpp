@@ -89,6 +89,7 @@ private:
     std::string do_name() const override;
     virtual void annotate(VcfHeader::Builder& header) const override;
     virtual Classification classify(const MeasureVector& measures) const override;
+    virtual bool can_hard_filter_without_facets(const VcfRecord& call, const MeasureVector& measures) const override;
     
     virtual bool passes_all_hard_filters(const MeasureVector& measures) const;
     virtual bool passes_all_soft_filters(const MeasureVector& measures) const;
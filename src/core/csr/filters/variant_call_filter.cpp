@@ -12,6 +12,8 @@
 #include <limits>
 #include <cmath>
 #include <thread>
+#include <array>
+#include <future>
 
 #include <boost/range/combine.hpp>
 #include <boost/multiprecision/gmp.hpp>
@@ -27,7 +29,6 @@
 #include "utils/string_utils.hpp"
 #include "utils/genotype_reader.hpp"
 #include "utils/append.hpp"
-#include "utils/parallel_transform.hpp"
 #include "io/variant/vcf_writer.hpp"
 #include "io/variant/vcf_spec.hpp"
 
@@ -55,6 +56,28 @@ bool contains(const std::vector<MeasureWrapper>& measures, const std::string& na
                         [&] (const auto& measure) { return measure.name() == name; }) != std::cend(measures);
 }
 
+auto get_facet_requirements(const std::vector<MeasureWrapper>& measures)
+{
+    std::vector<bool> result(measures.size());
+    std::transform(std::cbegin(measures), std::cend(measures), std::begin(result),
+                   [] (const auto& measure) { return !measure.requirements().empty(); });
+    return result;
+}
+
+auto get_first_equal_indices(const std::vector<MeasureWrapper>& measures)
+{
+    std::vector<std::size_t> result(measures.size());
+    for (std::size_t i {0}; i < measures.size(); ++i) {
+        result[i] = std::distance(std::cbegin(measures), std::find(std::cbegin(measures), std::cend(measures), measures[i]));
+    }
+    return result;
+}
+
+bool any_of(const std::vector<bool>& values) noexcept
+{
+    return std::find(std::cbegin(values), std::cend(values), true) != std::cend(values);
+}
+
 } // namespace
 
 // public methods
@@ -69,6 +92,8 @@ VariantCallFilter::VariantCallFilter(FacetFactory facet_factory,
 , facet_names_ {get_all_requirements(measures_)}
 , output_config_ {output_config}
 , duplicate_measures_ {}
+, measure_requires_facets_ {get_facet_requirements(measures_)}
+, first_equal_measures_ {get_first_equal_indices(measures_)}
 , workers_ {get_pool_size(threading)}
 {
     std::unordered_map<MeasureWrapper, int> measure_counts {};
@@ -262,8 +287,12 @@ VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& cal
 
 VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& block) const
 {
-    const auto facets = compute_facets(block);
-    auto result = measure(block, facets);
+    MeasureBlock result {};
+    const auto requires_facets = measure_without_facets(block, result);
+    if (any_of(requires_facets)) {
+        const auto facets = compute_facets(block);
+        measure_with_facets(block, facets, requires_facets, result);
+    }
     return result;
 }
 
@@ -272,14 +301,39 @@ std::vector<VariantCallFilter::MeasureBlock> VariantCallFilter::measure(const st
     std::vector<MeasureBlock> result {};
     result.reserve(blocks.size());
     if (is_multithreaded()) {
-        const auto facets = compute_facets(blocks);
+        result.resize(blocks.size());
+        std::vector<std::vector<bool>> requires_facets(blocks.size());
+        std::vector<std::size_t> facet_block_indices {};
+        facet_block_indices.reserve(blocks.size());
+        for (std::size_t block_idx {0}; block_idx < blocks.size(); ++block_idx) {
+            requires_facets[block_idx] = measure_without_facets(blocks[block_idx], result[block_idx]);
+            if (any_of(requires_facets[block_idx])) facet_block_indices.push_back(block_idx);
+        }
+        if (facet_block_indices.empty()) return result;
+        std::vector<Measure::FacetMap> facets {};
+        if (facet_block_indices.size() == blocks.size()) {
+            facets = compute_facets(blocks);
+        } else {
+            // Only fetch reads for blocks that still have calls to measure
+            std::vector<CallBlock> facet_blocks {};
+            facet_blocks.reserve(facet_block_indices.size());
+            for (const auto block_idx : facet_block_indices) {
+                facet_blocks.push_back(blocks[block_idx]);
+            }
+            facets = compute_facets(facet_blocks);
+        }
         if (debug_log_) {
-            stream(*debug_log_) << "Measuring " << blocks.size() << " blocks with " << workers_.size() << " threads";
+            stream(*debug_log_) << "Measuring " << facet_block_indices.size() << " blocks with " << workers_.size() << " threads";
         }
-        transform(std::cbegin(blocks), std::cend(blocks), std::cbegin(facets), std::back_inserter(result),
-                  [this] (const auto& block, const auto& block_facets) {
-                      return this->measure(block, block_facets);
-                  }, workers_);
+        std::vector<std::future<void>> futures {};
+        futures.reserve(facet_block_indices.size());
+        for (std::size_t i {0}; i < facet_block_indices.size(); ++i) {
+            const auto block_idx = facet_block_indices[i];
+            futures.push_back(workers_.push([&, i, block_idx] () {
+                measure_with_facets(blocks[block_idx], facets[i], requires_facets[block_idx], result[block_idx]);
+            }));
+        }
+        for (auto& future : futures) future.get();
     } else {
         for (const CallBlock& block : blocks) {
             result.push_back(measure(block));
@@ -288,6 +342,35 @@ std::vector<VariantCallFilter::MeasureBlock> VariantCallFilter::measure(const st
     return result;
 }
 
+void VariantCallFilter::measure_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples,
+                                       const BlockBatchVisitor& visitor) const
+{
+    // Batches of blocks go through a two slot ring buffer: the next batch is read from the source, and the
+    // previous batch visited, while the current batch is measured. So reading, measuring, and writing all
+    // overlap, but no more than two batches are ever held in memory.
+    const auto measure_async = [this] (const std::vector<CallBlock>& batch) {
+        return std::async(std::launch::async, [this, &batch] () { return this->measure(batch); });
+    };
+    std::array<std::vector<CallBlock>, 2> batches {};
+    std::size_t current {0};
+    if (first == last) return;
+    batches[current] = read_next_blocks(first, last, samples);
+    auto measures = measure_async(batches[current]);
+    while (!batches[current].empty()) {
+        auto& next_batch = batches[1 - current];
+        next_batch.clear();
+        if (first != last) {
+            next_batch = read_next_blocks(first, last, samples);
+        }
+        const auto current_measures = measures.get();
+        if (!next_batch.empty()) {
+            measures = measure_async(next_batch);
+        }
+        visitor(batches[current], current_measures);
+        current = 1 - current;
+    }
+}
+
 void VariantCallFilter::write(const VcfRecord& call, const Classification& classification, VcfWriter& dest) const
 {
     if (!is_hard_filtered(classification)) {
@@ -526,40 +609,52 @@ std::vector<Measure::FacetMap> VariantCallFilter::compute_facets(const std::vect
     return result;
 }
 
-VariantCallFilter::MeasureBlock VariantCallFilter::measure(const CallBlock& block, const Measure::FacetMap& facets) const
+std::vector<bool> VariantCallFilter::measure_without_facets(const CallBlock& block, MeasureBlock& result) const
+{
+    result.resize(block.size());
+    std::vector<bool> requires_facets(block.size(), false);
+    for (std::size_t call_idx {0}; call_idx < block.size(); ++call_idx) {
+        result[call_idx] = measure_without_facets(block[call_idx]);
+        if (!facet_names_.empty()) {
+            requires_facets[call_idx] = !can_hard_filter_without_facets(block[call_idx], result[call_idx]);
+        }
+    }
+    return requires_facets;
+}
+
+VariantCallFilter::MeasureVector VariantCallFilter::measure_without_facets(const VcfRecord& call) const
+{
+    MeasureVector result(measures_.size(), Measure::Optional<Measure::ValueType> {});
+    for (std::size_t i {0}; i < measures_.size(); ++i) {
+        if (!measure_requires_facets_[i]) {
+            const auto first_equal_idx = first_equal_measures_[i];
+            result[i] = first_equal_idx < i ? result[first_equal_idx] : measures_[i](call);
+        }
+    }
+    return result;
+}
+
+void VariantCallFilter::measure_with_facets(const CallBlock& block, const Measure::FacetMap& facets,
+                                            const std::vector<bool>& requires_facets, MeasureBlock& result) const
 {
     if (debug_log_ && !block.empty()) {
         stream(*debug_log_) << "Measuring block " << encompassing_region(block) << " containing " << block.size() << " calls";
     }
-    MeasureBlock result(block.size());
-    std::transform(std::cbegin(block), std::cend(block), std::begin(result),
-                   [&] (const VcfRecord& call) { return this->measure(call, facets); });
-    return result;
+    for (std::size_t call_idx {0}; call_idx < block.size(); ++call_idx) {
+        if (requires_facets[call_idx]) {
+            measure_with_facets(block[call_idx], facets, result[call_idx]);
+        }
+    }
 }
 
-VariantCallFilter::MeasureVector VariantCallFilter::measure(const VcfRecord& call, const Measure::FacetMap& facets) const
+void VariantCallFilter::measure_with_facets(const VcfRecord& call, const Measure::FacetMap& facets, MeasureVector& result) const
 {
-    MeasureVector result(measures_.size());
-    if (duplicate_measures_.empty()) {
-        std::transform(std::cbegin(measures_), std::cend(measures_), std::begin(result),
-                       [&] (const MeasureWrapper& m) { return m(call, facets); });
-    } else {
-        std::unordered_map<MeasureWrapper, Measure::ResultType> result_buffer {};
-        result_buffer.reserve(duplicate_measures_.size());
-        for (const auto& m : duplicate_measures_) {
-            result_buffer.emplace(m, m(call, facets));
+    for (std::size_t i {0}; i < measures_.size(); ++i) {
+        if (measure_requires_facets_[i]) {
+            const auto first_equal_idx = first_equal_measures_[i];
+            result[i] = first_equal_idx < i ? result[first_equal_idx] : measures_[i](call, facets);
         }
-        std::transform(std::cbegin(measures_), std::cend(measures_), std::begin(result),
-                       [&] (const MeasureWrapper& m) -> Measure::ResultType {
-                           auto itr = result_buffer.find(m);
-                           if (itr != std::cend(result_buffer)) {
-                               return itr->second;
-                           } else {
-                               return m(call, facets);
-                           }
-                       });
     }
-    return result;
 }
 
 void VariantCallFilter::pass(const SampleName& sample, VcfRecord::Builder& call) const
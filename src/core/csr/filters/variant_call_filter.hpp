@@ -76,6 +76,7 @@ protected:
     using VcfIterator   = VcfReader::RecordIterator;
     using CallBlock     = std::vector<VcfRecord>;
     using MeasureBlock  = std::vector<MeasureVector>;
+    using BlockBatchVisitor = std::function<void(const std::vector<CallBlock>&, const std::vector<MeasureBlock>&)>;
     
     struct Classification
     {
@@ -98,6 +99,8 @@ protected:
     MeasureVector measure(const VcfRecord& call) const;
     MeasureBlock measure(const CallBlock& block) const;
     std::vector<MeasureBlock> measure(const std::vector<CallBlock>& blocks) const;
+    void measure_blocks(VcfIterator& first, const VcfIterator& last, const SampleList& samples,
+                        const BlockBatchVisitor& visitor) const;
     void write(const VcfRecord& call, const Classification& classification, VcfWriter& dest) const;
     void write(const VcfRecord& call, const Classification& classification,
                const SampleList& samples, const ClassificationList& sample_classifications,
@@ -114,6 +117,8 @@ private:
     FacetNameSet facet_names_;
     OutputOptions output_config_;
     std::vector<MeasureWrapper> duplicate_measures_;
+    std::vector<bool> measure_requires_facets_;
+    std::vector<std::size_t> first_equal_measures_;
     
     mutable ThreadPool workers_;
     
@@ -122,6 +127,9 @@ private:
     virtual void filter(const VcfReader& source, VcfWriter& dest, const VcfHeader& dest_header) const = 0;
     virtual boost::optional<std::string> call_quality_name() const { return boost::none; }
     virtual boost::optional<std::string> genotype_quality_name() const { return boost::none; }
+    // Called with the values of the measures that do not require facets, with all other values missing.
+    // If true is returned the call must be hard filtered, so its other measures are never evaluated.
+    virtual bool can_hard_filter_without_facets(const VcfRecord& call, const MeasureVector& measures) const { return false; }
     virtual boost::optional<Phred<double>> compute_joint_quality(const ClassificationList& sample_classifications, const MeasureVector& measures) const;
     virtual bool is_soft_filtered(const ClassificationList& sample_classifications, boost::optional<Phred<double>> joint_quality,
                                   const MeasureVector& measures, std::vector<std::string>& reasons) const;
@@ -129,8 +137,11 @@ private:
     VcfHeader make_header(const VcfReader& source) const;
     Measure::FacetMap compute_facets(const CallBlock& block) const;
     std::vector<Measure::FacetMap> compute_facets(const std::vector<CallBlock>& blocks) const;
-    MeasureBlock measure(const CallBlock& block, const Measure::FacetMap& facets) const;
-    MeasureVector measure(const VcfRecord& call, const Measure::FacetMap& facets) const;
+    std::vector<bool> measure_without_facets(const CallBlock& block, MeasureBlock& result) const;
+    MeasureVector measure_without_facets(const VcfRecord& call) const;
+    void measure_with_facets(const CallBlock& block, const Measure::FacetMap& facets,
+                             const std::vector<bool>& requires_facets, MeasureBlock& result) const;
+    void measure_with_facets(const VcfRecord& call, const Measure::FacetMap& facets, MeasureVector& result) const;
     VcfRecord::Builder construct_template(const VcfRecord& call) const;
     bool is_requested_annotation(const MeasureWrapper& measure) const noexcept;
     bool is_hard_filtered(const Classification& classification) const noexcept;
@@ -0,0 +1,92 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef best_first_join_hpp
+#define best_first_join_hpp
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <limits>
+#include <cstddef>
+
+namespace octopus { namespace model {
+
+struct PrunedJoints
+{
+    std::size_t count = 0;
+    double max_log_probability = std::numeric_limits<double>::lowest();
+};
+
+namespace detail {
+
+struct JointSearchBound
+{
+    double log_probability;
+    std::size_t first, second;
+};
+
+inline bool operator<(const JointSearchBound& lhs, const JointSearchBound& rhs) noexcept
+{
+    return lhs.log_probability < rhs.log_probability;
+}
+
+template <typename Iterator>
+auto sort_by_probability(const Iterator first, const Iterator last)
+{
+    std::vector<Iterator> result(std::distance(first, last));
+    std::iota(std::begin(result), std::end(result), first);
+    std::sort(std::begin(result), std::end(result), [] (auto lhs, auto rhs) { return lhs->probability > rhs->probability; });
+    return result;
+}
+
+} // namespace detail
+
+// Joins every element of [first1, last1) with every element of [first2, last2), best-first.
+// make_joint must return a joint with a log_probability no greater than the sum of the two component
+// probabilities (e.g. the sum plus a log probability), so pairs are visited in order of decreasing bound
+// and the search stops once the bound falls min_log_probability_ratio below the best joint found. Every
+// joint within min_log_probability_ratio of the best joint is appended to result. Pairs not visited are
+// summarised in pruned, so the caller can account for the mass they could have contributed.
+template <typename Iterator1, typename Iterator2, typename F, typename Joint>
+void join_best_first(const Iterator1 first1, const Iterator1 last1,
+                     const Iterator2 first2, const Iterator2 last2,
+                     F make_joint,
+                     const double min_log_probability_ratio,
+                     std::vector<Joint>& result,
+                     PrunedJoints& pruned)
+{
+    if (first1 == last1 || first2 == last2) return;
+    const auto sorted1 = detail::sort_by_probability(first1, last1);
+    const auto sorted2 = detail::sort_by_probability(first2, last2);
+    const auto bound = [&] (std::size_t i, std::size_t j) -> detail::JointSearchBound {
+        return {sorted1[i]->probability + sorted2[j]->probability, i, j};
+    };
+    // Each pair (i, j) is reached from (i, j - 1), or from (i - 1, 0) when j == 0, which has an
+    // equal or larger bound, so every pair is pushed exactly once and popped in bound order
+    std::priority_queue<detail::JointSearchBound> frontier {};
+    frontier.push(bound(0, 0));
+    auto max_log_probability = std::numeric_limits<double>::lowest();
+    std::size_t num_visited {0};
+    while (!frontier.empty()) {
+        const auto next = frontier.top();
+        if (next.log_probability < max_log_probability + min_log_probability_ratio) break;
+        frontier.pop();
+        result.push_back(make_joint(*sorted1[next.first], *sorted2[next.second]));
+        ++num_visited;
+        max_log_probability = std::max(result.back().log_probability, max_log_probability);
+        if (next.second + 1 < sorted2.size()) frontier.push(bound(next.first, next.second + 1));
+        if (next.second == 0 && next.first + 1 < sorted1.size()) frontier.push(bound(next.first + 1, 0));
+    }
+    if (!frontier.empty()) {
+        pruned.count += sorted1.size() * sorted2.size() - num_visited;
+        pruned.max_log_probability = std::max(frontier.top().log_probability, pruned.max_log_probability);
+    }
+}
+
+} // namespace model
+} // namespace octopus
+
+#endif
@@ -10,10 +10,14 @@
 #include <limits>
 #include <cassert>
 #include <exception>
+#include <numeric>
+#include <functional>
+#include <future>
 
 #include "utils/maths.hpp"
 #include "utils/select_top_k.hpp"
 #include "utils/concat.hpp"
+#include "utils/thread_pool.hpp"
 #include "constant_mixture_genotype_likelihood_model.hpp"
 #include "hardy_weinberg_model.hpp"
 
@@ -44,32 +48,73 @@ using LogProbability = double;
 using GenotypeLogLikelihoodVector  = std::vector<LogProbability>;
 using GenotypeLogLikelihoodMatrix  = std::vector<GenotypeLogLikelihoodVector>;
 
-struct GenotypeLogProbability
+using GenotypeMarginalPosteriorVector  = std::vector<double>;
+using GenotypeMarginalPosteriorMatrix  = std::vector<GenotypeMarginalPosteriorVector>; // for each sample
+
+// Genotypes that are not (effectively) supported by a sample's reads are removed from the sample's EM support
+struct SparseGenotypeLogLikelihoodVector
 {
-    const Genotype<IndexedHaplotype<>>& genotype;
-    double log_probability;
+    std::vector<unsigned> genotype_indices;
+    GenotypeLogLikelihoodVector log_likelihoods;
 };
-using GenotypeLogMarginalVector = std::vector<GenotypeLogProbability>;
+using SparseGenotypeLogLikelihoodMatrix = std::vector<SparseGenotypeLogLikelihoodVector>;
 
-using GenotypeMarginalPosteriorVector  = std::vector<double>;
-using GenotypeMarginalPosteriorMatrix  = std::vector<GenotypeMarginalPosteriorVector>; // for each sample
+using GenotypeHaplotypeTable = std::vector<std::vector<unsigned>>;
+using HaplotypeCountVector   = std::vector<double>;
+
+auto make_genotype_haplotype_table(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes)
+{
+    GenotypeHaplotypeTable result(genotypes.size());
+    std::transform(std::cbegin(genotypes), std::cend(genotypes), std::begin(result), [] (const auto& genotype) {
+        std::vector<unsigned> haplotype_indices {};
+        haplotype_indices.reserve(genotype.ploidy());
+        for (const auto& haplotype : genotype) {
+            haplotype_indices.push_back(static_cast<unsigned>(index_of(haplotype)));
+        }
+        std::sort(std::begin(haplotype_indices), std::end(haplotype_indices));
+        haplotype_indices.erase(std::unique(std::begin(haplotype_indices), std::end(haplotype_indices)), std::end(haplotype_indices));
+        return haplotype_indices;
+    });
+    return result;
+}
+
+SparseGenotypeLogLikelihoodVector
+make_sparse(const GenotypeLogLikelihoodVector& genotype_log_likelihoods, const double min_log_likelihood_ratio)
+{
+    assert(!genotype_log_likelihoods.empty());
+    const auto min_log_likelihood = *std::max_element(std::cbegin(genotype_log_likelihoods), std::cend(genotype_log_likelihoods)) + min_log_likelihood_ratio;
+    SparseGenotypeLogLikelihoodVector result {};
+    for (unsigned genotype_idx {0}; genotype_idx < genotype_log_likelihoods.size(); ++genotype_idx) {
+        if (genotype_log_likelihoods[genotype_idx] >= min_log_likelihood) {
+            result.genotype_indices.push_back(genotype_idx);
+            result.log_likelihoods.push_back(genotype_log_likelihoods[genotype_idx]);
+        }
+    }
+    return result;
+}
 
-using InverseGenotypeTable = std::vector<std::vector<std::size_t>>;
+SparseGenotypeLogLikelihoodMatrix
+make_sparse(const GenotypeLogLikelihoodMatrix& genotype_log_likelihoods, const double min_log_likelihood_ratio)
+{
+    SparseGenotypeLogLikelihoodMatrix result {};
+    result.reserve(genotype_log_likelihoods.size());
+    for (const auto& sample_genotype_log_likelihoods : genotype_log_likelihoods) {
+        result.push_back(make_sparse(sample_genotype_log_likelihoods, min_log_likelihood_ratio));
+    }
+    return result;
+}
 
-auto make_inverse_genotype_table(const MappableBlock<Genotype<IndexedHaplotype<>>>& genotypes,
-                                 const std::size_t num_haplotypes)
+auto get_supported_genotypes(const SparseGenotypeLogLikelihoodMatrix& genotype_log_likelihoods, const std::size_t num_genotypes)
 {
-    InverseGenotypeTable result(num_haplotypes);
-    for (auto& indices : result) indices.reserve(genotypes.size() / num_haplotypes);
-    for (std::size_t genotype_idx {0}; genotype_idx < genotypes.size(); ++genotype_idx) {
-        for (const auto& haplotype : genotypes[genotype_idx]) {
-            result[index_of(haplotype)].push_back(genotype_idx);
+    std::vector<bool> is_supported(num_genotypes, false);
+    for (const auto& sample_genotype_log_likelihoods : genotype_log_likelihoods) {
+        for (const auto genotype_idx : sample_genotype_log_likelihoods.genotype_indices) {
+            is_supported[genotype_idx] = true;
         }
     }
-    for (auto& indices : result) {
-        std::sort(std::begin(indices), std::end(indices));
-        indices.erase(std::unique(std::begin(indices), std::end(indices)), std::end(indices));
-        indices.shrink_to_fit();
+    std::vector<unsigned> result {};
+    for (unsigned genotype_idx {0}; genotype_idx < num_genotypes; ++genotype_idx) {
+        if (is_supported[genotype_idx]) result.push_back(genotype_idx);
     }
     return result;
 }
@@ -81,39 +126,65 @@ double calculate_frequency_update_norm(const std::size_t num_samples, const unsi
 
 double calculate_frequency_update_norm(const std::vector<unsigned>& sample_ploidies) noexcept
 {
-    return std::accumulate(std::cbegin(sample_ploidies), std::cend(sample_ploidies), 0.0, std::multiplies<> {});
+    return std::accumulate(std::cbegin(sample_ploidies), std::cend(sample_ploidies), 0.0);
 }
 
 struct EMOptions
 {
     unsigned max_iterations;
     double epsilon;
+    double min_genotype_log_likelihood_ratio;
+    boost::optional<ThreadPool&> workers;
 };
 
+// Samples are processed in fixed size blocks so haplotype counts are always reduced in
+// the same order, and results do not depend on the number of threads
+using SampleBlock = std::pair<std::size_t, std::size_t>;
+
+constexpr std::size_t sample_block_size {32};
+
+auto make_sample_blocks(const std::size_t num_samples)
+{
+    std::vector<SampleBlock> result {};
+    result.reserve(num_samples / sample_block_size + 1);
+    for (std::size_t block_begin {0}; block_begin < num_samples; block_begin += sample_block_size) {
+        result.emplace_back(block_begin, std::min(block_begin + sample_block_size, num_samples));
+    }
+    return result;
+}
+
 struct ModelConstants
 {
     const PopulationModel::GenotypeVector& genotypes;
-    const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods;
-    const InverseGenotypeTable genotypes_containing_haplotypes;
+    const SparseGenotypeLogLikelihoodMatrix genotype_log_likilhoods;
+    const std::vector<unsigned> supported_genotypes;
+    const GenotypeHaplotypeTable genotype_haplotypes;
+    const std::vector<SampleBlock> sample_blocks;
     const std::size_t num_haplotypes;
     const double frequency_update_norm;
     
     ModelConstants(const MappableBlock<Haplotype>& haplotypes,
                    const PopulationModel::GenotypeVector& genotypes,
-                   const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
+                   const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods,
+                   const EMOptions& options)
     : genotypes {genotypes}
-    , genotype_log_likilhoods {genotype_log_likilhoods}
-    , genotypes_containing_haplotypes {make_inverse_genotype_table(genotypes, haplotypes.size())}
+    , genotype_log_likilhoods {make_sparse(genotype_log_likilhoods, options.min_genotype_log_likelihood_ratio)}
+    , supported_genotypes {get_supported_genotypes(this->genotype_log_likilhoods, genotypes.size())}
+    , genotype_haplotypes {make_genotype_haplotype_table(genotypes)}
+    , sample_blocks {make_sample_blocks(genotype_log_likilhoods.size())}
     , num_haplotypes {haplotypes.size()}
     , frequency_update_norm {calculate_frequency_update_norm(genotype_log_likilhoods.size(), genotypes.front().ploidy())}
     {}
     ModelConstants(const MappableBlock<Haplotype>& haplotypes,
                    const PopulationModel::GenotypeVector& genotypes,
                    const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods,
-                   const std::vector<unsigned>& sample_ploidies)
+                   const std::vector<unsigned>& sample_ploidies,
+                   const EMOptions& options)
     : genotypes {genotypes}
-    , genotype_log_likilhoods {genotype_log_likilhoods}
-    , genotypes_containing_haplotypes {make_inverse_genotype_table(genotypes, haplotypes.size())}
+    , genotype_log_likilhoods {make_sparse(genotype_log_likilhoods, options.min_genotype_log_likelihood_ratio)}
+    , supported_genotypes {get_supported_genotypes(this->genotype_log_likilhoods, genotypes.size())}
+    , genotype_haplotypes {make_genotype_haplotype_table(genotypes)}
+    , sample_blocks {make_sample_blocks(genotype_log_likilhoods.size())}
     , num_haplotypes {haplotypes.size()}
     , frequency_update_norm {calculate_frequency_update_norm(sample_ploidies)}
     {}
@@ -170,86 +241,97 @@ compute_genotype_log_likelihoods(const std::vector<SampleName>& samples,
     return result;
 }
 
-GenotypeLogMarginalVector
-init_genotype_log_marginals(const PopulationModel::GenotypeVector& genotypes,
-                            const HardyWeinbergModel& hw_model)
+// Only genotypes in the support of some sample are evaluated; other entries are never read
+void update_genotype_log_marginals(GenotypeLogLikelihoodVector& genotype_log_marginals,
+                                   const HardyWeinbergModel& hw_model,
+                                   const ModelConstants& constants)
 {
-    GenotypeLogMarginalVector result {};
-    result.reserve(genotypes.size());
-    for (const auto& genotype : genotypes) {
-        result.push_back({genotype, hw_model.evaluate(genotype)});
+    for (const auto genotype_idx : constants.supported_genotypes) {
+        genotype_log_marginals[genotype_idx] = hw_model.evaluate(constants.genotypes[genotype_idx]);
     }
-    return result;
 }
 
-void update_genotype_log_marginals(GenotypeLogMarginalVector& current_log_marginals,
-                                   const HardyWeinbergModel& hw_model)
+void update_genotype_posteriors(GenotypeMarginalPosteriorVector& sample_genotype_posteriors,
+                                const GenotypeLogLikelihoodVector& genotype_log_marginals,
+                                const SparseGenotypeLogLikelihoodVector& sample_genotype_log_likilhoods)
 {
-    std::for_each(std::begin(current_log_marginals), std::end(current_log_marginals),
-                  [&hw_model] (auto& p) { p.log_probability = hw_model.evaluate(p.genotype); });
+    const auto num_genotypes = sample_genotype_log_likilhoods.genotype_indices.size();
+    sample_genotype_posteriors.resize(num_genotypes);
+    for (std::size_t i {0}; i < num_genotypes; ++i) {
+        sample_genotype_posteriors[i] = genotype_log_marginals[sample_genotype_log_likilhoods.genotype_indices[i]]
+                                        + sample_genotype_log_likilhoods.log_likelihoods[i];
+    }
+    maths::normalise_exp(sample_genotype_posteriors);
 }
 
-GenotypeMarginalPosteriorMatrix
-init_genotype_posteriors(const GenotypeLogMarginalVector& genotype_log_marginals,
-                         const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
+void add_haplotype_counts(const GenotypeMarginalPosteriorVector& sample_genotype_posteriors,
+                          const SparseGenotypeLogLikelihoodVector& sample_genotype_log_likilhoods,
+                          const GenotypeHaplotypeTable& genotype_haplotypes,
+                          HaplotypeCountVector& result)
 {
-    GenotypeMarginalPosteriorMatrix result {};
-    result.reserve(genotype_log_likilhoods.size());
-    for (const auto& sample_genotype_log_likilhoods : genotype_log_likilhoods) {
-        GenotypeMarginalPosteriorVector posteriors(genotype_log_marginals.size());
-        std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
-                       std::cbegin(sample_genotype_log_likilhoods), std::begin(posteriors),
-                       [] (const auto& genotype_log_marginal, const auto genotype_log_likilhood) {
-                           return genotype_log_marginal.log_probability + genotype_log_likilhood;
-                       });
-        maths::normalise_exp(posteriors);
-        result.emplace_back(std::move(posteriors));
+    for (std::size_t i {0}; i < sample_genotype_posteriors.size(); ++i) {
+        for (const auto haplotype_idx : genotype_haplotypes[sample_genotype_log_likilhoods.genotype_indices[i]]) {
+            result[haplotype_idx] += sample_genotype_posteriors[i];
+        }
     }
-    return result;
 }
 
-void update_genotype_posteriors(GenotypeMarginalPosteriorMatrix& current_genotype_posteriors,
-                                const GenotypeLogMarginalVector& genotype_log_marginals,
-                                const GenotypeLogLikelihoodMatrix& genotype_log_likilhoods)
+// E-step for a block of samples, which also accumulates the expected haplotype counts
+// needed for the next M-step so the posteriors are streamed through once per iteration
+HaplotypeCountVector
+update_genotype_posteriors(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
+                           const GenotypeLogLikelihoodVector& genotype_log_marginals,
+                           const ModelConstants& constants,
+                           const SampleBlock samples)
 {
-    auto likelihood_itr = std::cbegin(genotype_log_likilhoods);
-    for (auto& sample_genotype_posteriors : current_genotype_posteriors) {
-        std::transform(std::cbegin(genotype_log_marginals), std::cend(genotype_log_marginals),
-                       std::cbegin(*likelihood_itr++), std::begin(sample_genotype_posteriors),
-                       [] (const auto& log_marginal, const auto& log_likeilhood) {
-                           return log_marginal.log_probability + log_likeilhood;
-                       });
-        maths::normalise_exp(sample_genotype_posteriors);
+    HaplotypeCountVector result(constants.num_haplotypes, 0.0);
+    for (auto sample_idx = samples.first; sample_idx < samples.second; ++sample_idx) {
+        const auto& sample_genotype_log_likilhoods = constants.genotype_log_likilhoods[sample_idx];
+        update_genotype_posteriors(genotype_posteriors[sample_idx], genotype_log_marginals, sample_genotype_log_likilhoods);
+        add_haplotype_counts(genotype_posteriors[sample_idx], sample_genotype_log_likilhoods, constants.genotype_haplotypes, result);
     }
+    return result;
 }
 
-auto collapse_genotype_posteriors(const GenotypeMarginalPosteriorMatrix& genotype_posteriors)
+void add(const HaplotypeCountVector& counts, HaplotypeCountVector& result)
 {
-    assert(!genotype_posteriors.empty());
-    std::vector<double> result(genotype_posteriors.front().size());
-    for (const auto& sample_posteriors : genotype_posteriors) {
-        std::transform(std::cbegin(result), std::cend(result), std::cbegin(sample_posteriors), std::begin(result),
-                       [] (const auto curr, const auto p) { return curr + p; });
+    std::transform(std::cbegin(result), std::cend(result), std::cbegin(counts), std::begin(result), std::plus<> {});
+}
+
+HaplotypeCountVector
+update_genotype_posteriors(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
+                           const GenotypeLogLikelihoodVector& genotype_log_marginals,
+                           const ModelConstants& constants,
+                           boost::optional<ThreadPool&> workers)
+{
+    HaplotypeCountVector result(constants.num_haplotypes, 0.0);
+    if (!workers || constants.sample_blocks.size() < 2) {
+        for (const auto& samples : constants.sample_blocks) {
+            add(update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants, samples), result);
+        }
+    } else {
+        std::vector<std::future<HaplotypeCountVector>> block_counts {};
+        block_counts.reserve(constants.sample_blocks.size());
+        for (const auto& samples : constants.sample_blocks) {
+            block_counts.push_back(workers->push([&, samples] () {
+                return update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants, samples); }));
+        }
+        for (auto& counts : block_counts) {
+            add(counts.get(), result);
+        }
     }
     return result;
 }
 
 double update_haplotype_frequencies(HardyWeinbergModel& hw_model,
-                                    const GenotypeMarginalPosteriorMatrix& genotype_posteriors,
-                                    const InverseGenotypeTable& genotypes_containing_haplotypes,
-                                    const std::size_t num_haplotypes,
+                                    const HaplotypeCountVector& haplotype_counts,
                                     const double frequency_update_norm)
 {
-    const auto collaped_posteriors = collapse_genotype_posteriors(genotype_posteriors);
     double max_frequency_change {0};
     auto& current_haplotype_frequencies = hw_model.frequencies();
-    for (std::size_t haplotype_idx {0}; haplotype_idx < num_haplotypes; ++haplotype_idx) {
+    for (std::size_t haplotype_idx {0}; haplotype_idx < haplotype_counts.size(); ++haplotype_idx) {
         auto& current_frequency = current_haplotype_frequencies[haplotype_idx];
-        double new_frequency {0};
-        for (const auto& genotype_index : genotypes_containing_haplotypes[haplotype_idx]) {
-            new_frequency += collaped_posteriors[genotype_index];
-        }
-        new_frequency /= frequency_update_norm;
+        const auto new_frequency = haplotype_counts[haplotype_idx] / frequency_update_norm;
         const auto frequency_change = std::abs(current_frequency - new_frequency);
         if (frequency_change > max_frequency_change) {
             max_frequency_change = frequency_change;
@@ -260,52 +342,62 @@ double update_haplotype_frequencies(HardyWeinbergModel& hw_model,
 }
 
 double do_em_iteration(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
+                       HaplotypeCountVector& haplotype_counts,
                        HardyWeinbergModel& hw_model,
-                       GenotypeLogMarginalVector& genotype_log_marginals,
-                       const ModelConstants& constants)
-{
-    const auto max_change = update_haplotype_frequencies(hw_model,
-                                                         genotype_posteriors,
-                                                         constants.genotypes_containing_haplotypes,
-                                                         constants.num_haplotypes,
-                                                         constants.frequency_update_norm);
-    update_genotype_log_marginals(genotype_log_marginals, hw_model);
-    update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants.genotype_log_likilhoods);
+                       GenotypeLogLikelihoodVector& genotype_log_marginals,
+                       const ModelConstants& constants,
+                       boost::optional<ThreadPool&> workers)
+{
+    const auto max_change = update_haplotype_frequencies(hw_model, haplotype_counts, constants.frequency_update_norm);
+    update_genotype_log_marginals(genotype_log_marginals, hw_model, constants);
+    haplotype_counts = update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants, workers);
     return max_change;
 }
 
 void run_em(GenotypeMarginalPosteriorMatrix& genotype_posteriors,
+            HaplotypeCountVector& haplotype_counts,
             HardyWeinbergModel& hw_model,
-            GenotypeLogMarginalVector& genotype_log_marginals,
+            GenotypeLogLikelihoodVector& genotype_log_marginals,
             const ModelConstants& constants,
             const EMOptions options,
             boost::optional<logging::TraceLogger> trace_log = boost::none)
 {
     for (unsigned n {1}; n <= options.max_iterations; ++n) {
-        const auto max_change = do_em_iteration(genotype_posteriors, hw_model, genotype_log_marginals,constants);
+        const auto max_change = do_em_iteration(genotype_posteriors, haplotype_counts, hw_model, genotype_log_marginals, constants, options.workers);
         if (max_change <= options.epsilon) break;
     }
 }
 
-auto compute_approx_genotype_marginal_posteriors(const PopulationModel::GenotypeVector& genotypes,
-                                                 const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
-                                                 const ModelConstants& constants,
-                                                 const EMOptions options)
+auto expand(const GenotypeMarginalPosteriorMatrix& genotype_posteriors, const ModelConstants& constants)
 {
-    auto hw_model = make_hardy_weinberg_model(constants);
-    auto genotype_log_marginals = init_genotype_log_marginals(genotypes, hw_model);
-    auto result = init_genotype_posteriors(genotype_log_marginals, genotype_likelihoods);
-    run_em(result, hw_model, genotype_log_marginals, constants, options);
+    GenotypeMarginalPosteriorMatrix result(genotype_posteriors.size(), GenotypeMarginalPosteriorVector(constants.genotypes.size(), 0.0));
+    for (std::size_t sample_idx {0}; sample_idx < genotype_posteriors.size(); ++sample_idx) {
+        const auto& genotype_indices = constants.genotype_log_likilhoods[sample_idx].genotype_indices;
+        for (std::size_t i {0}; i < genotype_indices.size(); ++i) {
+            result[sample_idx][genotype_indices[i]] = genotype_posteriors[sample_idx][i];
+        }
+    }
     return result;
 }
 
+auto compute_approx_genotype_marginal_posteriors(const ModelConstants& constants, const EMOptions options)
+{
+    auto hw_model = make_hardy_weinberg_model(constants);
+    GenotypeLogLikelihoodVector genotype_log_marginals(constants.genotypes.size());
+    update_genotype_log_marginals(genotype_log_marginals, hw_model, constants);
+    GenotypeMarginalPosteriorMatrix genotype_posteriors(constants.genotype_log_likilhoods.size());
+    auto haplotype_counts = update_genotype_posteriors(genotype_posteriors, genotype_log_marginals, constants, options.workers);
+    run_em(genotype_posteriors, haplotype_counts, hw_model, genotype_log_marginals, constants, options);
+    return expand(genotype_posteriors, constants);
+}
+
 auto compute_approx_genotype_marginal_posteriors(const MappableBlock<Haplotype>& haplotypes,
                                                  const PopulationModel::GenotypeVector& genotypes,
                                                  const GenotypeLogLikelihoodMatrix& genotype_likelihoods,
                                                  const EMOptions options)
 {
-    const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods};
-    return compute_approx_genotype_marginal_posteriors(genotypes, genotype_likelihoods, constants, options);
+    const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods, options};
+    return compute_approx_genotype_marginal_posteriors(constants, options);
 }
 
 auto compute_approx_genotype_marginal_posteriors(const MappableBlock<Haplotype>& haplotypes,
@@ -314,8 +406,8 @@ auto compute_approx_genotype_marginal_posteriors(const MappableBlock<Haplotype>&
                                                  const std::vector<unsigned>& sample_plodies,
                                                  const EMOptions options)
 {
-    const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods, sample_plodies};
-    return compute_approx_genotype_marginal_posteriors(genotypes, genotype_likelihoods, constants, options);
+    const ModelConstants constants {haplotypes, genotypes, genotype_likelihoods, sample_plodies, options};
+    return compute_approx_genotype_marginal_posteriors(constants, options);
 }
 
 using GenotypeCombinationVector = std::vector<std::size_t>;
@@ -610,7 +702,8 @@ PopulationModel::evaluate(const SampleVector& samples,
         genotype_combinations = generate_all_genotype_combinations(genotypes.size(), samples.size());
     } else {
         const auto max_genotype_combinations = options_.max_genotype_combinations ? *options_.max_genotype_combinations : *num_possible_genotype_combinations;
-        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
+        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon, options_.min_em_genotype_log_likelihood_ratio,
+                                    options_.workers};
         const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, em_options);
         genotype_combinations = propose_genotype_combinations(genotypes, em_genotype_marginals, max_genotype_combinations);
     }
@@ -691,7 +784,8 @@ PopulationModel::evaluate(const SampleVector& samples,
         genotype_combinations = generate_all_genotype_combinations(sample_genotype_set_ids, genotype_set_sizes);
     } else {
         const auto max_genotype_combinations = options_.max_genotype_combinations ? *options_.max_genotype_combinations : *num_possible_genotype_combinations;
-        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon};
+        const EMOptions em_options {options_.max_em_iterations, options_.em_epsilon, options_.min_em_genotype_log_likelihood_ratio,
+                                    options_.workers};
         const auto em_genotype_marginals = compute_approx_genotype_marginal_posteriors(haplotypes, genotypes, genotype_log_likelihoods, sample_ploidies, em_options);
         genotype_combinations = propose_genotype_combinations(genotypes, em_genotype_marginals, max_genotype_combinations);
     }
@@ -16,6 +16,7 @@
 #include "core/models/haplotype_likelihood_array.hpp"
 #include "containers/probability_matrix.hpp"
 #include "containers/mappable_block.hpp"
+#include "utils/thread_pool.hpp"
 #include "logging/logging.hpp"
 
 namespace octopus { namespace model {
@@ -28,6 +29,8 @@ public:
         boost::optional<std::size_t> max_genotype_combinations = boost::none;
         unsigned max_em_iterations = 100;
         double em_epsilon = 0.001;
+        double min_em_genotype_log_likelihood_ratio = -50; // per sample, relative to the sample's best genotype
+        boost::optional<ThreadPool&> workers = boost::none; // for sample-parallel EM; must not be a pool the model is evaluated on
     };
     struct Latents
     {
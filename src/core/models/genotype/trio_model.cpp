@@ -5,6 +5,7 @@
 
 #include <iterator>
 #include <algorithm>
+#include <numeric>
 #include <cmath>
 #include <random>
 #include <utility>
@@ -16,6 +17,7 @@
 
 #include "utils/maths.hpp"
 #include "constant_mixture_genotype_likelihood_model.hpp"
+#include "best_first_join.hpp"
 
 namespace octopus { namespace model {
 
@@ -467,16 +469,34 @@ auto joint_probability(const GenotypeIndexProbabilityPair& mother, const Genotyp
 }
 
 template <typename T1, typename T2>
-auto join_size(const ReducedVectorMap<T1>& first, const ReducedVectorMap<T2>& second) noexcept
+std::size_t partial_join_size(const ReducedVectorMap<T1>& first, const ReducedVectorMap<T2>& second) noexcept
 {
     using std::distance;
     std::size_t result {0};
-    result += distance(first.first, first.last_full_join) * distance(second.first, second.last_full_join);
     result += distance(first.last_full_join, first.last) * distance(second.first, second.last_to_partially_join);
     result += distance(second.last_full_join, second.last) * distance(first.first, first.last_to_partially_join);
     return result;
 }
 
+template <typename T1, typename T2>
+std::size_t join_size(const ReducedVectorMap<T1>& first, const ReducedVectorMap<T2>& second) noexcept
+{
+    using std::distance;
+    const std::size_t full_join_size = distance(first.first, first.last_full_join) * distance(second.first, second.last_full_join);
+    return full_join_size + partial_join_size(first, second);
+}
+
+// The best-first search usually visits a small fraction of the full join, so only a pair per
+// fully joined element is reserved for it; the vector grows geometrically if it visits more
+template <typename T1, typename T2>
+std::size_t best_first_join_size_hint(const ReducedVectorMap<T1>& first, const ReducedVectorMap<T2>& second) noexcept
+{
+    using std::distance;
+    const std::size_t num_full_joins1 = distance(first.first, first.last_full_join);
+    const std::size_t num_full_joins2 = distance(second.first, second.last_full_join);
+    return std::min(num_full_joins1 * num_full_joins2, num_full_joins1 + num_full_joins2) + partial_join_size(first, second);
+}
+
 auto join(const ReducedVectorMap<GenotypeIndexProbabilityPair>& maternal,
           const ReducedVectorMap<GenotypeIndexProbabilityPair>& paternal,
           const TrioGenotypeData& genotypes,
@@ -520,224 +540,289 @@ bool all_triploid(const G& child, const G& mother, const G& father) noexcept
     return is_triploid(child) && is_triploid(mother) && is_triploid(father);
 }
 
-template <typename H, typename G>
-double probability_of_child_given_haploid_parent(const H& child, const G& parent,
-                                                 const DeNovoModel& mutation_model)
+using JointProbability = TrioModel::Latents::JointProbability;
+
+// Caches ln p(h | parent genotype), the probability that a parent with the given genotype transmits haplotype h,
+// allowing for de novo mutation. The probability of a child genotype given the parent genotypes factorises into
+// these terms, so each joint needs a few lookups rather than repeated mutation model evaluations.
+class InheritanceProbabilityTable
+{
+public:
+    InheritanceProbabilityTable() = delete;
+    
+    InheritanceProbabilityTable(const TrioModel::GenotypeVector& parent_genotypes,
+                                std::size_t num_haplotypes,
+                                const DeNovoModel& mutation_model);
+    
+    InheritanceProbabilityTable(const InheritanceProbabilityTable&)            = delete;
+    InheritanceProbabilityTable& operator=(const InheritanceProbabilityTable&) = delete;
+    InheritanceProbabilityTable(InheritanceProbabilityTable&&)                 = default;
+    InheritanceProbabilityTable& operator=(InheritanceProbabilityTable&&)      = delete;
+    
+    ~InheritanceProbabilityTable() = default;
+    
+    double operator()(const IndexedHaplotype<>& haplotype, GenotypeIndex parent) const;
+    
+private:
+    const TrioModel::GenotypeVector& parent_genotypes_;
+    const DeNovoModel& mutation_model_;
+    std::size_t num_haplotypes_;
+    mutable std::vector<std::vector<boost::optional<double>>> table_;
+    
+    double evaluate(const IndexedHaplotype<>& haplotype, const Genotype<IndexedHaplotype<>>& parent) const;
+};
+
+InheritanceProbabilityTable::InheritanceProbabilityTable(const TrioModel::GenotypeVector& parent_genotypes,
+                                                         const std::size_t num_haplotypes,
+                                                         const DeNovoModel& mutation_model)
+: parent_genotypes_ {parent_genotypes}
+, mutation_model_ {mutation_model}
+, num_haplotypes_ {num_haplotypes}
+, table_(parent_genotypes.size())
+{}
+
+double InheritanceProbabilityTable::operator()(const IndexedHaplotype<>& haplotype, const GenotypeIndex parent) const
 {
-    return mutation_model.evaluate(child, parent[0]);
+    auto& row = table_[parent];
+    if (row.empty()) row.resize(num_haplotypes_);
+    assert(index_of(haplotype) < row.size());
+    auto& result = row[index_of(haplotype)];
+    if (!result) result = evaluate(haplotype, parent_genotypes_[parent]);
+    return *result;
 }
 
-template <typename H, typename G>
-double probability_of_child_given_diploid_parent(const H& child, const G& parent,
-                                                 const DeNovoModel& mutation_model)
+double InheritanceProbabilityTable::evaluate(const IndexedHaplotype<>& haplotype, const Genotype<IndexedHaplotype<>>& parent) const
 {
-    static const double ln2 {std::log(2)};
-    const auto p1 = mutation_model.evaluate(child, parent[0]);
-    const auto p2 = mutation_model.evaluate(child, parent[1]);
-    return maths::log_sum_exp(p1, p2) - ln2;
+    switch (parent.ploidy()) {
+        case 1: return mutation_model_.evaluate(haplotype, parent[0]);
+        case 2: {
+            static const double ln2 {std::log(2)};
+            const auto p1 = mutation_model_.evaluate(haplotype, parent[0]);
+            const auto p2 = mutation_model_.evaluate(haplotype, parent[1]);
+            return maths::log_sum_exp(p1, p2) - ln2;
+        }
+        case 3: {
+            static const double ln3 {std::log(3)};
+            const auto p1 = mutation_model_.evaluate(haplotype, parent[0]);
+            const auto p2 = mutation_model_.evaluate(haplotype, parent[1]);
+            const auto p3 = mutation_model_.evaluate(haplotype, parent[2]);
+            return maths::log_sum_exp(p1, p2, p3) - ln3;
+        }
+        default: {
+            std::vector<double> ps(parent.ploidy());
+            std::transform(std::cbegin(parent), std::cend(parent), std::begin(ps),
+                           [&] (const auto& parent_haplotype) { return mutation_model_.evaluate(haplotype, parent_haplotype); });
+            return maths::log_sum_exp(ps) - std::log(parent.ploidy());
+        }
+    }
 }
 
-template <typename H, typename G>
-double probability_of_child_given_diploid_parents(const H& child_from_mother, const H& child_from_father,
-                                                  const G& mother, const G& father,
-                                                  const DeNovoModel& mutation_model)
+auto count_haplotypes(const TrioModel::GenotypeVector& genotypes)
 {
-    return probability_of_child_given_diploid_parent(child_from_mother, mother, mutation_model)
-            + probability_of_child_given_diploid_parent(child_from_father, father, mutation_model);
+    std::size_t result {0};
+    for (const auto& genotype : genotypes) {
+        for (const auto& haplotype : genotype) {
+            result = std::max(result, static_cast<std::size_t>(index_of(haplotype)) + 1);
+        }
+    }
+    return result;
 }
 
-template <typename H, typename G>
-double probability_of_child_given_triploid_parent(const H& child, const G& parent,
-                                                  const DeNovoModel& mutation_model)
+struct InheritanceProbabilityTables
 {
-    static const double ln3 {std::log(3)};
-    const auto p1 = mutation_model.evaluate(child, parent[0]);
-    const auto p2 = mutation_model.evaluate(child, parent[1]);
-    const auto p3 = mutation_model.evaluate(child, parent[2]);
-    return maths::log_sum_exp(p1, p2, p3) - ln3;
-}
+    InheritanceProbabilityTable maternal, paternal;
+};
 
-template <typename H, typename G>
-double probability_of_child_given_triploid_parents(const H& child1_from_mother,
-                                                   const H& child2_from_mother,
-                                                   const H& child_from_father,
-                                                   const G& mother, const G& father,
-                                                   const DeNovoModel& mutation_model)
+auto make_inheritance_tables(const TrioGenotypeData& genotypes, const DeNovoModel& mutation_model)
 {
-    return probability_of_child_given_triploid_parent(child1_from_mother, mother, mutation_model)
-           + probability_of_child_given_triploid_parent(child2_from_mother, mother, mutation_model)
-           + probability_of_child_given_triploid_parent(child_from_father, father, mutation_model);
+    const auto num_haplotypes = count_haplotypes(genotypes.child);
+    return InheritanceProbabilityTables {
+        InheritanceProbabilityTable {genotypes.maternal, num_haplotypes, mutation_model},
+        InheritanceProbabilityTable {genotypes.paternal, num_haplotypes, mutation_model}
+    };
 }
 
 template <unsigned ChildPloidy, unsigned MotherPloidy, unsigned FatherPloidy>
 struct ProbabilityOfChildGivenParents
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
         return 0;
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
 template <> struct ProbabilityOfChildGivenParents<2, 2, 2>
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
         static const double ln2 {std::log(2)};
-        const auto p1 = probability_of_child_given_diploid_parents(child[0], child[1], mother, father, mutation_model);
-        const auto p2 = probability_of_child_given_diploid_parents(child[1], child[0], mother, father, mutation_model);
+        const auto p1 = inheritance.maternal(child[0], mother) + inheritance.paternal(child[1], father);
+        const auto p2 = inheritance.maternal(child[1], mother) + inheritance.paternal(child[0], father);
         return maths::log_sum_exp(p1, p2) - ln2;
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
 template <> struct ProbabilityOfChildGivenParents<3, 3, 3>
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
         static const double ln6 {std::log(6)};
-        const auto p1 = probability_of_child_given_triploid_parents(child[0], child[1], child[2], mother, father, mutation_model);
-        const auto p2 = probability_of_child_given_triploid_parents(child[0], child[2], child[1], mother, father, mutation_model);
-        const auto p3 = probability_of_child_given_triploid_parents(child[1], child[0], child[2], mother, father, mutation_model);
-        const auto p4 = probability_of_child_given_triploid_parents(child[1], child[2], child[0], mother, father, mutation_model);
-        const auto p5 = probability_of_child_given_triploid_parents(child[2], child[0], child[1], mother, father, mutation_model);
-        const auto p6 = probability_of_child_given_triploid_parents(child[2], child[1], child[0], mother, father, mutation_model);
+        const auto m0 = inheritance.maternal(child[0], mother), f0 = inheritance.paternal(child[0], father);
+        const auto m1 = inheritance.maternal(child[1], mother), f1 = inheritance.paternal(child[1], father);
+        const auto m2 = inheritance.maternal(child[2], mother), f2 = inheritance.paternal(child[2], father);
+        const auto p1 = m0 + m1 + f2, p2 = m0 + m2 + f1;
+        const auto p3 = m1 + m0 + f2, p4 = m1 + m2 + f0;
+        const auto p5 = m2 + m0 + f1, p6 = m2 + m1 + f0;
         return maths::log_sum_exp({p1, p2, p3, p4, p5, p6}) - ln6;
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
 template <> struct ProbabilityOfChildGivenParents<2, 2, 1>
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
         static const double ln2 {std::log(2)};
-        const auto p1 = probability_of_child_given_diploid_parent(child[0], mother, mutation_model);
-        const auto p2 = probability_of_child_given_diploid_parent(child[1], mother, mutation_model);
-        const auto p3 = probability_of_child_given_haploid_parent(child[0], father, mutation_model);
-        const auto p4 = probability_of_child_given_haploid_parent(child[1], father, mutation_model);
+        const auto p1 = inheritance.maternal(child[0], mother);
+        const auto p2 = inheritance.maternal(child[1], mother);
+        const auto p3 = inheritance.paternal(child[0], father);
+        const auto p4 = inheritance.paternal(child[1], father);
         return maths::log_sum_exp(p1 + p4, p2 + p3) - ln2;
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
 template <> struct ProbabilityOfChildGivenParents<1, 2, 1>
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
-        return probability_of_child_given_diploid_parent(child[0], mother, mutation_model);
+        return inheritance.maternal(child[0], mother);
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
 template <> struct ProbabilityOfChildGivenParents<1, 0, 1>
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
-        return probability_of_child_given_haploid_parent(child[0], father, mutation_model);
+        return inheritance.paternal(child[0], father);
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
 template <> struct ProbabilityOfChildGivenParents<1, 1, 1>
 {
-    ProbabilityOfChildGivenParents(const DeNovoModel& mutation_model) : mutation_model {mutation_model} {}
+    ProbabilityOfChildGivenParents(const InheritanceProbabilityTables& inheritance) : inheritance {inheritance} {}
     template <typename G>
-    double operator()(const G& child, const G& mother, const G& father)
+    double operator()(const G& child, GenotypeIndex mother, GenotypeIndex father) const
     {
         static const double ln2 {std::log(2)};
-        const auto p1 = probability_of_child_given_haploid_parent(child[0], mother, mutation_model);
-        const auto p2 = probability_of_child_given_haploid_parent(child[0], father, mutation_model);
+        const auto p1 = inheritance.maternal(child[0], mother);
+        const auto p2 = inheritance.paternal(child[0], father);
         return maths::log_sum_exp(p1, p2) - ln2;
     }
-    const DeNovoModel& mutation_model;
+    const InheritanceProbabilityTables& inheritance;
 };
 
-using JointProbability = TrioModel::Latents::JointProbability;
-
-template <typename F>
-auto joint_probability(const ParentsProbabilityPair& parents,
-                       const GenotypeIndexProbabilityPair& child,
-                       const TrioGenotypeData& genotypes,
-                       F joint_probability_function)
+template <typename T1, typename T2, typename F>
+auto join(const ReducedVectorMap<T1>& first,
+          const ReducedVectorMap<T2>& second,
+          F make_joint,
+          const TrioModel::Options& options,
+          PrunedJoints& pruned)
 {
-    return parents.probability + child.probability
-           + joint_probability_function(genotypes.child[child.genotype], genotypes.maternal[parents.maternal], genotypes.paternal[parents.paternal]);
+    std::vector<JointProbability> result {};
+    result.reserve(best_first_join_size_hint(first, second));
+    join_best_first(first.first, first.last_full_join, second.first, second.last_full_join,
+                    make_joint, options.min_joint_log_probability_ratio, result, pruned);
+    std::for_each(first.last_full_join, first.last, [&] (const auto& f) {
+        std::for_each(second.first, second.last_to_partially_join, [&] (const auto& s) {
+            result.push_back(make_joint(f, s));
+        });
+    });
+    std::for_each(second.last_full_join, second.last, [&] (const auto& s) {
+        std::for_each(first.first, first.last_to_partially_join, [&] (const auto& f) {
+            result.push_back(make_joint(f, s));
+        });
+    });
+    return result;
 }
 
 template <typename F>
 auto join(const ReducedVectorMap<ParentsProbabilityPair>& parents,
           const ReducedVectorMap<GenotypeIndexProbabilityPair>& child,
           const TrioGenotypeData& genotypes,
-          F jpdf)
+          F jpdf,
+          const TrioModel::Options& options,
+          PrunedJoints& pruned)
 {
-    std::vector<JointProbability> result {};
-    result.reserve(join_size(parents, child));
-    std::for_each(parents.first, parents.last_full_join, [&] (const auto& p) {
-        std::for_each(child.first, child.last_full_join, [&] (const auto& c) {
-            result.push_back({joint_probability(p, c, genotypes, jpdf), 0.0, p.maternal, p.paternal, c.genotype});
-        });
-    });
-    std::for_each(parents.last_full_join, parents.last, [&] (const auto& p) {
-        std::for_each(child.first, child.last_to_partially_join, [&] (const auto& c) {
-            result.push_back({joint_probability(p, c, genotypes, jpdf), 0.0, p.maternal, p.paternal, c.genotype});
-        });
-    });
-    std::for_each(child.last_full_join, child.last, [&] (const auto& c) {
-        std::for_each(parents.first, parents.last_to_partially_join, [&] (const auto& p) {
-            result.push_back({joint_probability(p, c, genotypes, jpdf), 0.0, p.maternal, p.paternal, c.genotype});
-        });
-    });
-    return result;
+    const auto make_joint = [&] (const ParentsProbabilityPair& p, const GenotypeIndexProbabilityPair& c) -> JointProbability {
+        const auto log_probability = p.probability + c.probability + jpdf(genotypes.child[c.genotype], p.maternal, p.paternal);
+        return {log_probability, 0.0, p.maternal, p.paternal, c.genotype};
+    };
+    return join(parents, child, make_joint, options, pruned);
 }
 
 auto join(const ReducedVectorMap<ParentsProbabilityPair>& parents,
           const ReducedVectorMap<GenotypeIndexProbabilityPair>& child,
           const TrioGenotypeData& genotypes,
-          const DeNovoModel& mutation_model)
+          const DeNovoModel& mutation_model,
+          const TrioModel::Options& options,
+          PrunedJoints& pruned)
 {
     const auto maternal_ploidy = genotypes.maternal[parents.first->maternal].ploidy();
     const auto paternal_ploidy = genotypes.paternal[parents.first->paternal].ploidy();
     const auto child_ploidy    = genotypes.child[child.first->genotype].ploidy();
+    const auto inheritance = make_inheritance_tables(genotypes, mutation_model);
     if (child_ploidy == 1) {
         if (paternal_ploidy == 1) {
             if (maternal_ploidy == 0) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 0, 1> {mutation_model});
+                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 0, 1> {inheritance}, options, pruned);
             }
             if (maternal_ploidy == 1) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 1, 1> {mutation_model});
+                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 1, 1> {inheritance}, options, pruned);
             }
             if (maternal_ploidy == 2) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 2, 1> {mutation_model});
+                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<1, 2, 1> {inheritance}, options, pruned);
             }
         }
     } else if (child_ploidy == 2) {
         if (maternal_ploidy == 2) {
             if (paternal_ploidy == 1) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<2, 2, 1> {mutation_model});
+                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<2, 2, 1> {inheritance}, options, pruned);
             }
             if (paternal_ploidy == 2) {
-                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<2, 2, 2> {mutation_model});
+                return join(parents, child, genotypes, ProbabilityOfChildGivenParents<2, 2, 2> {inheritance}, options, pruned);
             }
         }
     } else if (child_ploidy == 3 && maternal_ploidy == 3 && paternal_ploidy == 3) {
-        return join(parents, child, genotypes, ProbabilityOfChildGivenParents<3, 3, 3> {mutation_model});
+        return join(parents, child, genotypes, ProbabilityOfChildGivenParents<3, 3, 3> {inheritance}, options, pruned);
     }
     throw std::runtime_error {"TrioModel: unimplemented joint probability function"};
 }
 
+void add_pruned_log_mass(boost::optional<double>& lost_log_mass, const PrunedJoints& pruned, const double log_evidence)
+{
+    if (pruned.count > 0) {
+        const auto pruned_log_mass = std::log(pruned.count) + pruned.max_log_probability - log_evidence;
+        lost_log_mass = lost_log_mass ? maths::log_sum_exp(*lost_log_mass, pruned_log_mass) : pruned_log_mass;
+    }
+}
+
 auto extract_probabilities(const std::vector<JointProbability>& joint_likelihoods)
 {
     std::vector<double> result(joint_likelihoods.size());
@@ -824,10 +909,12 @@ TrioModel::evaluate(const GenotypeVector& maternal_genotypes,
     paternal_likelihoods.shrink_to_fit();
     reduced_paternal_likelihoods.clear();
     reduced_paternal_likelihoods.shrink_to_fit();
-    auto joint_likelihoods = join(reduced_parental_likelihoods, reduced_child_likelihoods_info, genotypes, mutation_model_);
+    PrunedJoints pruned_joints {};
+    auto joint_likelihoods = join(reduced_parental_likelihoods, reduced_child_likelihoods_info, genotypes, mutation_model_, options_, pruned_joints);
     if (debug_log_) debug::print(stream(*debug_log_), genotypes, joint_likelihoods);
     const auto evidence = normalise_exp(joint_likelihoods);
     if (lost_log_mass) *lost_log_mass *= 2 * std::distance(reduced_child_likelihoods_info.first, reduced_child_likelihoods_info.last_full_join);
+    add_pruned_log_mass(lost_log_mass, pruned_joints, evidence);
     return {std::move(joint_likelihoods), evidence, lost_log_mass};
 }
 
@@ -847,40 +934,20 @@ auto probability_of_child_given_parent(const Genotype<IndexedHaplotype<>>& child
     return 0.0; // TODO
 }
 
-auto joint_probability(const GenotypeIndexProbabilityPair& parent,
-                       const GenotypeIndexProbabilityPair& child,
-                       const TrioModel::GenotypeVector& parent_genotypes,
-                       const TrioModel::GenotypeVector& child_genotypes,
-                       const DeNovoModel& mutation_model)
-{
-    return parent.probability + child.probability
-           + probability_of_child_given_parent(child_genotypes[child.genotype], parent_genotypes[parent.genotype], mutation_model);
-}
-
 auto join(const ReducedVectorMap<GenotypeIndexProbabilityPair>& parent,
           const ReducedVectorMap<GenotypeIndexProbabilityPair>& child,
           const TrioModel::GenotypeVector& parent_genotypes,
           const TrioModel::GenotypeVector& child_genotypes,
-          const DeNovoModel& mutation_model)
+          const DeNovoModel& mutation_model,
+          const TrioModel::Options& options,
+          PrunedJoints& pruned)
 {
-    std::vector<JointProbability> result {};
-    result.reserve(join_size(parent, child));
-    std::for_each(parent.first, parent.last_full_join, [&] (const auto& p) {
-        std::for_each(child.first, child.last_full_join, [&] (const auto& c) {
-            result.push_back({joint_probability(p, c, parent_genotypes, child_genotypes, mutation_model), 0.0, p.genotype, p.genotype, c.genotype});
-        });
-    });
-    std::for_each(parent.last_full_join, parent.last, [&] (const auto& p) {
-        std::for_each(child.first, child.last_to_partially_join, [&] (const auto& c) {
-            result.push_back({joint_probability(p, c, parent_genotypes, child_genotypes, mutation_model), 0.0, p.genotype, p.genotype, c.genotype});
-        });
-    });
-    std::for_each(child.last_full_join, child.last, [&] (const auto& c) {
-        std::for_each(parent.first, parent.last_to_partially_join, [&] (const auto& p) {
-            result.push_back({joint_probability(p, c, parent_genotypes, child_genotypes, mutation_model), 0.0, p.genotype, p.genotype, c.genotype});
-        });
-    });
-    return result;
+    const auto make_joint = [&] (const GenotypeIndexProbabilityPair& p, const GenotypeIndexProbabilityPair& c) -> JointProbability {
+        const auto log_probability = p.probability + c.probability
+                                     + probability_of_child_given_parent(child_genotypes[c.genotype], parent_genotypes[p.genotype], mutation_model);
+        return {log_probability, 0.0, p.genotype, p.genotype, c.genotype};
+    };
+    return join(parent, child, make_joint, options, pruned);
 }
 
 TrioModel::InferredLatents
@@ -899,11 +966,13 @@ TrioModel::evaluate_allosome(const GenotypeVector& parent_genotypes,
     if (debug_log_) debug::print(stream(*debug_log_), "parent", child_genotypes, parent_likelihoods);
     const auto reduced_parent_likelihoods = reduce(parent_likelihoods, prior_model_, lost_log_mass, options_, parent_genotypes);
     haplotype_likelihoods.prime(trio_.child());
-    auto joint_likelihoods = join(reduced_parent_likelihoods, reduced_child_likelihoods, parent_genotypes, child_genotypes, mutation_model_);
+    PrunedJoints pruned_joints {};
+    auto joint_likelihoods = join(reduced_parent_likelihoods, reduced_child_likelihoods, parent_genotypes, child_genotypes, mutation_model_, options_, pruned_joints);
     if (lost_log_mass) *lost_log_mass *= 2 * std::distance(reduced_child_likelihoods.first, reduced_child_likelihoods.last_full_join);
     clear(parent_likelihoods);
     clear(child_likelihoods);
     const auto evidence = normalise_exp(joint_likelihoods);
+    add_pruned_log_mass(lost_log_mass, pruned_joints, evidence);
     if (debug_log_) {
         const TrioGenotypeData genotypes {parent_genotypes, parent_genotypes, child_genotypes};
         debug::print(stream(*debug_log_), genotypes, joint_likelihoods);
@@ -49,6 +49,8 @@ public:
     {
         boost::optional<std::size_t> max_genotype_combinations = boost::none;
         double max_individual_log_probability_loss = -1'000, max_joint_log_probability_loss = -10'000;
+        // Joint genotypes bounded this far below the best joint are not evaluated
+        double min_joint_log_probability_ratio = -250;
     };
     
     TrioModel() = delete;
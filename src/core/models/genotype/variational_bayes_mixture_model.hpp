@@ -14,6 +14,7 @@
 #include <cassert>
 #include <limits>
 #include <type_traits>
+#include <unordered_map>
 
 #include <boost/optional.hpp>
 #include <boost/math/special_functions/digamma.hpp>
@@ -73,6 +74,7 @@ public:
     BaseType::const_iterator begin() const noexcept;
     BaseType::const_iterator end() const noexcept;
     BaseType::value_type operator[](const std::size_t n) const noexcept;
+    const BaseType::value_type* data() const noexcept;
 
 private:
     const BaseType* likelihoods;
@@ -85,9 +87,33 @@ using VBGenotypeVector = std::vector<VBGenotype<K>>; // Per element per genotype
 template <std::size_t K>
 using VBReadLikelihoodMatrix = std::vector<VBGenotypeVector<K>>; // One element per sample
 
-using VBTau = std::vector<VBReadLikelihoodArray::BaseType::value_type>; // One element per read
+// Responsibilities for a single sample, stored contiguously as [haplotype in genotype][read]
 template <std::size_t K>
-using VBResponsibilityVector = std::array<VBTau, K>; // One element per haplotype in genotype (i.e. K)
+class VBResponsibilityVector
+{
+public:
+    using ValueType = VBReadLikelihoodArray::BaseType::value_type;
+    
+    VBResponsibilityVector() = default;
+    
+    explicit VBResponsibilityVector(std::size_t num_reads);
+    
+    VBResponsibilityVector(const VBResponsibilityVector&)            = default;
+    VBResponsibilityVector& operator=(const VBResponsibilityVector&) = default;
+    VBResponsibilityVector(VBResponsibilityVector&&)                 = default;
+    VBResponsibilityVector& operator=(VBResponsibilityVector&&)      = default;
+    
+    ~VBResponsibilityVector() = default;
+    
+    std::size_t num_reads() const noexcept;
+    const ValueType* operator[](const std::size_t k) const noexcept; // One element per read
+    ValueType* operator[](const std::size_t k) noexcept;
+    
+private:
+    std::vector<ValueType> taus_;
+    std::size_t num_reads_;
+};
+
 template <std::size_t K>
 using VBResponsibilityMatrix = std::vector<VBResponsibilityVector<K>>; // One element per sample
 
@@ -104,39 +130,51 @@ struct VBLatents
 
 namespace detail {
 
-using VBExpandedLikelihood = std::vector<float>; // One element per genotype
-using VBExpandedGenotype = std::vector<VBExpandedLikelihood>; // One element per read
+// The read likelihoods of a single sample, with each distinct haplotype likelihood array stored once and
+// contiguously as [haplotype][read]. Genotypes are stored as the indices of their haplotypes, so marginalising
+// over genotypes reduces to weighted sums over the (usually far fewer) distinct haplotypes.
 template <std::size_t K>
-using VBExpandedGenotypeVector = std::array<VBExpandedGenotype, K>; // One element per haplotype in genotype
-template <std::size_t K>
-using VBExpandedLikelihoodMatrix = std::vector<VBExpandedGenotypeVector<K>>; // One element per sample
+class VBCompressedGenotypeVector
+{
+public:
+    using ValueType = VBReadLikelihoodArray::BaseType::value_type;
+    using HaplotypeIndex = unsigned;
+    using GenotypeIndex = std::array<HaplotypeIndex, K>;
+    
+    VBCompressedGenotypeVector() = default;
+    
+    explicit VBCompressedGenotypeVector(const VBGenotypeVector<K>& likelihoods);
+    
+    VBCompressedGenotypeVector(const VBCompressedGenotypeVector&)            = default;
+    VBCompressedGenotypeVector& operator=(const VBCompressedGenotypeVector&) = default;
+    VBCompressedGenotypeVector(VBCompressedGenotypeVector&&)                 = default;
+    VBCompressedGenotypeVector& operator=(VBCompressedGenotypeVector&&)      = default;
+    
+    ~VBCompressedGenotypeVector() = default;
+    
+    std::size_t num_reads() const noexcept;
+    std::size_t num_haplotypes() const noexcept;
+    std::size_t num_genotypes() const noexcept;
+    const GenotypeIndex& genotype(const std::size_t g) const noexcept;
+    const ValueType* operator[](const std::size_t h) const noexcept; // One element per read
+    
+private:
+    std::vector<ValueType> likelihoods_;
+    std::vector<GenotypeIndex> genotypes_;
+    std::size_t num_reads_, num_haplotypes_;
+};
 
 template <std::size_t K>
-auto invert(const VBGenotypeVector<K>& likelihoods)
-{
-    static_assert(K > 0, "K == 0");
-    const auto num_genotypes = likelihoods.size();
-    assert(num_genotypes > 0);
-    const auto num_reads = likelihoods.front().front().size();
-    VBExpandedGenotypeVector<K> result {};
-    for (std::size_t k {0}; k < K; ++k) {
-        result[k] = VBExpandedGenotype(num_reads, VBExpandedLikelihood(num_genotypes));
-        for (std::size_t n {0}; n < num_reads; ++n) {
-            for (std::size_t g {0}; g < num_genotypes; ++g) {
-                result[k][n][g] = likelihoods[g][k][n];
-            }
-        }
-    }
-    return result;
-}
+using VBCompressedLikelihoodMatrix = std::vector<VBCompressedGenotypeVector<K>>; // One element per sample
 
 template <std::size_t K>
-auto invert(const VBReadLikelihoodMatrix<K>& matrix)
+auto compress(const VBReadLikelihoodMatrix<K>& matrix)
 {
-    VBExpandedLikelihoodMatrix<K> result {};
+    VBCompressedLikelihoodMatrix<K> result {};
     result.reserve(matrix.size());
-    std::transform(std::cbegin(matrix), std::cend(matrix), std::back_inserter(result),
-                   [] (const auto& v) { return invert(v); });
+    for (const auto& likelihoods : matrix) {
+        result.emplace_back(likelihoods);
+    }
     return result;
 }
 
@@ -195,9 +233,30 @@ auto count_reads(const VBGenotypeVector<K>& likelihoods) noexcept
 }
 
 template <std::size_t K>
-auto count_reads(const VBExpandedGenotypeVector<K>& likelihoods) noexcept
+auto count_reads(const VBCompressedGenotypeVector<K>& likelihoods) noexcept
 {
-    return likelihoods[0].size();
+    return likelihoods.num_reads();
+}
+
+// Simple loops over contiguous memory so the compiler can vectorise the reductions
+template <typename T1, typename T2>
+auto dot(const T1* lhs, const T2* rhs, const std::size_t n) noexcept
+{
+    T1 result {0};
+    for (std::size_t i {0}; i < n; ++i) {
+        result += lhs[i] * rhs[i];
+    }
+    return result;
+}
+
+template <typename T>
+auto sum(const T* values, const std::size_t n) noexcept
+{
+    T result {0};
+    for (std::size_t i {0}; i < n; ++i) {
+        result += values[i];
+    }
+    return result;
 }
 
 template <typename ProbabilityVector_, std::size_t K>
@@ -220,13 +279,6 @@ auto inner_product(const T1& lhs, const T2& rhs) noexcept
     return std::inner_product(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs), T {0});
 }
 
-template <typename ProbabilityVector_, std::size_t K>
-auto marginalise(const ProbabilityVector_& distribution, const VBExpandedGenotypeVector<K>& likelihoods,
-                 const unsigned k, const std::size_t n) noexcept
-{
-    return inner_product(distribution, likelihoods[k][n]);
-}
-
 template <std::size_t K, typename T, typename ProbabilityVector_, typename VBLikelihoodGenotypeVector>
 void
 update_responsibilities_helper(VBResponsibilityVector<K>& result,
@@ -248,33 +300,47 @@ update_responsibilities_helper(VBResponsibilityVector<K>& result,
     }
 }
 
-template <std::size_t K, typename T, typename ProbabilityVector_>
+template <std::size_t K, typename T>
 void
 update_responsibilities_helper(VBResponsibilityVector<K>& result,
                                const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBExpandedGenotypeVector<K>& read_likelihoods,
-                               std::false_type)
-{
-    using LikelihoodType = VBExpandedLikelihood::value_type;
-    const std::vector<LikelihoodType> demoted_genotype_probabilities {std::cbegin(genotype_probabilities), std::cend(genotype_probabilities)};
-    update_responsibilities_helper(result, al, demoted_genotype_probabilities, read_likelihoods, std::true_type {});
-}
-
-template <std::size_t K, typename T, typename ProbabilityVector_>
-void
-update_responsibilities_helper(VBResponsibilityVector<K>& result,
-                               const std::array<T, K>& al,
-                               const ProbabilityVector_& genotype_probabilities,
-                               const VBExpandedGenotypeVector<K>& read_likelihoods)
+                               const ProbabilityVector& genotype_probabilities,
+                               const VBCompressedGenotypeVector<K>& read_likelihoods)
 {
-    // For the expanded likelihood array, the inner product between likelihoods and genotype
-    // posteriors - a key bottleneck in the responsibility update calculate - can be vectorised.
-    // To ensure optimal execution the floating point types of the genotype probabilities and likelihoods should match.
-    using ProbabilityType = typename ProbabilityVector_::value_type;
-    using LikelihoodType = VBExpandedLikelihood::value_type;
-    update_responsibilities_helper(result, al, genotype_probabilities, read_likelihoods,
-                                   std::is_same<ProbabilityType, LikelihoodType> {});
+    // The genotype marginal sum_g p_g ln p(n | g_k) is sum_h w_kh ln p(n | h), where w_kh is the
+    // total probability of genotypes with haplotype h in position k. Accumulating over haplotypes
+    // rather than reads gives contiguous loops over the responsibility and likelihood buffers.
+    const auto N = count_reads(read_likelihoods);
+    const auto H = read_likelihoods.num_haplotypes();
+    std::vector<double> haplotype_weights(K * H);
+    for (std::size_t g {0}; g < genotype_probabilities.size(); ++g) {
+        const auto& genotype = read_likelihoods.genotype(g);
+        for (unsigned k {0}; k < K; ++k) {
+            haplotype_weights[k * H + genotype[k]] += genotype_probabilities[g];
+        }
+    }
+    for (unsigned k {0}; k < K; ++k) {
+        const auto ln_rho = result[k];
+        std::fill(ln_rho, ln_rho + N, al[k]);
+        for (std::size_t h {0}; h < H; ++h) {
+            const auto weight = haplotype_weights[k * H + h];
+            if (weight == 0) continue;
+            const auto haplotype_likelihoods = read_likelihoods[h];
+            for (std::size_t n {0}; n < N; ++n) {
+                ln_rho[n] += weight * haplotype_likelihoods[n];
+            }
+        }
+    }
+    std::array<typename VBResponsibilityVector<K>::ValueType, K> ln_rho;
+    for (std::size_t n {0}; n < N; ++n) {
+        for (unsigned k {0}; k < K; ++k) {
+            ln_rho[k] = result[k][n];
+        }
+        const auto ln_rho_norm = maths::fast_log_sum_exp(ln_rho);
+        for (unsigned k {0}; k < K; ++k) {
+            result[k][n] = maths::fast_exp(ln_rho[k] - ln_rho_norm);
+        }
+    }
 }
 
 template <std::size_t K, typename T, typename VBLikelihoodGenotypeVector, typename ProbabilityVector_>
@@ -315,9 +381,7 @@ init_responsibilities(const VBAlpha<K>& prior_alphas,
                       const ProbabilityVector& genotype_probabilities,
                       const VBLikelihoodVector_& read_likelihoods)
 {
-    const auto N = count_reads(read_likelihoods);
-    VBResponsibilityVector<K> result {};
-    for (auto& tau : result) tau.resize(N);
+    VBResponsibilityVector<K> result {count_reads(read_likelihoods)};
     update_responsibilities(result, prior_alphas, genotype_probabilities, read_likelihoods);
     return result;
 }
@@ -347,8 +411,9 @@ template <std::size_t K>
 void update_alpha(VBAlpha<K>& alpha, const VBAlpha<K>& prior_alpha,
                   const VBResponsibilityVector<K>& taus) noexcept
 {
+    const auto N = taus.num_reads();
     for (unsigned k {0}; k < K; ++k) {
-        alpha[k] = prior_alpha[k] + sum(taus[k]);
+        alpha[k] = prior_alpha[k] + sum(taus[k], N);
     }
 }
 
@@ -363,19 +428,15 @@ void update_alphas(VBAlphaVector<K>& alphas, const VBAlphaVector<K>& prior_alpha
     }
 }
 
-inline auto marginalise(const VBTau& responsibilities, const VBReadLikelihoodArray& likelihoods) noexcept
-{
-    assert(responsibilities.size() == likelihoods.size()); // num reads
-    return inner_product(responsibilities, likelihoods);
-}
-
 template <std::size_t K>
 auto marginalise(const VBResponsibilityVector<K>& responsibilities,
                  const VBGenotype<K>& read_likelihoods) noexcept
 {
+    const auto N = responsibilities.num_reads();
     double result {0};
     for (unsigned k {0}; k < K; ++k) {
-        result += marginalise(responsibilities[k], read_likelihoods[k]);
+        assert(read_likelihoods[k].size() == N);
+        result += dot(responsibilities[k], std::addressof(*std::cbegin(read_likelihoods[k])), N);
     }
     return result;
 }
@@ -394,6 +455,57 @@ auto marginalise(const VBResponsibilityMatrix<K>& responsibilities,
     return result;
 }
 
+template <std::size_t K>
+void marginalise(LogProbabilityVector& result,
+                 const VBResponsibilityMatrix<K>& responsibilities,
+                 const VBReadLikelihoodMatrix<K>& read_likelihoods) noexcept
+{
+    const auto G = result.size();
+    for (std::size_t g {0}; g < G; ++g) {
+        result[g] = marginalise(responsibilities, read_likelihoods, g);
+    }
+}
+
+template <std::size_t K>
+void marginalise(LogProbabilityVector& result,
+                 const VBResponsibilityMatrix<K>& responsibilities,
+                 const VBCompressedLikelihoodMatrix<K>& read_likelihoods)
+{
+    // Each genotype marginal is a sum of K haplotype marginals, so only K * H inner products are needed
+    const auto G = result.size();
+    const auto S = read_likelihoods.size(); // num samples
+    assert(S == responsibilities.size());
+    std::fill(std::begin(result), std::end(result), 0.0);
+    std::vector<double> haplotype_marginals {};
+    for (std::size_t s {0}; s < S; ++s) {
+        const auto N = count_reads(read_likelihoods[s]);
+        const auto H = read_likelihoods[s].num_haplotypes();
+        haplotype_marginals.resize(K * H);
+        for (unsigned k {0}; k < K; ++k) {
+            for (std::size_t h {0}; h < H; ++h) {
+                haplotype_marginals[k * H + h] = dot(responsibilities[s][k], read_likelihoods[s][h], N);
+            }
+        }
+        for (std::size_t g {0}; g < G; ++g) {
+            const auto& genotype = read_likelihoods[s].genotype(g);
+            for (unsigned k {0}; k < K; ++k) {
+                result[g] += haplotype_marginals[k * H + genotype[k]];
+            }
+        }
+    }
+}
+
+inline void update_genotype_log_posteriors(LogProbabilityVector& result,
+                                           const LogProbabilityVector& genotype_log_priors,
+                                           const LogProbabilityVector& genotype_log_marginals)
+{
+    const auto G = result.size();
+    for (std::size_t g {0}; g < G; ++g) {
+        result[g] = genotype_log_priors[g] + genotype_log_marginals[g];
+    }
+    maths::normalise_logs(result);
+}
+
 template <std::size_t K>
 void update_genotype_log_posteriors(LogProbabilityVector& result,
                                     const LogProbabilityVector& genotype_log_priors,
@@ -407,20 +519,22 @@ void update_genotype_log_posteriors(LogProbabilityVector& result,
     maths::normalise_logs(result);
 }
 
-inline auto entropy(const VBTau& tau) noexcept
+template <typename T>
+auto entropy(const T* tau, const std::size_t n) noexcept
 {
-    using T = VBTau::value_type;
-    return -std::accumulate(std::cbegin(tau), std::cend(tau), T {0},
-                            [] (const auto curr, const auto t) noexcept { return curr + (t * std::log(t)); });
+    T result {0};
+    for (std::size_t i {0}; i < n; ++i) {
+        result -= tau[i] * std::log(tau[i]);
+    }
+    return result;
 }
 
 // E [ln q(Z_s)]
 template <std::size_t K>
 auto sum_entropies(const VBResponsibilityVector<K>& taus) noexcept
 {
-    using T = VBTau::value_type;
-    return std::accumulate(std::cbegin(taus), std::cend(taus), T {0},
-                           [] (const auto curr, const auto& tau) noexcept { return curr + entropy(tau); });
+    // Responsibilities are stored contiguously so this is a single pass over K * N elements
+    return entropy(taus[0], K * taus.num_reads());
 }
 
 template <std::size_t K>
@@ -452,6 +566,32 @@ auto calculate_evidence_lower_bound(const VBAlphaVector<K>& prior_alphas,
     return result;
 }
 
+// As above, but reusing the genotype marginals already computed for the genotype posterior update
+template <std::size_t K>
+auto calculate_evidence_lower_bound(const VBAlphaVector<K>& prior_alphas,
+                                    const VBAlphaVector<K>& posterior_alphas,
+                                    const LogProbabilityVector& genotype_log_priors,
+                                    const ProbabilityVector& genotype_posteriors,
+                                    const LogProbabilityVector& genotype_log_posteriors,
+                                    const LogProbabilityVector& genotype_log_marginals,
+                                    const VBResponsibilityMatrix<K>& taus,
+                                    const double max_posterior_skip)
+{
+    const auto G = genotype_log_priors.size();
+    const auto S = taus.size();
+    double result {0};
+    for (std::size_t g {0}; g < G; ++g) {
+        if (genotype_posteriors[g] >= max_posterior_skip) {
+            result += genotype_posteriors[g] * (genotype_log_priors[g] - genotype_log_posteriors[g] + genotype_log_marginals[g]);
+        }
+    }
+    for (std::size_t s {0}; s < S; ++s) {
+        result += (maths::log_beta(posterior_alphas[s]) - maths::log_beta(prior_alphas[s]));
+        result += sum_entropies(taus[s]);
+    }
+    return result;
+}
+
 // Main algorithm - single seed
 
 // Starting iteration with given genotype_log_posteriors
@@ -475,14 +615,16 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
     auto posterior_alphas = prior_alphas;
     auto responsibilities = init_responsibilities<K>(posterior_alphas, genotype_posteriors, log_likelihoods2);
     assert(responsibilities.size() == log_likelihoods1.size()); // num samples
+    LogProbabilityVector genotype_log_marginals(genotype_log_priors.size());
     auto prev_evidence = std::numeric_limits<double>::lowest();
     for (unsigned i {0}; i < params.max_iterations; ++i) {
-        update_genotype_log_posteriors(genotype_log_posteriors, genotype_log_priors, responsibilities, log_likelihoods1);
+        marginalise(genotype_log_marginals, responsibilities, log_likelihoods2);
+        update_genotype_log_posteriors(genotype_log_posteriors, genotype_log_priors, genotype_log_marginals);
         exp(genotype_log_posteriors, genotype_posteriors);
         update_alphas(posterior_alphas, prior_alphas, responsibilities);
         auto curr_evidence = calculate_evidence_lower_bound(prior_alphas, posterior_alphas, genotype_log_priors,
-                                                            genotype_posteriors, genotype_log_posteriors, responsibilities,
-                                                            log_likelihoods1, 1e-10);
+                                                            genotype_posteriors, genotype_log_posteriors, genotype_log_marginals,
+                                                            responsibilities, 1e-10);
         if (curr_evidence <= prev_evidence || (curr_evidence - prev_evidence) < params.epsilon) break;
         prev_evidence = curr_evidence;
         update_responsibilities(responsibilities, posterior_alphas, genotype_posteriors, log_likelihoods2);
@@ -493,7 +635,7 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
     };
 }
 
-// Not using inverted log likelihoods
+// Not using compressed log likelihoods
 template <std::size_t K>
 VBLatents<K>
 run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
@@ -509,7 +651,7 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
 // Main algorithm - multiple seed
 
 template <std::size_t K>
-bool run_vb_with_matrix_inversion(const VBReadLikelihoodMatrix<K>& log_likelihoods,
+bool run_vb_with_matrix_compression(const VBReadLikelihoodMatrix<K>& log_likelihoods,
                                   const VariationalBayesParameters& params,
                                   const std::vector<LogProbabilityVector>& seeds) noexcept
 {
@@ -526,10 +668,10 @@ run_variational_bayes(const VBAlphaVector<K>& prior_alphas,
 {
     std::vector<VBLatents<K>> result {};
     result.reserve(seeds.size());
-    if (run_vb_with_matrix_inversion(log_likelihoods, params, seeds)) {
-        const auto inverted_log_likelihoods = invert(log_likelihoods);
+    if (run_vb_with_matrix_compression(log_likelihoods, params, seeds)) {
+        const auto compressed_log_likelihoods = compress(log_likelihoods);
         const auto func = [&] (auto&& seed) { return detail::run_variational_bayes(prior_alphas, genotype_log_priors, log_likelihoods,
-                                                                                   inverted_log_likelihoods, std::move(seed), params); };
+                                                                                   compressed_log_likelihoods, std::move(seed), params); };
         if (params.parallel_execution) {
             parallel_transform(std::make_move_iterator(std::begin(seeds)), std::make_move_iterator(std::end(seeds)),
                                std::back_inserter(result), func);
@@ -704,6 +846,96 @@ inline VBReadLikelihoodArray::BaseType::value_type VBReadLikelihoodArray::operat
     return likelihoods->operator[](n);
 }
 
+inline const VBReadLikelihoodArray::BaseType::value_type* VBReadLikelihoodArray::data() const noexcept
+{
+    return likelihoods->data();
+}
+
+template <std::size_t K>
+VBResponsibilityVector<K>::VBResponsibilityVector(const std::size_t num_reads)
+: taus_(K * num_reads)
+, num_reads_ {num_reads}
+{}
+
+template <std::size_t K>
+std::size_t VBResponsibilityVector<K>::num_reads() const noexcept
+{
+    return num_reads_;
+}
+
+template <std::size_t K>
+const typename VBResponsibilityVector<K>::ValueType*
+VBResponsibilityVector<K>::operator[](const std::size_t k) const noexcept
+{
+    return taus_.data() + k * num_reads_;
+}
+
+template <std::size_t K>
+typename VBResponsibilityVector<K>::ValueType*
+VBResponsibilityVector<K>::operator[](const std::size_t k) noexcept
+{
+    return taus_.data() + k * num_reads_;
+}
+
+namespace detail {
+
+template <std::size_t K>
+VBCompressedGenotypeVector<K>::VBCompressedGenotypeVector(const VBGenotypeVector<K>& likelihoods)
+: likelihoods_ {}
+, genotypes_(likelihoods.size())
+, num_reads_ {likelihoods.empty() ? 0 : likelihoods.front().front().size()}
+, num_haplotypes_ {0}
+{
+    // Genotypes reference the likelihoods of shared haplotypes, so distinct haplotypes are identified by address
+    std::unordered_map<const ValueType*, HaplotypeIndex> haplotype_indices {};
+    for (std::size_t g {0}; g < likelihoods.size(); ++g) {
+        for (std::size_t k {0}; k < K; ++k) {
+            const auto& haplotype_likelihoods = likelihoods[g][k];
+            assert(haplotype_likelihoods.size() == num_reads_);
+            const auto p = haplotype_indices.emplace(haplotype_likelihoods.data(), num_haplotypes_);
+            if (p.second) {
+                likelihoods_.insert(std::cend(likelihoods_), std::cbegin(haplotype_likelihoods), std::cend(haplotype_likelihoods));
+                ++num_haplotypes_;
+            }
+            genotypes_[g][k] = p.first->second;
+        }
+    }
+}
+
+template <std::size_t K>
+std::size_t VBCompressedGenotypeVector<K>::num_reads() const noexcept
+{
+    return num_reads_;
+}
+
+template <std::size_t K>
+std::size_t VBCompressedGenotypeVector<K>::num_haplotypes() const noexcept
+{
+    return num_haplotypes_;
+}
+
+template <std::size_t K>
+std::size_t VBCompressedGenotypeVector<K>::num_genotypes() const noexcept
+{
+    return genotypes_.size();
+}
+
+template <std::size_t K>
+const typename VBCompressedGenotypeVector<K>::GenotypeIndex&
+VBCompressedGenotypeVector<K>::genotype(const std::size_t g) const noexcept
+{
+    return genotypes_[g];
+}
+
+template <std::size_t K>
+const typename VBCompressedGenotypeVector<K>::ValueType*
+VBCompressedGenotypeVector<K>::operator[](const std::size_t h) const noexcept
+{
+    return likelihoods_.data() + h * num_reads_;
+}
+
+} // namespace detail
+
 template <std::size_t K>
 MemoryFootprint
 estimate_memory_requirement(const std::vector<SampleName>& samples,
@@ -717,14 +949,14 @@ estimate_memory_requirement(const std::vector<SampleName>& samples,
         bytes += sizeof(VBGenotypeVector<K>) * num_genotypes;
         bytes += sizeof(VBResponsibilityMatrix<K>);
         const auto num_likelihoods = likelihoods.num_likelihoods(sample);
-        const auto tau_bytes = num_likelihoods * sizeof(VBTau::value_type);
+        const auto tau_bytes = num_likelihoods * sizeof(typename VBResponsibilityVector<K>::ValueType);
         bytes += tau_bytes * K + sizeof(VBResponsibilityVector<K>);
         if (!params.save_memory) {
-            bytes += sizeof(detail::VBExpandedLikelihoodMatrix<K>);
-            auto inverse_bytes = sizeof(detail::VBExpandedLikelihood::value_type) * num_genotypes + sizeof(detail::VBExpandedLikelihood);
-            inverse_bytes *= num_likelihoods;
-            inverse_bytes += sizeof(detail::VBExpandedGenotype);
-            bytes += K * inverse_bytes + sizeof(detail::VBExpandedGenotypeVector<K>);
+            using CompressedGenotypeVector = detail::VBCompressedGenotypeVector<K>;
+            bytes += sizeof(detail::VBCompressedLikelihoodMatrix<K>) + sizeof(CompressedGenotypeVector);
+            const auto num_haplotypes = std::min(likelihoods.num_haplotypes(), K * num_genotypes);
+            bytes += sizeof(typename CompressedGenotypeVector::ValueType) * num_haplotypes * num_likelihoods;
+            bytes += sizeof(typename CompressedGenotypeVector::GenotypeIndex) * num_genotypes;
         }
     }
     return MemoryFootprint {bytes};
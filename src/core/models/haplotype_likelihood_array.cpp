@@ -208,6 +208,11 @@ MappableBlock<Haplotype> HaplotypeLikelihoodArray::haplotypes() const
     return haplotypes_;
 }
 
+std::size_t HaplotypeLikelihoodArray::num_haplotypes() const noexcept
+{
+    return haplotypes_.size();
+}
+
 HaplotypeLikelihoodArray::SampleLikelihoodMap
 HaplotypeLikelihoodArray::extract_sample(const SampleName& sample) const
 {
@@ -371,6 +376,16 @@ HaplotypeLikelihoodArray::merge_samples(boost::optional<SampleName> new_sample)
     return result;
 }
 
+HaplotypeLikelihoodArray HaplotypeLikelihoodArray::copy_likelihoods() const
+{
+    HaplotypeLikelihoodArray result {static_cast<unsigned>(haplotypes_.size()), samples_};
+    result.likelihoods_ = likelihoods_;
+    result.haplotype_indices_ = haplotype_indices_;
+    result.sample_indices_ = sample_indices_;
+    result.haplotypes_ = haplotypes_;
+    return result;
+}
+
 // non-member methods
 
 namespace debug {
@@ -76,6 +76,7 @@ public:
     
     std::vector<SampleName> samples() const;
     MappableBlock<Haplotype> haplotypes() const;
+    std::size_t num_haplotypes() const noexcept;
     
     SampleLikelihoodMap extract_sample(const SampleName& sample) const;
     
@@ -94,6 +95,10 @@ public:
     HaplotypeLikelihoodArray merge_samples(const std::vector<SampleName>& samples, boost::optional<SampleName> new_sample = boost::none) const;
     HaplotypeLikelihoodArray merge_samples(boost::optional<SampleName> new_sample = boost::none) const;
     
+    // Copies the computed likelihoods but not the likelihood model; the copy is unprimed so it can be primed
+    // independently, e.g. on another thread.
+    HaplotypeLikelihoodArray copy_likelihoods() const;
+    
 private:
     static constexpr unsigned char mapperKmerSize {6};
     static constexpr std::size_t maxMappingPositions {10};
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <complex>
 #include <numeric>
+#include <tuple>
 #include <stdexcept>
 
 #include <boost/math/special_functions/binomial.hpp>
@@ -15,6 +16,8 @@
 
 namespace octopus {
 
+constexpr std::size_t CoalescentModel::alleleSetWordBits_;
+
 CoalescentModel::CoalescentModel(Haplotype reference, Parameters params,
                                  std::size_t num_haplotyes_hint, CachingStrategy caching)
 : reference_ {std::move(reference)}
@@ -22,9 +25,14 @@ CoalescentModel::CoalescentModel(Haplotype reference, Parameters params,
 , params_ {params}
 , haplotypes_ {}
 , caching_ {caching}
-, index_cache_ {}
-, index_flag_buffer_ {}
-, k_indel_zero_result_cache_ {2 * num_haplotyes_hint, std::vector<boost::optional<LogProbability>> {}}
+, allele_universe_ {}
+, num_allele_set_words_ {0}
+, allele_sets_ {}
+, indel_mask_ {}
+, allele_result_tables_ {}
+, allele_set_buffer_ {}
+, result_tables_ {}
+, result_table_indices_ {}
 {
     if (params_.snp_heterozygosity <= 0 || params_.indel_heterozygosity <= 0) {
         throw std::domain_error {"CoalescentModel: snp and indel heterozygosity must be > 0"};
@@ -39,7 +47,7 @@ CoalescentModel::CoalescentModel(Haplotype reference, Parameters params,
                                         std::forward_as_tuple(reference_),
                                         std::forward_as_tuple());
     }
-    k_indel_pos_result_cache_.reserve(2 * num_haplotyes_hint);
+    get_result_table(params_.indel_heterozygosity);
 }
 
 void CoalescentModel::set_reference(Haplotype reference)
@@ -53,38 +61,46 @@ void CoalescentModel::set_reference(Haplotype reference)
                                         std::forward_as_tuple(reference_),
                                         std::forward_as_tuple());
     }
+    if (is_primed()) encode_allele_sets();
 }
 
 void CoalescentModel::prime(MappableBlock<Haplotype> haplotypes)
 {
     haplotypes_ = std::move(haplotypes);
-    index_cache_.assign(haplotypes_.size(), boost::none);
-    index_flag_buffer_.assign(haplotypes_.size(), false);
+    encode_allele_sets();
 }
 
 void CoalescentModel::unprime() noexcept
 {
     haplotypes_.clear();
     haplotypes_.shrink_to_fit();
-    index_cache_.clear();
-    index_cache_.shrink_to_fit();
-    index_flag_buffer_.clear();
-    index_flag_buffer_.shrink_to_fit();
+    allele_universe_.clear();
+    allele_universe_.shrink_to_fit();
+    num_allele_set_words_ = 0;
+    allele_sets_.clear();
+    allele_sets_.shrink_to_fit();
+    indel_mask_.clear();
+    indel_mask_.shrink_to_fit();
+    allele_result_tables_.clear();
+    allele_result_tables_.shrink_to_fit();
+    allele_set_buffer_.clear();
+    allele_set_buffer_.shrink_to_fit();
 }
 
 bool CoalescentModel::is_primed() const noexcept
 {
-    return !index_cache_.empty();
+    return !haplotypes_.empty();
 }
 
 CoalescentModel::LogProbability CoalescentModel::evaluate(const Haplotype& haplotype) const
 {
-    return evaluate(count_segregating_sites(haplotype));
+    fill_site_buffer(haplotype);
+    return evaluate_site_buffer(1);
 }
 
 CoalescentModel::LogProbability CoalescentModel::evaluate(const std::vector<unsigned>& haplotype_indices) const
 {
-    return evaluate(count_segregating_sites(haplotype_indices));
+    return evaluate(haplotype_indices, std::true_type {});
 }
 
 namespace {
@@ -175,49 +191,31 @@ auto coalescent(const unsigned n, const unsigned k_snp, const unsigned k_indel,
 
 } // namespace
 
-CoalescentModel::LogProbability CoalescentModel::evaluate(const SiteCountTuple& t) const
+CoalescentModel::LogProbability
+CoalescentModel::evaluate(const unsigned k_snp, const unsigned k_indel, const unsigned n, const unsigned result_table) const
 {
-    unsigned k_snp, k_indel, n;
-    std::tie(k_snp, k_indel, n) = t;
-    if (k_indel == 0) {
-        return evaluate(k_snp, n);
-    } else {
-        return evaluate(k_snp, k_indel, n);
+    auto& table = result_tables_[result_table];
+    if (table.results.size() <= n) table.results.resize(n + 1);
+    auto& n_results = table.results[n];
+    if (n_results.size() <= k_indel) n_results.resize(k_indel + 1);
+    auto& k_indel_results = n_results[k_indel];
+    if (k_indel_results.size() <= k_snp) k_indel_results.resize(k_snp + 1);
+    auto& result = k_indel_results[k_snp];
+    if (!result) {
+        result = coalescent(n, k_snp, k_indel, params_.snp_heterozygosity, table.indel_heterozygosity);
     }
+    return *result;
 }
 
-CoalescentModel::LogProbability CoalescentModel::evaluate(const unsigned k_snp, const unsigned n) const
+unsigned CoalescentModel::get_result_table(const double indel_heterozygosity) const
 {
-    if (k_indel_zero_result_cache_.size() > n) {
-        if (k_indel_zero_result_cache_[n].size() > k_snp) {
-            auto& result = k_indel_zero_result_cache_[n][k_snp];
-            if (!result) {
-                result = coalescent(n, k_snp, 0, params_.snp_heterozygosity, params_.indel_heterozygosity);
-            }
-            return *result;
-        } else {
-            k_indel_zero_result_cache_[n].resize(k_snp + 1, boost::none);
-        }
-    } else {
-        k_indel_zero_result_cache_.resize(n + 1);
-        k_indel_zero_result_cache_[n].assign(k_snp + 1, boost::none);
+    const auto key = maths::round_sf(indel_heterozygosity, 6);
+    auto itr = result_table_indices_.find(key);
+    if (itr == std::cend(result_table_indices_)) {
+        itr = result_table_indices_.emplace(key, static_cast<unsigned>(result_tables_.size())).first;
+        result_tables_.push_back({indel_heterozygosity, {}});
     }
-    const auto result = coalescent(n, k_snp, 0, params_.snp_heterozygosity, params_.indel_heterozygosity);
-    k_indel_zero_result_cache_[n][k_snp] = result;
-    return result;
-}
-
-CoalescentModel::LogProbability CoalescentModel::evaluate(const unsigned k_snp, const unsigned k_indel, const unsigned n) const
-{
-    const auto indel_heterozygosity = calculate_buffered_indel_heterozygosity();
-    const auto t = std::make_tuple(k_snp, k_indel, n, maths::round_sf(indel_heterozygosity, 6));
-    auto itr = k_indel_pos_result_cache_.find(t);
-    if (itr != std::cend(k_indel_pos_result_cache_)) {
-        return itr->second;
-    }
-    const auto result = coalescent(n, k_snp, k_indel, params_.snp_heterozygosity, indel_heterozygosity);
-    k_indel_pos_result_cache_.emplace(t, result);
-    return result;
+    return itr->second;
 }
 
 void CoalescentModel::fill_site_buffer(const Haplotype& haplotype) const
@@ -270,17 +268,16 @@ void CoalescentModel::fill_site_buffer_from_address_cache(const Haplotype& haplo
                    std::back_inserter(site_buffer2_));
 }
 
-CoalescentModel::SiteCountTuple CoalescentModel::count_segregating_sites(const Haplotype& haplotype) const
-{
-    fill_site_buffer(haplotype);
-    return count_segregating_sites_in_buffer(1);
-}
-
-CoalescentModel::SiteCountTuple CoalescentModel::count_segregating_sites_in_buffer(const unsigned num_haplotypes) const
+CoalescentModel::LogProbability CoalescentModel::evaluate_site_buffer(const unsigned num_haplotypes) const
 {
     const auto num_indels = std::count_if(std::cbegin(site_buffer1_), std::cend(site_buffer1_),
                                           [] (const auto& v) noexcept { return is_indel(v); });
-    return std::make_tuple(site_buffer1_.size() - num_indels, num_indels, num_haplotypes + 1);
+    const unsigned k_snp = site_buffer1_.size() - num_indels, k_indel = num_indels;
+    if (k_indel == 0) {
+        return evaluate(k_snp, k_indel, num_haplotypes + 1, 0);
+    } else {
+        return evaluate(k_snp, k_indel, num_haplotypes + 1, get_result_table(calculate_buffered_indel_heterozygosity()));
+    }
 }
 
 double CoalescentModel::calculate_buffered_indel_heterozygosity() const
@@ -306,6 +303,60 @@ double CoalescentModel::calculate_heterozygosity(const Variant& indel) const
     return calculate_indel_probability(indel_heterozygosity_model_, offset, indel_size(indel));
 }
 
+void CoalescentModel::encode_allele_sets()
+{
+    std::vector<std::vector<Variant>> differences {};
+    differences.reserve(haplotypes_.size());
+    allele_universe_.clear();
+    for (const auto& haplotype : haplotypes_) {
+        differences.push_back(haplotype.difference(reference_));
+        allele_universe_.insert(std::cend(allele_universe_), std::cbegin(differences.back()), std::cend(differences.back()));
+    }
+    std::sort(std::begin(allele_universe_), std::end(allele_universe_));
+    allele_universe_.erase(std::unique(std::begin(allele_universe_), std::end(allele_universe_)), std::end(allele_universe_));
+    num_allele_set_words_ = (allele_universe_.size() + alleleSetWordBits_ - 1) / alleleSetWordBits_;
+    const auto set_bit = [] (auto first_word, const std::size_t bit) {
+        first_word[bit / alleleSetWordBits_] |= AlleleSetWord {1} << (bit % alleleSetWordBits_);
+    };
+    allele_sets_.assign(haplotypes_.size() * num_allele_set_words_, 0);
+    for (std::size_t i {0}; i < differences.size(); ++i) {
+        const auto allele_set = std::next(std::begin(allele_sets_), i * num_allele_set_words_);
+        for (const auto& allele : differences[i]) {
+            const auto allele_itr = std::lower_bound(std::cbegin(allele_universe_), std::cend(allele_universe_), allele);
+            assert(allele_itr != std::cend(allele_universe_) && *allele_itr == allele);
+            set_bit(allele_set, std::distance(std::cbegin(allele_universe_), allele_itr));
+        }
+    }
+    indel_mask_.assign(num_allele_set_words_, 0);
+    allele_result_tables_.assign(allele_universe_.size(), 0);
+    for (std::size_t i {0}; i < allele_universe_.size(); ++i) {
+        if (is_indel(allele_universe_[i])) {
+            set_bit(std::begin(indel_mask_), i);
+            allele_result_tables_[i] = get_result_table(calculate_heterozygosity(allele_universe_[i]));
+        }
+    }
+    allele_set_buffer_.assign(num_allele_set_words_, 0);
+}
+
+CoalescentModel::LogProbability CoalescentModel::evaluate_allele_set_buffer(const unsigned num_haplotypes) const
+{
+    unsigned k_snp {0}, k_indel {0};
+    boost::optional<unsigned> max_indel_result_table {};
+    for (std::size_t i {0}; i < num_allele_set_words_; ++i) {
+        const auto indels = allele_set_buffer_[i] & indel_mask_[i];
+        k_snp += __builtin_popcountll(allele_set_buffer_[i] & ~indel_mask_[i]);
+        k_indel += __builtin_popcountll(indels);
+        for (auto bits = indels; bits != 0; bits &= bits - 1) {
+            const auto result_table = allele_result_tables_[i * alleleSetWordBits_ + __builtin_ctzll(bits)];
+            if (!max_indel_result_table || result_tables_[result_table].indel_heterozygosity
+                                           > result_tables_[*max_indel_result_table].indel_heterozygosity) {
+                max_indel_result_table = result_table;
+            }
+        }
+    }
+    return evaluate(k_snp, k_indel, num_haplotypes + 1, k_indel == 0 ? 0 : *max_indel_result_table);
+}
+
 CoalescentProbabilityGreater::CoalescentProbabilityGreater(CoalescentModel model)
 : model_ {std::move(model)}
 , buffer_ {}
@@ -12,11 +12,10 @@
 #include <iterator>
 #include <algorithm>
 #include <cstddef>
-#include <tuple>
+#include <cstdint>
 #include <cassert>
 #include <type_traits>
 
-#include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
 
 #include "concepts/indexed.hpp"
@@ -67,15 +66,15 @@ public:
     
 private:
     using VariantReference = std::reference_wrapper<const Variant>;
-    using SiteCountTuple = std::tuple<unsigned, unsigned, unsigned>;
-    using SiteCountIndelTuple = std::tuple<unsigned, unsigned, unsigned, double>;
+    using AlleleSetWord = std::uint64_t;
     
-    struct SiteCountTupleHash
+    static constexpr std::size_t alleleSetWordBits_ {64};
+    
+    // Dense table of results for a single indel heterozygosity, indexed by [n][k_indel][k_snp]
+    struct ResultTable
     {
-        std::size_t operator()(const SiteCountIndelTuple& t) const noexcept
-        {
-            return boost::hash_value(t);
-        }
+        double indel_heterozygosity;
+        std::vector<std::vector<std::vector<boost::optional<LogProbability>>>> results;
     };
     
     Haplotype reference_;
@@ -87,54 +86,77 @@ private:
     mutable std::vector<VariantReference> site_buffer1_, site_buffer2_;
     mutable std::unordered_map<Haplotype, std::vector<Variant>> difference_value_cache_;
     mutable std::unordered_map<const Haplotype*, std::vector<Variant>> difference_address_cache_;
-    mutable std::vector<boost::optional<std::vector<Variant>>> index_cache_;
-    mutable std::vector<bool> index_flag_buffer_;
-    mutable std::vector<std::vector<boost::optional<LogProbability>>> k_indel_zero_result_cache_;
-    mutable std::unordered_map<SiteCountIndelTuple, LogProbability, SiteCountTupleHash> k_indel_pos_result_cache_;
     
-    LogProbability evaluate(const SiteCountTuple& t) const;
-    LogProbability evaluate(unsigned k_snp, unsigned n) const;
-    LogProbability evaluate(unsigned k_snp, unsigned k_indel, unsigned n) const;
+    // When primed, each haplotype is encoded as a bitset over the allele universe of all the primed
+    // haplotypes, so the segregating sites of any set of indexed haplotypes is just the union of their bitsets
+    std::vector<Variant> allele_universe_;
+    std::size_t num_allele_set_words_;
+    std::vector<AlleleSetWord> allele_sets_, indel_mask_;
+    std::vector<unsigned> allele_result_tables_;
+    mutable std::vector<AlleleSetWord> allele_set_buffer_;
+    
+    mutable std::vector<ResultTable> result_tables_;
+    mutable std::unordered_map<double, unsigned> result_table_indices_;
+    
+    LogProbability evaluate(unsigned k_snp, unsigned k_indel, unsigned n, unsigned result_table) const;
+    unsigned get_result_table(double indel_heterozygosity) const;
+    
+    template <typename Container> LogProbability evaluate(const Container& haplotypes, std::false_type) const;
+    template <typename Container> LogProbability evaluate(const Container& haplotypes, std::true_type) const;
     
     void fill_site_buffer(const Haplotype& haplotype) const;
     template <typename Range> void fill_site_buffer(const Range& haplotypes) const;
-    template <typename Range> void fill_site_buffer(const Range& haplotypes, std::false_type) const;
-    template <typename Range> void fill_site_buffer(const Range& haplotypes, std::true_type) const;
     void fill_site_buffer_uncached(const Haplotype& haplotype) const;
     void fill_site_buffer_from_value_cache(const Haplotype& haplotype) const;
     void fill_site_buffer_from_address_cache(const Haplotype& haplotype) const;
-    
-    SiteCountTuple count_segregating_sites(const Haplotype& haplotype) const;
-    template <typename Container> SiteCountTuple count_segregating_sites(const Container& haplotypes) const;
-    SiteCountTuple count_segregating_sites_in_buffer(unsigned num_haplotypes) const;
+    LogProbability evaluate_site_buffer(unsigned num_haplotypes) const;
     double calculate_buffered_indel_heterozygosity() const;
     double calculate_heterozygosity(const Variant& indel) const;
+    
+    void encode_allele_sets();
+    template <typename Range> void fill_allele_set_buffer(const Range& haplotypes) const;
+    LogProbability evaluate_allele_set_buffer(unsigned num_haplotypes) const;
 };
 
-template <typename Container>
-CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes) const
-{
-    return evaluate(count_segregating_sites(haplotypes));
-}
-
-// private methods
-
 namespace detail {
 
 template <typename T, typename = void> struct is_indexed_or_index : std::false_type {};
 template <typename T>
 struct is_indexed_or_index<T, std::enable_if_t<is_indexed_v<T> || std::is_integral<T>::value>> : std::true_type {};
 
+template <typename Container>
+auto size(const Container& haplotypes) noexcept
+{
+    // Use this because Genotype template does not have a size member method (uses ploidy instead).
+    return std::distance(std::cbegin(haplotypes), std::cend(haplotypes));
+}
+
 } // namespace detail
 
-template <typename Range>
-void CoalescentModel::fill_site_buffer(const Range& haplotypes) const
+template <typename Container>
+CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes) const
+{
+    return evaluate(haplotypes, detail::is_indexed_or_index<typename Container::value_type> {});
+}
+
+// private methods
+
+template <typename Container>
+CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes, std::false_type) const
+{
+    fill_site_buffer(haplotypes);
+    return evaluate_site_buffer(detail::size(haplotypes));
+}
+
+template <typename Container>
+CoalescentModel::LogProbability CoalescentModel::evaluate(const Container& haplotypes, std::true_type) const
 {
-    fill_site_buffer(haplotypes, detail::is_indexed_or_index<typename Range::value_type> {});
+    fill_allele_set_buffer(haplotypes);
+    return evaluate_allele_set_buffer(detail::size(haplotypes));
 }
 
 template <typename Range>
-void CoalescentModel::fill_site_buffer(const Range& haplotypes, std::false_type) const
+void CoalescentModel::fill_site_buffer(const Range& haplotypes) const
 {
     assert(site_buffer2_.empty());
     site_buffer1_.clear();
@@ -153,55 +175,15 @@ template <typename T>
 inline std::enable_if_t<std::is_integral<T>::value, T> index_of(T i) noexcept { return i; }
 
 template <typename Range>
-void CoalescentModel::fill_site_buffer(const Range& haplotypes, std::true_type) const
+void CoalescentModel::fill_allele_set_buffer(const Range& haplotypes) const
 {
-    site_buffer1_.clear();
-    std::fill(std::begin(index_flag_buffer_), std::end(index_flag_buffer_), false);
-    unsigned num_unique_nonempty_indices {0};
-    auto middle = std::begin(site_buffer1_);
+    assert(is_primed());
+    std::fill(std::begin(allele_set_buffer_), std::end(allele_set_buffer_), 0);
     for (auto indexed : haplotypes) {
-        const auto index = index_of(indexed);
-        if (!index_flag_buffer_[index]) {
-            auto& variants = index_cache_[index];
-            if (!variants) {
-                variants = haplotypes_[index].difference(reference_);
-            }
-            if (!variants->empty()) {
-                middle = site_buffer1_.insert(std::cend(site_buffer1_), std::cbegin(*variants), std::cend(*variants));
-                ++num_unique_nonempty_indices;
-            }
-            index_flag_buffer_[index] = true;
-        }
+        const auto allele_set = std::next(std::cbegin(allele_sets_), index_of(indexed) * num_allele_set_words_);
+        std::transform(allele_set, std::next(allele_set, num_allele_set_words_), std::cbegin(allele_set_buffer_),
+                       std::begin(allele_set_buffer_), [] (auto lhs, auto rhs) noexcept { return lhs | rhs; });
     }
-    if (num_unique_nonempty_indices == 2) {
-        assert(site_buffer2_.empty());
-        std::merge(std::begin(site_buffer1_), middle, middle, std::end(site_buffer1_), std::back_inserter(site_buffer2_));
-        site_buffer2_.erase(std::unique(std::begin(site_buffer2_), std::end(site_buffer2_)), std::end(site_buffer2_));
-        site_buffer1_ = std::move(site_buffer2_);
-        site_buffer2_.clear();
-    } else if (num_unique_nonempty_indices > 2) {
-        std::sort(std::begin(site_buffer1_), std::end(site_buffer1_));
-        site_buffer1_.erase(std::unique(std::begin(site_buffer1_), std::end(site_buffer1_)), std::end(site_buffer1_));
-    }
-}
-
-namespace detail {
-
-template <typename Container>
-auto size(const Container& haplotypes) noexcept
-{
-    // Use this because Genotype template does not have a size member method (uses ploidy instead).
-    return std::distance(std::cbegin(haplotypes), std::cend(haplotypes));
-}
-
-} // namespace detail
-
-template <typename Container>
-CoalescentModel::SiteCountTuple
-CoalescentModel::count_segregating_sites(const Container& haplotypes) const
-{
-    fill_site_buffer(haplotypes);
-    return count_segregating_sites_in_buffer(detail::size(haplotypes));
 }
 
 struct CoalescentProbabilityGreater
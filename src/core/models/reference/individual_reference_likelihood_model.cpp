@@ -3,7 +3,64 @@
 
 #include "individual_reference_likelihood_model.hpp"
 
-namespace octopus {
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
 
+#include "utils/maths.hpp"
 
+namespace octopus { namespace model {
+
+namespace {
+
+struct BaseLnLikelihoods
+{
+    double reference, non_reference, heterozygous;
+};
+
+using BaseLnLikelihoodTable = std::array<BaseLnLikelihoods, std::numeric_limits<AlignedRead::BaseQuality>::max() + 1>;
+
+auto make_base_ln_likelihood_table()
+{
+    BaseLnLikelihoodTable result {};
+    for (std::size_t base_quality {0}; base_quality < result.size(); ++base_quality) {
+        const auto phred = std::max(base_quality, std::size_t {1});
+        const auto error_ln_probability = phred * -maths::constants::ln10Div10<>;
+        const auto correct_ln_probability = std::log(1.0 - std::pow(10.0, -static_cast<double>(phred) / 10.0));
+        result[base_quality].reference = correct_ln_probability;
+        result[base_quality].non_reference = error_ln_probability;
+        result[base_quality].heterozygous = maths::log_sum_exp(correct_ln_probability, error_ln_probability) - std::log(2);
+    }
+    return result;
+}
+
+} // namespace
+
+Phred<double> compute_homozygous_reference_posterior(const Allele& reference, const ReadPileups& pileups)
+{
+    static const BaseLnLikelihoodTable base_ln_likelihoods {make_base_ln_likelihood_table()};
+    const auto& pileup_region = contig_region(pileups);
+    const auto& allele_region = contig_region(reference);
+    const auto first = std::max(allele_region.begin(), pileup_region.begin());
+    const auto last = std::min(allele_region.end(), pileup_region.end());
+    double hom_ref_ln_likelihood {0}, het_alt_ln_likelihood {0};
+    std::size_t depth {0};
+    for (auto position = first; position < last; ++position) {
+        const auto reference_base = reference.sequence()[position - allele_region.begin()];
+        const auto column = pileups.column(position);
+        for (std::size_t i {0}; i < column.size; ++i) {
+            const auto& ln_likelihoods = base_ln_likelihoods[column.base_qualities[i]];
+            hom_ref_ln_likelihood += column.bases[i] == reference_base ? ln_likelihoods.reference : ln_likelihoods.non_reference;
+            het_alt_ln_likelihood += ln_likelihoods.heterozygous;
+        }
+        depth += column.size;
+    }
+    if (depth == 0) return Phred<double> {3.0};
+    const auto het_ln_posterior = het_alt_ln_likelihood - maths::log_sum_exp(hom_ref_ln_likelihood, het_alt_ln_likelihood);
+    return log_probability_false_to_phred(het_ln_posterior);
+}
+
+} // namespace model
 } // namespace octopus
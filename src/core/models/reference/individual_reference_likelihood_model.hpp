@@ -4,9 +4,18 @@
 #ifndef individual_reference_likelihood_model_hpp
 #define individual_reference_likelihood_model_hpp
 
-namespace octopus {
+#include "basics/phred.hpp"
+#include "basics/read_pileup.hpp"
+#include "core/types/allele.hpp"
 
+namespace octopus { namespace model {
 
+// Posterior that a sample is homozygous for the reference allele, rather than heterozygous for some
+// other allele, given the pileup base observations over the allele. Each base observation is correct with
+// probability given by its base quality (floored at 1). Returns Phred 3 when there are no observations.
+Phred<double> compute_homozygous_reference_posterior(const Allele& reference, const ReadPileups& pileups);
+
+} // namespace model
 } // namespace octopus
 
 #endif
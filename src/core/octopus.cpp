@@ -27,6 +27,7 @@
 #include <boost/optional.hpp>
 
 #include "config/common.hpp"
+#include "config/option_collation.hpp"
 #include "basics/genomic_region.hpp"
 #include "basics/ploidy_map.hpp"
 #include "concepts/mappable.hpp"
@@ -56,6 +57,8 @@
 #include "readpipe/buffered_read_pipe.hpp"
 #include "core/tools/bam_realigner.hpp"
 #include "core/tools/indel_profiler.hpp"
+#include "core/checkpoint_journal.hpp"
+#include "core/sharding.hpp"
 
 #include "timers.hpp" // BENCHMARK
 
@@ -143,13 +146,18 @@ auto get_call_types(const GenomeCallingComponents& components, const std::vector
 void write_caller_output_header(GenomeCallingComponents& components, const UserCommandInfo& info)
 {
     const auto call_types = get_call_types(components, components.contigs());
+    VcfHeader header {};
     if (components.sites_only() && !apply_csr(components)) {
-        components.output() << make_vcf_header({}, components.contigs(), components.reference(),
-                                               call_types, info);
+        header = make_vcf_header({}, components.contigs(), components.reference(), call_types, info);
     } else {
-        components.output() << make_vcf_header(components.samples(), components.contigs(),
-                                               components.reference(), call_types, info);
+        header = make_vcf_header(components.samples(), components.contigs(), components.reference(), call_types, info);
     }
+    if (components.shard()) {
+        VcfHeader::Builder builder {header};
+        add_shard_field(*components.shard(), builder);
+        header = builder.build_once();
+    }
+    components.output() << header;
 }
 
 std::string get_caller_name(const GenomeCallingComponents& components)
@@ -203,6 +211,23 @@ void log_startup_info(const GenomeCallingComponents& components)
     str.pop_back(); // the extra whitespace
     log << str;
     stream(log) << "Invoked calling model: " << get_caller_name(components);
+    if (components.shard()) {
+        const auto& shard = *components.shard();
+        auto ls = stream(log);
+        ls << "Calling shard " << shard.index << '/' << shard.count << " from ";
+        if (shard.begin) {
+            ls << shard.begin->contig << ':' << shard.begin->position;
+        } else {
+            ls << "the start";
+        }
+        ls << " to ";
+        if (shard.end) {
+            ls << shard.end->contig << ':' << shard.end->position;
+        } else {
+            ls << "the end";
+        }
+        ls << " of the search regions";
+    }
     {
         const auto search_size = utils::format_with_commas(sum_region_sizes(components.search_regions()));
         const auto num_threads = components.num_threads();
@@ -262,6 +287,11 @@ void log_finish_info(const GenomeCallingComponents& components, const utils::Tim
     stream(info_log) << "Finished calling "
                      << utils::format_with_commas(search_size) << "bp, total runtime "
                      << run_duration;
+    if (components.memory_governor()) {
+        std::ostringstream ss {};
+        print_peak_usage(ss, *components.memory_governor());
+        info_log << ss.str();
+    }
     const auto output_path = get_final_output_path(components);
     if (output_path) stream(info_log) << "Calls have been written to " << *output_path;
 }
@@ -477,10 +507,19 @@ bool can_use_temp_bcf(const GenomicRegion& region)
     return std::find(std::cbegin(region.contig_name()), std::cend(region.contig_name()), ':') == std::cend(region.contig_name());
 }
 
+auto get_temp_output_directory(const GenomeCallingComponents& components)
+{
+    // Checkpointed calls must outlive the run
+    if (components.checkpoint_journal()) {
+        return components.checkpoint_journal()->directory();
+    }
+    return *components.temp_directory();
+}
+
 auto create_unique_temp_output_file_path(const GenomicRegion& region,
                                          const GenomeCallingComponents& components)
 {
-    auto result = *components.temp_directory();
+    auto result = get_temp_output_directory(components);
     const auto begin   = std::to_string(region.begin());
     const auto end     = std::to_string(region.end());
     boost::filesystem::path file_name {region.contig_name() + "_" + begin + "-" + end + "_temp"};
@@ -512,17 +551,32 @@ VcfWriter create_unique_temp_output_file(const GenomicRegion::ContigName& contig
     return create_unique_temp_output_file(components.reference().contig_region(contig), components);
 }
 
+VcfWriter create_checkpointed_temp_output_file(const GenomicRegion::ContigName& contig,
+                                               const GenomeCallingComponents& components,
+                                               CheckpointJournal& journal)
+{
+    const auto progress = journal.progress(contig);
+    if (progress.calls_file) {
+        return restore_temp_output_file(*progress.calls_file, progress.num_records);
+    }
+    auto result = create_unique_temp_output_file(contig, components);
+    journal.record_calls_file(contig, *result.path());
+    return result;
+}
+
 using TempVcfWriterMap = std::unordered_map<ContigName, VcfWriter>;
 
-TempVcfWriterMap make_temp_vcf_writers(const GenomeCallingComponents& components)
+TempVcfWriterMap make_temp_vcf_writers(GenomeCallingComponents& components)
 {
-    if (!components.temp_directory()) {
+    if (!components.temp_directory() && !components.checkpoint_journal()) {
         throw std::runtime_error {"Could not make temp writers"};
     }
     TempVcfWriterMap result {};
     result.reserve(components.contigs().size());
     for (const auto& contig : components.contigs()) {
-        auto contig_writer = create_unique_temp_output_file(contig, components);
+        auto contig_writer = components.checkpoint_journal()
+                             ? create_checkpointed_temp_output_file(contig, components, *components.checkpoint_journal())
+                             : create_unique_temp_output_file(contig, components);
         contig_writer.close();
         result.emplace(contig, std::move(contig_writer));
     }
@@ -683,6 +737,16 @@ auto make_contig_components(const ContigName& contig, GenomeCallingComponents& c
     return result;
 }
 
+void mark_finished(const ContigName& contig, const bool last_contig, TaskMakerSyncPacket& sync)
+{
+    std::unique_lock<std::mutex> lock {sync.mutex};
+    sync.cv.wait(lock, [&] () { return sync.ready; });
+    sync.finished.at(contig) = true;
+    if (last_contig) sync.all_done = true;
+    lock.unlock();
+    sync.cv.notify_one();
+}
+
 void make_tasks_helper(TaskMap& tasks,
                        std::vector<ContigName> contigs,
                        GenomeCallingComponents& components,
@@ -698,6 +762,14 @@ void make_tasks_helper(TaskMap& tasks,
             const auto& contig = contigs[i];
             if (debug_log) stream(*debug_log) << "Making tasks for contig " << contig;
             auto contig_components = make_contig_components(contig, components, num_threads);
+            if (components.checkpoint_journal()) {
+                remove_recorded_windows(contig_components.regions, components.checkpoint_journal()->progress(contig));
+                if (contig_components.regions.empty()) {
+                    if (debug_log) stream(*debug_log) << "All windows in contig " << contig << " are already recorded";
+                    mark_finished(contig, i == contigs.size() - 1, sync);
+                    continue;
+                }
+            }
             make_contig_tasks(contig_components, execution_policy, tasks[contig], sync, i == contigs.size() - 1, window_config);
             if (debug_log) stream(*debug_log) << "Finished making tasks for contig " << contig;
         }
@@ -927,20 +999,28 @@ struct TaskWriterSyncPacket
     bool done = false;
 };
 
-void write(std::deque<CompletedTask>& tasks, TempVcfWriterMap& writers)
+void write(CompletedTask& task, VcfWriter& temp_vcf, boost::optional<CheckpointJournal&> journal)
+{
+    const auto num_calls = task.calls.size();
+    write_calls(std::move(task.calls), temp_vcf);
+    // Written tasks have already had connecting calls resolved with the next task, so the
+    // next task can be recalled on resume without needing these calls
+    if (journal) journal->record_window(task.region, num_calls);
+}
+
+void write(std::deque<CompletedTask>& tasks, TempVcfWriterMap& writers, boost::optional<CheckpointJournal&> journal)
 {
     static auto debug_log = get_debug_log();
     for (auto&& task : tasks) {
         if (debug_log) {
             stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
         }
-        auto& writer = writers.at(contig_name(task));
-        write_calls(std::move(task.calls), writer);
+        write(task, writers.at(contig_name(task)), journal);
     }
     tasks.clear();
 }
 
-void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync)
+void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync, boost::optional<CheckpointJournal&> journal)
 {
     try {
         std::unique_lock<std::mutex> lock {sync.mutex, std::defer_lock};
@@ -952,7 +1032,7 @@ void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync
             std::swap(sync.tasks, buffer);
             lock.unlock();
             sync.cv.notify_one();
-            write(buffer, writers);
+            write(buffer, writers, journal);
         }
         logging::DebugLogger debug_log {};
         debug_log << "Task writer finished";
@@ -973,17 +1053,18 @@ void write_temp_vcf_helper(TempVcfWriterMap& writers, TaskWriterSyncPacket& sync
     }
 }
 
-std::thread make_task_writer_thread(TempVcfWriterMap& temp_writers, TaskWriterSyncPacket& writer_sync)
+std::thread make_task_writer_thread(TempVcfWriterMap& temp_writers, TaskWriterSyncPacket& writer_sync,
+                                    boost::optional<CheckpointJournal&> journal)
 {
-    return std::thread {write_temp_vcf_helper, std::ref(temp_writers), std::ref(writer_sync)};
+    return std::thread {write_temp_vcf_helper, std::ref(temp_writers), std::ref(writer_sync), journal};
 }
 
-void write(std::deque<CompletedTask>&& tasks, VcfWriter& temp_vcf)
+void write(std::deque<CompletedTask>&& tasks, VcfWriter& temp_vcf, boost::optional<CheckpointJournal&> journal)
 {
     static auto debug_log = get_debug_log();
     for (auto&& task : tasks) {
         if (debug_log) stream(*debug_log) << "Writing completed task " << task << " that finished in " << duration(task);
-        write_calls(std::move(task.calls), temp_vcf);
+        write(task, temp_vcf, journal);
     }
 }
 
@@ -1081,21 +1162,32 @@ void resolve_connecting_calls(RemainingTaskMap& remaining_tasks,
     }
 }
 
-void write(RemainingTaskMap&& remaining_tasks, TempVcfWriterMap& temp_vcfs)
+void write(RemainingTaskMap&& remaining_tasks, TempVcfWriterMap& temp_vcfs, boost::optional<CheckpointJournal&> journal)
 {
     for (auto& p : remaining_tasks) {
-        write(std::move(p.second), temp_vcfs.at(p.first));
+        write(std::move(p.second), temp_vcfs.at(p.first), journal);
     }
 }
 
 void write_remaining_tasks(FutureCompletedTasks& futures, CompletedTaskMap& buffered_tasks, TempVcfWriterMap& temp_vcfs,
-                           const ContigCallingComponentFactoryMap& calling_components)
+                           const ContigCallingComponentFactoryMap& calling_components,
+                           boost::optional<CheckpointJournal&> journal)
 {
     static auto debug_log = get_debug_log();
     if (debug_log) stream(*debug_log) << "Waiting for " << futures.size() << " running tasks to finish";
     auto remaining_tasks = extract_remaining_tasks(futures, buffered_tasks);
     resolve_connecting_calls(remaining_tasks, calling_components);
-    write(std::move(remaining_tasks), temp_vcfs);
+    write(std::move(remaining_tasks), temp_vcfs, journal);
+}
+
+void log_recorded_windows(const CheckpointJournal& journal, GenomeCallingComponents& components)
+{
+    for (const auto& contig : components.contigs()) {
+        const auto progress = journal.progress(contig);
+        if (progress.end > 0) {
+            components.progress_meter().log_completed(GenomicRegion {contig, 0, progress.end});
+        }
+    }
 }
 
 auto extract_writers(TempVcfWriterMap&& vcfs)
@@ -1156,9 +1248,14 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     const auto calling_components = make_contig_calling_component_factory_map(components);
     unsigned num_idle_futures {0};
     
+    const auto journal = components.checkpoint_journal();
+    if (journal && journal->is_resumed()) {
+        logging::InfoLogger info_log {};
+        stream(info_log) << "Resuming calling from checkpoint " << journal->directory();
+    }
     auto temp_writers = make_temp_vcf_writers(components);
     TaskWriterSyncPacket task_writer_sync {};
-    auto task_writer_thread = make_task_writer_thread(temp_writers, task_writer_sync);
+    auto task_writer_thread = make_task_writer_thread(temp_writers, task_writer_sync, journal);
     if (!task_writer_thread.joinable()) {
         logging::FatalLogger fatal_log {};
         fatal_log << "Unable to make task writer thread";
@@ -1167,8 +1264,8 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     task_writer_thread.detach();
     
     // Wait for the first task to be made
-    const auto tasks_available = [&] () noexcept { return task_maker_sync.num_tasks > 0; };
-    while(task_maker_sync.num_tasks == 0) {
+    const auto tasks_available = [&] () noexcept { return task_maker_sync.num_tasks > 0 || task_maker_sync.all_done; };
+    while(task_maker_sync.num_tasks == 0 && !task_maker_sync.all_done) {
         pending_task_lock.lock();
         task_maker_sync.cv.wait(pending_task_lock, tasks_available);
         pending_task_lock.unlock();
@@ -1176,6 +1273,7 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     task_maker_sync.batch_size_hint = num_task_threads / 2;
     
     components.progress_meter().start();
+    if (journal) log_recorded_windows(*journal, components);
     
     while (!task_maker_sync.all_done || task_maker_sync.num_tasks > 0) {
         pending_task_lock.lock();
@@ -1185,7 +1283,7 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
             if (num_idle_futures < futures.size()) {
                 // If there are running futures then it's good periodically check to see if
                 // any have finished and process them while we wait for the task maker.
-                while (task_maker_sync.num_tasks == 0 && caller_sync.num_finished == 0) {
+                while (task_maker_sync.num_tasks == 0 && !task_maker_sync.all_done && caller_sync.num_finished == 0) {
                     auto now = std::chrono::system_clock::now();
                     task_maker_sync.cv.wait_until(pending_task_lock, now + 5s, tasks_available);
                 }
@@ -1234,9 +1332,10 @@ void run_octopus_multi_threaded(GenomeCallingComponents& components)
     holdbacks.clear(); // holdbacks are just references to buffered tasks
     if (debug_log) *debug_log << "Finished making new tasks. Waiting for task writer to complete existing jobs";
     wait_until_finished(task_writer_sync);
-    write_remaining_tasks(futures, buffered_tasks, temp_writers, calling_components);
+    write_remaining_tasks(futures, buffered_tasks, temp_writers, calling_components, journal);
     components.progress_meter().stop();
     merge(std::move(temp_writers), components);
+    if (journal) journal->clear();
 }
 
 } // namespace
@@ -1248,7 +1347,8 @@ bool is_multithreaded(const GenomeCallingComponents& components)
 
 void run_calling(GenomeCallingComponents& components)
 {
-    if (is_multithreaded(components)) {
+    // Only the multithreaded calling path writes calls in windows that can be checkpointed
+    if (is_multithreaded(components) || components.checkpoint_journal()) {
         if (DEBUG_MODE) {
             logging::WarningLogger warn_log {};
             warn_log << "Running in parallel mode can make debug log difficult to interpret";
@@ -1635,4 +1735,21 @@ void run_octopus(GenomeCallingComponents& components, UserCommandInfo info)
     cleanup(components);
 }
 
+void run_shard_merge(const options::OptionMap& options)
+{
+    logging::InfoLogger info_log {};
+    std::vector<VcfReader> shards {};
+    for (auto& shard_path : options::get_shard_paths(options)) {
+        shards.emplace_back(std::move(shard_path));
+    }
+    stream(info_log) << "Merging " << shards.size() << " shards";
+    const auto output_path = options::get_output_path(options);
+    auto output = output_path ? VcfWriter {*output_path} : VcfWriter {};
+    merge_shards(shards, output);
+    output.close();
+    if (output_path) {
+        stream(info_log) << "Merged shard calls written to " << *output_path;
+    }
+}
+
 } // namespace octopus
@@ -7,6 +7,7 @@
 #include <string>
 
 #include "calling_components.hpp"
+#include "config/option_parser.hpp"
 
 namespace octopus {
 
@@ -17,6 +18,9 @@ struct UserCommandInfo
 
 void run_octopus(GenomeCallingComponents& components, UserCommandInfo info);
 
+// Merges the outputs of a sharded run rather than calling
+void run_shard_merge(const options::OptionMap& options);
+
 }
 
 #endif
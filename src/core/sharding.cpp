@@ -0,0 +1,294 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "sharding.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "io/variant/vcf_utils.hpp"
+#include "exceptions/user_error.hpp"
+
+namespace octopus {
+
+namespace {
+
+// Calling cost is mostly proportional to the number of reads, but reference bases without
+// reads still need some work
+constexpr double referenceBaseCost {0.01};
+
+const std::string shardTag {"octopusShard"};
+
+using ContigName = GenomicRegion::ContigName;
+using Position   = GenomicRegion::Position;
+
+std::vector<double> calculate_costs_per_base(const std::vector<ContigName>& contigs,
+                                             const ReferenceGenome& reference,
+                                             const ReadManager& reads)
+{
+    std::vector<double> result {};
+    result.reserve(contigs.size());
+    for (const auto& contig : contigs) {
+        double read_density {0};
+        const auto num_mapped_reads = reads.count_mapped_reads(contig);
+        const auto contig_size = reference.contig_size(contig);
+        if (num_mapped_reads && contig_size > 0) {
+            read_density = static_cast<double>(*num_mapped_reads) / contig_size;
+        }
+        result.push_back(referenceBaseCost + read_density);
+    }
+    return result;
+}
+
+double sum_cost(const InputRegionMap& regions, const std::vector<ContigName>& contigs,
+                const std::vector<double>& costs_per_base)
+{
+    double result {0};
+    for (std::size_t i {0}; i < contigs.size(); ++i) {
+        if (regions.count(contigs[i]) == 0) continue;
+        for (const auto& region : regions.at(contigs[i])) {
+            result += size(region) * costs_per_base[i];
+        }
+    }
+    return result;
+}
+
+// The boundary is the end of the last region if the target is not reached, which can happen through
+// rounding or when there is nothing to split, so there is only no boundary if there are no regions
+boost::optional<ShardBoundary>
+find_boundary(const double target_cost, const InputRegionMap& regions, const std::vector<ContigName>& contigs,
+              const std::vector<double>& costs_per_base)
+{
+    boost::optional<ShardBoundary> result {};
+    double cost {0};
+    for (std::size_t i {0}; i < contigs.size(); ++i) {
+        if (regions.count(contigs[i]) == 0) continue;
+        for (const auto& region : regions.at(contigs[i])) {
+            const auto region_cost = size(region) * costs_per_base[i];
+            if (cost + region_cost > target_cost) {
+                const auto offset = static_cast<Position>((target_cost - cost) / costs_per_base[i]);
+                return ShardBoundary {contigs[i], region.begin() + std::min(offset, size(region))};
+            }
+            cost += region_cost;
+            result = ShardBoundary {contigs[i], region.end()};
+        }
+    }
+    return result;
+}
+
+std::string to_string(const ShardBoundary& boundary)
+{
+    return boundary.contig + ":" + std::to_string(boundary.position);
+}
+
+ShardBoundary parse_boundary(const std::string& boundary)
+{
+    const auto position_pos = boundary.rfind(':');
+    if (position_pos == std::string::npos) {
+        throw std::invalid_argument {"parse_boundary: bad boundary " + boundary};
+    }
+    return {boundary.substr(0, position_pos), static_cast<Position>(std::stoul(boundary.substr(position_pos + 1)))};
+}
+
+bool operator==(const ShardBoundary& lhs, const ShardBoundary& rhs) noexcept
+{
+    return lhs.contig == rhs.contig && lhs.position == rhs.position;
+}
+
+class InconsistentShards : public UserError
+{
+    std::string do_where() const override
+    {
+        return "merge_shards";
+    }
+
+    std::string do_why() const override
+    {
+        std::ostringstream ss {};
+        ss << "The shard file " << file_ << ' ' << why_;
+        return ss.str();
+    }
+
+    std::string do_help() const override
+    {
+        return "Give the output of every shard of the same --shard run, in shard order, to --merge-shards";
+    }
+
+    VcfReader::Path file_;
+    std::string why_;
+public:
+    InconsistentShards(VcfReader::Path file, std::string why) : file_ {std::move(file)}, why_ {std::move(why)} {}
+};
+
+VcfHeader remove_shard_field(const VcfHeader& header)
+{
+    auto structured_fields = header.structured_fields();
+    structured_fields.erase(VcfHeader::Tag {shardTag});
+    return VcfHeader {header.file_format(), header.samples(), header.basic_fields(), std::move(structured_fields)};
+}
+
+// The calls either side of a shard boundary are split at a single cut point: the begin of the first
+// call of the right shard that is not entirely in its left overlap. Calls that begin at or after the cut
+// come from the right shard, and calls that end at or before it from the left shard. This keeps all of
+// the right shard's calls around the boundary, so its phase sets are not broken, and any call of the
+// left shard that overlaps them is dropped.
+boost::optional<Position> find_cut(const VcfReader& shard, const ShardBoundary& begin)
+{
+    for (auto p = shard.iterate(VcfReader::UnpackPolicy::sites); p.first != p.second; ++p.first) {
+        const auto& call = *p.first;
+        if (call.chrom() != begin.contig) break;
+        if (mapped_end(call) > begin.position) return mapped_begin(call);
+    }
+    return boost::none;
+}
+
+// A missing cut means the right shard has no calls on the boundary contig past its left overlap
+void write_shard_calls(const VcfReader& shard_vcf, const Shard& shard,
+                       const boost::optional<Position> begin_cut, const boost::optional<Position> end_cut,
+                       VcfWriter& dst)
+{
+    for (auto p = shard_vcf.iterate(); p.first != p.second; ++p.first) {
+        const auto& call = *p.first;
+        if (shard.begin && call.chrom() == shard.begin->contig) {
+            if (!begin_cut || mapped_begin(call) < *begin_cut) continue;
+        }
+        if (shard.end && call.chrom() == shard.end->contig) {
+            if (end_cut && mapped_end(call) > *end_cut) continue;
+        }
+        dst << call;
+    }
+}
+
+} // namespace
+
+Shard make_shard(const unsigned index, const unsigned count,
+                 const InputRegionMap& regions,
+                 const std::vector<ContigName>& contigs,
+                 const ReferenceGenome& reference,
+                 const ReadManager& reads)
+{
+    if (index == 0 || index > count) {
+        throw std::invalid_argument {"make_shard: bad shard index"};
+    }
+    Shard result {index, count};
+    auto costs_per_base = calculate_costs_per_base(contigs, reference, reads);
+    auto total_cost = sum_cost(regions, contigs, costs_per_base);
+    if (!(total_cost > 0)) {
+        // Nothing to weight the regions by, so split them evenly by length
+        std::fill(std::begin(costs_per_base), std::end(costs_per_base), 1.0);
+        total_cost = sum_cost(regions, contigs, costs_per_base);
+    }
+    // Each boundary target is calculated identically by the shards either side of it
+    const auto boundary_target = [&] (unsigned i) { return total_cost * i / count; };
+    if (index > 1) result.begin = find_boundary(boundary_target(index - 1), regions, contigs, costs_per_base);
+    if (index < count) result.end = find_boundary(boundary_target(index), regions, contigs, costs_per_base);
+    return result;
+}
+
+InputRegionMap get_shard_regions(const Shard& shard,
+                                 const InputRegionMap& regions,
+                                 const std::vector<ContigName>& contigs,
+                                 const GenomicRegion::Size overlap)
+{
+    InputRegionMap result {};
+    auto contig_itr = std::cbegin(contigs);
+    if (shard.begin) {
+        contig_itr = std::find(std::cbegin(contigs), std::cend(contigs), shard.begin->contig);
+    }
+    for (; contig_itr != std::cend(contigs); ++contig_itr) {
+        const auto& contig = *contig_itr;
+        Position lhs {0}, rhs {std::numeric_limits<Position>::max()};
+        if (shard.begin && contig == shard.begin->contig) {
+            lhs = shard.begin->position > overlap ? shard.begin->position - overlap : 0;
+        }
+        const bool is_last_contig {shard.end && contig == shard.end->contig};
+        if (is_last_contig && shard.end->position < rhs - overlap) {
+            rhs = shard.end->position + overlap;
+        }
+        if (regions.count(contig) == 1) {
+            InputRegionMap::mapped_type shard_regions {};
+            for (const auto& region : regions.at(contig)) {
+                if (region.begin() < rhs && lhs < region.end()) {
+                    shard_regions.emplace(contig, std::max(region.begin(), lhs), std::min(region.end(), rhs));
+                }
+            }
+            if (!shard_regions.empty()) result.emplace(contig, std::move(shard_regions));
+        }
+        if (is_last_contig) break;
+    }
+    return result;
+}
+
+void add_shard_field(const Shard& shard, VcfHeader::Builder& builder)
+{
+    std::unordered_map<std::string, std::string> values {
+        {"ID", std::to_string(shard.index)},
+        {"Count", std::to_string(shard.count)}
+    };
+    if (shard.begin) values.emplace("Begin", to_string(*shard.begin));
+    if (shard.end) values.emplace("End", to_string(*shard.end));
+    builder.add_structured_field(shardTag, std::move(values));
+}
+
+boost::optional<Shard> get_shard(const VcfHeader& header)
+{
+    const VcfHeader::Tag tag {shardTag};
+    if (!header.has(tag)) return boost::none;
+    const auto fields = header.structured_fields(tag);
+    if (fields.size() != 1) return boost::none;
+    const auto& field = fields.front();
+    try {
+        Shard result {};
+        result.index = std::stoul(field.at(VcfHeader::StructuredKey {"ID"}));
+        result.count = std::stoul(field.at(VcfHeader::StructuredKey {"Count"}));
+        const auto begin_itr = field.find(VcfHeader::StructuredKey {"Begin"});
+        if (begin_itr != std::cend(field)) result.begin = parse_boundary(begin_itr->second);
+        const auto end_itr = field.find(VcfHeader::StructuredKey {"End"});
+        if (end_itr != std::cend(field)) result.end = parse_boundary(end_itr->second);
+        return result;
+    } catch (const std::logic_error&) {
+        return boost::none;
+    }
+}
+
+void merge_shards(std::vector<VcfReader>& shards, VcfWriter& dst)
+{
+    std::vector<Shard> shard_infos {};
+    shard_infos.reserve(shards.size());
+    std::vector<VcfHeader> headers {};
+    headers.reserve(shards.size());
+    for (const auto& shard : shards) {
+        headers.push_back(shard.fetch_header());
+        auto shard_info = get_shard(headers.back());
+        if (!shard_info) {
+            throw InconsistentShards {shard.path(), "is not the output of a --shard run"};
+        }
+        if (shard_info->count != shards.size()) {
+            throw InconsistentShards {shard.path(), "is from a run with " + std::to_string(shard_info->count) + " shards"};
+        }
+        if (shard_info->index != shard_infos.size() + 1) {
+            throw InconsistentShards {shard.path(), "is shard " + std::to_string(shard_info->index) + " but was given in position "
+                                                    + std::to_string(shard_infos.size() + 1)};
+        }
+        if (!shard_infos.empty() && (!shard_infos.back().end || !shard_info->begin || !(*shard_infos.back().end == *shard_info->begin))) {
+            throw InconsistentShards {shard.path(), "does not begin where the previous shard ends"};
+        }
+        shard_infos.push_back(std::move(*shard_info));
+    }
+    dst << remove_shard_field(merge(headers));
+    std::vector<boost::optional<Position>> cuts(shards.size() + 1);
+    for (std::size_t i {1}; i < shards.size(); ++i) {
+        cuts[i] = find_cut(shards[i], *shard_infos[i].begin);
+    }
+    for (std::size_t i {0}; i < shards.size(); ++i) {
+        write_shard_calls(shards[i], shard_infos[i], cuts[i], cuts[i + 1], dst);
+    }
+}
+
+} // namespace octopus
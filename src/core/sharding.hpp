@@ -0,0 +1,58 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef sharding_hpp
+#define sharding_hpp
+
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/read/read_manager.hpp"
+#include "io/variant/vcf_header.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_writer.hpp"
+
+namespace octopus {
+
+/*
+ A shard is a contiguous part of the search regions, taken in contig output order. Shard boundaries
+ only depend on the search regions, the contig order, the reference, and the read file indices, so
+ independent runs with the same inputs agree on them. Each shard is called with some overlap either
+ side of its boundaries, and the boundary calls are resolved when the shard outputs are merged.
+ */
+struct ShardBoundary
+{
+    GenomicRegion::ContigName contig;
+    GenomicRegion::Position position;
+};
+
+struct Shard
+{
+    unsigned index, count; // index is one-based
+    boost::optional<ShardBoundary> begin = boost::none, end = boost::none; // none at the ends of the search regions
+};
+
+Shard make_shard(unsigned index, unsigned count,
+                 const InputRegionMap& regions,
+                 const std::vector<GenomicRegion::ContigName>& contigs,
+                 const ReferenceGenome& reference,
+                 const ReadManager& reads);
+
+InputRegionMap get_shard_regions(const Shard& shard,
+                                 const InputRegionMap& regions,
+                                 const std::vector<GenomicRegion::ContigName>& contigs,
+                                 GenomicRegion::Size overlap);
+
+void add_shard_field(const Shard& shard, VcfHeader::Builder& builder);
+boost::optional<Shard> get_shard(const VcfHeader& header);
+
+// Writes the calls of all shards, which must be given in shard order, as if they were called in one run
+void merge_shards(std::vector<VcfReader>& shards, VcfWriter& dst);
+
+} // namespace octopus
+
+#endif
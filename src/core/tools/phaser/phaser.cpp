@@ -8,12 +8,11 @@
 #include <algorithm>
 #include <numeric>
 #include <cstddef>
+#include <cstdint>
 #include <cmath>
 #include <utility>
 #include <iostream>
 
-#include <boost/functional/hash.hpp>
-#include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/adjacency_matrix.hpp>
 #include <boost/graph/graphviz.hpp>
 
@@ -32,6 +31,7 @@
 #include "utils/mappable_algorithms.hpp"
 #include "utils/maths.hpp"
 #include "utils/map_utils.hpp"
+#include "utils/parallel_transform.hpp"
 
 namespace octopus {
 
@@ -40,7 +40,6 @@ Phaser::Phaser(Config config) : config_ {config} {}
 namespace {
 
 using CompressedGenotype = Genotype<IndexedHaplotype<>>;
-using SharedGenotype = Genotype<SharedHaplotype>;
 
 template <typename Range>
 auto minmax_ploidy(const Range& genotypes) noexcept
@@ -127,8 +126,78 @@ auto copy_unique(std::vector<GenomicRegion> regions)
     return regions;
 }
 
+using AlleleIndex = std::uint16_t;
+using AlleleSetIndex = unsigned;
+
+constexpr AlleleSetIndex homozygousAlleleSet {0};
+
 } // namespace
 
+// Genotypes encoded by the index of the allele each haplotype has at each site, so pairwise phase
+// qualities can be computed without copying genotype chunks. Every sample is phased with the same encoding.
+struct Phaser::GenotypeEncoding
+{
+    GenotypeEncoding(const MappableBlock<Haplotype>& haplotypes,
+                     const std::vector<CompressedGenotype>& genotypes,
+                     const std::vector<GenomicRegion>& sites);
+    
+    std::vector<std::vector<AlleleIndex>> haplotype_alleles; // [site][haplotype]
+    std::vector<std::size_t> num_alleles; // [site]
+    std::vector<std::size_t> genotype_offsets; // genotype g has haplotypes [offsets[g], offsets[g + 1])
+    std::vector<std::size_t> genotype_haplotypes;
+    std::vector<std::vector<AlleleSetIndex>> allele_sets; // [site][genotype]
+};
+
+Phaser::GenotypeEncoding::GenotypeEncoding(const MappableBlock<Haplotype>& haplotypes,
+                                           const std::vector<CompressedGenotype>& genotypes,
+                                           const std::vector<GenomicRegion>& sites)
+: haplotype_alleles(sites.size(), std::vector<AlleleIndex>(haplotypes.size(), 0))
+, num_alleles(sites.size())
+, genotype_offsets {}
+, genotype_haplotypes {}
+, allele_sets(sites.size(), std::vector<AlleleSetIndex>(genotypes.size(), homozygousAlleleSet))
+{
+    genotype_offsets.reserve(genotypes.size() + 1);
+    genotype_offsets.push_back(0);
+    std::vector<bool> is_used_haplotype(haplotypes.size(), false);
+    for (const auto& genotype : genotypes) {
+        for (const auto& haplotype : genotype) {
+            genotype_haplotypes.push_back(index_of(haplotype));
+            is_used_haplotype[index_of(haplotype)] = true;
+        }
+        genotype_offsets.push_back(genotype_haplotypes.size());
+    }
+    std::vector<Haplotype::NucleotideSequence> alleles {};
+    std::vector<AlleleIndex> genotype_alleles {};
+    std::map<std::vector<AlleleIndex>, AlleleSetIndex> allele_set_indices {};
+    for (std::size_t site_idx {0}; site_idx < sites.size(); ++site_idx) {
+        alleles.clear();
+        auto& site_haplotype_alleles = haplotype_alleles[site_idx];
+        for (std::size_t haplotype_idx {0}; haplotype_idx < haplotypes.size(); ++haplotype_idx) {
+            if (is_used_haplotype[haplotype_idx]) {
+                auto allele = haplotypes[haplotype_idx].sequence(sites[site_idx]);
+                const auto allele_itr = std::find(std::cbegin(alleles), std::cend(alleles), allele);
+                site_haplotype_alleles[haplotype_idx] = std::distance(std::cbegin(alleles), allele_itr);
+                if (allele_itr == std::cend(alleles)) alleles.push_back(std::move(allele));
+            }
+        }
+        num_alleles[site_idx] = alleles.size();
+        allele_set_indices.clear();
+        for (std::size_t genotype_idx {0}; genotype_idx < genotypes.size(); ++genotype_idx) {
+            genotype_alleles.clear();
+            for (auto haplotype_idx = genotype_offsets[genotype_idx]; haplotype_idx < genotype_offsets[genotype_idx + 1]; ++haplotype_idx) {
+                genotype_alleles.push_back(site_haplotype_alleles[genotype_haplotypes[haplotype_idx]]);
+            }
+            std::sort(std::begin(genotype_alleles), std::end(genotype_alleles));
+            genotype_alleles.erase(std::unique(std::begin(genotype_alleles), std::end(genotype_alleles)), std::end(genotype_alleles));
+            if (genotype_alleles.size() > 1) {
+                const auto allele_set_index = static_cast<AlleleSetIndex>(allele_set_indices.size() + 1);
+                allele_sets[site_idx][genotype_idx] = allele_set_indices.emplace(genotype_alleles, allele_set_index).first->second;
+            }
+        }
+    }
+}
+
 Phaser::PhaseSetMap
 Phaser::phase(const MappableBlock<Haplotype>& haplotypes,
               const GenotypePosteriorMap& genotype_posteriors,
@@ -155,6 +224,8 @@ Phaser::phase(const MappableBlock<Haplotype>& haplotypes,
         }
     } else {
         boost::optional<GenotypePosteriorMap> collapsed_genotype_posteriors {};
+        using UnphasedSample = std::pair<SampleName, SampleGenotypePosteriorMap>;
+        std::vector<UnphasedSample> unphased_samples {};
         for (const auto& p : genotype_posteriors) {
             const SampleName& sample {p.first};
             if (!collapsed_genotype_posteriors && genotype_calls && config_.max_phase_quality
@@ -167,19 +238,34 @@ Phaser::phase(const MappableBlock<Haplotype>& haplotypes,
                     std::tie(min_genotype_ploidy, max_genotype_ploidy) = minmax_ploidy(genotypes);
                     if (genotype_calls) collapse_each(*genotype_calls);
                 }
-                PhaseSetVector phase_sets {};
                 if (collapsed_genotype_posteriors) {
-                    const auto& collapsed_sample_genotype_posteriors = (*collapsed_genotype_posteriors)[sample];
+                    auto collapsed_sample_genotype_posteriors = (*collapsed_genotype_posteriors)[sample];
                     if (genotype_calls && config_.max_phase_quality
                      && min_phase_quality(genotype_calls->at(sample), collapsed_sample_genotype_posteriors) >= *config_.max_phase_quality) {
                         result[sample].push_back({max_phase_set, *config_.max_phase_quality});
                     } else {
-                        phase_sets = phase_sample(unique_variation_sites, genotypes, collapsed_sample_genotype_posteriors);
+                        unphased_samples.emplace_back(sample, std::move(collapsed_sample_genotype_posteriors));
                     }
                 } else {
-                    phase_sets = phase_sample(unique_variation_sites, genotypes, p.second);
+                    unphased_samples.emplace_back(sample, p.second);
                 }
-                result.emplace(sample, std::move(phase_sets));
+            }
+        }
+        if (!unphased_samples.empty()) {
+            const GenotypeEncoding encoded_genotypes {haplotypes, genotypes, unique_variation_sites};
+            const auto phase_sample_helper = [&] (const UnphasedSample& p) {
+                return this->phase_sample(unique_variation_sites, encoded_genotypes, p.second);
+            };
+            std::vector<PhaseSetVector> sample_phase_sets(unphased_samples.size());
+            if (config_.workers && unphased_samples.size() > 1) {
+                octopus::transform(std::cbegin(unphased_samples), std::cend(unphased_samples),
+                                   std::begin(sample_phase_sets), phase_sample_helper, *config_.workers);
+            } else {
+                std::transform(std::cbegin(unphased_samples), std::cend(unphased_samples),
+                               std::begin(sample_phase_sets), phase_sample_helper);
+            }
+            for (std::size_t sample_idx {0}; sample_idx < unphased_samples.size(); ++sample_idx) {
+                result.emplace(unphased_samples[sample_idx].first, std::move(sample_phase_sets[sample_idx]));
             }
         }
     }
@@ -232,156 +318,77 @@ Phaser::phase(const MappableBlock<Haplotype>& haplotypes,
 
 namespace {
 
-using GenotypeChunk = SharedGenotype;
-using GenotypeChunkPosteriorMap = std::unordered_map<GenotypeChunk, double>;
-
-struct GenotypeInfo
+struct GenotypeChunk
 {
-    using AlleleIndex = std::uint8_t;
-    using AlleleIndexSet = std::vector<AlleleIndex>;
-    AlleleIndexSet alleles;
+    AlleleSetIndex lhs_alleles, rhs_alleles;
+    std::size_t first_allele_pair, last_allele_pair;
+    double posterior;
 };
 
-using GenotypeInfoVector = std::vector<GenotypeInfo>;
-using GenotypeInfoMatrix = std::vector<GenotypeInfoVector>;
-
-using AlleleVector = std::vector<Allele>;
-
-GenotypeInfo compute_genotype_info(const Genotype<Allele>& genotype, AlleleVector& alleles)
-{
-    GenotypeInfo::AlleleIndexSet indices(genotype.ploidy());
-    const auto get_allele_index = [&] (const Allele& allele) -> GenotypeInfo::AlleleIndex {
-        const auto allele_itr = std::find(std::cbegin(alleles), std::cend(alleles), allele);
-        if (allele_itr != std::cend(alleles)) {
-            return std::distance(std::cbegin(alleles), allele_itr);
-        }
-        alleles.push_back(allele);
-        return alleles.size() - 1;
-    };
-    std::transform(std::cbegin(genotype), std::cend(genotype), std::begin(indices), get_allele_index);
-    std::sort(std::begin(indices), std::end(indices));
-    indices.erase(std::unique(std::begin(indices), std::end(indices)), std::end(indices));
-    return {std::move(indices)};
-}
-
-GenotypeInfoVector compute_genotype_info(const std::vector<CompressedGenotype>& genotypes, const GenomicRegion& region)
-{
-    GenotypeInfoVector result(genotypes.size());
-    AlleleVector alleles {};
-    alleles.reserve(5);
-    transform_each(std::cbegin(genotypes), std::cend(genotypes),
-                  [&] (const auto& element) { return copy<Allele>(element, region); }, 
-                  [&] (const auto& genotype) { return compute_genotype_info(genotype, alleles); },
-                  std::begin(result));
-    return result;
-}
-
-auto compute_genotype_info(const std::vector<CompressedGenotype>& genotypes, const std::vector<GenomicRegion>& regions)
-{
-    GenotypeInfoMatrix result {};
-    result.reserve(regions.size());
-    for (const auto& region : regions) {
-        result.push_back(compute_genotype_info(genotypes, region));
-    }
-    return result;
-}
-
-bool is_heterozygous(std::size_t genotype_index, const GenotypeInfoVector& info) noexcept
-{
-    return info[genotype_index].alleles.size() > 1;
-}
-
-bool is_very_likely_homozygous(const GenomicRegion& region, 
-                               const Phaser::SampleGenotypePosteriorMap& genotype_posteriors, 
-                               const GenotypeInfoVector& info)
-{
-    assert(!genotype_posteriors.empty());
-    const static auto posterior_less = [] (const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; };
-    const auto map_posterior_itr = std::max_element(std::cbegin(genotype_posteriors), std::cend(genotype_posteriors), posterior_less);
-    const auto map_posterior = map_posterior_itr->second;
-    return map_posterior > 0.9999 && !is_heterozygous(std::distance(std::cbegin(genotype_posteriors), map_posterior_itr), info);
-}
-
-auto copy_each_helper(const std::vector<CompressedGenotype>& genotypes,
-                      const std::vector<GenomicRegion>& sites,
-                      const std::size_t lhs, const std::size_t rhs)
+struct PhaseQualityBuffers
 {
-    if (!are_adjacent(sites[lhs], sites[rhs])) {
-        const std::vector<GenomicRegion> sites_tmp {sites[lhs], sites[rhs]};
-        return copy_each<GenotypeChunk::ElementType>(genotypes, sites_tmp);
-    } else {
-        assert(is_before(sites[lhs], sites[rhs]));
-        const auto site = closed_region(sites[lhs], sites[rhs]);
-        return copy_each<GenotypeChunk::ElementType>(genotypes, site);
-    }
-}
+    std::vector<GenotypeChunk> chunks;
+    std::vector<std::size_t> allele_pairs;
+    std::vector<double> chunk_set_weights, chunk_posteriors;
+    std::vector<std::size_t> chunk_set_offsets;
+};
 
-auto
-compute_chunk_set_posteriors(const std::vector<CompressedGenotype>& genotypes,
-                             const std::vector<GenomicRegion>& sites,
-                             const std::size_t lhs, const std::size_t rhs,
-                             const Phaser::SampleGenotypePosteriorMap& genotype_posteriors,
-                             const GenotypeInfoMatrix& info)
+// The chunks of genotypes with the same allele sets at both sites form a chunk set. The phase
+// quality is the posterior mass of the chunks that are not the MAP chunk of their set.
+auto compute_phase_quality(PhaseQualityBuffers& buffers)
 {
-    auto chunks = copy_each_helper(genotypes, sites, lhs, rhs);
-    using AlleleIndexSetRef = std::reference_wrapper<const GenotypeInfo::AlleleIndexSet>;
-    using AlleleIndexSetRefPair = std::pair<AlleleIndexSetRef, AlleleIndexSetRef>;
-    const static auto allele_index_pair_hasher = [] (const auto& p) {
-        std::size_t result {};
-        boost::hash_combine(result, p.first.get());
-        boost::hash_combine(result, p.second.get());
-        return result;
+    auto& chunks = buffers.chunks;
+    const auto& allele_pairs = buffers.allele_pairs;
+    const auto chunk_allele_pairs_less = [&] (const GenotypeChunk& lhs, const GenotypeChunk& rhs) {
+        return std::lexicographical_compare(std::next(std::cbegin(allele_pairs), lhs.first_allele_pair),
+                                            std::next(std::cbegin(allele_pairs), lhs.last_allele_pair),
+                                            std::next(std::cbegin(allele_pairs), rhs.first_allele_pair),
+                                            std::next(std::cbegin(allele_pairs), rhs.last_allele_pair));
     };
-    const static auto allele_index_pair_equal = [] (const auto& lhs, const auto& rhs) {
-        return lhs.first.get() == rhs.first.get() && lhs.second.get() == rhs.second.get();
+    const auto is_same_chunk_set = [] (const GenotypeChunk& lhs, const GenotypeChunk& rhs) noexcept {
+        return lhs.lhs_alleles == rhs.lhs_alleles && lhs.rhs_alleles == rhs.rhs_alleles;
     };
-    using AlleleIndexSetPairPosteriorMap = std::unordered_map<AlleleIndexSetRefPair, GenotypeChunkPosteriorMap,
-                                                              decltype(allele_index_pair_hasher), decltype(allele_index_pair_equal)>;
-    AlleleIndexSetPairPosteriorMap chunk_set_posteriors {10, allele_index_pair_hasher, allele_index_pair_equal};
-    for (std::size_t g {0}; g < genotypes.size(); ++g) {
-        if (is_heterozygous(g, info[lhs]) && is_heterozygous(g, info[rhs])) {
-            collapse(chunks[g]);
-            const auto index_pair = std::make_pair(std::cref(info[lhs][g].alleles), std::cref(info[rhs][g].alleles));
-            chunk_set_posteriors[index_pair][chunks[g]] += genotype_posteriors[genotypes[g]];
+    std::stable_sort(std::begin(chunks), std::end(chunks), [&] (const GenotypeChunk& lhs, const GenotypeChunk& rhs) {
+        if (lhs.lhs_alleles != rhs.lhs_alleles) return lhs.lhs_alleles < rhs.lhs_alleles;
+        if (lhs.rhs_alleles != rhs.rhs_alleles) return lhs.rhs_alleles < rhs.rhs_alleles;
+        return chunk_allele_pairs_less(lhs, rhs);
+    });
+    auto& set_offsets = buffers.chunk_set_offsets;
+    auto& posteriors = buffers.chunk_posteriors;
+    set_offsets.clear();
+    posteriors.clear();
+    for (std::size_t chunk_idx {0}; chunk_idx < chunks.size(); ++chunk_idx) {
+        const auto& chunk = chunks[chunk_idx];
+        if (chunk_idx == 0 || !is_same_chunk_set(chunks[chunk_idx - 1], chunk)) {
+            set_offsets.push_back(posteriors.size());
+            posteriors.push_back(chunk.posterior);
+        } else if (chunk_allele_pairs_less(chunks[chunk_idx - 1], chunk)) {
+            posteriors.push_back(chunk.posterior);
+        } else {
+            posteriors.back() += chunk.posterior;
         }
     }
-    std::vector<std::vector<double>> result {};
-    result.reserve(chunk_set_posteriors.size());
-    for (const auto& p : chunk_set_posteriors) {
-        result.push_back(extract_values(p.second));
+    set_offsets.push_back(posteriors.size());
+    const auto num_sets = set_offsets.size() - 1;
+    auto& set_weights = buffers.chunk_set_weights;
+    set_weights.resize(num_sets);
+    for (std::size_t set_idx {0}; set_idx < num_sets; ++set_idx) {
+        set_weights[set_idx] = std::accumulate(std::next(std::cbegin(posteriors), set_offsets[set_idx]),
+                                               std::next(std::cbegin(posteriors), set_offsets[set_idx + 1]), 0.0);
     }
-    return result;
-}
-
-auto compute_phase_quality(const std::vector<CompressedGenotype>& genotypes,
-                           const std::vector<GenomicRegion>& sites,
-                           const std::size_t lhs, const std::size_t rhs,
-                           const Phaser::SampleGenotypePosteriorMap& genotype_posteriors,
-                           const GenotypeInfoMatrix& info)
-{
-    if (overlaps(sites[lhs], sites[rhs])
-     || is_very_likely_homozygous(sites[lhs], genotype_posteriors, info[lhs])
-     || is_very_likely_homozygous(sites[rhs], genotype_posteriors, info[rhs])) {
-        return probability_false_to_phred(0.0); // maximum quality
-    }
-    auto chunk_set_posteriors = compute_chunk_set_posteriors(genotypes, sites, lhs, rhs, genotype_posteriors, info);
-    std::vector<double> set_weights(chunk_set_posteriors.size());
-    const static auto sum_probabilities = [] (const auto& probs) {
-         return std::accumulate(std::cbegin(probs), std::cend(probs), 0.0); };
-    std::transform(std::cbegin(chunk_set_posteriors), std::cend(chunk_set_posteriors), 
-                   std::begin(set_weights), sum_probabilities);
     double total_not_map_posterior {0};
     // subnormal numbers can cause divide by zero problems here when ffast-math is used.
     const auto heterozygous_mass = maths::normalise(set_weights);
     if (!maths::is_subnormal(heterozygous_mass) && heterozygous_mass > 0) {
-        for (std::size_t set_idx {0}; set_idx < chunk_set_posteriors.size(); ++set_idx) {
-            auto& posteriors = chunk_set_posteriors[set_idx];
-            if (posteriors.size() > 1 && !maths::is_subnormal(maths::normalise(posteriors))) {
-                for (auto& p : posteriors) p *= set_weights[set_idx];
-                assert(!posteriors.empty());
-                const auto map_posterior_itr = std::max_element(std::cbegin(posteriors), std::cend(posteriors));
-                const auto not_map_posterior = std::accumulate(std::cbegin(posteriors), map_posterior_itr,    
-                                               std::accumulate(std::next(map_posterior_itr), std::cend(posteriors), 0.0));
+        for (std::size_t set_idx {0}; set_idx < num_sets; ++set_idx) {
+            const auto first_posterior = std::next(std::begin(posteriors), set_offsets[set_idx]);
+            const auto last_posterior = std::next(std::begin(posteriors), set_offsets[set_idx + 1]);
+            if (std::distance(first_posterior, last_posterior) > 1
+             && !maths::is_subnormal(maths::normalise(first_posterior, last_posterior))) {
+                std::for_each(first_posterior, last_posterior, [&] (auto& p) { p *= set_weights[set_idx]; });
+                const auto map_posterior_itr = std::max_element(first_posterior, last_posterior);
+                const auto not_map_posterior = std::accumulate(first_posterior, map_posterior_itr,
+                                               std::accumulate(std::next(map_posterior_itr), last_posterior, 0.0));
                 total_not_map_posterior += not_map_posterior;
             }
         }
@@ -468,45 +475,106 @@ void write_phase_graph(const std::vector<GenomicRegion>& sites,
 
 } // namespace
 
-Phaser::PhaseSetVector
-Phaser::phase_sample(const std::vector<GenomicRegion>& sites,
-                     const std::vector<CompressedGenotype>& genotypes,
-                     const SampleGenotypePosteriorMap& genotype_posteriors) const
+PhaseQualityTable
+Phaser::compute_pairwise_phase_qualities(const std::vector<GenomicRegion>& sites,
+                                         const GenotypeEncoding& genotypes,
+                                         const SampleGenotypePosteriorMap& genotype_posteriors) const
 {
-    using std::cbegin; using std::cend;
-    using CompletePhaseGraph = boost::adjacency_list<boost::listS, boost::listS, boost::undirectedS, std::size_t>;
-    using CompletePhaseGraphVertex = boost::graph_traits<CompletePhaseGraph>::vertex_descriptor;
-    const auto genotype_info = compute_genotype_info(genotypes, sites);
-    CompletePhaseGraph phase_graph {};
-    std::vector<CompletePhaseGraphVertex> vertices(sites.size());
-    for (std::size_t idx {0}; idx < sites.size(); ++idx) {
-        vertices[idx] = boost::add_vertex(idx, phase_graph);
+    static const auto max_phase_quality = probability_false_to_phred(0.0);
+    const auto num_sites = sites.size();
+    const auto num_genotypes = genotype_posteriors.size();
+    std::size_t map_genotype_idx {0};
+    for (std::size_t genotype_idx {1}; genotype_idx < num_genotypes; ++genotype_idx) {
+        if (genotype_posteriors.value(genotype_idx) > genotype_posteriors.value(map_genotype_idx)) {
+            map_genotype_idx = genotype_idx;
+        }
     }
-    PhaseQualityTable pairwise_phase_qualities(sites.size(), PhaseQualityTable::value_type(sites.size()));
-    for (std::size_t lhs_region_idx {0}; lhs_region_idx < sites.size() - 1; ++lhs_region_idx) {
-        for (auto rhs_region_idx = lhs_region_idx + 1; rhs_region_idx < sites.size(); ++rhs_region_idx) {
-            const auto phase_quality = compute_phase_quality(genotypes, sites, lhs_region_idx, rhs_region_idx,
-                                                             genotype_posteriors, genotype_info);
-            if (phase_quality >= config_.min_phase_quality) {
-                boost::add_edge(vertices[lhs_region_idx], vertices[rhs_region_idx], phase_graph);
+    const auto is_map_genotype_very_likely = genotype_posteriors.value(map_genotype_idx) > 0.9999;
+    // Genotypes with zero posterior cannot change any phase quality so are excluded
+    std::vector<std::vector<std::size_t>> heterozygous_genotypes(num_sites);
+    std::vector<bool> is_very_likely_homozygous(num_sites);
+    for (std::size_t site_idx {0}; site_idx < num_sites; ++site_idx) {
+        const auto& allele_sets = genotypes.allele_sets[site_idx];
+        for (std::size_t genotype_idx {0}; genotype_idx < num_genotypes; ++genotype_idx) {
+            if (allele_sets[genotype_idx] != homozygousAlleleSet && genotype_posteriors.value(genotype_idx) > 0) {
+                heterozygous_genotypes[site_idx].push_back(genotype_idx);
             }
-            pairwise_phase_qualities[lhs_region_idx][rhs_region_idx] = phase_quality;
-            pairwise_phase_qualities[rhs_region_idx][lhs_region_idx] = phase_quality;
         }
+        is_very_likely_homozygous[site_idx] = is_map_genotype_very_likely && allele_sets[map_genotype_idx] == homozygousAlleleSet;
     }
+    PhaseQualityTable result(num_sites, PhaseQualityTable::value_type(num_sites));
+    PhaseQualityBuffers buffers {};
+    for (std::size_t lhs {0}; lhs < num_sites - 1; ++lhs) {
+        const auto& lhs_alleles = genotypes.haplotype_alleles[lhs];
+        const auto& lhs_heterozygous_genotypes = heterozygous_genotypes[lhs];
+        for (auto rhs = lhs + 1; rhs < num_sites; ++rhs) {
+            auto phase_quality = max_phase_quality;
+            if (!(overlaps(sites[lhs], sites[rhs]) || is_very_likely_homozygous[lhs] || is_very_likely_homozygous[rhs]
+                  || lhs_heterozygous_genotypes.empty() || heterozygous_genotypes[rhs].empty())) {
+                const auto& rhs_alleles = genotypes.haplotype_alleles[rhs];
+                const auto num_rhs_alleles = genotypes.num_alleles[rhs];
+                buffers.chunks.clear();
+                buffers.allele_pairs.clear();
+                auto rhs_genotype_itr = std::cbegin(heterozygous_genotypes[rhs]);
+                const auto last_rhs_genotype_itr = std::cend(heterozygous_genotypes[rhs]);
+                for (const auto genotype_idx : lhs_heterozygous_genotypes) {
+                    rhs_genotype_itr = std::lower_bound(rhs_genotype_itr, last_rhs_genotype_itr, genotype_idx);
+                    if (rhs_genotype_itr == last_rhs_genotype_itr) break;
+                    if (*rhs_genotype_itr != genotype_idx) continue;
+                    const auto first_allele_pair = buffers.allele_pairs.size();
+                    for (auto haplotype_idx = genotypes.genotype_offsets[genotype_idx];
+                         haplotype_idx < genotypes.genotype_offsets[genotype_idx + 1]; ++haplotype_idx) {
+                        const auto haplotype = genotypes.genotype_haplotypes[haplotype_idx];
+                        buffers.allele_pairs.push_back(lhs_alleles[haplotype] * num_rhs_alleles + rhs_alleles[haplotype]);
+                    }
+                    const auto first_pair_itr = std::next(std::begin(buffers.allele_pairs), first_allele_pair);
+                    std::sort(first_pair_itr, std::end(buffers.allele_pairs));
+                    buffers.allele_pairs.erase(std::unique(first_pair_itr, std::end(buffers.allele_pairs)), std::end(buffers.allele_pairs));
+                    buffers.chunks.push_back({genotypes.allele_sets[lhs][genotype_idx], genotypes.allele_sets[rhs][genotype_idx],
+                                              first_allele_pair, buffers.allele_pairs.size(),
+                                              genotype_posteriors.value(genotype_idx)});
+                }
+                if (!buffers.chunks.empty()) {
+                    phase_quality = compute_phase_quality(buffers);
+                }
+            }
+            result[lhs][rhs] = phase_quality;
+            result[rhs][lhs] = phase_quality;
+        }
+    }
+    return result;
+}
+
+Phaser::PhaseSetVector
+Phaser::phase_sample(const std::vector<GenomicRegion>& sites,
+                     const GenotypeEncoding& genotypes,
+                     const SampleGenotypePosteriorMap& genotype_posteriors) const
+{
+    using std::cbegin; using std::cend;
+    const auto pairwise_phase_qualities = compute_pairwise_phase_qualities(sites, genotypes, genotype_posteriors);
 //    std::string phase_graph_dot_filename {"/Users/dcooke/Genomics/octopus/scratch/phase_graph"};
 //    phase_graph_dot_filename += "_" + to_string(contig_region(encompassing_region(sites)));
 //    phase_graph_dot_filename += ".dot";
 //    std::ofstream phase_graph_dot {phase_graph_dot_filename};
 //    debug::write_phase_graph(sites, pairwise_phase_qualities, config_.min_phase_quality, phase_graph_dot);
+    const auto is_phased = [&] (const std::size_t lhs, const std::size_t rhs) {
+        return lhs != rhs && pairwise_phase_qualities[lhs][rhs] >= config_.min_phase_quality;
+    };
+    std::vector<std::size_t> vertex_degrees(sites.size(), 0);
+    for (std::size_t lhs_region_idx {0}; lhs_region_idx < sites.size() - 1; ++lhs_region_idx) {
+        for (auto rhs_region_idx = lhs_region_idx + 1; rhs_region_idx < sites.size(); ++rhs_region_idx) {
+            if (is_phased(lhs_region_idx, rhs_region_idx)) {
+                ++vertex_degrees[lhs_region_idx];
+                ++vertex_degrees[rhs_region_idx];
+            }
+        }
+    }
     std::vector<std::size_t> fully_connected_vertices {}, not_fully_connected_vertices {};
     fully_connected_vertices.reserve(sites.size());
     not_fully_connected_vertices.reserve(sites.size());
     for (std::size_t vertex_idx {0}; vertex_idx < sites.size(); ++vertex_idx) {
-        if (boost::degree(vertices[vertex_idx], phase_graph) == boost::num_vertices(phase_graph) - 1) {
+        if (vertex_degrees[vertex_idx] == sites.size() - 1) {
             fully_connected_vertices.push_back(vertex_idx);
-            boost::clear_vertex(vertices[vertex_idx], phase_graph);
-            boost::remove_vertex(vertices[vertex_idx], phase_graph);
         } else {
             not_fully_connected_vertices.push_back(vertex_idx);
         }
@@ -521,9 +589,9 @@ Phaser::phase_sample(const std::vector<GenomicRegion>& sites,
         singleton_vertices.reserve(not_fully_connected_vertices.size());
         partially_connected_vertices.reserve(not_fully_connected_vertices.size());
         for (const auto vertex_idx : not_fully_connected_vertices) {
-            if (boost::degree(vertices[vertex_idx], phase_graph) == 0) {
+            // Fully connected vertices are connected to every other vertex
+            if (vertex_degrees[vertex_idx] == fully_connected_vertices.size()) {
                 singleton_vertices.push_back(vertex_idx);
-                boost::remove_vertex(vertices[vertex_idx], phase_graph);
             } else {
                 partially_connected_vertices.push_back(vertex_idx);
             }
@@ -539,9 +607,7 @@ Phaser::phase_sample(const std::vector<GenomicRegion>& sites,
             PartialPhaseGraph partial_phase_graph(partially_connected_vertices.size());
             for (std::size_t lhs_idx {0}; lhs_idx < partially_connected_vertices.size() - 1; ++lhs_idx) {
                 for (std::size_t rhs_idx {0}; rhs_idx < partially_connected_vertices.size(); ++rhs_idx) {
-                    const auto lhs_vertex = vertices[partially_connected_vertices[lhs_idx]];
-                    const auto rhs_vertex = vertices[partially_connected_vertices[rhs_idx]];
-                    if (boost::edge(lhs_vertex, rhs_vertex, phase_graph).second) {
+                    if (is_phased(partially_connected_vertices[lhs_idx], partially_connected_vertices[rhs_idx])) {
                         boost::add_edge(lhs_idx, rhs_idx, partial_phase_graph);
                     }
                 }
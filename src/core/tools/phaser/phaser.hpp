@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <utility>
 #include <functional>
+#include <memory>
 #include <cassert>
 
 #include <boost/optional.hpp>
@@ -23,6 +24,7 @@
 #include "core/types/indexed_haplotype.hpp"
 #include "core/types/genotype.hpp"
 #include "utils/mappable_algorithms.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace octopus {
 
@@ -40,6 +42,7 @@ public:
         GenotypeMatchType genotype_match = GenotypeMatchType::exact;
         Phred<double> min_phase_quality = Phred<double> {10};
         boost::optional<Phred<double>> max_phase_quality = Phred<double> {100};
+        std::shared_ptr<ThreadPool> workers = nullptr; // samples are phased on these if given
     };
     
     struct PhaseSet
@@ -70,12 +73,18 @@ public:
 private:
     using CompressedGenotype = Genotype<IndexedHaplotype<>>;
     
+    struct GenotypeEncoding;
+    
     Config config_;
     
     PhaseSetVector
-    phase_sample(const std::vector<GenomicRegion>& partitions,
-                 const std::vector<CompressedGenotype>& genotypes,
+    phase_sample(const std::vector<GenomicRegion>& sites,
+                 const GenotypeEncoding& genotypes,
                  const SampleGenotypePosteriorMap& genotype_posteriors) const;
+    std::vector<std::vector<Phred<double>>>
+    compute_pairwise_phase_qualities(const std::vector<GenomicRegion>& sites,
+                                     const GenotypeEncoding& genotypes,
+                                     const SampleGenotypePosteriorMap& genotype_posteriors) const;
 };
 
 namespace debug {
@@ -19,6 +19,7 @@
 #include "utils/append.hpp"
 #include "utils/sequence_utils.hpp"
 #include "utils/free_memory.hpp"
+#include "utils/base_mismatches.hpp"
 #include "logging/logging.hpp"
 
 #include "utils/maths.hpp"
@@ -285,18 +286,17 @@ double CigarScanner::add_snvs_in_match_range(const GenomicRegion& region, const
                                              std::size_t read_index, const SampleName& origin)
 {
     const NucleotideSequence ref_segment {reference_.get().fetch_sequence(region)};
+    const auto read_segment = read.sequence().data() + read_index;
     double misalignment_penalty {0};
-    for (std::size_t ref_index {0}; ref_index < ref_segment.size(); ++ref_index, ++read_index) {
-        const char ref_base {ref_segment[ref_index]}, read_base {read.sequence()[read_index]};
-        if (ref_base != read_base && ref_base != 'N' && read_base != 'N') {
-            const auto begin_pos = region.begin() + static_cast<GenomicRegion::Position>(ref_index);
-            add_candidate(GenomicRegion {region.contig_name(), begin_pos, begin_pos + 1},
-                          ref_base, read_base, read, read_index, origin);
-            if (options_.misalignment_parameters && read.base_qualities()[read_index] >= options_.misalignment_parameters->snv_threshold) {
-                misalignment_penalty += options_.misalignment_parameters->snv_penalty;
-            }
+    for_each_mismatch(ref_segment.data(), read_segment, ref_segment.size(), [&] (const std::size_t ref_index) {
+        const char ref_base {ref_segment[ref_index]}, read_base {read_segment[ref_index]};
+        const auto begin_pos = region.begin() + static_cast<GenomicRegion::Position>(ref_index);
+        add_candidate(GenomicRegion {region.contig_name(), begin_pos, begin_pos + 1},
+                      ref_base, read_base, read, read_index + ref_index, origin);
+        if (options_.misalignment_parameters && read.base_qualities()[read_index + ref_index] >= options_.misalignment_parameters->snv_threshold) {
+            misalignment_penalty += options_.misalignment_parameters->snv_penalty;
         }
-    }
+    });
     return misalignment_penalty;
 }
 
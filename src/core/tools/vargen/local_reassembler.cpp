@@ -838,7 +838,9 @@ auto extract_variants(const Assembler::NucleotideSequence& ref, const Assembler:
 
 auto align(const Assembler::Variant& v, const Model& model)
 {
-    return align(v.ref, v.alt, model).cigar;
+    // Bubbles shorter than the band are aligned exactly, longer ones in linear memory
+    constexpr unsigned min_band_size {64};
+    return align(v.ref, v.alt, model, min_band_size).cigar;
 }
 
 struct VariantDecompositionConfig
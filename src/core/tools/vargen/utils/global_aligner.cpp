@@ -9,7 +9,11 @@
 #include <algorithm>
 #include <iterator>
 #include <functional>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
 #include <cassert>
+#include <emmintrin.h>
 
 namespace octopus { namespace coretools {
 
@@ -209,6 +213,229 @@ auto score(const DPMatrix& matrix) noexcept
     return std::max({last.match, last.insertion, last.deletion});
 }
 
+struct SSE2BandInstructionSet
+{
+    using ScoreType  = short;
+    using VectorType = __m128i;
+    
+    constexpr static int lanes = 8;
+    constexpr static ScoreType neg_inf = std::numeric_limits<ScoreType>::min();
+    
+    static VectorType _set1(ScoreType x) noexcept { return _mm_set1_epi16(x); }
+    static VectorType _load(const ScoreType* src) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+    static void _store(ScoreType* dest, VectorType x) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), x); }
+    static VectorType _add(VectorType lhs, VectorType rhs) noexcept { return _mm_adds_epi16(lhs, rhs); }
+    static VectorType _max(VectorType lhs, VectorType rhs) noexcept { return _mm_max_epi16(lhs, rhs); }
+    static ScoreType _extract_last(VectorType x) noexcept { return static_cast<ScoreType>(_mm_extract_epi16(x, 7)); }
+    
+    static VectorType _substitute(const ScoreType* query, ScoreType target, VectorType match, VectorType mismatch) noexcept
+    {
+        const auto matches = _mm_cmpeq_epi16(_load(query), _set1(target));
+        return _mm_or_si128(_mm_and_si128(matches, match), _mm_andnot_si128(matches, mismatch));
+    }
+    
+    static ScoreType scale(const int n, const ScoreType gap_extend) noexcept
+    {
+        return static_cast<ScoreType>(std::max(n * gap_extend, static_cast<int>(neg_inf)));
+    }
+    
+    // x[k] = max(x[k], x[k - 1] + gap_extend, ..., carry + (k + 1) * gap_extend) by log-step shifts
+    static VectorType _scan(VectorType x, const ScoreType gap_extend, const ScoreType carry) noexcept
+    {
+        x = _max(x, _add(_mm_or_si128(_mm_slli_si128(x, 2), _mm_set_epi16(0, 0, 0, 0, 0, 0, 0, neg_inf)),
+                         _set1(gap_extend)));
+        x = _max(x, _add(_mm_or_si128(_mm_slli_si128(x, 4), _mm_set_epi16(0, 0, 0, 0, 0, 0, neg_inf, neg_inf)),
+                         _set1(scale(2, gap_extend))));
+        x = _max(x, _add(_mm_or_si128(_mm_slli_si128(x, 8), _mm_set_epi16(0, 0, 0, 0, neg_inf, neg_inf, neg_inf, neg_inf)),
+                         _set1(scale(4, gap_extend))));
+        const auto carries = _mm_set_epi16(scale(8, gap_extend), scale(7, gap_extend), scale(6, gap_extend), scale(5, gap_extend),
+                                           scale(4, gap_extend), scale(3, gap_extend), scale(2, gap_extend), gap_extend);
+        return _max(x, _add(_set1(carry), carries));
+    }
+    
+    static void _store_trace(std::uint8_t* dest, VectorType match, VectorType insertion, VectorType deletion,
+                             VectorType insertion_open, VectorType deletion_open) noexcept
+    {
+        const auto deletion_beats_match   = _mm_cmpgt_epi16(deletion, match);
+        const auto insertion_beats_match  = _mm_cmpgt_epi16(insertion, match);
+        const auto is_match = _mm_xor_si128(_mm_or_si128(deletion_beats_match, insertion_beats_match), _set1(-1));
+        const auto is_deletion = _mm_andnot_si128(_mm_cmpgt_epi16(insertion, deletion), deletion_beats_match);
+        auto flags = _mm_sub_epi16(_mm_add_epi16(_set1(1), is_match), is_deletion);
+        flags = _mm_or_si128(flags, _mm_andnot_si128(_mm_cmpeq_epi16(insertion, insertion_open), _set1(4)));
+        flags = _mm_or_si128(flags, _mm_andnot_si128(_mm_cmpeq_epi16(deletion, deletion_open), _set1(8)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(flags, _mm_setzero_si128()));
+    }
+};
+
+constexpr int SSE2BandInstructionSet::lanes;
+constexpr SSE2BandInstructionSet::ScoreType SSE2BandInstructionSet::neg_inf;
+
+// Used when the scores may not fit in 16 bits
+struct ScalarBandInstructionSet
+{
+    using ScoreType  = int;
+    using VectorType = int;
+    
+    constexpr static int lanes = 1;
+    constexpr static ScoreType neg_inf = std::numeric_limits<ScoreType>::min() / 2;
+    
+    static VectorType _set1(ScoreType x) noexcept { return x; }
+    static VectorType _load(const ScoreType* src) noexcept { return *src; }
+    static void _store(ScoreType* dest, VectorType x) noexcept { *dest = x; }
+    static VectorType _add(VectorType lhs, VectorType rhs) noexcept { return std::max(lhs + rhs, neg_inf); }
+    static VectorType _max(VectorType lhs, VectorType rhs) noexcept { return std::max(lhs, rhs); }
+    static ScoreType _extract_last(VectorType x) noexcept { return x; }
+    
+    static VectorType _substitute(const ScoreType* query, ScoreType target, VectorType match, VectorType mismatch) noexcept
+    {
+        return *query == target ? match : mismatch;
+    }
+    
+    static VectorType _scan(VectorType x, const ScoreType gap_extend, const ScoreType carry) noexcept
+    {
+        return std::max(x, _add(carry, gap_extend));
+    }
+    
+    static void _store_trace(std::uint8_t* dest, VectorType match, VectorType insertion, VectorType deletion,
+                             VectorType insertion_open, VectorType deletion_open) noexcept
+    {
+        std::uint8_t flags;
+        if (match >= deletion) {
+            flags = match >= insertion ? 0 : 1;
+        } else {
+            flags = deletion >= insertion ? 2 : 1;
+        }
+        if (insertion != insertion_open) flags |= 4;
+        if (deletion != deletion_open) flags |= 8;
+        *dest = flags;
+    }
+};
+
+constexpr int ScalarBandInstructionSet::lanes;
+constexpr ScalarBandInstructionSet::ScoreType ScalarBandInstructionSet::neg_inf;
+
+// Traceback flags: the low two bits are the best state of the cell (0 = match, 1 = insertion, 2 = deletion),
+// insertion_extension_flag is set if the insertion state extends an insertion, and deletion_extension_flag
+// if the deletion state extends a deletion.
+enum class BandState : std::uint8_t { match = 0, insertion = 1, deletion = 2 };
+constexpr std::uint8_t best_state_mask {3}, insertion_extension_flag {4}, deletion_extension_flag {8};
+
+auto best_state(const std::uint8_t flags) noexcept
+{
+    return static_cast<BandState>(flags & best_state_mask);
+}
+
+template <typename InstructionSet>
+Alignment banded_align(const std::string& target, const std::string& query, const Model& model, const unsigned min_band_size)
+{
+    using ScoreType = typename InstructionSet::ScoreType;
+    constexpr int lanes {InstructionSet::lanes};
+    constexpr ScoreType neg_inf {InstructionSet::neg_inf};
+    const auto target_size = static_cast<int>(target.size()), query_size = static_cast<int>(query.size());
+    // Cell (i, j) is at offset k = j - i - min_diagonal in row i of the band
+    const int min_diagonal {std::min(0, query_size - target_size) - static_cast<int>(min_band_size)};
+    const int band_size {(std::abs(query_size - target_size) + 2 * static_cast<int>(min_band_size) + lanes) / lanes * lanes};
+    // Rows are padded either side so neighbouring cells outside the band can be loaded
+    const auto row_size = static_cast<std::size_t>(band_size + 2 * lanes);
+    std::vector<ScoreType> prev_match(row_size, neg_inf), prev_insertion(row_size, neg_inf), prev_deletion(row_size, neg_inf), prev_best(row_size, neg_inf);
+    std::vector<ScoreType> curr_match(row_size, neg_inf), curr_insertion(row_size, neg_inf), curr_deletion(row_size, neg_inf), curr_best(row_size, neg_inf);
+    const int query_offset {lanes - min_diagonal};
+    std::vector<ScoreType> query_codes(query_offset + std::max(query_size, target_size + min_diagonal + band_size), -1);
+    for (int j {0}; j < query_size; ++j) {
+        query_codes[query_offset + j] = static_cast<unsigned char>(query[j]);
+    }
+    std::vector<std::uint8_t> traces(static_cast<std::size_t>(target_size + 1) * band_size);
+    for (int k {0}; k < band_size; ++k) {
+        const auto j = min_diagonal + k;
+        if (j == 0) {
+            prev_match[k + 1] = prev_best[k + 1] = 0;
+        } else if (j > 0) {
+            prev_insertion[k + 1] = prev_best[k + 1] = static_cast<ScoreType>(std::max(model.gap_open + (j - 1) * model.gap_extend, static_cast<int>(neg_inf)));
+        }
+    }
+    using IS = InstructionSet;
+    const auto match_score = IS::_set1(model.match), mismatch_score = IS::_set1(model.mismatch);
+    const auto gap_open = IS::_set1(model.gap_open), gap_extend = IS::_set1(model.gap_extend);
+    for (int i {1}; i <= target_size; ++i) {
+        const ScoreType target_code {static_cast<unsigned char>(target[i - 1])};
+        const auto query_row = query_codes.data() + query_offset + i + min_diagonal - 1;
+        for (int k {0}; k < band_size; k += lanes) {
+            const auto match = IS::_add(IS::_load(prev_best.data() + k + 1), IS::_substitute(query_row + k, target_code, match_score, mismatch_score));
+            const auto deletion = IS::_max(IS::_add(IS::_load(prev_deletion.data() + k + 2), gap_extend),
+                                           IS::_add(IS::_load(prev_match.data() + k + 2), gap_open));
+            IS::_store(curr_match.data() + k + 1, match);
+            IS::_store(curr_deletion.data() + k + 1, deletion);
+        }
+        // Cells left of the first query column are outside the matrix
+        for (int k {0}; k < std::min(-(i + min_diagonal), band_size); ++k) {
+            curr_match[k + 1] = curr_deletion[k + 1] = neg_inf;
+        }
+        ScoreType carry {neg_inf};
+        const auto row_traces = traces.data() + static_cast<std::size_t>(i) * band_size;
+        for (int k {0}; k < band_size; k += lanes) {
+            const auto insertion_open = IS::_add(IS::_load(curr_match.data() + k), gap_open);
+            const auto insertion = IS::_scan(insertion_open, model.gap_extend, carry);
+            carry = IS::_extract_last(insertion);
+            const auto match = IS::_load(curr_match.data() + k + 1), deletion = IS::_load(curr_deletion.data() + k + 1);
+            IS::_store(curr_insertion.data() + k + 1, insertion);
+            IS::_store(curr_best.data() + k + 1, IS::_max(IS::_max(match, insertion), deletion));
+            const auto deletion_open = IS::_add(IS::_load(prev_match.data() + k + 2), gap_open);
+            IS::_store_trace(row_traces + k, match, insertion, deletion, insertion_open, deletion_open);
+        }
+        std::swap(prev_match, curr_match);
+        std::swap(prev_insertion, curr_insertion);
+        std::swap(prev_deletion, curr_deletion);
+        std::swap(prev_best, curr_best);
+    }
+    const auto band_offset = [=] (const int i, const int j) { return static_cast<std::size_t>(i) * band_size + (j - i - min_diagonal); };
+    AlignmentString alignment {};
+    int i {target_size}, j {query_size};
+    auto state = best_state(traces[band_offset(i, j)]);
+    while (i > 0 || j > 0) {
+        using Flag = CigarOperation::Flag;
+        if (i == 0) {
+            state = BandState::insertion;
+        } else if (j == 0) {
+            state = BandState::deletion;
+        }
+        assert(0 <= j - i - min_diagonal && j - i - min_diagonal < band_size);
+        const auto flags = traces[band_offset(i, j)];
+        switch (state) {
+            case BandState::match:
+            {
+                alignment.push_front(target[i - 1] == query[j - 1] ? Flag::sequenceMatch : Flag::substitution);
+                --i;
+                --j;
+                state = best_state(traces[band_offset(i, j)]);
+                break;
+            }
+            case BandState::insertion:
+            {
+                alignment.push_front(Flag::insertion);
+                state = (flags & insertion_extension_flag) ? BandState::insertion : BandState::match;
+                --j;
+                break;
+            }
+            case BandState::deletion:
+            {
+                alignment.push_front(Flag::deletion);
+                state = (flags & deletion_extension_flag) ? BandState::deletion : BandState::match;
+                --i;
+                break;
+            }
+        }
+    }
+    return {make_cigar(alignment), prev_best[query_size - target_size - min_diagonal + 1]};
+}
+
+bool can_use_short_scores(const std::string& target, const std::string& query, const Model& model) noexcept
+{
+    // Every reachable cell scores at least as well as the all gap alignment to it
+    const auto max_score_magnitude = static_cast<long>(target.size() + query.size()) * std::max<long>(model.match, -model.gap_extend)
+                                     + 4 * std::max<long>(-model.gap_open, -model.mismatch);
+    return max_score_magnitude < std::numeric_limits<short>::max();
+}
+
 } // namespace
 
 Alignment align(const std::string& target, const std::string& query, Model model)
@@ -228,5 +455,15 @@ Alignment align(const std::string& target, const std::string& query, Model model
     return {extract_alignment(target, query, matrix, model), score(matrix)};
 }
 
+Alignment align(const std::string& target, const std::string& query, Model model, const unsigned min_band_size)
+{
+    if (target.empty() || query.empty()) return align(target, query, model);
+    if (can_use_short_scores(target, query, model)) {
+        return banded_align<SSE2BandInstructionSet>(target, query, model, min_band_size);
+    } else {
+        return banded_align<ScalarBandInstructionSet>(target, query, model, min_band_size);
+    }
+}
+
 } // namespace coretools
 } // namespace octopus
@@ -27,6 +27,12 @@ struct Alignment
 
 Alignment align(const std::string& target, const std::string& query, Model model = Model {});
 
+// Only considers alignments that stay within min_band_size of the diagonals spanned by the sequence
+// length difference, so the result is optimal whenever the optimal alignment stays inside the band.
+// Each row of the band is scored with SIMD instructions and only the traceback flags are kept, so
+// memory use is linear in the target length for a fixed band.
+Alignment align(const std::string& target, const std::string& query, Model model, unsigned min_band_size);
+
 } // namespace coretools
 } // namespace octopus
 
@@ -7,14 +7,12 @@
 #include <algorithm>
 #include <cassert>
 
-#include <boost/iterator/zip_iterator.hpp>
-#include <boost/tuple/tuple.hpp>
-
 #include "basics/cigar_string.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/maths.hpp"
 #include "utils/append.hpp"
 #include "utils/free_memory.hpp"
+#include "utils/base_mismatches.hpp"
 
 namespace octopus { namespace coretools {
 
@@ -67,17 +65,13 @@ bool count_snvs_in_match_range(const NucleotideSequenceIterator first_ref, const
                                const NucleotideSequenceIterator first_base, const BaseQualityVectorIterator first_quality,
                                const AlignedRead::BaseQuality trigger)
 {
-    using boost::make_zip_iterator;
-    using Tuple = boost::tuple<char, char, AlignedRead::BaseQuality>;
-    const auto num_bases = std::distance(first_ref, last_ref);
-    const auto last_base = std::next(first_base, num_bases);
-    const auto last_quality = std::next(first_quality, num_bases);
-    return std::count_if(make_zip_iterator(boost::make_tuple(first_ref, first_base, first_quality)),
-                        make_zip_iterator(boost::make_tuple(last_ref, last_base, last_quality)),
-                        [trigger](const Tuple& t) {
-                            const char ref_base{t.get<0>()}, read_base{t.get<1>()};
-                            return ref_base != read_base && ref_base != 'N' && read_base != 'N' && t.get<2>() >= trigger;
-                        });
+    const auto num_bases = static_cast<std::size_t>(std::distance(first_ref, last_ref));
+    if (num_bases == 0) return false;
+    std::size_t result {0};
+    for_each_mismatch(&*first_ref, &*first_base, num_bases, [&] (const std::size_t offset) {
+        if (first_quality[offset] >= trigger) ++result;
+    });
+    return result;
 }
 
 double ln_probability_read_correctly_aligned(const double misalign_penalty, const AlignedRead& read,
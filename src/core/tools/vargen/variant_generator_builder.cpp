@@ -70,7 +70,12 @@ VariantGenerator VariantGeneratorBuilder::build(const ReferenceGenome& reference
         result.add(std::make_unique<LocalReassembler>(reference, *local_reassembler_));
     }
     for (auto packet : vcf_extractors_) {
-        result.add(std::make_unique<VcfExtractor>(std::make_unique<VcfReader>(packet.file), packet.options));
+        if (has_current_site_index(packet.file)) {
+            auto index = std::make_shared<const VcfSiteIndex>(get_site_index_path(packet.file));
+            result.add(std::make_unique<VcfExtractor>(std::move(index), packet.options));
+        } else {
+            result.add(std::make_unique<VcfExtractor>(std::make_unique<VcfReader>(packet.file), packet.options));
+        }
     }
     if (repeat_scanner_) {
         result.add(std::make_unique<RepeatScanner>(reference, *repeat_scanner_));
@@ -21,11 +21,18 @@ VcfExtractor::VcfExtractor(std::unique_ptr<VcfReader> reader)
 
 VcfExtractor::VcfExtractor(std::unique_ptr<VcfReader> reader, Options options)
 : reader_ {std::move(reader)}
+, index_ {}
 , options_ {options}
 {
     reader_->close();
 }
 
+VcfExtractor::VcfExtractor(std::shared_ptr<const VcfSiteIndex> index, Options options)
+: reader_ {}
+, index_ {std::move(index)}
+, options_ {options}
+{}
+
 std::unique_ptr<VariantGenerator> VcfExtractor::do_clone() const
 {
     return std::make_unique<VcfExtractor>(*this);
@@ -46,48 +53,54 @@ auto make_allele(const Iterator first_base, const Iterator last_base)
     return result;
 }
 
+template <typename Sequence, typename Container>
+void extract_variants(const GenomicRegion::ContigName& contig, const GenomicRegion::Position pos,
+                      const Sequence& ref_allele, const Sequence& alt_allele,
+                      Container& result, const bool split_complex)
+{
+    if (ref_allele.size() != alt_allele.size()) {
+        auto begin = pos;
+        const auto p = std::mismatch(std::cbegin(ref_allele), std::cend(ref_allele),
+                                     std::cbegin(alt_allele), std::cend(alt_allele));
+        if (p.first != std::cend(ref_allele) && alt_allele.size() > ref_allele.size()) {
+            const auto ref_pad_size = std::distance(std::cbegin(ref_allele), p.first);
+            begin += ref_pad_size;
+            const auto remaining_ref_size = ref_allele.size() - ref_pad_size;
+            if (split_complex) {
+                // Split non-reference padded insertions into snv (or mnv) and insertion with empty
+                // reference (e.g. A -> TT makes two variants A -> T and -> T).
+                const auto first_alt_end = std::next(p.second, remaining_ref_size);
+                result.emplace_back(contig, begin - 1,
+                                    make_allele(p.first, std::cend(ref_allele)),
+                                    make_allele(p.second, first_alt_end));
+                begin += remaining_ref_size;
+                result.emplace_back(contig, begin - 1, "",
+                                    make_allele(first_alt_end, std::cend(alt_allele)));
+            } else {
+                // otherwise extract as complete MNV
+                result.emplace_back(contig, begin - 1,
+                                    make_allele(p.first, std::cend(ref_allele)),
+                                    make_allele(p.second, std::cend(alt_allele)));
+            }
+        } else {
+            begin += std::distance(std::cbegin(ref_allele), p.first);
+            result.emplace_back(contig, begin - 1,
+                                make_allele(p.first, std::cend(ref_allele)),
+                                make_allele(p.second, std::cend(alt_allele)));
+        }
+    } else {
+        result.emplace_back(contig, pos - 1,
+                            make_allele(std::cbegin(ref_allele), std::cend(ref_allele)),
+                            make_allele(std::cbegin(alt_allele), std::cend(alt_allele)));
+    }
+}
+
 template <typename Container>
 void extract_variants(const VcfRecord& record, Container& result, const bool split_complex)
 {
     for (const auto& alt_allele : record.alt()) {
         if (is_canonical(alt_allele)) {
-            const auto& ref_allele = record.ref();
-            if (ref_allele.size() != alt_allele.size()) {
-                auto begin = record.pos();
-                const auto p = std::mismatch(std::cbegin(ref_allele), std::cend(ref_allele),
-                                             std::cbegin(alt_allele), std::cend(alt_allele));
-                if (p.first != std::cend(ref_allele) && alt_allele.size() > ref_allele.size()) {
-                    const auto ref_pad_size = std::distance(std::cbegin(ref_allele), p.first);
-                    begin += ref_pad_size;
-                    const auto remaining_ref_size = ref_allele.size() - ref_pad_size;
-                    if (split_complex) {
-                        // Split non-reference padded insertions into snv (or mnv) and insertion with empty
-                        // reference (e.g. A -> TT makes two variants A -> T and -> T).
-                        const auto first_alt_end = std::next(p.second, remaining_ref_size);
-                        result.emplace_back(record.chrom(), begin - 1,
-                                            make_allele(p.first, std::cend(ref_allele)),
-                                            make_allele(p.second, first_alt_end));
-                        begin += remaining_ref_size;
-                        result.emplace_back(record.chrom(), begin - 1, "",
-                                            make_allele(first_alt_end, std::cend(alt_allele)));
-                    } else {
-                        // otherwise extract as complete MNV
-                        result.emplace_back(record.chrom(), begin - 1,
-                                            make_allele(p.first, std::cend(ref_allele)),
-                                            make_allele(p.second, std::cend(alt_allele)));
-                    }
-                } else {
-                    begin += std::distance(std::cbegin(ref_allele), p.first);
-                    result.emplace_back(record.chrom(), begin - 1,
-                                        make_allele(p.first, std::cend(ref_allele)),
-                                        make_allele(p.second, std::cend(alt_allele)));
-                }
-            } else {
-                using utils::capitalise_copy;
-                result.emplace_back(record.chrom(), record.pos() - 1,
-                                    capitalise_copy(record.ref()),
-                                    capitalise_copy(alt_allele));
-            }
+            extract_variants(record.chrom(), record.pos(), record.ref(), alt_allele, result, split_complex);
         }
     }
 }
@@ -96,12 +109,18 @@ void extract_variants(const VcfRecord& record, Container& result, const bool spl
 
 std::vector<Variant> VcfExtractor::do_generate(const RegionSet& regions) const
 {
-    reader_->open();
     std::vector<Variant> result {};
-    for (const auto& region : regions) {
-        utils::append(fetch_variants(region), result);
+    if (index_) {
+        for (const auto& region : regions) {
+            utils::append(fetch_indexed_variants(region), result);
+        }
+    } else {
+        reader_->open();
+        for (const auto& region : regions) {
+            utils::append(fetch_variants(region), result);
+        }
+        reader_->close();
     }
-    reader_->close();
     return result;
 }
 
@@ -110,6 +129,16 @@ std::string VcfExtractor::name() const
     return "VCF extraction";
 }
 
+namespace {
+
+void sort_and_remove_duplicates(std::vector<Variant>& variants)
+{
+    std::sort(std::begin(variants), std::end(variants));
+    variants.erase(std::unique(std::begin(variants), std::end(variants)), std::end(variants));
+}
+
+} // namespace
+
 std::vector<Variant> VcfExtractor::fetch_variants(const GenomicRegion& region) const
 {
   std::deque<Variant> variants {};
@@ -120,8 +149,19 @@ std::vector<Variant> VcfExtractor::fetch_variants(const GenomicRegion& region) c
     }
     std::vector<Variant> result {std::make_move_iterator(std::begin(variants)),
                                  std::make_move_iterator(std::end(variants))};
-    std::sort(std::begin(result), std::end(result));
-    result.erase(std::unique(std::begin(result), std::end(result)), std::end(result));
+    sort_and_remove_duplicates(result);
+    return result;
+}
+
+std::vector<Variant> VcfExtractor::fetch_indexed_variants(const GenomicRegion& region) const
+{
+    std::vector<Variant> result {};
+    for (const auto& site : index_->fetch(region)) {
+        if (is_good(site)) {
+            extract_variants(region.contig_name(), site.pos, site.ref, site.alt, result, options_.split_complex);
+        }
+    }
+    sort_and_remove_duplicates(result);
     return result;
 }
 
@@ -131,5 +171,11 @@ bool VcfExtractor::is_good(const VcfRecord& record) const
     return !options_.min_quality || (record.qual() && *record.qual() >= *options_.min_quality);
 }
 
+bool VcfExtractor::is_good(const VcfSiteIndex::Site& site) const
+{
+    if (!options_.extract_filtered && site.is_filtered) return false;
+    return !options_.min_quality || (site.qual && *site.qual >= *options_.min_quality);
+}
+
 } // namespace coretools
 } // namespace octopus
@@ -11,6 +11,7 @@
 #include <boost/optional.hpp>
 
 #include "io/variant/vcf.hpp"
+#include "io/variant/vcf_site_index.hpp"
 #include "core/types/variant.hpp"
 #include "variant_generator.hpp"
 
@@ -35,6 +36,8 @@ public:
     
     VcfExtractor(std::unique_ptr<VcfReader> reader);
     VcfExtractor(std::unique_ptr<VcfReader> reader, Options options);
+    // Queries are made directly on the memory mapped index, so clones can extract concurrently
+    VcfExtractor(std::shared_ptr<const VcfSiteIndex> index, Options options);
     
     VcfExtractor(const VcfExtractor&)            = default;
     VcfExtractor& operator=(const VcfExtractor&) = default;
@@ -49,10 +52,13 @@ private:
     std::string name() const override;
     
     mutable std::shared_ptr<VcfReader> reader_;
+    std::shared_ptr<const VcfSiteIndex> index_;
     Options options_;
     
     std::vector<Variant> fetch_variants(const GenomicRegion& region) const;
+    std::vector<Variant> fetch_indexed_variants(const GenomicRegion& region) const;
     bool is_good(const VcfRecord& record) const;
+    bool is_good(const VcfSiteIndex::Site& site) const;
 };
 
 } // namespace coretools
@@ -10,6 +10,8 @@
 #include <stdexcept>
 #include <sstream>
 #include <limits>
+#include <array>
+#include <future>
 #include <cassert>
 
 #include <boost/filesystem/operations.hpp>
@@ -25,6 +27,7 @@
 #include "exceptions/malformed_file_error.hpp"
 #include "exceptions/unwritable_file_error.hpp"
 #include "utils/string_utils.hpp"
+#include "logging/logging.hpp"
 #include "annotated_aligned_read.hpp"
 
 #include <iostream>
@@ -177,8 +180,35 @@ bool is_cram(const boost::filesystem::path& file)
 
 } // namespace
 
-HtslibSamFacade::HtslibSamFacade(Path file_path)
+// Decompression gets the extra thread when num_threads is odd, as a single thread is better
+// spent decompressing than converting
+HtslibThreadPool::HtslibThreadPool(const unsigned num_threads)
+: hts_pool_ {hts_tpool_init(static_cast<int>(num_threads - num_threads / 2)), 0}
+, workers_ {num_threads / 2}
+{
+    if (!hts_pool_.pool) {
+        throw std::runtime_error {"HtslibThreadPool: could not create htslib thread pool"};
+    }
+}
+
+HtslibThreadPool::~HtslibThreadPool() noexcept
+{
+    hts_tpool_destroy(hts_pool_.pool);
+}
+
+htsThreadPool* HtslibThreadPool::hts_pool() noexcept
+{
+    return &hts_pool_;
+}
+
+ThreadPool& HtslibThreadPool::workers() noexcept
+{
+    return workers_;
+}
+
+HtslibSamFacade::HtslibSamFacade(Path file_path, std::shared_ptr<HtslibThreadPool> decoding_threads)
 : file_path_ {std::move(file_path)}
+, decoding_threads_ {std::move(decoding_threads)}
 , hts_file_ {open_hts_file(file_path_), HtsFileDeleter {}}
 , hts_header_ {(hts_file_) ? sam_hdr_read(hts_file_.get()) : nullptr, HtsHeaderDeleter {}}
 , hts_index_ {(hts_file_) ? sam_index_load(hts_file_.get(), file_path_.c_str()) : nullptr, HtsIndexDeleter {}}
@@ -186,6 +216,7 @@ HtslibSamFacade::HtslibSamFacade(Path file_path)
 , contig_names_ {}
 , sample_names_ {}
 , samples_ {}
+, has_reported_invalid_records_ {false}
 {
     namespace fs = boost::filesystem;
     if (!hts_file_) {
@@ -216,6 +247,7 @@ HtslibSamFacade::HtslibSamFacade(Path file_path)
         close();
         throw;
     }
+    set_decoding_threads();
     for (const auto& pair : sample_names_) {
         if (std::find(std::cbegin(samples_), std::cend(samples_), pair.second) == std::cend(samples_)) {
             samples_.emplace_back(pair.second);
@@ -273,6 +305,15 @@ void HtslibSamFacade::open()
     if (hts_file_) {
         hts_header_.reset(sam_hdr_read(hts_file_.get()));
         hts_index_.reset(sam_index_load(hts_file_.get(), file_path_.c_str()));
+        set_decoding_threads();
+    }
+}
+
+void HtslibSamFacade::set_decoding_threads()
+{
+    if (decoding_threads_ && hts_file_) {
+        // Failing to attach the pool is not an error, the file is just decompressed on the calling thread
+        hts_set_thread_pool(hts_file_.get(), decoding_threads_->hts_pool());
     }
 }
 
@@ -647,21 +688,13 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const GenomicRegion&
     if (samples_.size() == 1) {
         return {{samples_.front(), fetch_reads(samples_.front(), region)}};
     }
-    HtslibIterator it {*this, region};
     for (const auto& sample : samples_) {
         auto p = result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
         try_reserve(p.first->second, defaultReserve_, defaultReserve_ / 10);
     }
-    while (++it) {
-        try {
-            result.at(sample_names_.at(it.read_group())).emplace_back(*it);
-        } catch (InvalidBamRecord& e) {
-            // TODO: Just ignore? Could log or something.
-            //std::clog << "Warning: " << e.what() << std::endl;
-        } catch (...) {
-            throw;
-        }
-    }
+    fetch_reads(region, [&] (const HtslibIterator& it) {
+        return &result.at(sample_names_.at(it.read_group()));
+    });
     return result;
 }
 
@@ -669,20 +702,11 @@ HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_reads(const SampleName& sa
 {
     if (!contains(samples_, sample)) return {};
     if (samples_.size() == 1) return fetch_all_reads(region);
-    HtslibIterator it {*this, region};
     ReadContainer result {};
     try_reserve(result, defaultReserve_, defaultReserve_ / 10);
-    while (++it) {
-        if (sample_names_.at(it.read_group()) == sample) {
-            try {
-                result.emplace_back(*it);
-            } catch (InvalidBamRecord& e) {
-                // TODO
-            } catch (...) {
-                throw;
-            }
-        }
-    }
+    fetch_reads(region, [&] (const HtslibIterator& it) {
+        return sample_names_.at(it.read_group()) == sample ? &result : nullptr;
+    });
     return result;
 }
 
@@ -693,7 +717,6 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
         return {{samples.front(), fetch_reads(samples.front(), region)}};
     }
     if (is_subset(samples_, samples)) return fetch_reads(region);
-    HtslibIterator it {*this, region};
     SampleReadMap result {samples.size()};
     for (const auto& sample : samples) {
         if (contains(samples_, sample)) {
@@ -704,18 +727,10 @@ HtslibSamFacade::SampleReadMap HtslibSamFacade::fetch_reads(const std::vector<Sa
         }
     }
     if (result.empty()) return result; // no matching samples
-    while (++it) {
-        const auto& sample = sample_names_.at(it.read_group());
-        if (result.count(sample) == 1) {
-            try {
-                result.at(sample_names_.at(it.read_group())).emplace_back(*it);
-            } catch (InvalidBamRecord& e) {
-                // TODO
-            } catch (...) {
-                throw;
-            }
-        }
-    }
+    fetch_reads(region, [&] (const HtslibIterator& it) -> ReadContainer* {
+        const auto sample_itr = result.find(sample_names_.at(it.read_group()));
+        return sample_itr != std::end(result) ? &sample_itr->second : nullptr;
+    });
     return result;
 }
 
@@ -744,6 +759,13 @@ boost::optional<std::vector<GenomicRegion::ContigName>> HtslibSamFacade::mapped_
     return result;
 }
 
+boost::optional<std::size_t> HtslibSamFacade::count_mapped_reads(const GenomicRegion::ContigName& contig) const
+{
+    if (hts_file_->is_cram) return boost::none;
+    if (hts_targets_.count(contig) == 0) return 0;
+    return get_num_mapped_reads(contig);
+}
+
 void HtslibSamFacade::write(const AlignedRead& read)
 {
     if (!hts_file_ || !hts_header_) {
@@ -778,19 +800,98 @@ void HtslibSamFacade::write(const AnnotatedAlignedRead& read)
 
 HtslibSamFacade::ReadContainer HtslibSamFacade::fetch_all_reads(const GenomicRegion& region) const
 {
-    HtslibIterator it {*this, region};
     ReadContainer result {};
     try_reserve(result, defaultReserve_, defaultReserve_ / 10);
-    while (++it) {
-        try {
-            result.emplace_back(*it);
-        } catch (InvalidBamRecord& e) {
-            // TODO
-        } catch (...) {
-            throw;
+    fetch_reads(region, [&] (const HtslibIterator&) { return &result; });
+    return result;
+}
+
+void HtslibSamFacade::fetch_reads(const GenomicRegion& region, const ReadDestinationFinder& find_destination) const
+{
+    // Invalid records are skipped rather than failing the whole fetch, but are reported
+    std::size_t num_invalid_records {0};
+    std::string first_invalid_record {};
+    const auto skip_invalid_record = [&] (std::string what) {
+        if (num_invalid_records++ == 0) first_invalid_record = std::move(what);
+    };
+    HtslibIterator it {*this, region};
+    if (!decoding_threads_ || decoding_threads_->workers().empty()) {
+        while (++it) {
+            try {
+                const auto destination = find_destination(it);
+                if (destination) destination->emplace_back(*it);
+            } catch (const InvalidBamRecord& e) {
+                skip_invalid_record(e.what());
+            }
+        }
+    } else {
+        // Records are copied out of the iterator in batches so they can be converted concurrently
+        auto& workers = decoding_threads_->workers();
+        std::vector<std::unique_ptr<bam1_t, HtsBam1Deleter>> records {};
+        records.reserve(decodingBatchSize_);
+        std::vector<ReadContainer*> destinations(decodingBatchSize_);
+        std::vector<boost::optional<AlignedRead>> reads(decodingBatchSize_);
+        std::vector<std::string> invalid_records(decodingBatchSize_);
+        std::vector<std::future<void>> conversions {};
+        conversions.reserve(workers.size());
+        bool has_next {true};
+        while (has_next) {
+            std::size_t batch_size {0};
+            while (batch_size < decodingBatchSize_) {
+                has_next = ++it;
+                if (!has_next) break;
+                ReadContainer* destination {nullptr};
+                try {
+                    destination = find_destination(it);
+                } catch (const InvalidBamRecord& e) {
+                    skip_invalid_record(e.what());
+                }
+                if (destination) {
+                    if (batch_size == records.size()) {
+                        records.emplace_back(bam_init1(), HtsBam1Deleter {});
+                    }
+                    if (!records[batch_size] || !bam_copy1(records[batch_size].get(), it.record())) {
+                        throw std::runtime_error {"HtslibSamFacade: error copying record from " + file_path_.string()};
+                    }
+                    destinations[batch_size++] = destination;
+                }
+            }
+            if (batch_size == 0) break;
+            // Each worker converts a contiguous chunk so reads are added in file order
+            const auto chunk_size = (batch_size + workers.size() - 1) / workers.size();
+            conversions.clear();
+            for (std::size_t chunk_begin {0}; chunk_begin < batch_size; chunk_begin += chunk_size) {
+                const auto chunk_end = std::min(chunk_begin + chunk_size, batch_size);
+                conversions.push_back(workers.push([&, chunk_begin, chunk_end] () {
+                    for (auto idx = chunk_begin; idx < chunk_end; ++idx) {
+                        try {
+                            reads[idx] = make_read(records[idx].get());
+                        } catch (const InvalidBamRecord& e) {
+                            reads[idx] = boost::none;
+                            invalid_records[idx] = e.what();
+                        }
+                    }
+                }));
+            }
+            for (auto& conversion : conversions) conversion.wait();
+            for (auto& conversion : conversions) conversion.get();
+            for (std::size_t idx {0}; idx < batch_size; ++idx) {
+                if (reads[idx]) {
+                    destinations[idx]->push_back(std::move(*reads[idx]));
+                } else {
+                    skip_invalid_record(std::move(invalid_records[idx]));
+                }
+            }
         }
     }
-    return result;
+    // Only the first fetch with invalid records is reported, as a bad file would otherwise warn on every fetch
+    if (num_invalid_records > 0 && !has_reported_invalid_records_) {
+        logging::WarningLogger log {};
+        stream(log) << "Skipped " << num_invalid_records << " invalid record(s) in " << region
+                    << " of " << file_path_ << ", the first was: " << first_invalid_record
+                    << ". Further invalid records in this file will be skipped without warning";
+        has_reported_invalid_records_ = true;
+    }
 }
 
 bool is_tag_type(const std::string& header_line, const std::string& tag)
@@ -921,20 +1022,32 @@ auto extract_sequence_length(const bam1_t* b) noexcept
     return b->core.l_qseq;
 }
 
-char extract_base(const std::uint8_t* hts_sequence, const std::uint32_t index) noexcept
+using PackedBasePairTable = std::array<std::array<char, 2>, 256>;
+
+// Each packed byte holds two bases (high nibble first), so sequences are decoded a byte at a time
+PackedBasePairTable make_packed_base_pair_table() noexcept
 {
-    static constexpr const char* symbolTable {"=ACMGRSVTWYHKDBN"};
-    return symbolTable[bam_seqi(hts_sequence, index)];
+    constexpr const char* symbolTable {"=ACMGRSVTWYHKDBN"};
+    PackedBasePairTable result {};
+    for (std::size_t packed {0}; packed < result.size(); ++packed) {
+        result[packed] = {{symbolTable[packed >> 4], symbolTable[packed & 0xF]}};
+    }
+    return result;
 }
 
 AlignedRead::NucleotideSequence extract_sequence(const bam1_t* b)
 {
     using NucleotideSequence = AlignedRead::NucleotideSequence;
+    static const auto base_pairs = make_packed_base_pair_table();
     const auto sequence_length  = static_cast<NucleotideSequence::size_type>(extract_sequence_length(b));
     const auto hts_sequence     = bam_get_seq(b);
     NucleotideSequence result(sequence_length, 'N');
-    std::uint32_t i {0};
-    std::generate_n(std::begin(result), sequence_length, [&] () { return extract_base(hts_sequence, i++); });
+    for (NucleotideSequence::size_type i {0}; i + 1 < sequence_length; i += 2) {
+        std::copy_n(base_pairs[hts_sequence[i / 2]].data(), 2, std::next(std::begin(result), i));
+    }
+    if (sequence_length % 2 == 1) {
+        result.back() = base_pairs[hts_sequence[sequence_length / 2]][0];
+    }
     return result;
 }
 
@@ -1032,15 +1145,20 @@ void add_supplementary_alignments(const bam1_t* record, AlignedRead& read)
 }
 
 AlignedRead HtslibSamFacade::HtslibIterator::operator*() const
+{
+    return hts_facade_.make_read(hts_bam1_.get());
+}
+
+AlignedRead HtslibSamFacade::make_read(const bam1_t* record) const
 {
     using std::begin; using std::end; using std::next; using std::move;
-    auto qualities = extract_qualities(hts_bam1_.get());
-    auto cigar = extract_cigar_string(hts_bam1_.get());
-    const auto& info = hts_bam1_->core;
+    auto qualities = extract_qualities(record);
+    auto cigar = extract_cigar_string(record);
+    const auto& info = record->core;
     auto read_begin_tmp = clipped_begin(cigar, info.pos);
-    auto sequence = extract_sequence(hts_bam1_.get());
+    auto sequence = extract_sequence(record);
     if (sequence.size() != qualities.size()) {
-        throw InvalidBamRecord {hts_facade_.file_path_, extract_read_name(hts_bam1_.get()), "corrupt sequence data"};
+        throw InvalidBamRecord {file_path_, extract_read_name(record), "corrupt sequence data"};
     }
     if (read_begin_tmp < 0) {
         // Then the read hangs off the left of the contig, and we must remove bases, base_qualities, and
@@ -1059,50 +1177,55 @@ AlignedRead HtslibSamFacade::HtslibIterator::operator*() const
         read_begin_tmp = 0;
     }
     const auto read_begin = static_cast<AlignedRead::MappingDomain::Position>(read_begin_tmp);
-    const auto& contig_name = hts_facade_.get_contig_name(info.tid);
+    const auto& contig_name = get_contig_name(info.tid);
     AlignedRead result;
     if (has_multiple_segments(info)) {
         result = {
-            extract_read_name(hts_bam1_.get()),
+            extract_read_name(record),
             GenomicRegion {contig_name, read_begin, read_begin + octopus::reference_size<AlignedRead::MappingDomain::Position>(cigar)},
             move(sequence),
             move(qualities),
             move(cigar),
             mapping_quality(info),
             extract_flags(info),
-            read_group(),
-            extract_barcode(hts_bam1_.get()),
-            hts_facade_.get_contig_name(info.mtid),
+            read_group(record),
+            extract_barcode(record),
+            get_contig_name(info.mtid),
             next_segment_position(info),
             template_length(info),
             extract_next_segment_flags(info)
         };
     } else {
         result = {
-            extract_read_name(hts_bam1_.get()),
+            extract_read_name(record),
             GenomicRegion {contig_name, read_begin, read_begin + octopus::reference_size<AlignedRead::MappingDomain::Size>(cigar)},
             move(sequence),
             move(qualities),
             move(cigar),
             mapping_quality(info),
             extract_flags(info),
-            read_group(),
-            extract_barcode(hts_bam1_.get()),
+            read_group(record),
+            extract_barcode(record),
         };
     }
-    add_supplementary_alignments(hts_bam1_.get(), result);
+    add_supplementary_alignments(record, result);
     return result;
 }
 
-HtslibSamFacade::ReadGroupIdType HtslibSamFacade::HtslibIterator::read_group() const
+HtslibSamFacade::ReadGroupIdType HtslibSamFacade::read_group(const bam1_t* record) const
 {
-    const auto ptr = bam_aux_get(hts_bam1_.get(), readGroupTag.c_str());
+    const auto ptr = bam_aux_get(record, readGroupTag.c_str());
     if (ptr == nullptr) {
-        throw InvalidBamRecord {hts_facade_.file_path_, extract_read_name(hts_bam1_.get()), "no read group"};
+        throw InvalidBamRecord {file_path_, extract_read_name(record), "no read group"};
     }
     return HtslibSamFacade::ReadGroupIdType {bam_aux2Z(ptr)};
 }
 
+HtslibSamFacade::ReadGroupIdType HtslibSamFacade::HtslibIterator::read_group() const
+{
+    return hts_facade_.read_group(hts_bam1_.get());
+}
+
 bool HtslibSamFacade::HtslibIterator::is_good() const noexcept
 {
     if (extract_sequence_length(hts_bam1_.get()) == 0) {
@@ -1130,6 +1253,11 @@ std::size_t HtslibSamFacade::HtslibIterator::begin() const noexcept
     return hts_bam1_->core.pos;
 }
 
+const bam1_t* HtslibSamFacade::HtslibIterator::record() const noexcept
+{
+    return hts_bam1_.get();
+}
+
 namespace {
 
 void set_contig(const std::int32_t tid, bam1_t* result) noexcept
@@ -11,14 +11,17 @@
 #include <cstdint>
 #include <memory>
 #include <utility>
+#include <functional>
 
 #include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
 
 #include "htslib/hts.h"
 #include "htslib/sam.h"
+#include "htslib/thread_pool.h"
 
 #include "basics/aligned_read.hpp"
+#include "utils/thread_pool.hpp"
 #include "read_reader_impl.hpp"
 
 namespace octopus {
@@ -29,6 +32,30 @@ class AnnotatedAlignedRead;
 
 namespace io {
 
+// Threads for decompressing and decoding reads that are shared by every open file. The threads
+// are split between htslib decompression and record conversion, so there are num_threads in total.
+class HtslibThreadPool
+{
+public:
+    HtslibThreadPool() = delete;
+    
+    explicit HtslibThreadPool(unsigned num_threads);
+    
+    HtslibThreadPool(const HtslibThreadPool&)            = delete;
+    HtslibThreadPool& operator=(const HtslibThreadPool&) = delete;
+    HtslibThreadPool(HtslibThreadPool&&)                 = delete;
+    HtslibThreadPool& operator=(HtslibThreadPool&&)      = delete;
+    
+    ~HtslibThreadPool() noexcept;
+    
+    htsThreadPool* hts_pool() noexcept;
+    ThreadPool& workers() noexcept;
+    
+private:
+    htsThreadPool hts_pool_;
+    ThreadPool workers_;
+};
+
 class HtslibSamFacade : public IReadReaderImpl
 {
 public:
@@ -47,7 +74,9 @@ public:
     
     HtslibSamFacade() = delete;
     
-    HtslibSamFacade(Path file_path);
+    // If decoding_threads is given, htslib decompresses on its pool, and fetched records
+    // are converted to AlignedReads in batches on its workers, if it has any.
+    HtslibSamFacade(Path file_path, std::shared_ptr<HtslibThreadPool> decoding_threads = nullptr);
     HtslibSamFacade(Path sam_out, Path sam_template);
     
     HtslibSamFacade(const HtslibSamFacade&)            = delete;
@@ -112,6 +141,7 @@ public:
     GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const override;
     std::vector<GenomicRegion::ContigName> reference_contigs() const override;
     boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const override;
+    boost::optional<std::size_t> count_mapped_reads(const GenomicRegion::ContigName& contig) const override;
     
     void write(const AlignedRead& read);
     void write(const AnnotatedAlignedRead& read);
@@ -120,6 +150,7 @@ private:
     using HtsTid = std::int32_t;
     
     static constexpr std::size_t defaultReserve_ {1'000'000};
+    static constexpr std::size_t decodingBatchSize_ {1'024};
     
     struct HtsFileDeleter
     {
@@ -159,6 +190,7 @@ private:
         bool is_good() const noexcept;
         ContigRegion region() const;
         std::size_t begin() const noexcept;
+        const bam1_t* record() const noexcept;
     
     private:
         struct HtsIteratorDeleter
@@ -178,6 +210,9 @@ private:
     
     Path file_path_;
     
+    // Declared before the file so the file is closed before the pool can be destroyed
+    std::shared_ptr<HtslibThreadPool> decoding_threads_;
+    
     std::unique_ptr<htsFile, HtsFileDeleter> hts_file_;
     std::unique_ptr<bam_hdr_t, HtsHeaderDeleter> hts_header_;
     std::unique_ptr<hts_idx_t, HtsIndexDeleter> hts_index_;
@@ -188,11 +223,20 @@ private:
     
     std::vector<SampleName> samples_;
     
+    mutable bool has_reported_invalid_records_;
+    
+    // Returns where a read should be put, or nullptr if it should be skipped
+    using ReadDestinationFinder = std::function<ReadContainer*(const HtslibIterator&)>;
+    
     void init_maps();
+    void set_decoding_threads();
     HtsTid get_htslib_target(const GenomicRegion::ContigName& contig) const;
     const GenomicRegion::ContigName& get_contig_name(HtsTid target) const;
     std::uint64_t get_num_mapped_reads(const GenomicRegion::ContigName& contig) const;
     ReadContainer fetch_all_reads(const GenomicRegion& region) const;
+    void fetch_reads(const GenomicRegion& region, const ReadDestinationFinder& find_destination) const;
+    AlignedRead make_read(const bam1_t* record) const;
+    ReadGroupIdType read_group(const bam1_t* record) const;
     void set_fixed_length_data(const AlignedRead& read, bam1_t* result) const;
     void write(const AlignedRead& read, bam1_t* result) const;
     void write(const AnnotatedAlignedRead& read, bam1_t* result) const;
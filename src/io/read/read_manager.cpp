@@ -8,6 +8,8 @@
 #include <utility>
 #include <deque>
 #include <numeric>
+#include <future>
+#include <thread>
 #include <cassert>
 
 #include <boost/filesystem/operations.hpp>
@@ -15,11 +17,16 @@
 #include "basics/aligned_read.hpp"
 #include "utils/append.hpp"
 #include "utils/coverage_tracker.hpp"
+#include "utils/thread_pool.hpp"
+#include "htslib_sam_facade.hpp"
 
 namespace octopus { namespace io {
 
-ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files)
+ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files, unsigned num_decoding_threads,
+                         boost::optional<Path> manifest, unsigned max_open_threads)
 : max_open_files_ {max_open_files}
+, decoding_threads_ {num_decoding_threads > 0 ? std::make_shared<HtslibThreadPool>(num_decoding_threads) : nullptr}
+, max_open_threads_ {max_open_threads}
 , num_files_ {static_cast<unsigned>(read_file_paths.size())}
 , all_readers_single_sample_ {true}
 , closed_readers_ {
@@ -30,7 +37,7 @@ ReadManager::ReadManager(std::vector<Path> read_file_paths, unsigned max_open_fi
 , possible_regions_in_readers_ {}
 , samples_ {}
 {
-    setup_reader_samples_and_regions();
+    setup_reader_samples_and_regions(std::move(manifest));
     open_initial_files();
     samples_.reserve(reader_paths_containing_sample_.size());
     std::unordered_set<Path, PathHash> found {};
@@ -59,6 +66,8 @@ ReadManager::ReadManager(ReadManager&& other)
     std::lock_guard<std::mutex> lock {other.mutex_};
     using std::move;
     max_open_files_                 = move(other.max_open_files_);
+    decoding_threads_               = move(other.decoding_threads_);
+    max_open_threads_               = move(other.max_open_threads_);
     num_files_                      = move(other.num_files_);
     all_readers_single_sample_      = move(other.all_readers_single_sample_);
     closed_readers_                 = move(other.closed_readers_);
@@ -75,6 +84,8 @@ ReadManager& ReadManager::operator=(ReadManager&& other)
         std::lock(lock_lhs, lock_rhs);
         using std::move;
         max_open_files_                 = move(other.max_open_files_);
+        decoding_threads_               = move(other.decoding_threads_);
+        max_open_threads_               = move(other.max_open_threads_);
         num_files_                      = move(other.num_files_);
         all_readers_single_sample_      = move(other.all_readers_single_sample_);
         closed_readers_                 = move(other.closed_readers_);
@@ -93,6 +104,8 @@ void swap(ReadManager& lhs, ReadManager& rhs) noexcept
     std::lock_guard<std::mutex> lock_lhs {lhs.mutex_, std::adopt_lock}, lock_rhs {rhs.mutex_, std::adopt_lock};
     using std::swap;
     swap(lhs.max_open_files_,                 rhs.max_open_files_);
+    swap(lhs.decoding_threads_,               rhs.decoding_threads_);
+    swap(lhs.max_open_threads_,               rhs.max_open_threads_);
     swap(lhs.num_files_,                      rhs.num_files_);
     swap(lhs.all_readers_single_sample_,             rhs.all_readers_single_sample_);
     swap(lhs.closed_readers_,                 rhs.closed_readers_);
@@ -134,6 +147,13 @@ std::vector<ReadManager::Path> ReadManager::paths() const
     return result;
 }
 
+std::vector<ReadManager::Path> ReadManager::paths(const SampleName& sample) const
+{
+    auto result = reader_paths_containing_sample_.at(sample);
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
 bool ReadManager::all_readers_have_one_sample() const
 {
     return all_readers_single_sample_;
@@ -341,6 +361,23 @@ std::size_t ReadManager::count_reads(const GenomicRegion& region) const
     return count_reads(samples(), region);
 }
 
+boost::optional<std::size_t> ReadManager::count_mapped_reads(const GenomicRegion::ContigName& contig) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    std::size_t result {0};
+    for (const auto& p : open_readers_) {
+        const auto num_mapped_reads = p.second.count_mapped_reads(contig);
+        if (!num_mapped_reads) return boost::none;
+        result += *num_mapped_reads;
+    }
+    for (const auto& reader_path : closed_readers_) {
+        const auto num_mapped_reads = make_reader(reader_path).count_mapped_reads(contig);
+        if (!num_mapped_reads) return boost::none;
+        result += *num_mapped_reads;
+    }
+    return result;
+}
+
 GenomicRegion ReadManager::find_covered_subregion(const SampleName& sample, const GenomicRegion& region,
                                                   const std::size_t max_reads) const
 {
@@ -518,24 +555,76 @@ auto extract_spanning_regions(std::vector<GenomicRegion::ContigName> contigs,
     return result;
 }
 
-} // namespace
-
-void ReadManager::setup_reader_samples_and_regions()
+ReadManifest::FileSummary summarise(const ReadReader& reader)
 {
-    for (const auto& reader_path : closed_readers_) {
-        auto reader = make_reader(reader_path);
-        auto possible_reader_regions = reader.mapped_regions();
-        if (possible_reader_regions) {
-            add_possible_regions_to_reader_map(reader_path, *possible_reader_regions);
+    ReadManifest::FileSummary result {};
+    auto possible_reader_regions = reader.mapped_regions();
+    if (possible_reader_regions) {
+        result.possible_regions = std::move(*possible_reader_regions);
+    } else {
+        auto possible_reader_contigs = reader.mapped_contigs();
+        if (possible_reader_contigs) {
+            result.possible_regions = extract_spanning_regions(*possible_reader_contigs, reader);
         } else {
-            auto possible_reader_contigs = reader.mapped_contigs();
-            if (possible_reader_contigs) {
-                add_possible_regions_to_reader_map(reader_path, extract_spanning_regions(*possible_reader_contigs, reader));
-            } else {
-                add_possible_regions_to_reader_map(reader_path, extract_spanning_regions(reader.reference_contigs(), reader));
-            }
+            result.possible_regions = extract_spanning_regions(reader.reference_contigs(), reader);
+        }
+    }
+    result.samples = reader.extract_samples();
+    return result;
+}
+
+unsigned calculate_num_open_threads(const std::size_t num_files, unsigned max_threads) noexcept
+{
+    if (max_threads == 0) max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    return static_cast<unsigned>(std::min(num_files, static_cast<std::size_t>(max_threads)));
+}
+
+template <typename F>
+auto concurrent_transform(const std::size_t n, const unsigned max_threads, F&& f)
+{
+    std::vector<std::result_of_t<F(std::size_t)>> result {};
+    result.reserve(n);
+    const auto num_threads = calculate_num_open_threads(n, max_threads);
+    if (num_threads > 1) {
+        ThreadPool workers {num_threads};
+        std::vector<std::future<std::result_of_t<F(std::size_t)>>> futures {};
+        futures.reserve(n);
+        for (std::size_t i {0}; i < n; ++i) {
+            futures.push_back(workers.push(f, i));
         }
-        add_reader_to_sample_map(reader_path, reader.extract_samples());
+        for (auto& future : futures) result.push_back(future.get());
+    } else {
+        for (std::size_t i {0}; i < n; ++i) result.push_back(f(i));
+    }
+    return result;
+}
+
+} // namespace
+
+void ReadManager::setup_reader_samples_and_regions(boost::optional<Path> manifest_path)
+{
+    std::vector<Path> reader_paths {std::cbegin(closed_readers_), std::cend(closed_readers_)};
+    std::sort(std::begin(reader_paths), std::end(reader_paths));
+    boost::optional<ReadManifest> manifest {};
+    if (manifest_path) manifest = ReadManifest {std::move(*manifest_path)};
+    std::vector<boost::optional<ReadManifest::FileSummary>> summaries(reader_paths.size());
+    std::vector<std::size_t> unknown_reader_indices {};
+    for (std::size_t i {0}; i < reader_paths.size(); ++i) {
+        if (manifest) summaries[i] = manifest->find(reader_paths[i]);
+        if (!summaries[i]) unknown_reader_indices.push_back(i);
+    }
+    auto probed_summaries = concurrent_transform(unknown_reader_indices.size(), max_open_threads_, [&] (std::size_t i) {
+        return summarise(make_reader(reader_paths[unknown_reader_indices[i]]));
+    });
+    for (std::size_t i {0}; i < unknown_reader_indices.size(); ++i) {
+        const auto reader_index = unknown_reader_indices[i];
+        if (manifest) manifest->update(reader_paths[reader_index], probed_summaries[i]);
+        summaries[reader_index] = std::move(probed_summaries[i]);
+    }
+    if (manifest && !unknown_reader_indices.empty()) manifest->write();
+    for (std::size_t i {0}; i < reader_paths.size(); ++i) {
+        add_possible_regions_to_reader_map(reader_paths[i], summaries[i]->possible_regions);
+        add_reader_to_sample_map(reader_paths[i], summaries[i]->samples);
     }
 }
 
@@ -551,7 +640,14 @@ void ReadManager::open_initial_files()
 
 ReadReader ReadManager::make_reader(const Path& reader_path) const
 {
-    return ReadReader {reader_path};
+    return ReadReader {reader_path, decoding_threads_};
+}
+
+std::vector<ReadReader>
+ReadManager::make_readers(std::vector<Path>::const_iterator first, std::vector<Path>::const_iterator last) const
+{
+    return concurrent_transform(static_cast<std::size_t>(std::distance(first, last)), max_open_threads_,
+                                [=] (std::size_t i) { return make_reader(*std::next(first, i)); });
 }
 
 bool ReadManager::all_readers_are_open() const noexcept
@@ -590,6 +686,16 @@ void ReadManager::open_reader(const Path& reader_path) const
     closed_readers_.erase(reader_path);
 }
 
+void ReadManager::open_new_readers(std::vector<Path>::const_iterator first, std::vector<Path>::const_iterator last) const
+{
+    auto readers = make_readers(first, last);
+    for (auto& reader : readers) {
+        open_readers_.emplace(*first, std::move(reader));
+        closed_readers_.erase(*first);
+        ++first;
+    }
+}
+
 std::vector<ReadManager::Path>::iterator
 ReadManager::open_readers(std::vector<Path>::iterator first, std::vector<Path>::iterator last) const
 {
@@ -597,7 +703,7 @@ ReadManager::open_readers(std::vector<Path>::iterator first, std::vector<Path>::
     auto num_available_spaces = num_reader_spaces();
     auto num_requested_spaces = static_cast<unsigned>(std::distance(first, last));
     if (num_requested_spaces <= num_available_spaces) {
-        std::for_each(first, last, [this] (const Path& path) { open_reader(path); });
+        open_new_readers(first, last);
         return first;
     }
     auto num_readers_to_close = std::min(num_open_readers(), num_requested_spaces - num_available_spaces);
@@ -605,7 +711,7 @@ ReadManager::open_readers(std::vector<Path>::iterator first, std::vector<Path>::
     num_available_spaces += num_readers_to_close;
     // partition range so opened readers come last
     auto first_open = std::next(first, num_requested_spaces - num_available_spaces);
-    std::for_each(first_open, last, [this] (const Path& path) { open_reader(path); });
+    open_new_readers(first_open, last);
     return first_open;
 }
 
@@ -11,8 +11,10 @@
 #include <initializer_list>
 #include <cstddef>
 #include <mutex>
+#include <memory>
 
 #include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
 
 #include "basics/contig_region.hpp"
 #include "basics/genomic_region.hpp"
@@ -20,6 +22,7 @@
 #include "utils/hash_functions.hpp"
 #include "read_reader.hpp"
 #include "read_reader_impl.hpp"
+#include "read_manifest.hpp"
 
 namespace octopus {
 
@@ -40,7 +43,9 @@ public:
     
     ReadManager() = default;
     
-    ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files);
+    // Files are opened on up to max_open_threads threads, or one per core if 0
+    ReadManager(std::vector<Path> read_file_paths, unsigned max_open_files, unsigned num_decoding_threads = 0,
+                boost::optional<Path> manifest = boost::none, unsigned max_open_threads = 1);
     ReadManager(std::initializer_list<Path> read_file_paths);
     
     ReadManager(const ReadManager&)            = delete;
@@ -56,6 +61,7 @@ public:
     bool good() const noexcept;
     unsigned num_files() const noexcept;
     std::vector<Path> paths() const; // Managed files
+    std::vector<Path> paths(const SampleName& sample) const; // Managed files containing the sample
     bool all_readers_have_one_sample() const;
     unsigned num_samples() const noexcept;
     const std::vector<SampleName>& samples() const;
@@ -87,6 +93,9 @@ public:
     std::size_t count_reads(const std::vector<SampleName>& samples, const GenomicRegion& region) const;
     std::size_t count_reads(const GenomicRegion& region) const;
     
+    // Uses only the file indices, so is none if any file does not record mapped read counts
+    boost::optional<std::size_t> count_mapped_reads(const GenomicRegion::ContigName& contig) const;
+    
     GenomicRegion find_covered_subregion(const SampleName& sample, const GenomicRegion& region,
                                          std::size_t max_reads) const;
     GenomicRegion find_covered_subregion(const std::vector<SampleName>& samples, const GenomicRegion& region,
@@ -112,6 +121,8 @@ private:
     using ReaderRegionsMap        = std::unordered_map<Path, ContigMap, PathHash>;
     
     unsigned max_open_files_ = 200;
+    std::shared_ptr<HtslibThreadPool> decoding_threads_; // shared by all readers
+    unsigned max_open_threads_ = 1;
     unsigned num_files_;
     bool all_readers_single_sample_;
     
@@ -124,16 +135,18 @@ private:
     
     mutable std::mutex mutex_;
     
-    void setup_reader_samples_and_regions();
+    void setup_reader_samples_and_regions(boost::optional<Path> manifest);
     void open_initial_files();
     
     ReadReader make_reader(const Path& reader_path) const;
+    std::vector<ReadReader> make_readers(std::vector<Path>::const_iterator first, std::vector<Path>::const_iterator last) const;
     bool all_readers_are_open() const noexcept;
     bool is_open(const Path& reader_path) const noexcept;
     std::vector<Path>::iterator partition_open(std::vector<Path>& reader_paths) const;
     unsigned num_open_readers() const noexcept;
     unsigned num_reader_spaces() const noexcept;
     void open_reader(const Path& reader_path) const;
+    void open_new_readers(std::vector<Path>::const_iterator first, std::vector<Path>::const_iterator last) const;
     std::vector<Path>::iterator open_readers(std::vector<Path>::iterator first,
                                              std::vector<Path>::iterator last) const;
     void open_readers(unsigned n) const;
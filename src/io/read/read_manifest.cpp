@@ -0,0 +1,184 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "read_manifest.hpp"
+
+#include <fstream>
+#include <ostream>
+#include <utility>
+#include <stdexcept>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "utils/string_utils.hpp"
+
+namespace octopus { namespace io {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::string manifest_name {"octopus-read-manifest"};
+const std::string manifest_version {"2"};
+
+boost::optional<ReadManifest::FileState> get_file_state(const fs::path& file)
+{
+    boost::system::error_code error {};
+    const auto size = fs::file_size(file, error);
+    if (error) return boost::none;
+    const auto last_write_time = fs::last_write_time(file, error);
+    if (error) return boost::none;
+    return ReadManifest::FileState {size, last_write_time};
+}
+
+// The same candidates htslib tries, in the same order
+boost::optional<fs::path> find_index(const fs::path& read_file)
+{
+    for (const auto& extension : {".bai", ".csi", ".crai"}) {
+        auto result = read_file;
+        result += extension;
+        if (fs::exists(result)) return result;
+    }
+    for (const auto& extension : {".bai", ".csi", ".crai"}) {
+        auto result = read_file;
+        result.replace_extension(extension);
+        if (fs::exists(result)) return result;
+    }
+    return boost::none;
+}
+
+boost::optional<ReadManifest::FileState> get_index_state(const fs::path& read_file)
+{
+    const auto index = find_index(read_file);
+    if (index) return get_file_state(*index);
+    return boost::none;
+}
+
+bool is_same(const boost::optional<ReadManifest::FileState>& lhs, const boost::optional<ReadManifest::FileState>& rhs) noexcept
+{
+    if (!lhs || !rhs) return !lhs && !rhs;
+    return lhs->size == rhs->size && lhs->last_write_time == rhs->last_write_time;
+}
+
+const std::string missing_field {"-"};
+
+void write_state(const boost::optional<ReadManifest::FileState>& state, std::ostream& os)
+{
+    if (state) {
+        os << '\t' << state->size << '\t' << state->last_write_time;
+    } else {
+        os << '\t' << missing_field << '\t' << missing_field;
+    }
+}
+
+boost::optional<ReadManifest::FileState> parse_state(const std::string& size, const std::string& last_write_time)
+{
+    if (size == missing_field && last_write_time == missing_field) return boost::none;
+    return ReadManifest::FileState {std::stoull(size), static_cast<std::time_t>(std::stoll(last_write_time))};
+}
+
+} // namespace
+
+ReadManifest::ReadManifest(Path file)
+: file_ {std::move(file)}
+, entries_ {}
+{
+    load();
+}
+
+boost::optional<ReadManifest::FileSummary> ReadManifest::find(const Path& read_file) const
+{
+    const auto itr = entries_.find(read_file);
+    if (itr == std::cend(entries_)) return boost::none;
+    if (!is_same(get_file_state(read_file), itr->second.file_state)
+        || !is_same(get_index_state(read_file), itr->second.index_state)) {
+        return boost::none;
+    }
+    return itr->second.summary;
+}
+
+void ReadManifest::update(const Path& read_file, FileSummary summary)
+{
+    const auto state = get_file_state(read_file);
+    if (state) {
+        entries_[read_file] = Entry {*state, get_index_state(read_file), std::move(summary)};
+    } else {
+        entries_.erase(read_file);
+    }
+}
+
+bool ReadManifest::write() const
+{
+    if (file_.empty()) return false;
+    // Write to a uniquely named temporary file first so that concurrent or interrupted runs never see a partial manifest
+    const auto tmp_file = file_.parent_path() / fs::unique_path(file_.filename().string() + "-%%%%-%%%%-%%%%.tmp");
+    {
+        std::ofstream manifest {tmp_file.string()};
+        manifest << manifest_name << '\t' << manifest_version << '\n';
+        for (const auto& p : entries_) {
+            manifest << "file\t" << p.first.string();
+            write_state(p.second.file_state, manifest);
+            write_state(p.second.index_state, manifest);
+            manifest << '\n';
+            manifest << "samples";
+            for (const auto& sample : p.second.summary.samples) manifest << '\t' << sample;
+            manifest << '\n' << "regions";
+            for (const auto& region : p.second.summary.possible_regions) {
+                manifest << '\t' << region.contig_name() << '\t' << region.begin() << '\t' << region.end();
+            }
+            manifest << '\n';
+        }
+        manifest.close();
+        if (!manifest) {
+            boost::system::error_code error {};
+            fs::remove(tmp_file, error);
+            return false;
+        }
+    }
+    boost::system::error_code error {};
+    fs::rename(tmp_file, file_, error);
+    if (error) fs::remove(tmp_file, error);
+    return !error;
+}
+
+// private methods
+
+void ReadManifest::load()
+{
+    std::ifstream manifest {file_.string()};
+    if (!manifest) return;
+    std::string line {};
+    std::getline(manifest, line);
+    if (line != manifest_name + '\t' + manifest_version) return;
+    std::string samples_line {}, regions_line {};
+    try {
+        while (std::getline(manifest, line) && std::getline(manifest, samples_line) && std::getline(manifest, regions_line)) {
+            const auto file_fields = utils::split(line, '\t');
+            auto sample_fields = utils::split(samples_line, '\t');
+            const auto region_fields = utils::split(regions_line, '\t');
+            if (file_fields.size() != 6 || file_fields[0] != "file"
+                || sample_fields.empty() || sample_fields[0] != "samples"
+                || region_fields.empty() || region_fields[0] != "regions" || region_fields.size() % 3 != 1) {
+                throw std::invalid_argument {"bad manifest entry"};
+            }
+            const auto file_state = parse_state(file_fields[2], file_fields[3]);
+            if (!file_state) throw std::invalid_argument {"bad manifest entry"};
+            Entry entry {*file_state, parse_state(file_fields[4], file_fields[5]), {}};
+            entry.summary.samples.assign(std::make_move_iterator(std::next(std::begin(sample_fields))),
+                                         std::make_move_iterator(std::end(sample_fields)));
+            entry.summary.possible_regions.reserve(region_fields.size() / 3);
+            for (std::size_t i {1}; i < region_fields.size(); i += 3) {
+                entry.summary.possible_regions.emplace_back(region_fields[i],
+                                                            static_cast<GenomicRegion::Position>(std::stoul(region_fields[i + 1])),
+                                                            static_cast<GenomicRegion::Position>(std::stoul(region_fields[i + 2])));
+            }
+            entries_.emplace(file_fields[1], std::move(entry));
+        }
+    } catch (const std::logic_error&) {
+        // The manifest is only a cache, so anything unreadable is just rebuilt
+        entries_.clear();
+    }
+}
+
+} // namespace io
+} // namespace octopus
@@ -0,0 +1,78 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef read_manifest_hpp
+#define read_manifest_hpp
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <ctime>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "utils/hash_functions.hpp"
+
+namespace octopus { namespace io {
+
+/*
+ On-disk cache of the header information ReadManager needs from each read file, so that
+ large cohorts do not need every file opened on startup. Entries are keyed by the size and
+ modification time of the file and its index, and are ignored if any of these has changed.
+ */
+class ReadManifest
+{
+public:
+    using Path       = boost::filesystem::path;
+    using SampleName = std::string;
+
+    struct FileState
+    {
+        std::uintmax_t size;
+        std::time_t last_write_time;
+    };
+    
+    struct FileSummary
+    {
+        std::vector<SampleName> samples;
+        std::vector<GenomicRegion> possible_regions;
+    };
+
+    ReadManifest() = default;
+
+    ReadManifest(Path file);
+
+    ReadManifest(const ReadManifest&)            = default;
+    ReadManifest& operator=(const ReadManifest&) = default;
+    ReadManifest(ReadManifest&&)                 = default;
+    ReadManifest& operator=(ReadManifest&&)      = default;
+
+    ~ReadManifest() = default;
+
+    boost::optional<FileSummary> find(const Path& read_file) const;
+    void update(const Path& read_file, FileSummary summary);
+
+    // Returns false if the manifest could not be written, which is not an error as it is just a cache
+    bool write() const;
+
+private:
+    struct Entry
+    {
+        FileState file_state;
+        boost::optional<FileState> index_state;
+        FileSummary summary;
+    };
+
+    Path file_;
+    std::unordered_map<Path, Entry, utils::FilepathHash> entries_;
+
+    void load();
+};
+
+} // namespace io
+} // namespace octopus
+
+#endif
@@ -67,19 +67,19 @@ bool is_valid_read_file_type(const boost::filesystem::path& file_path)
     return includes(validReadFileExtensions, get_extension(file_path));
 }
 
-auto make_reader(const boost::filesystem::path& file_path)
+auto make_reader(const boost::filesystem::path& file_path, std::shared_ptr<HtslibThreadPool> decoding_threads)
 {
     if (!is_valid_read_file_type(file_path)) {
         throw UnknownReadFileFormat {file_path};
     }
-    return std::make_unique<HtslibSamFacade>(file_path);
+    return std::make_unique<HtslibSamFacade>(file_path, std::move(decoding_threads));
 }
 
 } //namespace
 
-ReadReader::ReadReader(const boost::filesystem::path& file_path)
+ReadReader::ReadReader(const boost::filesystem::path& file_path, std::shared_ptr<HtslibThreadPool> decoding_threads)
 : file_path_ {file_path}
-, impl_ {make_reader(file_path_)}
+, impl_ {make_reader(file_path_, std::move(decoding_threads))}
 {}
 
 ReadReader::ReadReader(ReadReader&& other)
@@ -158,6 +158,12 @@ boost::optional<std::vector<GenomicRegion>> ReadReader::mapped_regions() const
     return impl_->mapped_regions();
 }
 
+boost::optional<std::size_t> ReadReader::count_mapped_reads(const GenomicRegion::ContigName& contig) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return impl_->count_mapped_reads(contig);
+}
+
 bool ReadReader::iterate(const GenomicRegion& region,
                          AlignedReadReadVisitor visitor) const
 {
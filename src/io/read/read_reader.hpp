@@ -24,6 +24,8 @@ class AlignedRead;
 
 namespace io {
 
+class HtslibThreadPool;
+
 /*
  ReadReader is a simple RAII threadsafe wrapper around a IReadReaderImpl
  */
@@ -41,7 +43,7 @@ public:
     
     ReadReader() = default;
     
-    ReadReader(const Path& file_path);
+    ReadReader(const Path& file_path, std::shared_ptr<HtslibThreadPool> decoding_threads = nullptr);
     
     ReadReader(const ReadReader&)            = delete;
     ReadReader& operator=(const ReadReader&) = delete;
@@ -66,6 +68,7 @@ public:
     GenomicRegion::Size reference_size(const GenomicRegion::ContigName& contig) const;
     boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const;
     boost::optional<std::vector<GenomicRegion>> mapped_regions() const;
+    boost::optional<std::size_t> count_mapped_reads(const GenomicRegion::ContigName& contig) const;
     
     bool iterate(const GenomicRegion& region,
                  AlignedReadReadVisitor visitor) const;
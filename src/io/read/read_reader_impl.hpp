@@ -87,6 +87,8 @@ public:
     
     virtual boost::optional<std::vector<GenomicRegion::ContigName>> mapped_contigs() const { return boost::none; };
     virtual boost::optional<std::vector<GenomicRegion>> mapped_regions() const { return boost::none; };
+    // The number of reads mapped to the contig according to the file index, if known
+    virtual boost::optional<std::size_t> count_mapped_reads(const GenomicRegion::ContigName& contig) const { return boost::none; };
 };
 
 } // namespace io
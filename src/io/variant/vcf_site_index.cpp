@@ -0,0 +1,295 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "vcf_site_index.hpp"
+
+#include <array>
+#include <deque>
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstring>
+#include <cmath>
+#include <utility>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_spec.hpp"
+#include "exceptions/malformed_file_error.hpp"
+#include "exceptions/unwritable_file_error.hpp"
+
+namespace octopus {
+
+// The index is written in host byte order:
+//
+// magic[8] version:u32 num_contigs:u32
+// num_contigs * (name_size:u32 name[name_size] first_site:u64 num_sites:u64 max_ref_size:u32)
+// num_sites:u64 num_allele_bases:u64 padding to 8 bytes
+// num_sites * SiteEntry
+// alleles[num_allele_bases]
+struct VcfSiteIndex::SiteEntry
+{
+    std::uint32_t pos, alleles; // ref bases followed by alt bases
+    std::uint16_t ref_size, alt_size;
+    QualityType qual; // NaN if missing
+};
+
+namespace {
+
+constexpr std::array<char, 8> magic {{'O', 'C', 'T', 'S', 'I', 'T', 'E', 'S'}};
+constexpr std::uint32_t version {1};
+constexpr std::uint16_t filtered_bit {1u << 15};
+constexpr std::uint16_t max_allele_size {filtered_bit - 1};
+
+class MalformedSiteIndex : public MalformedFileError
+{
+    std::string do_where() const override
+    {
+        return "VcfSiteIndex";
+    }
+public:
+    MalformedSiteIndex(VcfSiteIndex::Path file) : MalformedFileError {std::move(file), "octopus site index"} {}
+};
+
+class UnsortedSiteIndexSource : public MalformedFileError
+{
+    std::string do_where() const override
+    {
+        return "make_site_index";
+    }
+public:
+    UnsortedSiteIndexSource(VcfSiteIndex::Path file) : MalformedFileError {std::move(file), "vcf"}
+    {
+        set_reason("records are not grouped by contig, which is required to make a site index");
+    }
+};
+
+class UnwritableSiteIndex : public UnwritableFileError
+{
+    std::string do_where() const override
+    {
+        return "make_site_index";
+    }
+public:
+    UnwritableSiteIndex(VcfSiteIndex::Path file) : UnwritableFileError {std::move(file), "site index"} {}
+};
+
+class SiteIndexCursor
+{
+public:
+    SiteIndexCursor(const boost::iostreams::mapped_file_source& file, const VcfSiteIndex::Path& path)
+    : first_ {file.data()}, curr_ {file.data()}, last_ {file.data() + file.size()}, path_ {path}
+    {}
+
+    template <typename T>
+    T read()
+    {
+        T result;
+        std::memcpy(&result, advance(sizeof(T)), sizeof(T));
+        return result;
+    }
+
+    const char* advance(const std::size_t n)
+    {
+        if (static_cast<std::size_t>(last_ - curr_) < n) {
+            MalformedSiteIndex error {path_};
+            error.set_reason("the file is truncated");
+            throw error;
+        }
+        const auto result = curr_;
+        curr_ += n;
+        return result;
+    }
+
+    void align(const std::size_t alignment)
+    {
+        advance((alignment - (curr_ - first_) % alignment) % alignment);
+    }
+
+private:
+    const char* first_, *curr_, *last_;
+    const VcfSiteIndex::Path& path_;
+};
+
+} // namespace
+
+VcfSiteIndex::VcfSiteIndex(Path index_path)
+: path_ {std::move(index_path)}
+, file_ {path_.string()}
+, contigs_ {}
+, sites_ {nullptr}
+, num_sites_ {0}
+, alleles_ {nullptr}
+{
+    SiteIndexCursor cursor {file_, path_};
+    if (!std::equal(std::cbegin(magic), std::cend(magic), cursor.advance(magic.size()))
+        || cursor.read<std::uint32_t>() != version) {
+        MalformedSiteIndex error {path_};
+        error.set_reason("the file is not an octopus site index, or was made by an incompatible version");
+        throw error;
+    }
+    const auto num_contigs = cursor.read<std::uint32_t>();
+    contigs_.reserve(num_contigs);
+    for (std::uint32_t i {0}; i < num_contigs; ++i) {
+        const auto name_size = cursor.read<std::uint32_t>();
+        const auto name = cursor.advance(name_size);
+        ContigEntry contig {};
+        contig.first_site = cursor.read<std::uint64_t>();
+        contig.num_sites = cursor.read<std::uint64_t>();
+        contig.max_ref_size = cursor.read<std::uint32_t>();
+        contigs_.emplace(GenomicRegion::ContigName {name, name_size}, contig);
+    }
+    num_sites_ = cursor.read<std::uint64_t>();
+    const auto num_allele_bases = cursor.read<std::uint64_t>();
+    cursor.align(alignof(SiteEntry));
+    sites_ = reinterpret_cast<const SiteEntry*>(cursor.advance(num_sites_ * sizeof(SiteEntry)));
+    alleles_ = cursor.advance(num_allele_bases);
+}
+
+const VcfSiteIndex::Path& VcfSiteIndex::path() const noexcept
+{
+    return path_;
+}
+
+std::size_t VcfSiteIndex::count_sites() const noexcept
+{
+    return num_sites_;
+}
+
+std::vector<VcfSiteIndex::Site> VcfSiteIndex::fetch(const GenomicRegion& region) const
+{
+    std::vector<Site> result {};
+    const auto contig_itr = contigs_.find(region.contig_name());
+    if (contig_itr == std::cend(contigs_)) return result;
+    const auto& contig = contig_itr->second;
+    const auto first_site = sites_ + contig.first_site, last_site = first_site + contig.num_sites;
+    // Records are sorted by position, so any record overlapping the region begins no more than
+    // max_ref_size positions before it
+    const auto min_begin = region.begin() > contig.max_ref_size ? region.begin() - contig.max_ref_size : Position {0};
+    auto site_itr = std::lower_bound(first_site, last_site, min_begin,
+                                     [] (const SiteEntry& site, const Position begin) { return site.pos - 1 < begin; });
+    for (; site_itr != last_site && site_itr->pos - 1 < region.end(); ++site_itr) {
+        const auto& site = *site_itr;
+        const Position site_end {site.pos - 1u + site.ref_size};
+        if (site_end > region.begin()) {
+            const auto ref = alleles_ + site.alleles;
+            const auto alt_size = site.alt_size & max_allele_size;
+            boost::optional<QualityType> qual {};
+            if (!std::isnan(site.qual)) qual = site.qual;
+            result.push_back({site.pos, {ref, site.ref_size}, {ref + site.ref_size, alt_size}, qual,
+                              (site.alt_size & filtered_bit) != 0});
+        }
+    }
+    return result;
+}
+
+boost::filesystem::path get_site_index_path(const boost::filesystem::path& vcf_path)
+{
+    auto result = vcf_path;
+    result += ".sites";
+    return result;
+}
+
+bool has_current_site_index(const boost::filesystem::path& vcf_path)
+{
+    namespace fs = boost::filesystem;
+    const auto index_path = get_site_index_path(vcf_path);
+    boost::system::error_code error {};
+    if (!fs::exists(index_path, error) || error) return false;
+    const auto index_time = fs::last_write_time(index_path, error);
+    if (error) return false;
+    const auto vcf_time = fs::last_write_time(vcf_path, error);
+    return !error && index_time >= vcf_time;
+}
+
+namespace {
+
+bool is_indexable(const VcfRecord::NucleotideSequence& allele)
+{
+    return allele != vcfspec::missingValue && allele != vcfspec::deleteMaskAllele && allele.size() <= max_allele_size;
+}
+
+template <typename T>
+void write(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+void make_site_index(const VcfReader& vcf, const boost::filesystem::path& index_path)
+{
+    using SiteEntry = VcfSiteIndex::SiteEntry;
+    struct ContigSites
+    {
+        GenomicRegion::ContigName name;
+        std::vector<SiteEntry> sites;
+        std::uint32_t max_ref_size;
+    };
+    std::deque<ContigSites> contigs {};
+    std::string alleles {};
+    for (auto p = vcf.iterate(VcfReader::UnpackPolicy::sites); p.first != p.second; ++p.first) {
+        const VcfRecord& record {*p.first};
+        const auto& ref = record.ref();
+        if (ref.size() > max_allele_size) continue;
+        if (contigs.empty() || contigs.back().name != record.chrom()) {
+            const auto itr = std::find_if(std::cbegin(contigs), std::cend(contigs),
+                                          [&] (const ContigSites& contig) { return contig.name == record.chrom(); });
+            if (itr != std::cend(contigs)) {
+                throw UnsortedSiteIndexSource {vcf.path()};
+            }
+            contigs.push_back({record.chrom(), {}, 0});
+        }
+        auto& contig = contigs.back();
+        const auto qual = record.qual();
+        const auto filtered = is_filtered(record);
+        for (const auto& alt : record.alt()) {
+            if (!is_indexable(alt)) continue;
+            if (alleles.size() + ref.size() + alt.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error {"make_site_index: too many allele bases to index"};
+            }
+            SiteEntry site {};
+            site.pos = static_cast<std::uint32_t>(record.pos());
+            site.alleles = static_cast<std::uint32_t>(alleles.size());
+            site.ref_size = static_cast<std::uint16_t>(ref.size());
+            site.alt_size = static_cast<std::uint16_t>(alt.size() | (filtered ? filtered_bit : 0u));
+            site.qual = qual ? *qual : std::numeric_limits<VcfSiteIndex::QualityType>::quiet_NaN();
+            alleles += ref;
+            alleles += alt;
+            contig.sites.push_back(site);
+            contig.max_ref_size = std::max(contig.max_ref_size, static_cast<std::uint32_t>(ref.size()));
+        }
+    }
+    std::ofstream out {index_path.string(), std::ios::binary};
+    if (!out) throw UnwritableSiteIndex {index_path};
+    out.write(magic.data(), magic.size());
+    write(out, version);
+    write(out, static_cast<std::uint32_t>(contigs.size()));
+    std::uint64_t num_sites {0};
+    std::size_t header_size {magic.size() + 2 * sizeof(std::uint32_t)};
+    for (auto& contig : contigs) {
+        std::stable_sort(std::begin(contig.sites), std::end(contig.sites),
+                         [] (const SiteEntry& lhs, const SiteEntry& rhs) { return lhs.pos < rhs.pos; });
+        write(out, static_cast<std::uint32_t>(contig.name.size()));
+        out.write(contig.name.data(), contig.name.size());
+        write(out, num_sites);
+        write(out, static_cast<std::uint64_t>(contig.sites.size()));
+        write(out, contig.max_ref_size);
+        header_size += 2 * sizeof(std::uint32_t) + contig.name.size() + 2 * sizeof(std::uint64_t);
+        num_sites += contig.sites.size();
+    }
+    write(out, num_sites);
+    write(out, static_cast<std::uint64_t>(alleles.size()));
+    header_size += 2 * sizeof(std::uint64_t);
+    const std::array<char, alignof(SiteEntry)> padding {};
+    out.write(padding.data(), (alignof(SiteEntry) - header_size % alignof(SiteEntry)) % alignof(SiteEntry));
+    for (const auto& contig : contigs) {
+        out.write(reinterpret_cast<const char*>(contig.sites.data()), contig.sites.size() * sizeof(SiteEntry));
+    }
+    out.write(alleles.data(), alleles.size());
+    if (!out) throw UnwritableSiteIndex {index_path};
+}
+
+} // namespace octopus
@@ -0,0 +1,90 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef vcf_site_index_hpp
+#define vcf_site_index_hpp
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "vcf_record.hpp"
+
+namespace octopus {
+
+class VcfReader;
+
+/*
+ A compact binary index of the sites (position, REF, ALT, QUAL, FILTER) in a VCF file. Each ALT allele
+ is stored as a fixed size entry in a position sorted array, and the file is memory mapped, so region
+ queries are just binary searches that can be made concurrently without any locking.
+ */
+class VcfSiteIndex
+{
+public:
+    using Path        = boost::filesystem::path;
+    using Position    = GenomicRegion::Position;
+    using QualityType = VcfRecord::QualityType;
+
+    struct Site
+    {
+        Position pos; // One based, as VcfRecord::pos
+        boost::string_ref ref, alt;
+        boost::optional<QualityType> qual;
+        bool is_filtered;
+    };
+
+    VcfSiteIndex() = delete;
+
+    VcfSiteIndex(Path index_path);
+
+    VcfSiteIndex(const VcfSiteIndex&)            = delete;
+    VcfSiteIndex& operator=(const VcfSiteIndex&) = delete;
+    VcfSiteIndex(VcfSiteIndex&&)                 = default;
+    VcfSiteIndex& operator=(VcfSiteIndex&&)      = default;
+
+    ~VcfSiteIndex() = default;
+
+    const Path& path() const noexcept;
+
+    std::size_t count_sites() const noexcept;
+
+    // Sites of records overlapping the region, in position order
+    std::vector<Site> fetch(const GenomicRegion& region) const;
+
+private:
+    friend void make_site_index(const VcfReader& vcf, const boost::filesystem::path& index_path);
+
+    struct SiteEntry;
+    struct ContigEntry
+    {
+        std::uint64_t first_site, num_sites;
+        std::uint32_t max_ref_size;
+    };
+
+    Path path_;
+    boost::iostreams::mapped_file_source file_;
+    std::unordered_map<GenomicRegion::ContigName, ContigEntry> contigs_;
+    const SiteEntry* sites_;
+    std::uint64_t num_sites_;
+    const char* alleles_;
+};
+
+// The site index path that is used for the given VCF file
+boost::filesystem::path get_site_index_path(const boost::filesystem::path& vcf_path);
+
+// True if the VCF has a site index that is not older than the VCF itself
+bool has_current_site_index(const boost::filesystem::path& vcf_path);
+
+void make_site_index(const VcfReader& vcf, const boost::filesystem::path& index_path);
+
+} // namespace octopus
+
+#endif
@@ -90,6 +90,11 @@ int main(const int argc, const char** argv)
             const auto start = std::chrono::system_clock::now();
             sanity_check(options);
             log_command_line_options(options);
+            if (is_shard_merge_command(options)) {
+                run_shard_merge(options);
+                log_program_end();
+                return EXIT_SUCCESS;
+            }
             auto components = collate_genome_calling_components(options);
             auto end = std::chrono::system_clock::now();
             using utils::TimeInterval;
@@ -10,17 +10,15 @@
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <utility>
 #include <cassert>
 
 #include <boost/random/uniform_int_distribution.hpp>
-#include <boost/random/discrete_distribution.hpp>
 
-#include "basics/mappable_reference_wrapper.hpp"
 #include "concepts/mappable_range.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/read_algorithms.hpp"
 #include "utils/append.hpp"
-#include "utils/random_select.hpp"
 
 // Use boost distributions as std distributions not guaranteed to be deterministic across compilers.
 // Generators are however.
@@ -35,137 +33,92 @@ Downsampler::Report::DownsampleRegion::DownsampleRegion(GenomicRegion region, st
 
 namespace {
 
-using ReadWrapper = MappableReferenceWrapper<const AlignedRead>;
-
 using PositionCoverages = std::vector<unsigned>;
-
-bool has_minimum_coverage(const PositionCoverages& required_coverage)
-{
-    return std::all_of(std::cbegin(required_coverage), std::cend(required_coverage),
-                       [] (const auto coverage) noexcept { return coverage == 0; });
-}
+using CoverageDeltas    = std::vector<int>;
 
 template <typename ForwardIt>
-auto calculate_minimum_coverages(const ForwardIt first, const ForwardIt last,
-                                 const GenomicRegion& region, const unsigned min_coverage)
-{
-    auto result = calculate_positional_coverage(first, last, region);
-    std::transform(std::cbegin(result), std::cend(result), std::begin(result),
-                   [min_coverage] (const auto coverage) noexcept {
-                       return std::min(coverage, min_coverage);
-                   });
+auto calculate_read_offsets(const ForwardIt first, const ForwardIt last, const GenomicRegion& region)
+{
+    std::vector<std::pair<std::size_t, std::size_t>> result {};
+    result.reserve(std::distance(first, last));
+    const auto region_length = static_cast<std::size_t>(size(region));
+    std::transform(first, last, std::back_inserter(result), [&region, region_length] (const AlignedRead& read) {
+        // Reads must start inside the region but may end after it
+        assert(!begins_before(read, region));
+        const auto begin_offset = static_cast<std::size_t>(begin_distance(region, read));
+        return std::make_pair(begin_offset, std::min(begin_offset + region_size(read), region_length));
+    });
     return result;
 }
 
-template <typename RandomGenerator>
-auto sample(const PositionCoverages& required_coverage, RandomGenerator& generator)
-{
-    // TODO: Do we really need to keep regenerating this distribution?
-    boost::random::discrete_distribution<std::size_t> dist {std::cbegin(required_coverage), std::cend(required_coverage)};
-    return dist(generator);
-}
-
-template <typename T, typename RandomGenerator>
-auto random_sample(const OverlapRange<T>& range, RandomGenerator& generator)
+auto calculate_required_coverages(const std::vector<std::pair<std::size_t, std::size_t>>& read_offsets,
+                                  const GenomicRegion& region, const unsigned target_coverage)
 {
-    return random_select(std::begin(range), std::end(range), generator).base();
-}
-
-template <typename BidirIt, typename RandomGenerator>
-auto pick_sample(BidirIt first_unsampled, BidirIt last_unsampled,
-                 const std::vector<GenomicRegion>& positions,
-                 const PositionCoverages& required_coverage,
-                 const AlignedRead::MappingDomain::Size max_read_size,
-                 RandomGenerator& generator)
-{
-    assert(first_unsampled < last_unsampled);
-    const auto candidates = overlap_range(first_unsampled, last_unsampled,
-                                          positions[sample(required_coverage, generator)],
-                                          max_read_size);
-    assert(!candidates.empty());
-    return random_sample(candidates, generator);
-}
-
-void reduce(PositionCoverages& coverages, const ReadWrapper& read, const GenomicRegion& region)
-{
-    assert(!begins_before(read, region));
-    const auto read_offset = begin_distance(region, read);
-    const auto first = std::next(std::begin(coverages), read_offset);
-    auto last = std::next(first, region_size(read));
-    if (last > std::end(coverages)) last = std::end(coverages);
-    std::transform(first, last, first, [] (const auto x) noexcept { return (x > 0) ? x - 1 : 0; });
-}
-
-template <typename ForwardIt>
-ForwardIt shift_left(ForwardIt first, ForwardIt last)
-{
-    return std::rotate(first, std::next(first), last);
-}
-
-template <typename BidirIt>
-BidirIt shift_right(BidirIt first, BidirIt last)
-{
-    const auto rfirst = std::make_reverse_iterator(last);
-    const auto rlast  = std::make_reverse_iterator(first);
-    return std::rotate(rfirst, std::next(rfirst), rlast).base();
-}
-
-template <typename BidirIt>
-void remove_sample(BidirIt& first, BidirIt sample, BidirIt& last)
-{
-    assert(first <= sample && sample < last);
-    // rotating is linear time so it's cheaper to shift the sample into the closer of the
-    // two sampled groups.
-    if (std::distance(first, sample) < std::distance(sample, last)) {
-        if (sample != first) {
-            shift_right(first, std::next(sample));
-        }
-        ++first;
-    } else {
-        if (sample != std::prev(last)) {
-            shift_left(sample, last);
-        }
-        --last;
+    CoverageDeltas deltas(size(region) + 1, 0);
+    for (const auto& offsets : read_offsets) {
+        ++deltas[offsets.first];
+        --deltas[offsets.second];
     }
+    PositionCoverages result(size(region));
+    int coverage {0};
+    for (std::size_t position {0}; position < result.size(); ++position) {
+        coverage += deltas[position];
+        result[position] = std::min(static_cast<unsigned>(coverage), target_coverage);
+    }
+    return result;
 }
 
-auto extract_sampled(std::vector<ReadWrapper>& reads,
-                     std::vector<ReadWrapper>::iterator first_unsampled,
-                     std::vector<ReadWrapper>::iterator last_unsampled)
+template <typename RandomGenerator>
+std::size_t pop_random(std::vector<std::size_t>& candidates, RandomGenerator& generator)
 {
-    reads.erase(first_unsampled, last_unsampled);
-    std::sort(std::begin(reads), std::end(reads));
-    std::vector<AlignedRead> result {};
-    result.reserve(reads.size());
-    std::transform(std::begin(reads), std::end(reads), std::back_inserter(result),
-                   [] (const auto& wrapper) -> AlignedRead { return wrapper.get(); });
+    boost::random::uniform_int_distribution<std::size_t> dist {0, candidates.size() - 1};
+    const auto idx = dist(generator);
+    const auto result = candidates[idx];
+    candidates[idx] = candidates.back();
+    candidates.pop_back();
     return result;
 }
 
 } // namespace
 
-template <typename InputIt, typename RandomGenerator>
-auto sample(const InputIt first_read, const InputIt last_read, const GenomicRegion& region,
+template <typename ForwardIt, typename RandomGenerator>
+auto sample(const ForwardIt first_read, const ForwardIt last_read, const GenomicRegion& region,
             const unsigned target_coverage, RandomGenerator& generator)
 {
     if (first_read == last_read) return std::vector<AlignedRead> {};
-    const auto positions = decompose(region);
-    auto required_coverage = calculate_minimum_coverages(first_read, last_read, region, target_coverage);
-    assert(positions.size() == required_coverage.size());
-    std::vector<ReadWrapper> reads {first_read, last_read};
-    const auto max_read_size = size(largest_region(reads)); // for efficient overlap detection
-    // The reads are partitioned into three groups: sampled | unsampled | sampled
-    // which allows a sampled read to be optimally moved out of the unsampled partition
-    auto first_unsampled_itr = std::begin(reads);
-    auto last_unsampled_itr  = std::end(reads);
-    while (!has_minimum_coverage(required_coverage)) {
-        const auto sampled_itr = pick_sample(first_unsampled_itr, last_unsampled_itr,
-                                             positions, required_coverage, max_read_size,
-                                             generator);
-        reduce(required_coverage, *sampled_itr, region);
-        remove_sample(first_unsampled_itr, sampled_itr, last_unsampled_itr);
+    const auto read_offsets = calculate_read_offsets(first_read, last_read, region);
+    const auto required_coverages = calculate_required_coverages(read_offsets, region, target_coverage);
+    // Sweep through the region, and whenever the coverage of sampled reads drops below the required
+    // coverage, randomly sample from the unsampled reads overlapping the sweep position. Reads that
+    // ended before the sweep position are only removed from the candidates when they are drawn,
+    // so each read is added and removed once.
+    std::vector<char> is_sampled(read_offsets.size(), false);
+    std::vector<std::size_t> candidates {};
+    CoverageDeltas sampled_coverage_deltas(required_coverages.size() + 1, 0);
+    int sampled_coverage {0};
+    std::size_t next_read_idx {0};
+    for (std::size_t position {0}; position < required_coverages.size(); ++position) {
+        sampled_coverage += sampled_coverage_deltas[position];
+        for (; next_read_idx < read_offsets.size() && read_offsets[next_read_idx].first <= position; ++next_read_idx) {
+            candidates.push_back(next_read_idx);
+        }
+        while (sampled_coverage < static_cast<int>(required_coverages[position])) {
+            assert(!candidates.empty());
+            const auto read_idx = pop_random(candidates, generator);
+            if (read_offsets[read_idx].second > position) {
+                is_sampled[read_idx] = true;
+                ++sampled_coverage;
+                --sampled_coverage_deltas[read_offsets[read_idx].second];
+            }
+        }
     }
-    return extract_sampled(reads, first_unsampled_itr, last_unsampled_itr);
+    std::vector<AlignedRead> result {};
+    result.reserve(std::count(std::cbegin(is_sampled), std::cend(is_sampled), true));
+    std::size_t read_idx {0};
+    std::for_each(first_read, last_read, [&] (const AlignedRead& read) {
+        if (is_sampled[read_idx++]) result.push_back(read);
+    });
+    return result;
 }
 
 namespace {
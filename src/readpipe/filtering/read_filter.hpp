@@ -51,11 +51,19 @@ public:
         return passes(read);
     }
     
+    // Filters that do not inspect base qualities are unaffected by read transforms, and are
+    // usually much cheaper to evaluate
+    bool inspects_base_qualities() const noexcept
+    {
+        return do_inspects_base_qualities();
+    }
+    
 protected:
     BasicReadFilter(std::string name) : Nameable {std::move(name)} {};
     
 private:
     virtual bool passes(const AlignedRead&) const noexcept = 0;
+    virtual bool do_inspects_base_qualities() const noexcept { return false; }
 };
 
 struct HasWellFormedCigar : BasicReadFilter
@@ -117,6 +125,7 @@ struct HasSufficientGoodBaseFraction : BasicReadFilter
                                   double min_good_base_fraction);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool do_inspects_base_qualities() const noexcept override { return true; }
     
 private:
     BaseQuality good_base_quality_;
@@ -134,6 +143,7 @@ struct HasSufficientGoodQualityBases : BasicReadFilter
                                   unsigned min_good_bases);
     
     bool passes(const AlignedRead& read) const noexcept override;
+    bool do_inspects_base_qualities() const noexcept override { return true; }
     
 private:
     BaseQuality good_base_quality_;
@@ -24,6 +24,8 @@ namespace octopus { namespace readpipe
  
  This is a template class as the type of iterator used for context-based filteration needs to be 
  known at compile time. The class needs to know what container it is going to be operating on.
+ 
+ Basic filters that do not inspect base qualities are evaluated before those that do.
  */
 template <typename BidirIt>
 class ReadFilterer
@@ -60,9 +62,16 @@ public:
     BidirIt partition(ReadIterator first, ReadIterator last) const;
     BidirIt partition(ReadIterator first, ReadIterator last, FilterCountMap& filter_counts) const;
     
+    // Like remove, but reads are transformed in the same pass as the basic filters are evaluated. The
+    // transform is only applied to reads passing the filters that do not inspect base qualities,
+    // and must only modify read sequences and base qualities.
+    template <typename UnaryFunction>
+    BidirIt transform_remove(ReadIterator first, ReadIterator last, UnaryFunction transform) const;
+    
 private:
     std::vector<BasicFilterPtr> basic_filters_;
     std::vector<ContextFilterPtr> context_filters_;
+    std::size_t num_quality_independent_filters_ = 0;
     
     bool passes_all_basic_filters(const AlignedRead& read) const noexcept;
     auto find_failing_basic_filter(const AlignedRead& read) const noexcept;
@@ -71,7 +80,13 @@ private:
 template <typename BidirIt>
 void ReadFilterer<BidirIt>::add(BasicFilterPtr filter)
 {
-    basic_filters_.emplace_back(std::move(filter));
+    if (filter->inspects_base_qualities()) {
+        basic_filters_.emplace_back(std::move(filter));
+    } else {
+        const auto position = std::next(std::begin(basic_filters_), num_quality_independent_filters_);
+        basic_filters_.insert(position, std::move(filter));
+        ++num_quality_independent_filters_;
+    }
 }
 
 template <typename BidirIt>
@@ -244,6 +259,29 @@ BidirIt ReadFilterer<BidirIt>::partition(BidirIt first, BidirIt last,
     return last;
 }
 
+template <typename BidirIt>
+template <typename UnaryFunction>
+BidirIt ReadFilterer<BidirIt>::transform_remove(BidirIt first, BidirIt last, UnaryFunction transform) const
+{
+    const auto quality_filters_begin = std::next(std::cbegin(basic_filters_), num_quality_independent_filters_);
+    const auto passes = [] (const AlignedRead& read) { return [&read] (const auto& filter) { return (*filter)(read); }; };
+    auto result = first;
+    for (auto itr = first; itr != last; ++itr) {
+        if (std::all_of(std::cbegin(basic_filters_), quality_filters_begin, passes(*itr))) {
+            transform(*itr);
+            if (std::all_of(quality_filters_begin, std::cend(basic_filters_), passes(*itr))) {
+                if (result != itr) *result = std::move(*itr);
+                ++result;
+            }
+        }
+    }
+    last = result;
+    for (const auto& filter : context_filters_) {
+        last = filter->remove(first, last);
+    }
+    return last;
+}
+
 // private member methods
 
 template <typename BidirIt>
@@ -307,6 +345,18 @@ filter(Map& reads, const ReadFilterer& f, OptionalFilterCountMap<Map, ReadFilter
     return result;
 }
 
+template <typename Map, typename ReadFilterer, typename UnaryFunction>
+FilterPointMap<Map> transform_filter(Map& reads, const ReadFilterer& f, UnaryFunction transform)
+{
+    FilterPointMap<Map> result {reads.size()};
+    
+    for (auto& p : reads) {
+        result.emplace(p.first, f.transform_remove(std::begin(p.second), std::end(p.second), transform));
+    }
+    
+    return result;
+}
+
 template <typename Map>
 std::size_t erase_filtered_reads(Map& reads, const FilterPointMap<Map>& filter_points)
 {
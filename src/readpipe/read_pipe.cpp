@@ -6,11 +6,14 @@
 #include <utility>
 #include <iterator>
 #include <algorithm>
+#include <future>
+#include <unordered_map>
 #include <cassert>
 
 #include "utils/read_stats.hpp"
 #include "utils/mappable_algorithms.hpp"
 #include "utils/append.hpp"
+#include "utils/hash_functions.hpp"
 
 namespace octopus {
 
@@ -29,6 +32,7 @@ ReadPipe::ReadPipe(const ReadManager& source, ReadTransformer transformer, ReadF
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
 , fragment_size_ {}
+, workers_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -44,6 +48,7 @@ ReadPipe::ReadPipe(const ReadManager& source, ReadTransformer prefilter_transfor
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
 , fragment_size_ {}
+, workers_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
@@ -59,18 +64,12 @@ ReadPipe::ReadPipe(const ReadManager& source, GenomicRegion::Size fragment_size,
 , downsampler_ {std::move(downsampler)}
 , samples_ {std::move(samples)}
 , fragment_size_ {fragment_size}
+, workers_ {}
 , debug_log_ {}
 {
     if (DEBUG_MODE) debug_log_ = logging::DebugLogger {};
 }
 
-std::vector<std::vector<SampleName>> batch_samples(std::vector<SampleName> samples)
-{
-    std::vector<std::vector<SampleName>> result {};
-    result.emplace_back(std::move(samples)); // TODO: find a better strategy for this
-    return result;
-}
-
 const ReadManager& ReadPipe::read_manager() const noexcept
 {
     return source_;
@@ -81,6 +80,11 @@ void ReadPipe::set_read_manager(const ReadManager& source) noexcept
     source_ = source;
 }
 
+void ReadPipe::set_workers(std::shared_ptr<ThreadPool> workers) noexcept
+{
+    workers_ = std::move(workers);
+}
+
 unsigned ReadPipe::num_samples() const noexcept
 {
     return static_cast<unsigned>(samples_.size());
@@ -93,6 +97,46 @@ const std::vector<SampleName>& ReadPipe::samples() const noexcept
 
 namespace {
 
+// Samples that share a file are put in the same batch, so each file is only decoded once per fetch
+std::vector<std::vector<SampleName>>
+batch_samples(const std::vector<SampleName>& samples, const ReadManager& source, const bool parallel)
+{
+    std::vector<std::vector<SampleName>> result {};
+    if (!parallel) {
+        result.push_back(samples);
+        return result;
+    }
+    std::unordered_map<ReadManager::Path, std::size_t, utils::FilepathHash> file_batches {};
+    for (const auto& sample : samples) {
+        const auto sample_paths = source.paths(sample);
+        boost::optional<std::size_t> batch {};
+        for (const auto& path : sample_paths) {
+            const auto file_batch_itr = file_batches.find(path);
+            if (file_batch_itr == std::cend(file_batches)) continue;
+            const auto file_batch = file_batch_itr->second;
+            if (!batch) {
+                batch = file_batch;
+            } else if (file_batch != *batch) {
+                // The sample joins two batches
+                utils::append(std::move(result[file_batch]), result[*batch]);
+                result[file_batch].clear();
+                for (auto& p : file_batches) {
+                    if (p.second == file_batch) p.second = *batch;
+                }
+            }
+        }
+        if (!batch) {
+            batch = result.size();
+            result.emplace_back();
+        }
+        result[*batch].push_back(sample);
+        for (const auto& path : sample_paths) file_batches[path] = *batch;
+    }
+    result.erase(std::remove_if(std::begin(result), std::end(result), [] (const auto& batch) { return batch.empty(); }),
+                 std::end(result));
+    return result;
+}
+
 template <typename Map>
 void sort_each(Map& reads)
 {
@@ -182,93 +226,42 @@ struct IsMappingQualityZero
     bool operator()(const AlignedRead& read) const noexcept { return read.mapping_quality() == 0; }
 };
 
+void merge(ReadPipe::Report&& src, ReadPipe::Report& dst)
+{
+    for (auto& p : src.raw_depths) dst.raw_depths.insert(std::move(p));
+    for (auto& p : src.mapping_quality_zero_depths) dst.mapping_quality_zero_depths.insert(std::move(p));
+    for (auto& p : src.downsample_report) dst.downsample_report.insert(std::move(p));
+}
+
 } // namespace
 
 ReadMap ReadPipe::fetch_reads(const GenomicRegion& region, boost::optional<Report&> report) const
 {
-    using namespace readpipe;
     ReadMap result {samples_.size()};
     for (const auto& sample : samples_) {
         result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
     }
     if (report) report->raw_depths.reserve(samples_.size());
-    for (const auto& batch : batch_samples(samples_)) {
-        auto batch_reads = fetch_batch(source_, batch, region);
-        if (debug_log_) {
-            stream(*debug_log_) << "Fetched " << count_reads(batch_reads) << " unfiltered reads from " << region;
-        }
-        if (report) {
-            for (const auto& p : batch_reads) {
-                report->raw_depths.emplace(p.first, make_coverage_tracker(p.second));
-                report->mapping_quality_zero_depths.emplace(p.first, make_coverage_tracker(p.second, IsMappingQualityZero {}));
-            }
+    const auto batches = batch_samples(samples_, source_, workers_ != nullptr);
+    if (workers_ && batches.size() > 1) {
+        // Batches are in separate files, so can be fetched and processed independently
+        std::vector<Report> batch_reports(report ? batches.size() : 0);
+        std::vector<std::future<ReadMap>> batch_reads {};
+        batch_reads.reserve(batches.size());
+        for (std::size_t i {0}; i < batches.size(); ++i) {
+            batch_reads.push_back(workers_->push([&, i] () {
+                return process_batch(batches[i], region, report ? boost::optional<Report&> {batch_reports[i]} : boost::none);
+            }));
         }
-        transform_reads(batch_reads, prefilter_transformer_);
-        if (debug_log_) {
-            SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
-            filter_counts.reserve(samples_.size());
-            for (const auto& sample : samples_) {
-                filter_counts[sample].reserve(filterer_.num_filters());
-            }
-            erase_filtered_reads(batch_reads, filter(batch_reads, filterer_, filter_counts));
-            if (filterer_.num_filters() > 0) {
-                for (const auto& p : filter_counts) {
-                    stream(*debug_log_) << "In sample " << p.first;
-                    if (!p.second.empty()) {
-                        for (const auto& c : p.second) {
-                            stream(*debug_log_) << c.second << " reads failed the " << c.first << " filter";
-                        }
-                    } else {
-                        *debug_log_ << "No reads were filtered";
-                    }
-                }
-            }
-        } else {
-            erase_filtered_reads(batch_reads, filter(batch_reads, filterer_));
-        }
-        if (postfilter_transformer_) {
-            transform_reads(batch_reads, *postfilter_transformer_);
-        }
-        if (debug_log_) {
-            stream(*debug_log_) << "There are " << count_reads(batch_reads) << " reads in " << region
-                            << " after filtering";
-        }
-        if (fragment_size_) {
-            fragment(batch_reads, *fragment_size_, region);
-            if (debug_log_) {
-                stream(*debug_log_) << "Fragmented reads from " << region << " into " << count_reads(batch_reads) << " reads";
-                SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
-                filter_counts.reserve(samples_.size());
-                for (const auto& sample : samples_) {
-                    filter_counts[sample].reserve(filterer_.num_filters());
-                }
-                erase_filtered_reads(batch_reads, filter(batch_reads, filterer_, filter_counts));
-                if (filterer_.num_filters() > 0) {
-                    for (const auto& p : filter_counts) {
-                        stream(*debug_log_) << "In sample " << p.first;
-                        if (!p.second.empty()) {
-                            for (const auto& c : p.second) {
-                                stream(*debug_log_) << c.second << " read fragments failed the " << c.first << " filter";
-                            }
-                        } else {
-                            *debug_log_ << "No read fragments were filtered";
-                        }
-                    }
-                }
-            } else {
-                erase_filtered_reads(batch_reads, filter(batch_reads, filterer_));
-            }
+        // Wait for all tasks before collecting any as the tasks reference locals
+        for (auto& reads : batch_reads) reads.wait();
+        for (std::size_t i {0}; i < batches.size(); ++i) {
+            insert_each(batch_reads[i].get(), result);
+            if (report) merge(std::move(batch_reports[i]), *report);
         }
-        if (downsampler_) {
-            auto reads = make_mappable_map(std::move(batch_reads));
-            auto downsample_reports = downsample(reads, *downsampler_);
-            if (debug_log_) stream(*debug_log_) << "Downsampling removed " << count_downsampled_reads(downsample_reports) << " reads from " << region;
-            if (report) {
-                report->downsample_report = std::move(downsample_reports);
-            }
-            insert_each(std::move(reads), result);
-        } else {
-            insert_each(std::move(batch_reads), result);
+    } else {
+        for (const auto& batch : batches) {
+            insert_each(process_batch(batch, region, report), result);
         }
     }
     shrink_to_fit(result); // TODO: should we make this conditional on extra capacity?
@@ -303,4 +296,100 @@ ReadMap ReadPipe::fetch_reads(const std::vector<GenomicRegion>& regions, boost::
     return result;
 }
 
+// private methods
+
+ReadMap ReadPipe::process_batch(const std::vector<SampleName>& batch, const GenomicRegion& region,
+                                boost::optional<Report&> report) const
+{
+    using namespace readpipe;
+    ReadMap result {batch.size()};
+    for (const auto& sample : batch) {
+        result.emplace(std::piecewise_construct, std::forward_as_tuple(sample), std::forward_as_tuple());
+    }
+    auto batch_reads = fetch_batch(source_, batch, region);
+    if (debug_log_) {
+        stream(*debug_log_) << "Fetched " << count_reads(batch_reads) << " unfiltered reads from " << region;
+    }
+    if (report) {
+        for (const auto& p : batch_reads) {
+            report->raw_depths.emplace(p.first, make_coverage_tracker(p.second));
+            report->mapping_quality_zero_depths.emplace(p.first, make_coverage_tracker(p.second, IsMappingQualityZero {}));
+        }
+    }
+    if (debug_log_) {
+        transform_reads(batch_reads, prefilter_transformer_);
+        SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
+        filter_counts.reserve(batch.size());
+        for (const auto& sample : batch) {
+            filter_counts[sample].reserve(filterer_.num_filters());
+        }
+        erase_filtered_reads(batch_reads, filter(batch_reads, filterer_, filter_counts));
+        if (filterer_.num_filters() > 0) {
+            for (const auto& p : filter_counts) {
+                stream(*debug_log_) << "In sample " << p.first;
+                if (!p.second.empty()) {
+                    for (const auto& c : p.second) {
+                        stream(*debug_log_) << c.second << " reads failed the " << c.first << " filter";
+                    }
+                } else {
+                    *debug_log_ << "No reads were filtered";
+                }
+            }
+        }
+    } else if (!prefilter_transformer_.has_template_transforms()) {
+        // Reads failing cheap filters are removed before being transformed, and all other reads
+        // are only visited once
+        const auto transform = [this] (AlignedRead& read) { prefilter_transformer_.transform_read(read); };
+        erase_filtered_reads(batch_reads, transform_filter(batch_reads, filterer_, transform));
+    } else {
+        transform_reads(batch_reads, prefilter_transformer_);
+        erase_filtered_reads(batch_reads, filter(batch_reads, filterer_));
+    }
+    if (postfilter_transformer_) {
+        transform_reads(batch_reads, *postfilter_transformer_);
+    }
+    if (debug_log_) {
+        stream(*debug_log_) << "There are " << count_reads(batch_reads) << " reads in " << region
+                        << " after filtering";
+    }
+    if (fragment_size_) {
+        fragment(batch_reads, *fragment_size_, region);
+        if (debug_log_) {
+            stream(*debug_log_) << "Fragmented reads from " << region << " into " << count_reads(batch_reads) << " reads";
+            SampleFilterCountMap<SampleName, decltype(filterer_)> filter_counts {};
+            filter_counts.reserve(batch.size());
+            for (const auto& sample : batch) {
+                filter_counts[sample].reserve(filterer_.num_filters());
+            }
+            erase_filtered_reads(batch_reads, filter(batch_reads, filterer_, filter_counts));
+            if (filterer_.num_filters() > 0) {
+                for (const auto& p : filter_counts) {
+                    stream(*debug_log_) << "In sample " << p.first;
+                    if (!p.second.empty()) {
+                        for (const auto& c : p.second) {
+                            stream(*debug_log_) << c.second << " read fragments failed the " << c.first << " filter";
+                        }
+                    } else {
+                        *debug_log_ << "No read fragments were filtered";
+                    }
+                }
+            }
+        } else {
+            erase_filtered_reads(batch_reads, filter(batch_reads, filterer_));
+        }
+    }
+    if (downsampler_) {
+        auto reads = make_mappable_map(std::move(batch_reads));
+        auto downsample_reports = downsample(reads, *downsampler_);
+        if (debug_log_) stream(*debug_log_) << "Downsampling removed " << count_downsampled_reads(downsample_reports) << " reads from " << region;
+        if (report) {
+            for (auto& p : downsample_reports) report->downsample_report.insert(std::move(p));
+        }
+        insert_each(std::move(reads), result);
+    } else {
+        insert_each(std::move(batch_reads), result);
+    }
+    return result;
+}
+
 } // namespace octopus
@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <cstddef>
 #include <functional>
+#include <memory>
 
 #include <boost/optional.hpp>
 
@@ -15,6 +16,7 @@
 #include "basics/genomic_region.hpp"
 #include "io/read/read_manager.hpp"
 #include "utils/coverage_tracker.hpp"
+#include "utils/thread_pool.hpp"
 #include "logging/logging.hpp"
 #include "filtering/read_filterer.hpp"
 #include "transformers/read_transformer.hpp"
@@ -82,6 +84,9 @@ public:
     const ReadManager& read_manager() const noexcept;
     void set_read_manager(const ReadManager& source) noexcept;
     
+    // Samples are fetched and processed concurrently on the given workers, which may be shared
+    void set_workers(std::shared_ptr<ThreadPool> workers) noexcept;
+    
     unsigned num_samples() const noexcept;
     const std::vector<SampleName>& samples() const noexcept;
     
@@ -98,7 +103,11 @@ private:
     boost::optional<Downsampler> downsampler_;
     std::vector<SampleName> samples_;
     boost::optional<GenomicRegion::Size> fragment_size_;
+    std::shared_ptr<ThreadPool> workers_;
     mutable boost::optional<logging::DebugLogger> debug_log_;
+    
+    ReadMap process_batch(const std::vector<SampleName>& batch, const GenomicRegion& region,
+                          boost::optional<Report&> report) const;
 };
 
 } // namespace octopus
@@ -0,0 +1,75 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "base_mismatches.hpp"
+
+#include <immintrin.h>
+
+#include "system.hpp"
+
+namespace octopus {
+
+namespace {
+
+#if defined(__AVX2__) && AVX2_AVAILABLE
+
+using BaseVector = __m256i;
+
+constexpr std::size_t vector_bases {32};
+
+auto load(const char* bases) noexcept
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bases));
+}
+
+std::uint32_t make_mismatch_mask(const BaseVector lhs, const BaseVector rhs) noexcept
+{
+    const auto n = _mm256_set1_epi8('N');
+    const auto matches = _mm256_or_si256(_mm256_cmpeq_epi8(lhs, rhs),
+                                         _mm256_or_si256(_mm256_cmpeq_epi8(lhs, n), _mm256_cmpeq_epi8(rhs, n)));
+    return ~static_cast<std::uint32_t>(_mm256_movemask_epi8(matches));
+}
+
+#else
+
+using BaseVector = __m128i;
+
+constexpr std::size_t vector_bases {16};
+
+auto load(const char* bases) noexcept
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(bases));
+}
+
+std::uint32_t make_mismatch_mask(const BaseVector lhs, const BaseVector rhs) noexcept
+{
+    const auto n = _mm_set1_epi8('N');
+    const auto matches = _mm_or_si128(_mm_cmpeq_epi8(lhs, rhs),
+                                      _mm_or_si128(_mm_cmpeq_epi8(lhs, n), _mm_cmpeq_epi8(rhs, n)));
+    return ~static_cast<std::uint32_t>(_mm_movemask_epi8(matches)) & 0xFFFFu;
+}
+
+#endif // defined(__AVX2__) && AVX2_AVAILABLE
+
+bool is_mismatch(const char lhs, const char rhs) noexcept
+{
+    return lhs != rhs && lhs != 'N' && rhs != 'N';
+}
+
+} // namespace
+
+MismatchMask make_mismatch_mask(const char* lhs, const char* rhs, std::size_t n) noexcept
+{
+    n = std::min(n, mismatch_mask_bases);
+    MismatchMask result {0};
+    std::size_t i {0};
+    for (; i + vector_bases <= n; i += vector_bases) {
+        result |= static_cast<MismatchMask>(make_mismatch_mask(load(lhs + i), load(rhs + i))) << i;
+    }
+    for (; i < n; ++i) {
+        if (is_mismatch(lhs[i], rhs[i])) result |= MismatchMask {1} << i;
+    }
+    return result;
+}
+
+} // namespace octopus
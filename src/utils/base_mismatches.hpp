@@ -0,0 +1,35 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef base_mismatches_hpp
+#define base_mismatches_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+namespace octopus {
+
+using MismatchMask = std::uint64_t;
+
+constexpr std::size_t mismatch_mask_bases {64};
+
+// Bit i is set if lhs[i] != rhs[i] and neither base is 'N', for i < min(n, mismatch_mask_bases).
+// Bases are compared a vector at a time.
+MismatchMask make_mismatch_mask(const char* lhs, const char* rhs, std::size_t n) noexcept;
+
+// Calls f(i) for each i < n where lhs[i] != rhs[i] and neither base is 'N', in increasing order
+template <typename F>
+void for_each_mismatch(const char* lhs, const char* rhs, const std::size_t n, F&& f)
+{
+    for (std::size_t block_offset {0}; block_offset < n; block_offset += mismatch_mask_bases) {
+        auto mask = make_mismatch_mask(lhs + block_offset, rhs + block_offset, std::min(n - block_offset, mismatch_mask_bases));
+        for (; mask != 0; mask &= mask - 1) {
+            f(block_offset + static_cast<std::size_t>(__builtin_ctzll(mask)));
+        }
+    }
+}
+
+} // namespace octopus
+
+#endif
@@ -5,7 +5,6 @@
 #define coverage_tracker_hpp
 
 #include <vector>
-#include <deque>
 #include <cstddef>
 #include <utility>
 #include <iterator>
@@ -14,11 +13,13 @@
 #include <stdexcept>
 #include <cassert>
 #include <limits>
+#include <cmath>
 
 #include <boost/optional.hpp>
 #include <boost/iterator/filter_iterator.hpp>
 
 #include "concepts/mappable.hpp"
+#include "mappable_algorithms.hpp"
 #include "maths.hpp"
 
 namespace octopus {
@@ -26,6 +27,11 @@ namespace octopus {
 /**
  CoverageTracker provides an efficient method for tracking coverage statistics over a range
  of Mappable objects without having to store the entire collection.
+ 
+ Only the begin and end positions of added regions are recorded, so adding is constant time.
+ Depths are materialised as runs of constant depth on the first query after adding, so queries
+ are proportional to the number of depth changes in the query region rather than its size. As
+ materialisation happens in const methods, these are not safe to call concurrently.
  */
 template <typename Region, typename T = unsigned>
 class CoverageTracker
@@ -33,6 +39,7 @@ class CoverageTracker
 public:
     using RegionType = Region;
     using DepthType  = T;
+    using Position   = typename Region::Position;
     
     CoverageTracker(bool check_overflow = false);
     
@@ -46,23 +53,23 @@ public:
     template <typename MappableType>
     void add(const MappableType& mappable);
     
-    bool any() const noexcept;
-    bool any(const Region& region) const noexcept;
+    bool any() const;
+    bool any(const Region& region) const;
     
-    std::size_t sum() const noexcept;
-    std::size_t sum(const Region& region) const noexcept;
+    std::size_t sum() const;
+    std::size_t sum(const Region& region) const;
     
-    DepthType max() const noexcept;
-    DepthType max(const Region& region) const noexcept;
+    DepthType max() const;
+    DepthType max(const Region& region) const;
     
-    DepthType min() const noexcept;
-    DepthType min(const Region& region) const noexcept;
+    DepthType min() const;
+    DepthType min(const Region& region) const;
     
-    double mean() const noexcept;
-    double mean(const Region& region) const noexcept;
+    double mean() const;
+    double mean(const Region& region) const;
     
-    double stdev() const noexcept;
-    double stdev(const Region& region) const noexcept;
+    double stdev() const;
+    double stdev(const Region& region) const;
     
     double median() const;
     double median(const Region& region) const;
@@ -71,22 +78,34 @@ public:
     OutputIt get(const Region& region, OutputIt result) const;
     std::vector<DepthType> get(const Region& region) const;
     
+    // Calls f(begin, end, depth) for each run of constant depth overlapping region, in order
+    template <typename F>
+    void visit(const Region& region, F f) const;
+    
     boost::optional<Region> encompassing_region() const;
     bool is_empty() const noexcept;
     std::size_t num_tracked() const noexcept;
     void clear() noexcept;
     
 private:
-    std::deque<DepthType> coverage_ = {};
-    Region encompassing_region_;
+    struct DepthRun
+    {
+        Position begin;
+        DepthType depth;
+    };
+    
+    mutable std::vector<Position> begins_ = {}, ends_ = {};
+    mutable std::size_t num_sorted_ = 0;
+    mutable std::vector<DepthRun> runs_ = {}; // the last run is always zero depth
+    mutable bool is_materialised_ = true;
+    Region first_region_;
+    Position min_begin_ = 0, max_end_ = 0;
     std::size_t num_tracked_ = 0;
     bool check_overflow_ = false;
     
-    using Iterator     = typename decltype(coverage_)::const_iterator;
-    using IteratorPair = std::pair<Iterator, Iterator>;
-    
     void do_add(const Region& region);
-    IteratorPair range(const Region& region) const;
+    void materialise() const;
+    std::pair<Position, Position> overlap_range(const Region& region) const;
 };
 
 // non-member methods
@@ -117,15 +136,41 @@ auto make_coverage_tracker(const Range& mappables, const UnaryPredicate conditio
     return make_coverage_tracker<decltype(begin), T>(begin, end);
 }
 
-template <typename Region>
-std::vector<Region> get_covered_regions(const CoverageTracker<Region>& tracker, const Region& region)
+namespace detail {
+
+inline bool is_same_contig_helper(const ContigRegion& lhs, const ContigRegion& rhs) noexcept
 {
-    const auto depths = tracker.coverage(region);
-    return select_regions(region, depths, [] (unsigned depth) { return depth > 0; });
+    return true;
 }
 
-template <typename Region>
-std::vector<Region> get_covered_regions(const CoverageTracker<Region>& tracker)
+inline bool is_same_contig_helper(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
+{
+    return is_same_contig(lhs, rhs);
+}
+
+} // namespace detail
+
+template <typename Region, typename T>
+std::vector<Region> get_covered_regions(const CoverageTracker<Region, T>& tracker, const Region& region)
+{
+    std::vector<Region> result {};
+    boost::optional<std::pair<typename Region::Position, typename Region::Position>> covered {};
+    tracker.visit(region, [&] (auto begin, auto end, auto depth) {
+        if (depth > 0) {
+            if (covered && covered->second == begin) {
+                covered->second = end;
+            } else {
+                if (covered) result.push_back(detail::make_region_helper(region, covered->first, covered->second));
+                covered = std::make_pair(begin, end);
+            }
+        }
+    });
+    if (covered) result.push_back(detail::make_region_helper(region, covered->first, covered->second));
+    return result;
+}
+
+template <typename Region, typename T>
+std::vector<Region> get_covered_regions(const CoverageTracker<Region, T>& tracker)
 {
     const auto tracker_region = tracker.encompassing_region();
     if (tracker_region) {
@@ -151,129 +196,156 @@ void CoverageTracker<Region, T>::add(const MappableType& mappable)
 }
 
 template <typename Region, typename T>
-bool CoverageTracker<Region, T>::any() const noexcept
+bool CoverageTracker<Region, T>::any() const
 {
-    return std::find_if(std::cbegin(coverage_), std::cend(coverage_),
-                        [] (auto depth) noexcept { return depth > 0; }) != std::cend(coverage_);
+    return !is_empty(); // only non-empty regions are tracked
 }
 
 template <typename Region, typename T>
-bool CoverageTracker<Region, T>::any(const Region& region) const noexcept
+bool CoverageTracker<Region, T>::any(const Region& region) const
 {
-    if (octopus::is_empty(region)) return false;
-    const auto p = range(region);
-    return std::find_if(p.first, p.second, [] (auto depth) noexcept { return depth > 0; }) != p.second;
+    bool result {false};
+    visit(region, [&result] (Position, Position, DepthType depth) { if (depth > 0) result = true; });
+    return result;
 }
 
 template <typename Region, typename T>
-std::size_t CoverageTracker<Region, T>::sum() const noexcept
+std::size_t CoverageTracker<Region, T>::sum() const
 {
-    return std::accumulate(std::cbegin(coverage_), std::cend(coverage_), std::size_t {0});
+    if (is_empty()) return 0;
+    return sum(*encompassing_region());
 }
 
 template <typename Region, typename T>
-std::size_t CoverageTracker<Region, T>::sum(const Region& region) const noexcept
+std::size_t CoverageTracker<Region, T>::sum(const Region& region) const
 {
-    if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    return std::accumulate(p.first, p.second, std::size_t {0});
+    std::size_t result {0};
+    visit(region, [&result] (Position begin, Position end, DepthType depth) {
+        result += static_cast<std::size_t>(depth) * (end - begin);
+    });
+    return result;
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::max() const noexcept
+T CoverageTracker<Region, T>::max() const
 {
-    if (coverage_.empty()) return 0;
-    return *std::max_element(std::cbegin(coverage_), std::cend(coverage_));
+    if (is_empty()) return 0;
+    return max(*encompassing_region());
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::max(const Region& region) const noexcept
+T CoverageTracker<Region, T>::max(const Region& region) const
 {
-    if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    if (p.first == p.second) return 0;
-    return *std::max_element(p.first, p.second);
+    boost::optional<DepthType> result {};
+    visit(region, [&result] (Position, Position, DepthType depth) {
+        if (!result || depth > *result) result = depth;
+    });
+    return result ? *result : 0;
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::min() const noexcept
+T CoverageTracker<Region, T>::min() const
 {
-    if (coverage_.empty()) return 0;
-    return *std::min_element(std::cbegin(coverage_), std::cend(coverage_));
+    if (is_empty()) return 0;
+    return min(*encompassing_region());
 }
 
 template <typename Region, typename T>
-T CoverageTracker<Region, T>::min(const Region& region) const noexcept
+T CoverageTracker<Region, T>::min(const Region& region) const
 {
-    if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    if (p.first == p.second) return 0;
-    return *std::min_element(p.first, p.second);
+    boost::optional<DepthType> result {};
+    visit(region, [&result] (Position, Position, DepthType depth) {
+        if (!result || depth < *result) result = depth;
+    });
+    return result ? *result : 0;
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::mean() const noexcept
+double CoverageTracker<Region, T>::mean() const
 {
-    if (coverage_.empty()) return 0;
-    return maths::mean(coverage_);
+    if (is_empty()) return 0;
+    return mean(*encompassing_region());
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::mean(const Region& region) const noexcept
+double CoverageTracker<Region, T>::mean(const Region& region) const
 {
-    if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    return maths::mean(p.first, p.second);
+    const auto overlap = overlap_range(region);
+    if (overlap.first >= overlap.second) return 0;
+    return static_cast<double>(sum(region)) / (overlap.second - overlap.first);
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::stdev() const noexcept
+double CoverageTracker<Region, T>::stdev() const
 {
-    if (coverage_.empty()) return 0;
-    return maths::stdev(coverage_);
+    if (is_empty()) return 0;
+    return stdev(*encompassing_region());
 }
 
 template <typename Region, typename T>
-double CoverageTracker<Region, T>::stdev(const Region& region) const noexcept
+double CoverageTracker<Region, T>::stdev(const Region& region) const
 {
-    if (octopus::is_empty(region)) return 0;
-    const auto p = range(region);
-    return maths::stdev(p.first, p.second);
+    const auto overlap = overlap_range(region);
+    if (overlap.first >= overlap.second) return 0;
+    const auto m = mean(region);
+    double ss {0};
+    visit(region, [&] (Position begin, Position end, DepthType depth) {
+        ss += (end - begin) * std::pow(depth - m, 2);
+    });
+    return std::sqrt(ss / (overlap.second - overlap.first));
 }
 
 template <typename Region, typename T>
 double CoverageTracker<Region, T>::median() const
 {
-    if (coverage_.empty()) return 0;
-    return maths::median(coverage_);
+    if (is_empty()) return 0;
+    return median(*encompassing_region());
 }
 
 template <typename Region, typename T>
 double CoverageTracker<Region, T>::median(const Region& region) const
 {
-    auto range_coverage = this->get(region);
-    if (range_coverage.empty()) return 0;
-    return maths::median(range_coverage);
+    // Positions outside the tracked region have zero depth
+    const auto num_positions = static_cast<std::size_t>(size(region));
+    if (num_positions == 0) return 0;
+    std::vector<std::pair<DepthType, std::size_t>> depth_counts {};
+    std::size_t num_overlapped_positions {0};
+    visit(region, [&] (Position begin, Position end, DepthType depth) {
+        depth_counts.emplace_back(depth, end - begin);
+        num_overlapped_positions += end - begin;
+    });
+    if (num_overlapped_positions < num_positions) {
+        depth_counts.emplace_back(0, num_positions - num_overlapped_positions);
+    }
+    std::sort(std::begin(depth_counts), std::end(depth_counts));
+    const auto nth_depth = [&] (const std::size_t n) {
+        std::size_t num_seen {0};
+        for (const auto& p : depth_counts) {
+            num_seen += p.second;
+            if (n < num_seen) return p.first;
+        }
+        return depth_counts.back().first;
+    };
+    if (num_positions % 2 == 1) {
+        return nth_depth(num_positions / 2);
+    } else {
+        return (static_cast<double>(nth_depth(num_positions / 2 - 1)) + nth_depth(num_positions / 2)) / 2;
+    }
 }
 
 template <typename Region, typename T>
 template <typename OutputIt>
 OutputIt CoverageTracker<Region, T>::get(const Region& region, OutputIt result) const
 {
-    if (coverage_.empty() || !overlaps(region, encompassing_region_)) {
+    const auto overlap = overlap_range(region);
+    if (overlap.first >= overlap.second) {
         return std::fill_n(result, size(region), 0);
     }
-    const auto p = range(region);
-    if (contains(encompassing_region_, region)) {
-        return std::copy(p.first, p.second, result);
-    } else {
-        using D = typename Region::Distance;
-        const auto lhs_pad = std::max(begin_distance(region, encompassing_region_), D {0});
-        result = std::fill_n(result, lhs_pad, 0);
-        result = std::copy(p.first, p.second, result);
-        const auto rhs_pad = std::max(end_distance(encompassing_region_, region), D {0});
-        return std::fill_n(result, rhs_pad, 0);
-    }
+    result = std::fill_n(result, overlap.first - region.begin(), 0);
+    visit(region, [&result] (Position begin, Position end, DepthType depth) {
+        result = std::fill_n(result, end - begin, depth);
+    });
+    return std::fill_n(result, region.end() - overlap.second, 0);
 }
 
 template <typename Region, typename T>
@@ -284,11 +356,26 @@ std::vector<T> CoverageTracker<Region, T>::get(const Region& region) const
     return result;
 }
 
+template <typename Region, typename T>
+template <typename F>
+void CoverageTracker<Region, T>::visit(const Region& region, F f) const
+{
+    const auto overlap = overlap_range(region);
+    if (overlap.first >= overlap.second) return;
+    materialise();
+    const auto run_before = [] (const Position position, const DepthRun& run) noexcept { return position < run.begin; };
+    auto run_itr = std::prev(std::upper_bound(std::cbegin(runs_), std::cend(runs_), overlap.first, run_before));
+    // The last run starts at max_end_, so is never visited
+    for (; run_itr->begin < overlap.second; ++run_itr) {
+        f(std::max(run_itr->begin, overlap.first), std::min(std::next(run_itr)->begin, overlap.second), run_itr->depth);
+    }
+}
+
 template <typename Region, typename T>
 boost::optional<Region> CoverageTracker<Region, T>::encompassing_region() const
 {
     if (!is_empty()) {
-        return encompassing_region_;
+        return detail::make_region_helper(first_region_, min_begin_, max_end_);
     } else {
         return boost::none;
     }
@@ -309,75 +396,90 @@ std::size_t CoverageTracker<Region, T>::num_tracked() const noexcept
 template <typename Region, typename T>
 void CoverageTracker<Region, T>::clear() noexcept
 {
-    coverage_.clear();
-    coverage_.shrink_to_fit();
+    begins_.clear();
+    begins_.shrink_to_fit();
+    ends_.clear();
+    ends_.shrink_to_fit();
+    runs_.clear();
+    runs_.shrink_to_fit();
+    num_sorted_ = 0;
+    is_materialised_ = true;
     num_tracked_ = 0;
 }
 
 // private methods
 
-namespace detail {
-
-inline bool is_same_contig_helper(const ContigRegion& lhs, const ContigRegion& rhs) noexcept
+template <typename Region, typename T>
+void CoverageTracker<Region, T>::do_add(const Region& region)
 {
-    return true;
+    if (octopus::is_empty(region)) return;
+    if (num_tracked_ == 0) {
+        first_region_ = region;
+        min_begin_ = region.begin();
+        max_end_ = region.end();
+    } else {
+        if (!detail::is_same_contig_helper(region, first_region_)) {
+            throw std::runtime_error {"CoverageTracker: contig mismatch"};
+        }
+        min_begin_ = std::min(min_begin_, region.begin());
+        max_end_ = std::max(max_end_, region.end());
+    }
+    begins_.push_back(region.begin());
+    ends_.push_back(region.end());
+    is_materialised_ = false;
+    ++num_tracked_;
 }
 
-inline bool is_same_contig_helper(const GenomicRegion& lhs, const GenomicRegion& rhs) noexcept
+namespace detail {
+
+template <typename T>
+void sort_unsorted_tail(std::vector<T>& values, const std::size_t num_sorted)
 {
-    return is_same_contig(lhs, rhs);
+    const auto first_unsorted = std::next(std::begin(values), num_sorted);
+    if (!std::is_sorted(first_unsorted, std::end(values))) {
+        std::sort(first_unsorted, std::end(values));
+    }
+    if (num_sorted > 0 && first_unsorted != std::end(values) && *first_unsorted < *std::prev(first_unsorted)) {
+        std::inplace_merge(std::begin(values), first_unsorted, std::end(values));
+    }
 }
 
 } // namespace detail
 
 template <typename Region, typename T>
-void CoverageTracker<Region, T>::do_add(const Region& region)
+void CoverageTracker<Region, T>::materialise() const
 {
-    if (octopus::is_empty(region)) return;
-    if (num_tracked_ == 0) {
-        coverage_.assign(size(region), 1);
-        encompassing_region_ = region;
-    } else {
-        if (!detail::is_same_contig_helper(region, encompassing_region_)) {
-            throw std::runtime_error {"CoverageTracker: contig mismatch"};
-        }
-        bool region_change {false};
-        if (begins_before(region, encompassing_region_)) {
-            coverage_.insert(std::cbegin(coverage_), left_overhang_size(region, encompassing_region_), 0);
-            region_change = true;
-        }
-        if (ends_before(encompassing_region_, region)) {
-            coverage_.insert(std::cend(coverage_), right_overhang_size(region, encompassing_region_), 0);
-            region_change = true;
+    if (is_materialised_) return;
+    // Regions are usually added in sorted order, so sorting is usually linear
+    detail::sort_unsorted_tail(begins_, num_sorted_);
+    detail::sort_unsorted_tail(ends_, num_sorted_);
+    num_sorted_ = begins_.size();
+    runs_.clear();
+    std::size_t depth {0};
+    auto begin_itr = std::cbegin(begins_);
+    auto end_itr = std::cbegin(ends_);
+    while (end_itr != std::cend(ends_)) {
+        const auto position = begin_itr != std::cend(begins_) ? std::min(*begin_itr, *end_itr) : *end_itr;
+        for (; begin_itr != std::cend(begins_) && *begin_itr == position; ++begin_itr) ++depth;
+        for (; end_itr != std::cend(ends_) && *end_itr == position; ++end_itr) --depth;
+        if (check_overflow_ && depth > static_cast<std::size_t>(std::numeric_limits<DepthType>::max())) {
+            throw std::runtime_error {"CoverageTracker::add failed due to depth overflow"};
         }
-        if (region_change) {
-            encompassing_region_ = octopus::encompassing_region(encompassing_region_, region);
+        if (runs_.empty() || runs_.back().depth != static_cast<DepthType>(depth)) {
+            runs_.push_back({position, static_cast<DepthType>(depth)});
         }
-        const auto first = std::next(std::begin(coverage_), begin_distance(encompassing_region_, region));
-        assert(first < std::end(coverage_));
-        assert(std::next(first, size(region)) <= std::end(coverage_));
-        const auto last = std::next(first, size(region));
-        if (check_overflow_) {
-            if (std::find(first, last, std::numeric_limits<DepthType>::max()) != last) {
-                throw std::runtime_error {"CoverageTracker::add failed due to depth overflow"};
-            }
-        }
-        std::transform(first, last, first, [] (auto count) noexcept { return count + 1; });
     }
-    ++num_tracked_;
+    is_materialised_ = true;
 }
 
 template <typename Region, typename T>
-typename CoverageTracker<Region, T>::IteratorPair CoverageTracker<Region, T>::range(const Region& region) const
+std::pair<typename Region::Position, typename Region::Position>
+CoverageTracker<Region, T>::overlap_range(const Region& region) const
 {
-    if (coverage_.empty() || !overlaps(region, encompassing_region_)) {
-        return {std::end(coverage_), std::end(coverage_)};
-    }
-    auto range_start_itr = std::begin(coverage_);
-    if (begins_before(encompassing_region_, region)) {
-        std::advance(range_start_itr, begin_distance(encompassing_region_, region));
+    if (is_empty() || octopus::is_empty(region) || !detail::is_same_contig_helper(region, first_region_)) {
+        return {0, 0};
     }
-    return {range_start_itr, std::next(range_start_itr, overlap_size(region, encompassing_region_))};
+    return {std::max(region.begin(), min_begin_), std::min(region.end(), max_end_)};
 }
 
 } // namespace octopus
@@ -10,6 +10,9 @@
 #include <utility>
 #include <cassert>
 #include <iostream>
+#include <numeric>
+#include <future>
+#include <cmath>
 
 #include "mappable_algorithms.hpp"
 #include "maths.hpp"
@@ -18,58 +21,86 @@
 #include "read_stats.hpp"
 #include "coverage_tracker.hpp"
 #include "sequence_utils.hpp"
+#include "thread_pool.hpp"
 
 namespace octopus {
 
 namespace {
 
-auto draw_sample(const InputRegionMap& regions, std::discrete_distribution<>& contig_sampling_distribution)
+// Each sample has its own generator so samples can be profiled concurrently and reproducibly
+using SamplingGenerator = std::mt19937;
+
+auto draw_sample(const InputRegionMap& regions, std::discrete_distribution<>& contig_sampling_distribution,
+                 SamplingGenerator& generator)
 {
-    static std::mt19937 generator {42};
     return std::next(std::cbegin(regions), contig_sampling_distribution(generator));
 }
 
-auto choose_sample_window(const GenomicRegion& target)
+auto choose_sample_window(const GenomicRegion& target, SamplingGenerator& generator)
 {
-    static std::mt19937 generator {42};
     std::uniform_int_distribution<GenomicRegion::Position> dist {target.begin(), target.end()};
     return GenomicRegion {target.contig_name(), dist(generator), target.end()};
 }
 
-auto choose_sample_region(const SampleName& sample, const InputRegionMap::mapped_type& regions)
+auto choose_sample_region(const SampleName& sample, const InputRegionMap::mapped_type& regions,
+                          SamplingGenerator& generator)
 {
     assert(!regions.empty());
-    return choose_sample_window(*random_select(std::cbegin(regions), std::cend(regions)));
+    return choose_sample_window(*random_select(std::cbegin(regions), std::cend(regions), generator), generator);
 }
 
 auto choose_sample_region(const SampleName& sample, const InputRegionMap& regions,
-                          std::discrete_distribution<>& contig_sampling_distribution)
+                          std::discrete_distribution<>& contig_sampling_distribution,
+                          SamplingGenerator& generator)
 {
-    return choose_sample_region(sample, draw_sample(regions, contig_sampling_distribution)->second);
+    return choose_sample_region(sample, draw_sample(regions, contig_sampling_distribution, generator)->second, generator);
 }
 
 struct SamplingSummary
 {
     InputRegionMap sampled_regions;
     std::size_t num_samples;
+    std::size_t num_sampled_positions = 0, total_sampled_depth = 0;
+    double last_checked_mean_depth = 0;
 };
 
+double mean_depth(const SamplingSummary& summary) noexcept
+{
+    return summary.num_sampled_positions > 0 ? static_cast<double>(summary.total_sampled_depth) / summary.num_sampled_positions : 0.0;
+}
+
+// Once every contig has its minimum draws, further draws only refine the depth estimate, so stop
+// when the mean depth has not changed much over the last few draws
+bool has_converged(SamplingSummary& summary, const std::size_t num_required_draws, const ReadSetProfileConfig& config)
+{
+    if (!config.depth_convergence_tolerance || summary.num_samples < num_required_draws) return false;
+    if (summary.num_samples % config.convergence_check_draws != 0) return false;
+    const auto depth = mean_depth(summary);
+    const auto change = std::abs(depth - summary.last_checked_mean_depth);
+    const bool result {summary.last_checked_mean_depth > 0 && change <= *config.depth_convergence_tolerance * summary.last_checked_mean_depth};
+    summary.last_checked_mean_depth = depth;
+    return result;
+}
+
 boost::optional<GenomicRegion>
 choose_next_sample_region(const SampleName& sample,
                           const InputRegionMap& regions,
                           const ReadSetProfileConfig& config,
                           std::discrete_distribution<>& contig_sampling_distribution,
-                          SamplingSummary& sampling_summary)
+                          SamplingSummary& sampling_summary,
+                          SamplingGenerator& generator)
 {
-    if (!regions.empty() && sampling_summary.num_samples < std::max(config.max_draws_per_sample, regions.size() * config.min_draws_per_contig)) {
+    const auto num_required_draws = regions.size() * config.min_draws_per_contig;
+    if (!regions.empty() && sampling_summary.num_samples < std::max(config.max_draws_per_sample, num_required_draws)
+        && !has_converged(sampling_summary, num_required_draws, config)) {
         for (const auto& p : regions) {
             if (!p.second.empty() && sampling_summary.sampled_regions[p.first].size() < config.min_draws_per_contig) {
-                auto sample_region = choose_sample_region(sample, p.second);
+                auto sample_region = choose_sample_region(sample, p.second, generator);
                 sampling_summary.sampled_regions[sample_region.contig_name()].insert(sample_region);
                 return sample_region;
             }
         }
-        return choose_sample_region(sample, regions, contig_sampling_distribution);
+        return choose_sample_region(sample, regions, contig_sampling_distribution, generator);
     } else {
         return boost::none;
     }
@@ -179,6 +210,131 @@ void erase_non_dna_or_rna_positions(std::vector<DepthType>& depths,
     depths.erase(std::remove_if(std::begin(depths), std::end(depths), not_dna_or_rna), std::end(depths));
 }
 
+template <typename DepthType>
+struct SampleReadsProfile
+{
+    std::deque<MemoryFootprint> memory_footprints = {}, fragmented_memory_footprints = {};
+    std::unordered_map<GenomicRegion::ContigName, std::vector<DepthType>> contig_depths = {};
+    std::deque<unsigned> read_lengths = {};
+    std::deque<AlignedRead::MappingQuality> mapping_qualities = {};
+    ReadSetProfile::GenomeContigDepthStatsPair depth_stats = {};
+};
+
+template <typename DepthType>
+SampleReadsProfile<DepthType>
+profile_sample_reads(const SampleName& sample,
+                     const ReferenceGenome& reference,
+                     const InputRegionMap& regions,
+                     const ReadManager& source,
+                     const ReadSetProfileConfig& config,
+                     std::discrete_distribution<> contig_sampling_distribution)
+{
+    SampleReadsProfile<DepthType> result {};
+    std::vector<DepthType> sample_depths {};
+    SamplingSummary sampling_summary {};
+    SamplingGenerator generator {42};
+    auto remaining_sampling_regions = regions;
+    while (true) {
+        const auto target_sampling_region = choose_next_sample_region(sample, remaining_sampling_regions, config, contig_sampling_distribution, sampling_summary, generator);
+        if (!target_sampling_region) break;
+        CoverageTracker<GenomicRegion, DepthType> depth_tracker {true};
+        auto remaining_reads = static_cast<int>(config.target_reads_per_draw);
+        boost::optional<GenomicRegion> critical_region {};
+        const auto read_visitor = [&] (const SampleName& sample, AlignedRead read) {
+            result.read_lengths.push_back(sequence_size(read));
+            result.mapping_qualities.push_back(read.mapping_quality());
+            result.memory_footprints.push_back(footprint(read));
+            if (config.fragment_size) {
+                result.fragmented_memory_footprints.push_back(fragmented_footprint(read, *config.fragment_size));
+            }
+            depth_tracker.add(read);
+            if (!critical_region) {
+                critical_region = mapped_region(read);
+                if (config.min_read_lengths > 1) {
+                    critical_region = expand_rhs(*critical_region, (config.min_read_lengths - 1) * size(*critical_region));
+                }
+            }
+            if (remaining_reads > 0) --remaining_reads;
+            return remaining_reads > 0 || overlaps(read, *critical_region);
+        };
+        source.iterate(sample, *target_sampling_region, read_visitor);
+        auto sampled_region = *target_sampling_region;
+        if (depth_tracker.any()) {
+            auto sampled_reads_region = *depth_tracker.encompassing_region();
+            assert(!result.read_lengths.empty());
+            if (remaining_reads > 0) {
+                sampled_region = *target_sampling_region;
+            } else {
+                assert(!is_before(sampled_reads_region, *target_sampling_region));
+                sampled_region = closed_region(*target_sampling_region, sampled_reads_region);
+                if (size(sampled_region) > result.read_lengths.back()) {
+                    // Ignore the last half read length bases to avoid adding positions undersampled because
+                    // the sampled read limit was hit.
+                    const auto read_length = static_cast<GenomicRegion::Distance>(result.read_lengths.back());
+                    sampled_region = expand_rhs(sampled_region, -read_length / 2);
+                } else {
+                    sampled_region = expand_rhs(head_region(*target_sampling_region), result.read_lengths.back() / 2);
+                }
+            }
+        }
+        auto read_depths = depth_tracker.get(sampled_region);
+        erase_non_dna_or_rna_positions(read_depths, sampled_region, reference);
+        sampling_summary.num_sampled_positions += read_depths.size();
+        sampling_summary.total_sampled_depth += std::accumulate(std::cbegin(read_depths), std::cend(read_depths), std::size_t {0});
+        utils::append(read_depths, result.contig_depths[sampled_region.contig_name()]);
+        utils::append(std::move(read_depths), sample_depths);
+        ++sampling_summary.num_samples;
+        auto removal_region = sampled_region;
+        if (depth_tracker.any()) {
+            removal_region = encompassing_region(removal_region, *depth_tracker.encompassing_region());
+        }
+        cut(removal_region, remaining_sampling_regions.at(sampled_region.contig_name()));
+        if (remaining_sampling_regions.at(sampled_region.contig_name()).empty()) {
+            remaining_sampling_regions.erase(sampled_region.contig_name());
+            contig_sampling_distribution = make_contig_sampling_distribution(remaining_sampling_regions);
+        }
+    }
+    if (!sample_depths.empty()) {
+        std::sort(std::begin(sample_depths), std::end(sample_depths)); // sorting means no copying from stats calculations
+        fill_depth_stats(sample_depths, result.depth_stats.genome);
+        for (auto& p : result.contig_depths) {
+            std::sort(std::begin(p.second), std::end(p.second)); // sorting means no copying from stats calculations
+            result.depth_stats.contig.emplace(p.first, make_depth_stats(p.second));
+        }
+    }
+    return result;
+}
+
+template <typename DepthType>
+std::vector<SampleReadsProfile<DepthType>>
+profile_sample_reads(const std::vector<SampleName>& samples,
+                     const ReferenceGenome& reference,
+                     const InputRegionMap& regions,
+                     const ReadManager& source,
+                     const ReadSetProfileConfig& config)
+{
+    const auto contig_sampling_distribution = make_contig_sampling_distribution(regions);
+    std::vector<SampleReadsProfile<DepthType>> result {};
+    result.reserve(samples.size());
+    const auto num_threads = std::min(static_cast<std::size_t>(config.max_threads), samples.size());
+    if (num_threads > 1) {
+        ThreadPool workers {num_threads};
+        std::vector<std::future<SampleReadsProfile<DepthType>>> futures {};
+        futures.reserve(samples.size());
+        for (const auto& sample : samples) {
+            futures.push_back(workers.push([&] () {
+                return profile_sample_reads<DepthType>(sample, reference, regions, source, config, contig_sampling_distribution);
+            }));
+        }
+        for (auto& f : futures) result.push_back(f.get());
+    } else {
+        for (const auto& sample : samples) {
+            result.push_back(profile_sample_reads<DepthType>(sample, reference, regions, source, config, contig_sampling_distribution));
+        }
+    }
+    return result;
+}
+
 template <typename DepthType>
 boost::optional<ReadSetProfile>
 profile_reads_helper(const std::vector<SampleName>& samples,
@@ -192,87 +348,22 @@ profile_reads_helper(const std::vector<SampleName>& samples,
     std::unordered_map<GenomicRegion::ContigName, std::vector<DepthType>> contig_depths {};
     std::deque<unsigned> read_lengths {};
     std::deque<AlignedRead::MappingQuality> mapping_qualities {};
-    const auto contig_sampling_distribution = make_contig_sampling_distribution(regions);
-    for (const auto& sample : samples) {
-        std::vector<DepthType> sample_depths {};
-        std::unordered_map<GenomicRegion::ContigName, std::vector<DepthType>> sample_contig_depths {};
-        SamplingSummary sampling_summary {};
-        auto remaining_sampling_regions = regions;
-        auto sample_contig_sampling_distribution = contig_sampling_distribution;
-        while (true) {
-            const auto target_sampling_region = choose_next_sample_region(sample, remaining_sampling_regions, config, sample_contig_sampling_distribution, sampling_summary);
-            if (!target_sampling_region) break;
-            CoverageTracker<GenomicRegion, DepthType> depth_tracker {true};
-            auto remaining_reads = static_cast<int>(config.target_reads_per_draw);
-            boost::optional<GenomicRegion> critical_region {};
-            const auto read_visitor = [&] (const SampleName& sample, AlignedRead read) {
-                read_lengths.push_back(sequence_size(read));
-                mapping_qualities.push_back(read.mapping_quality());
-                memory_footprints.push_back(footprint(read));
-                if (config.fragment_size) {
-                    fragmented_memory_footprints.push_back(fragmented_footprint(read, *config.fragment_size));
-                }
-                depth_tracker.add(read);
-                if (!critical_region) {
-                    critical_region = mapped_region(read);
-                    if (config.min_read_lengths > 1) {
-                        critical_region = expand_rhs(*critical_region, (config.min_read_lengths - 1) * size(*critical_region));
-                    }
-                }
-                if (remaining_reads > 0) --remaining_reads;
-                return remaining_reads > 0 || overlaps(read, *critical_region);
-            };
-            source.iterate(sample, *target_sampling_region, read_visitor);
-            auto sampled_region = *target_sampling_region;
-            if (depth_tracker.any()) {
-                auto sampled_reads_region = *depth_tracker.encompassing_region();
-                assert(!read_lengths.empty());
-                if (remaining_reads > 0) {
-                    sampled_region = *target_sampling_region;
-                } else {
-                    assert(!is_before(sampled_reads_region, *target_sampling_region));
-                    sampled_region = closed_region(*target_sampling_region, sampled_reads_region);
-                    if (size(sampled_region) > read_lengths.back()) {
-                        // Ignore the last half read length bases to avoid adding positions undersampled because
-                        // the sampled read limit was hit.
-                        const auto read_length = static_cast<GenomicRegion::Distance>(read_lengths.back());
-                        sampled_region = expand_rhs(sampled_region, -read_length / 2);
-                    } else {
-                        sampled_region = expand_rhs(head_region(*target_sampling_region), read_lengths.back() / 2);
-                    }
-                }
-            }
-            auto read_depths = depth_tracker.get(sampled_region);
-            erase_non_dna_or_rna_positions(read_depths, sampled_region, reference);
-            utils::append(read_depths, sample_contig_depths[sampled_region.contig_name()]);
-            utils::append(std::move(read_depths), sample_depths);
-            ++sampling_summary.num_samples;
-            auto removal_region = sampled_region;
-            if (depth_tracker.any()) {
-                removal_region = encompassing_region(removal_region, *depth_tracker.encompassing_region());
-            }
-            cut(removal_region, remaining_sampling_regions.at(sampled_region.contig_name()));
-            if (remaining_sampling_regions.at(sampled_region.contig_name()).empty()) {
-                remaining_sampling_regions.erase(sampled_region.contig_name());
-                sample_contig_sampling_distribution = make_contig_sampling_distribution(remaining_sampling_regions);
-            }
-        }
-        ReadSetProfile::GenomeContigDepthStatsPair sample_depth_stats {};
-        if (!sample_depths.empty()) {
-            std::sort(std::begin(sample_depths), std::end(sample_depths)); // sorting means no copying from stats calculations
-            fill_depth_stats(sample_depths, sample_depth_stats.genome);
-            sample_depths.clear();
-            sample_depths.shrink_to_fit();
-            for (auto& p : sample_contig_depths) {
-                std::sort(std::begin(p.second), std::end(p.second)); // sorting means no copying from stats calculations
-                sample_depth_stats.contig.emplace(p.first, make_depth_stats(p.second));
-                utils::append(std::move(p.second), contig_depths[p.first]);
-                p.second.clear();
-                p.second.shrink_to_fit();
-            }
+    auto sample_profiles = profile_sample_reads<DepthType>(samples, reference, regions, source, config);
+    for (std::size_t s {0}; s < samples.size(); ++s) {
+        auto& sample_profile = sample_profiles[s];
+        utils::append(std::move(sample_profile.memory_footprints), memory_footprints);
+        utils::append(std::move(sample_profile.fragmented_memory_footprints), fragmented_memory_footprints);
+        utils::append(std::move(sample_profile.read_lengths), read_lengths);
+        utils::append(std::move(sample_profile.mapping_qualities), mapping_qualities);
+        for (auto& p : sample_profile.contig_depths) {
+            utils::append(std::move(p.second), contig_depths[p.first]);
+            p.second.clear();
+            p.second.shrink_to_fit();
         }
-        result.depth_stats.sample.emplace(sample, std::move(sample_depth_stats));
+        result.depth_stats.sample.emplace(samples[s], std::move(sample_profile.depth_stats));
     }
+    sample_profiles.clear();
+    sample_profiles.shrink_to_fit();
     if (memory_footprints.empty()) return boost::none;
     fill_summary_stats(memory_footprints, result.memory_stats);
     if (config.fragment_size) {
@@ -24,6 +24,10 @@ struct ReadSetProfileConfig
     std::size_t min_draws_per_contig = 10;
     boost::optional<AlignedRead::NucleotideSequence::size_type> fragment_size = boost::none;
     unsigned min_read_lengths = 20;
+    // Stop drawing from a sample once the mean depth changes by less than this fraction
+    boost::optional<double> depth_convergence_tolerance = 0.01;
+    std::size_t convergence_check_draws = 25;
+    unsigned max_threads = 1; // samples are profiled concurrently
 };
 
 struct ReadSetProfile
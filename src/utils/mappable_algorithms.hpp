@@ -11,6 +11,7 @@
 #include <stdexcept>
 #include <type_traits>
 #include <limits>
+#include <vector>
 
 #include <boost/iterator/filter_iterator.hpp>
 #include <boost/range/iterator_range_core.hpp>
@@ -392,6 +393,48 @@ auto find_first_after(const Range& mappables, const MappableTp& mappable)
     return find_first_after(std::cbegin(mappables), std::cend(mappables), mappable);
 }
 
+// update_running_max_ends
+
+/**
+ Recomputes max_ends[i] = max(mapped_end(*first), ..., mapped_end(*(first + i))) for i >= first_changed,
+ resizing max_ends to the size of [first, last).
+ 
+ On a ForwardSorted range the running maximum end is non-decreasing, even when the ends themselves are not
+ (i.e. the range is not bidirectionally sorted), so it can be binary searched with find_first_possible_overlapped.
+ */
+template <typename ForwardIt, typename Position>
+void update_running_max_ends(ForwardIt first, ForwardIt last, std::vector<Position>& max_ends,
+                             std::size_t first_changed = 0)
+{
+    if (max_ends.empty()) first_changed = 0;
+    max_ends.resize(std::distance(first, last));
+    if (first_changed >= max_ends.size()) return;
+    std::advance(first, first_changed);
+    for (auto idx = first_changed; first != last; ++first, ++idx) {
+        max_ends[idx] = mapped_end(*first);
+        if (idx > 0) max_ends[idx] = std::max(max_ends[idx - 1], max_ends[idx]);
+    }
+}
+
+// find_first_possible_overlapped
+
+/**
+ Returns the first element in the range [first, last) that could overlap mappable, i.e. the first element
+ whose running maximum end, starting at first_max_end, is not before mapped_begin(mappable) (the equal case
+ being empty regions). No element before it can overlap mappable, however long the elements are.
+ 
+ Requires the range [first, last) is ForwardSorted and first_max_end is the running maximum end of first,
+ as computed by update_running_max_ends.
+ */
+template <typename ForwardIt, typename RandomIt, typename MappableTp>
+ForwardIt find_first_possible_overlapped(ForwardIt first, ForwardIt last, RandomIt first_max_end,
+                                         const MappableTp& mappable)
+{
+    const auto last_max_end = std::next(first_max_end, std::distance(first, last));
+    const auto max_end_itr = std::lower_bound(first_max_end, last_max_end, mapped_begin(mappable));
+    return std::next(first, std::distance(first_max_end, max_end_itr));
+}
+
 // find_next_mutually_exclusive
 
 /**
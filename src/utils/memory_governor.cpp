@@ -0,0 +1,194 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "memory_governor.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <ostream>
+
+namespace octopus {
+
+constexpr std::size_t MemoryGovernor::numStages_;
+
+namespace {
+
+auto index_of(const MemoryGovernor::Stage stage) noexcept
+{
+    return static_cast<std::size_t>(stage);
+}
+
+} // namespace
+
+MemoryGovernor::MemoryGovernor(MemoryFootprint limit)
+: limit_ {limit}
+, used_ {0}
+, peak_ {0}
+, stage_used_ {}
+, stage_peak_ {}
+, mutex_ {}
+, released_ {}
+{}
+
+MemoryFootprint MemoryGovernor::limit() const noexcept
+{
+    return limit_;
+}
+
+MemoryFootprint MemoryGovernor::available() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return used_ < limit_.bytes() ? limit_.bytes() - used_ : 0;
+}
+
+MemoryFootprint MemoryGovernor::usage() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return used_;
+}
+
+MemoryFootprint MemoryGovernor::usage(const Stage stage) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return stage_used_[index_of(stage)];
+}
+
+MemoryFootprint MemoryGovernor::peak_usage() const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return peak_;
+}
+
+MemoryFootprint MemoryGovernor::peak_usage(const Stage stage) const
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    return stage_peak_[index_of(stage)];
+}
+
+MemoryGovernor::Reservation MemoryGovernor::reserve(const Stage stage, const MemoryFootprint footprint)
+{
+    std::unique_lock<std::mutex> lock {mutex_};
+    released_.wait(lock, [&] () { return used_ == 0 || fits(footprint.bytes()); });
+    acquire(stage, footprint.bytes());
+    return {*this, stage, footprint.bytes()};
+}
+
+boost::optional<MemoryGovernor::Reservation> MemoryGovernor::try_reserve(const Stage stage, const MemoryFootprint footprint)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    if (!fits(footprint.bytes())) return boost::none;
+    acquire(stage, footprint.bytes());
+    return Reservation {*this, stage, footprint.bytes()};
+}
+
+MemoryGovernor::Reservation MemoryGovernor::force_reserve(const Stage stage, const MemoryFootprint footprint)
+{
+    std::lock_guard<std::mutex> lock {mutex_};
+    acquire(stage, footprint.bytes());
+    return {*this, stage, footprint.bytes()};
+}
+
+bool MemoryGovernor::fits(const std::size_t bytes) const noexcept
+{
+    return used_ <= limit_.bytes() && bytes <= limit_.bytes() - used_;
+}
+
+void MemoryGovernor::acquire(const Stage stage, const std::size_t bytes) noexcept
+{
+    used_ += bytes;
+    peak_ = std::max(peak_, used_);
+    auto& stage_used = stage_used_[index_of(stage)];
+    stage_used += bytes;
+    stage_peak_[index_of(stage)] = std::max(stage_peak_[index_of(stage)], stage_used);
+}
+
+void MemoryGovernor::release(const Stage stage, const std::size_t bytes) noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock {mutex_};
+        used_ -= bytes;
+        stage_used_[index_of(stage)] -= bytes;
+    }
+    released_.notify_all();
+}
+
+// MemoryGovernor::Reservation
+
+MemoryGovernor::Reservation::Reservation(MemoryGovernor& governor, const MemoryGovernor::Stage stage,
+                                         const std::size_t bytes) noexcept
+: governor_ {std::addressof(governor)}
+, stage_ {stage}
+, bytes_ {bytes}
+{}
+
+MemoryGovernor::Reservation::Reservation(Reservation&& other) noexcept
+: governor_ {other.governor_}
+, stage_ {other.stage_}
+, bytes_ {other.bytes_}
+{
+    other.governor_ = nullptr;
+    other.bytes_ = 0;
+}
+
+MemoryGovernor::Reservation& MemoryGovernor::Reservation::operator=(Reservation&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        governor_ = other.governor_;
+        stage_ = other.stage_;
+        bytes_ = other.bytes_;
+        other.governor_ = nullptr;
+        other.bytes_ = 0;
+    }
+    return *this;
+}
+
+MemoryGovernor::Reservation::~Reservation() noexcept
+{
+    release();
+}
+
+MemoryGovernor::Stage MemoryGovernor::Reservation::stage() const noexcept
+{
+    return stage_;
+}
+
+MemoryFootprint MemoryGovernor::Reservation::footprint() const noexcept
+{
+    return bytes_;
+}
+
+void MemoryGovernor::Reservation::release() noexcept
+{
+    if (governor_) {
+        governor_->release(stage_, bytes_);
+        governor_ = nullptr;
+        bytes_ = 0;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const MemoryGovernor::Stage stage)
+{
+    switch (stage) {
+        case MemoryGovernor::Stage::reads: os << "reads"; break;
+        case MemoryGovernor::Stage::haplotypes: os << "haplotypes"; break;
+        case MemoryGovernor::Stage::likelihoods: os << "likelihoods"; break;
+        case MemoryGovernor::Stage::genotypes: os << "genotypes"; break;
+    }
+    return os;
+}
+
+void print_peak_usage(std::ostream& os, const MemoryGovernor& governor)
+{
+    using Stage = MemoryGovernor::Stage;
+    os << "Peak working memory " << governor.peak_usage() << " of " << governor.limit() << " (";
+    bool first {true};
+    for (auto stage : {Stage::reads, Stage::haplotypes, Stage::likelihoods, Stage::genotypes}) {
+        if (!first) os << ", ";
+        os << stage << ' ' << governor.peak_usage(stage);
+        first = false;
+    }
+    os << ')';
+}
+
+} // namespace octopus
@@ -0,0 +1,107 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef memory_governor_hpp
+#define memory_governor_hpp
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+#include <iosfwd>
+
+#include <boost/optional.hpp>
+
+#include "memory_footprint.hpp"
+
+namespace octopus {
+
+/*
+ Process-wide accountant for the working memory of calling tasks. Tasks reserve an estimate of the
+ memory they need before making large allocations, and the reservation is released when it goes out
+ of scope.
+
+ reserve blocks until the request fits in the remaining budget, so it must not be called while the
+ calling thread holds another reservation. A request larger than the whole budget is granted once
+ nothing else is reserved, so tasks are deferred rather than failed. try_reserve never blocks, and
+ force_reserve accounts for memory that is needed regardless of the budget.
+ */
+class MemoryGovernor
+{
+public:
+    enum class Stage { reads, haplotypes, likelihoods, genotypes };
+
+    class Reservation;
+
+    MemoryGovernor() = delete;
+
+    MemoryGovernor(MemoryFootprint limit);
+
+    MemoryGovernor(const MemoryGovernor&)            = delete;
+    MemoryGovernor& operator=(const MemoryGovernor&) = delete;
+    MemoryGovernor(MemoryGovernor&&)                 = delete;
+    MemoryGovernor& operator=(MemoryGovernor&&)      = delete;
+
+    ~MemoryGovernor() = default;
+
+    MemoryFootprint limit() const noexcept;
+
+    MemoryFootprint available() const;
+    MemoryFootprint usage() const;
+    MemoryFootprint usage(Stage stage) const;
+    MemoryFootprint peak_usage() const;
+    MemoryFootprint peak_usage(Stage stage) const;
+
+    Reservation reserve(Stage stage, MemoryFootprint footprint);
+    boost::optional<Reservation> try_reserve(Stage stage, MemoryFootprint footprint);
+    Reservation force_reserve(Stage stage, MemoryFootprint footprint);
+
+private:
+    static constexpr std::size_t numStages_ {4};
+
+    MemoryFootprint limit_;
+    std::size_t used_, peak_;
+    std::array<std::size_t, numStages_> stage_used_, stage_peak_;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+
+    bool fits(std::size_t bytes) const noexcept;
+    void acquire(Stage stage, std::size_t bytes) noexcept;
+    void release(Stage stage, std::size_t bytes) noexcept;
+};
+
+class MemoryGovernor::Reservation
+{
+public:
+    Reservation() = default;
+
+    Reservation(const Reservation&)            = delete;
+    Reservation& operator=(const Reservation&) = delete;
+    Reservation(Reservation&& other) noexcept;
+    Reservation& operator=(Reservation&& other) noexcept;
+
+    ~Reservation() noexcept;
+
+    MemoryGovernor::Stage stage() const noexcept;
+    MemoryFootprint footprint() const noexcept;
+
+    void release() noexcept;
+
+private:
+    friend MemoryGovernor;
+
+    MemoryGovernor* governor_ = nullptr;
+    MemoryGovernor::Stage stage_ = MemoryGovernor::Stage::reads;
+    std::size_t bytes_ = 0;
+
+    Reservation(MemoryGovernor& governor, MemoryGovernor::Stage stage, std::size_t bytes) noexcept;
+};
+
+std::ostream& operator<<(std::ostream& os, MemoryGovernor::Stage stage);
+
+// Writes the peak usage of each stage
+void print_peak_usage(std::ostream& os, const MemoryGovernor& governor);
+
+} // namespace octopus
+
+#endif
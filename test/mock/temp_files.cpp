@@ -0,0 +1,65 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include "temp_files.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+#include <htslib/sam.h>
+
+namespace octopus { namespace test {
+
+namespace fs = boost::filesystem;
+
+void write_fasta(const fs::path& fasta, const std::vector<std::pair<std::string, std::string>>& contigs)
+{
+    constexpr std::size_t line_length {60};
+    std::ofstream fasta_file {fasta.string(), std::ios::binary};
+    std::ofstream index_file {fasta.string() + ".fai"};
+    std::size_t offset {0};
+    for (const auto& contig : contigs) {
+        const auto header = ">" + contig.first + "\n";
+        fasta_file << header;
+        offset += header.size();
+        index_file << contig.first << '\t' << contig.second.size() << '\t' << offset << '\t'
+                   << line_length << '\t' << line_length + 1 << '\n';
+        for (std::size_t pos {0}; pos < contig.second.size(); pos += line_length) {
+            const auto line = contig.second.substr(pos, line_length);
+            fasta_file << line << '\n';
+            offset += line.size() + 1;
+        }
+    }
+}
+
+void write_bam(const fs::path& bam, const std::string& sam)
+{
+    auto sam_path = bam;
+    sam_path.replace_extension(".sam");
+    write_file(sam_path, sam);
+    {
+        const auto close_file = [] (samFile* file) { sam_close(file); };
+        std::unique_ptr<samFile, decltype(close_file)> in {sam_open(sam_path.c_str(), "r"), close_file};
+        std::unique_ptr<samFile, decltype(close_file)> out {sam_open(bam.c_str(), "wb"), close_file};
+        if (!in || !out) throw std::runtime_error {"write_bam: could not open " + bam.string()};
+        std::unique_ptr<bam_hdr_t, decltype(&bam_hdr_destroy)> header {sam_hdr_read(in.get()), bam_hdr_destroy};
+        if (!header || sam_hdr_write(out.get(), header.get()) < 0) {
+            throw std::runtime_error {"write_bam: bad header for " + bam.string()};
+        }
+        std::unique_ptr<bam1_t, decltype(&bam_destroy1)> record {bam_init1(), bam_destroy1};
+        int status;
+        while ((status = sam_read1(in.get(), header.get(), record.get())) >= 0) {
+            if (sam_write1(out.get(), header.get(), record.get()) < 0) {
+                throw std::runtime_error {"write_bam: could not write " + bam.string()};
+            }
+        }
+        if (status < -1) throw std::runtime_error {"write_bam: bad record for " + bam.string()};
+    }
+    fs::remove(sam_path);
+    if (sam_index_build(bam.c_str(), 0) < 0) {
+        throw std::runtime_error {"write_bam: could not index " + bam.string()};
+    }
+}
+
+} // namespace test
+} // namespace octopus
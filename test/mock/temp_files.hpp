@@ -0,0 +1,53 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#ifndef temp_files_hpp
+#define temp_files_hpp
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+namespace octopus { namespace test {
+
+// A uniquely named directory that is removed, with everything in it, on destruction
+struct TempDirectory
+{
+    boost::filesystem::path path;
+
+    TempDirectory()
+    : path {boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("octopus-test-%%%%-%%%%")}
+    {
+        boost::filesystem::create_directories(path);
+    }
+
+    TempDirectory(const TempDirectory&)            = delete;
+    TempDirectory& operator=(const TempDirectory&) = delete;
+
+    ~TempDirectory()
+    {
+        boost::system::error_code error {};
+        boost::filesystem::remove_all(path, error);
+    }
+};
+
+inline void write_file(const boost::filesystem::path& path, const std::string& contents)
+{
+    std::ofstream file {path.string()};
+    file << contents;
+}
+
+// Writes the contigs, given as name-sequence pairs, to a fasta file with a fasta index
+void write_fasta(const boost::filesystem::path& fasta,
+                 const std::vector<std::pair<std::string, std::string>>& contigs);
+
+// Converts SAM text, which must be coordinate sorted, to an indexed BAM file
+void write_bam(const boost::filesystem::path& bam, const std::string& sam);
+
+} // namespace test
+} // namespace octopus
+
+#endif
@@ -0,0 +1,181 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/read_pileup.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(basics)
+BOOST_AUTO_TEST_SUITE(read_pileup)
+
+namespace {
+
+using BaseObservation = std::pair<char, AlignedRead::BaseQuality>;
+
+AlignedRead make_read(const GenomicRegion::Position begin, const std::string& sequence,
+                      AlignedRead::BaseQualityVector base_qualities, const std::string& cigar)
+{
+    auto parsed_cigar = parse_cigar(cigar);
+    const GenomicRegion region {"1", begin, begin + reference_size(parsed_cigar)};
+    return AlignedRead {"read", region, sequence, std::move(base_qualities), std::move(parsed_cigar),
+                        60, AlignedRead::Flags {}, "", ""};
+}
+
+// Reads without insertions, made of matches and deletions, some only partly overlapping [50, 150)
+std::vector<AlignedRead> make_random_reads(const std::size_t n, std::mt19937& generator)
+{
+    static const std::string bases {"ACGT"};
+    std::uniform_int_distribution<GenomicRegion::Position> begin_dist {20, 160};
+    std::uniform_int_distribution<std::size_t> base_dist {0, 3}, op_size_dist {1, 12}, num_ops_dist {0, 2};
+    std::uniform_int_distribution<unsigned> quality_dist {0, 60};
+    std::vector<AlignedRead> result {};
+    for (std::size_t i {0}; i < n; ++i) {
+        std::string cigar {std::to_string(op_size_dist(generator)) + "M"};
+        for (auto num_ops = num_ops_dist(generator); num_ops > 0; --num_ops) {
+            cigar += std::to_string(op_size_dist(generator)) + "D";
+            cigar += std::to_string(op_size_dist(generator)) + "M";
+        }
+        const auto sequence_size = octopus::sequence_size(parse_cigar(cigar));
+        std::string sequence(sequence_size, 'N');
+        for (auto& base : sequence) base = bases[base_dist(generator)];
+        AlignedRead::BaseQualityVector base_qualities(sequence_size);
+        for (auto& base_quality : base_qualities) base_quality = quality_dist(generator);
+        result.push_back(make_read(begin_dist(generator), sequence, std::move(base_qualities), cigar));
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+ReadPileups make_pileups(const std::vector<AlignedRead>& reads, const ContigRegion& region)
+{
+    ReadPileups::Builder builder {region};
+    for (const auto& read : reads) builder.add(read);
+    return builder.build();
+}
+
+// The per-position slicing used by the old ReadPileup::add
+std::vector<BaseObservation> slice_observations(const std::vector<AlignedRead>& reads, const ContigRegion::Position position,
+                                                unsigned& depth)
+{
+    std::vector<BaseObservation> result {};
+    depth = 0;
+    const GenomicRegion region {"1", position, position + 1};
+    for (const auto& read : reads) {
+        if (!overlaps(read, region)) continue;
+        ++depth;
+        const auto sequence = copy_sequence(read, region);
+        const auto base_qualities = copy_base_qualities(read, region);
+        for (std::size_t i {0}; i < sequence.size(); ++i) {
+            result.emplace_back(sequence[i], base_qualities[i]);
+        }
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+std::vector<BaseObservation> column_observations(const ReadPileups& pileups, const ContigRegion::Position position)
+{
+    const auto column = pileups.column(position);
+    std::vector<BaseObservation> result {};
+    for (std::size_t i {0}; i < column.size; ++i) {
+        result.emplace_back(column.bases[i], column.base_qualities[i]);
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(builder_matches_per_position_slicing_for_reads_without_insertions)
+{
+    std::mt19937 generator {42};
+    const ContigRegion region {50, 150};
+    for (unsigned trial {0}; trial < 20; ++trial) {
+        auto reads = make_random_reads(40, generator);
+        reads.push_back(make_read(100, "A", {30}, "1M"));
+        std::sort(std::begin(reads), std::end(reads));
+        const auto pileups = make_pileups(reads, region);
+        BOOST_CHECK(contig_region(pileups) == region);
+        for (auto position = region.begin(); position < region.end(); ++position) {
+            unsigned expected_depth {};
+            const auto expected = slice_observations(reads, position, expected_depth);
+            BOOST_CHECK_EQUAL(pileups.depth(position), expected_depth);
+            BOOST_CHECK(column_observations(pileups, position) == expected);
+            for (const char base : {'A', 'C', 'G', 'T'}) {
+                const auto expected_count = std::count_if(std::cbegin(expected), std::cend(expected),
+                                                          [=] (const auto& observation) { return observation.first == base; });
+                BOOST_CHECK_EQUAL(pileups.count(position, base), expected_count);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(deleted_positions_count_towards_depth_without_observations)
+{
+    const auto pileups = make_pileups({make_read(10, "ACGT", {10, 20, 30, 40}, "2M3D2M")}, ContigRegion {10, 17});
+    const std::vector<unsigned> expected_sizes {1, 1, 0, 0, 0, 1, 1};
+    for (unsigned i {0}; i < expected_sizes.size(); ++i) {
+        BOOST_CHECK_EQUAL(pileups.depth(10 + i), 1);
+        BOOST_CHECK_EQUAL(pileups.column(10 + i).size, expected_sizes[i]);
+    }
+    BOOST_CHECK(column_observations(pileups, 15) == (std::vector<BaseObservation> {{'G', 30}}));
+}
+
+BOOST_AUTO_TEST_CASE(inserted_bases_are_observed_at_the_next_position)
+{
+    // Consecutive insertion operations form one insertion, which is observed at the following
+    // reference position together with the base there, every base as an insertion_base
+    const auto pileups = make_pileups({make_read(10, "ACGTTAC", {1, 2, 3, 4, 5, 6, 7}, "2M2I1I2M")}, ContigRegion {10, 14});
+    const auto insertion = ReadPileups::insertion_base;
+    BOOST_CHECK(column_observations(pileups, 11) == (std::vector<BaseObservation> {{'C', 2}}));
+    BOOST_CHECK(column_observations(pileups, 12) == (std::vector<BaseObservation> {{insertion, 3}, {insertion, 4}, {insertion, 5}, {insertion, 6}}));
+    BOOST_CHECK(column_observations(pileups, 13) == (std::vector<BaseObservation> {{'C', 7}}));
+    BOOST_CHECK_EQUAL(pileups.count(12, insertion), 4);
+    for (ContigRegion::Position position {10}; position < 14; ++position) {
+        BOOST_CHECK_EQUAL(pileups.depth(position), 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(inserted_bases_before_a_deletion_are_observed_at_the_deleted_position)
+{
+    // A single inserted base is still an insertion_base, even though it is the only base observed
+    const auto pileups = make_pileups({make_read(10, "ACGTTA", {1, 2, 3, 4, 5, 6}, "2M1I1D1I2M")}, ContigRegion {10, 15});
+    const auto insertion = ReadPileups::insertion_base;
+    BOOST_CHECK(column_observations(pileups, 12) == (std::vector<BaseObservation> {{insertion, 3}}));
+    BOOST_CHECK(column_observations(pileups, 13) == (std::vector<BaseObservation> {{insertion, 4}, {insertion, 5}}));
+    BOOST_CHECK(column_observations(pileups, 14) == (std::vector<BaseObservation> {{'A', 6}}));
+    // Every read base is observed exactly once
+    std::size_t num_observations {0};
+    for (ContigRegion::Position position {10}; position < 15; ++position) {
+        num_observations += pileups.column(position).size;
+        BOOST_CHECK_EQUAL(pileups.depth(position), 1);
+    }
+    BOOST_CHECK_EQUAL(num_observations, 6);
+}
+
+BOOST_AUTO_TEST_CASE(reads_outside_the_region_are_ignored)
+{
+    const auto pileups = make_pileups({make_read(0, "ACGT", {1, 2, 3, 4}, "4M"), make_read(20, "ACGT", {1, 2, 3, 4}, "4M")}, ContigRegion {10, 20});
+    for (ContigRegion::Position position {10}; position < 20; ++position) {
+        BOOST_CHECK_EQUAL(pileups.depth(position), 0);
+        BOOST_CHECK_EQUAL(pileups.column(position).size, 0);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
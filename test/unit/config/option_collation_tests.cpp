@@ -0,0 +1,69 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "config/option_parser.hpp"
+#include "config/option_collation.hpp"
+#include "utils/memory_footprint.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(config)
+BOOST_AUTO_TEST_SUITE(option_collation)
+
+namespace {
+
+options::OptionMap parse(std::vector<std::string> args)
+{
+    args.insert(std::cbegin(args), {"octopus", "--reference", "reference.fa", "--reads", "reads.bam"});
+    std::vector<const char*> argv {};
+    for (const auto& arg : args) argv.push_back(arg.c_str());
+    argv.push_back(nullptr);
+    return options::parse_options(static_cast<int>(args.size()), argv.data());
+}
+
+std::size_t bytes(const std::string& footprint)
+{
+    return parse_footprint(footprint)->bytes();
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(thread_working_memory_is_unset_without_a_target)
+{
+    BOOST_CHECK(!options::get_target_thread_working_memory(parse({})));
+    BOOST_CHECK(!options::get_target_thread_working_memory(parse({"--threads", "4"})));
+}
+
+BOOST_AUTO_TEST_CASE(thread_working_memory_is_an_equal_share_of_the_target)
+{
+    const auto single = options::get_target_thread_working_memory(parse({"--target-working-memory", "8G"}));
+    BOOST_REQUIRE(single);
+    BOOST_CHECK_EQUAL(single->bytes(), bytes("8G"));
+    const auto shared = options::get_target_thread_working_memory(parse({"--target-working-memory", "8G", "--threads", "4"}));
+    BOOST_REQUIRE(shared);
+    BOOST_CHECK_EQUAL(shared->bytes(), bytes("2G"));
+    const auto automatic = options::get_target_thread_working_memory(parse({"--target-working-memory", "8G", "--threads", "0"}));
+    BOOST_REQUIRE(automatic);
+    const auto num_cores = std::max(std::thread::hardware_concurrency(), 1u);
+    BOOST_CHECK_EQUAL(automatic->bytes(), std::max(bytes("8G") / num_cores, bytes("100M")));
+}
+
+BOOST_AUTO_TEST_CASE(thread_working_memory_has_a_minimum)
+{
+    const auto result = options::get_target_thread_working_memory(parse({"--target-working-memory", "1G", "--threads", "64"}));
+    BOOST_REQUIRE(result);
+    BOOST_CHECK_EQUAL(result->bytes(), bytes("100M"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -6,17 +6,81 @@
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <random>
 
 #include "basics/contig_region.hpp"
 #include "containers/mappable_flat_set.hpp"
+#include "containers/mappable_flat_multi_set.hpp"
 
 namespace octopus { namespace test {
 
 using octopus::MappableFlatSet;
+using octopus::MappableFlatMultiSet;
 
 BOOST_AUTO_TEST_SUITE(containers)
 BOOST_AUTO_TEST_SUITE(mappable_flat_set)
 
+namespace {
+
+template <typename Set>
+void check_queries_match_brute_force(const Set& set, const ContigRegion& query)
+{
+    std::vector<ContigRegion> overlapped {}, contained {};
+    std::copy_if(std::cbegin(set), std::cend(set), std::back_inserter(overlapped),
+                 [&] (const auto& element) { return overlaps(element, query); });
+    std::copy_if(std::cbegin(set), std::cend(set), std::back_inserter(contained),
+                 [&] (const auto& element) { return contains(query, element); });
+    const auto overlap_range = set.overlap_range(query);
+    BOOST_CHECK((std::vector<ContigRegion> {std::cbegin(overlap_range), std::cend(overlap_range)} == overlapped));
+    const auto contained_range = set.contained_range(query);
+    BOOST_CHECK((std::vector<ContigRegion> {std::cbegin(contained_range), std::cend(contained_range)} == contained));
+    BOOST_CHECK_EQUAL(set.count_overlapped(query), overlapped.size());
+    BOOST_CHECK_EQUAL(set.has_overlapped(query), !overlapped.empty());
+}
+
+template <typename Set>
+void check_all_queries_match_brute_force(const Set& set)
+{
+    for (ContigRegion::Position begin {0}; begin <= 1050; begin += 7) {
+        for (ContigRegion::Position size : {0, 1, 5, 30}) {
+            check_queries_match_brute_force(set, ContigRegion {begin, begin + size});
+        }
+    }
+}
+
+// Many short elements with one very long one, so the elements are not bidirectionally sorted
+template <typename Set>
+void check_long_element_queries_match_brute_force()
+{
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<ContigRegion::Position> begin_dist {0, 1000}, size_dist {0, 10};
+    Set set {};
+    for (unsigned i {0}; i < 200; ++i) {
+        const auto begin = begin_dist(generator);
+        set.emplace(begin, begin + size_dist(generator));
+    }
+    const ContigRegion long_element {100, 900};
+    set.insert(long_element);
+    BOOST_REQUIRE(!is_bidirectionally_sorted(set));
+    check_all_queries_match_brute_force(set);
+    // Inserts and erases before and after the long element update the index
+    set.emplace(50, 60);
+    set.emplace(500, 505);
+    set.emplace(950, 1040);
+    set.insert(ContigRegion {20, 980});
+    check_all_queries_match_brute_force(set);
+    set.erase(long_element);
+    check_all_queries_match_brute_force(set);
+    set.erase(std::cbegin(set), std::next(std::cbegin(set), 10));
+    check_all_queries_match_brute_force(set);
+    set.erase(ContigRegion {20, 980});
+    check_all_queries_match_brute_force(set);
+    set.erase_overlapped(ContigRegion {400, 600});
+    check_all_queries_match_brute_force(set);
+}
+
+} // namespace
+
 BOOST_AUTO_TEST_CASE(emplace_works)
 {
     MappableFlatSet<ContigRegion> set {};
@@ -291,6 +355,12 @@ BOOST_AUTO_TEST_CASE(erase_all_only_erases_given_elements_and_maintains_order)
     BOOST_CHECK(std::is_sorted(std::cbegin(set), std::cend(set)));
 }
 
+BOOST_AUTO_TEST_CASE(overlap_queries_find_long_elements)
+{
+    check_long_element_queries_match_brute_force<MappableFlatSet<ContigRegion>>();
+    check_long_element_queries_match_brute_force<MappableFlatMultiSet<ContigRegion>>();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,118 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <iterator>
+
+#include "containers/matrix_map.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(containers)
+BOOST_AUTO_TEST_SUITE(matrix_map)
+
+namespace {
+
+using TestMap = MatrixMap<std::string, int, int>;
+
+// Row r, column c has value 10 * r + c
+TestMap make_row_wise(const unsigned num_rows, const unsigned num_cols)
+{
+    std::vector<int> key2s(num_cols);
+    for (unsigned c {0}; c < num_cols; ++c) key2s[c] = c;
+    TestMap result {std::cbegin(key2s), std::cend(key2s)};
+    for (unsigned r {0}; r < num_rows; ++r) {
+        std::vector<int> values(num_cols);
+        for (unsigned c {0}; c < num_cols; ++c) values[c] = 10 * r + c;
+        result.insert_at(std::to_string(r), std::cbegin(values), std::cend(values));
+    }
+    return result;
+}
+
+void check_values(const TestMap& map)
+{
+    for (const auto& row : map) {
+        for (const auto& p : row.second) {
+            BOOST_CHECK_EQUAL(p.second, 10 * std::stoi(row.first) + p.first);
+            BOOST_CHECK_EQUAL(map(row.first, p.first), p.second);
+        }
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(column_wise_insertion_matches_row_wise_insertion)
+{
+    const unsigned num_rows {5}, num_cols {9};
+    auto row_wise = make_row_wise(num_rows, 0);
+    for (unsigned c {0}; c < num_cols; ++c) {
+        std::vector<int> values(num_rows);
+        for (unsigned r {0}; r < num_rows; ++r) values[r] = 10 * r + c;
+        row_wise.insert_each(c, std::cbegin(values), std::cend(values));
+    }
+    const auto expected = make_row_wise(num_rows, num_cols);
+    BOOST_REQUIRE_EQUAL(row_wise.size1(), num_rows);
+    BOOST_REQUIRE_EQUAL(row_wise.size2(), num_cols);
+    for (unsigned r {0}; r < num_rows; ++r) {
+        BOOST_CHECK_EQUAL(row_wise.key1(r), std::to_string(r));
+        for (unsigned c {0}; c < num_cols; ++c) {
+            BOOST_CHECK_EQUAL(row_wise.key2(c), c);
+            BOOST_CHECK_EQUAL(row_wise.value(r, c), expected.value(r, c));
+        }
+    }
+    check_values(row_wise);
+    const auto copy = row_wise;
+    check_values(copy);
+}
+
+BOOST_AUTO_TEST_CASE(iteration_is_in_insertion_order)
+{
+    const auto map = make_row_wise(4, 3);
+    int r {0};
+    for (const auto& row : map) {
+        BOOST_CHECK_EQUAL(row.first, std::to_string(r++));
+        int c {0};
+        for (const auto& p : row.second) {
+            BOOST_CHECK_EQUAL(p.first, c++);
+        }
+        BOOST_CHECK_EQUAL(c, 3);
+    }
+    BOOST_CHECK_EQUAL(r, 4);
+}
+
+BOOST_AUTO_TEST_CASE(erasing_moves_the_last_key_into_the_erased_index)
+{
+    auto map = make_row_wise(4, 5);
+    BOOST_CHECK(map.erase1("1"));
+    BOOST_CHECK(!map.erase1("1"));
+    BOOST_REQUIRE_EQUAL(map.size1(), 3);
+    BOOST_CHECK_EQUAL(map.key1(1), "3");
+    BOOST_CHECK_EQUAL(map.index1("3"), 1);
+    BOOST_CHECK(map.erase2(1));
+    BOOST_CHECK(!map.erase2(1));
+    BOOST_REQUIRE_EQUAL(map.size2(), 4);
+    BOOST_CHECK_EQUAL(map.key2(1), 4);
+    BOOST_CHECK_EQUAL(map.index2(4), 1);
+    check_values(map);
+    BOOST_CHECK(map.erase2(3));
+    BOOST_CHECK(map.erase1("2"));
+    BOOST_CHECK_EQUAL(map.size1(), 2);
+    BOOST_CHECK_EQUAL(map.size2(), 3);
+    check_values(map);
+    map.pop_back();
+    BOOST_CHECK_EQUAL(map.size2(), 2);
+    check_values(map);
+    std::vector<int> values {100, 300};
+    map.insert_each(2, std::cbegin(values), std::cend(values));
+    BOOST_CHECK_EQUAL(map("0", 2), 100);
+    BOOST_CHECK_EQUAL(map("3", 2), 300);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
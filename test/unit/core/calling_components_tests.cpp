@@ -0,0 +1,142 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+
+#include "config/option_parser.hpp"
+#include "core/calling_components.hpp"
+#include "utils/input_reads_profiler.hpp"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(calling_components)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+const std::size_t contig_size {3000}, read_length {100};
+
+std::string make_sequence(const std::size_t length, std::mt19937& generator)
+{
+    static const std::string bases {"ACGT"};
+    std::uniform_int_distribution<std::size_t> dist {0, 3};
+    std::string result(length, 'N');
+    for (auto& base : result) base = bases[dist(generator)];
+    return result;
+}
+
+// Contig 1 is deeply covered by well mapped reads and contig 2 is thinly covered by poorly mapped
+// reads, so the reads profile of any part of the genome differs from the profile of the whole genome
+void write_inputs(const fs::path& fasta, const fs::path& bam)
+{
+    std::mt19937 generator {42};
+    const std::vector<std::pair<std::string, std::string>> contigs {
+        {"1", make_sequence(contig_size, generator)}, {"2", make_sequence(contig_size, generator)}
+    };
+    write_fasta(fasta, contigs);
+    std::ostringstream sam {};
+    sam << "@HD\tVN:1.6\tSO:coordinate\n";
+    for (const auto& contig : contigs) sam << "@SQ\tSN:" << contig.first << "\tLN:" << contig.second.size() << '\n';
+    sam << "@RG\tID:rg1\tSM:sample\n";
+    unsigned read_id {0};
+    for (const auto& contig : contigs) {
+        const bool is_first_contig {contig.first == "1"};
+        const std::size_t step {is_first_contig ? 2u : 25u};
+        const unsigned mapping_quality {is_first_contig ? 60u : 15u};
+        for (std::size_t pos {0}; pos + read_length <= contig.second.size(); pos += step) {
+            sam << "read" << read_id++ << "\t0\t" << contig.first << '\t' << pos + 1 << '\t' << mapping_quality
+                << '\t' << read_length << "M\t*\t0\t0\t" << contig.second.substr(pos, read_length)
+                << '\t' << std::string(read_length, 'I') << "\tRG:Z:rg1\n";
+        }
+    }
+    write_bam(bam, sam.str());
+}
+
+GenomeCallingComponents make_components(const fs::path& fasta, const fs::path& bam, const fs::path& output,
+                                        const std::string& shard = "")
+{
+    std::vector<std::string> args {
+        "octopus", "--reference", fasta.string(), "--reads", bam.string(), "--output", output.string(),
+        "--disable-call-filtering"
+    };
+    if (!shard.empty()) {
+        args.push_back("--shard");
+        args.push_back(shard);
+    }
+    std::vector<const char*> argv {};
+    for (const auto& arg : args) argv.push_back(arg.c_str());
+    argv.push_back(nullptr);
+    const auto options = options::parse_options(static_cast<int>(args.size()), argv.data());
+    return collate_genome_calling_components(options);
+}
+
+template <typename T>
+void check_equal(const ReadSetProfile::SummaryStats<T>& lhs, const ReadSetProfile::SummaryStats<T>& rhs)
+{
+    BOOST_CHECK_EQUAL(lhs.min, rhs.min);
+    BOOST_CHECK_EQUAL(lhs.max, rhs.max);
+    BOOST_CHECK_EQUAL(lhs.mean, rhs.mean);
+    BOOST_CHECK_EQUAL(lhs.median, rhs.median);
+    BOOST_CHECK_EQUAL(lhs.stdev, rhs.stdev);
+}
+
+void check_equal(const ReadSetProfile::DepthStats& lhs, const ReadSetProfile::DepthStats& rhs)
+{
+    BOOST_CHECK(lhs.distribution == rhs.distribution);
+    check_equal(lhs.all, rhs.all);
+    check_equal(lhs.positive, rhs.positive);
+}
+
+void check_equal(const ReadSetProfile& lhs, const ReadSetProfile& rhs)
+{
+    check_equal(lhs.depth_stats.combined.genome, rhs.depth_stats.combined.genome);
+    BOOST_REQUIRE_EQUAL(lhs.depth_stats.combined.contig.size(), rhs.depth_stats.combined.contig.size());
+    for (const auto& p : lhs.depth_stats.combined.contig) {
+        BOOST_REQUIRE_EQUAL(rhs.depth_stats.combined.contig.count(p.first), 1);
+        check_equal(p.second, rhs.depth_stats.combined.contig.at(p.first));
+    }
+    check_equal(lhs.memory_stats, rhs.memory_stats);
+    BOOST_REQUIRE_EQUAL(static_cast<bool>(lhs.fragmented_memory_stats), static_cast<bool>(rhs.fragmented_memory_stats));
+    if (lhs.fragmented_memory_stats) check_equal(*lhs.fragmented_memory_stats, *rhs.fragmented_memory_stats);
+    check_equal(lhs.length_stats, rhs.length_stats);
+    check_equal(lhs.mapping_quality_stats, rhs.mapping_quality_stats);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(shards_use_the_reads_profile_of_an_unsharded_run)
+{
+    const TempDirectory temp {};
+    const auto fasta = temp.path / "reference.fa", bam = temp.path / "reads.bam";
+    write_inputs(fasta, bam);
+    auto unsharded = make_components(fasta, bam, temp.path / "unsharded.vcf");
+    BOOST_REQUIRE(unsharded.reads_profile());
+    BOOST_REQUIRE(!unsharded.shard());
+    for (const std::string shard : {"1/2", "2/2"}) {
+        auto sharded = make_components(fasta, bam, temp.path / ("shard" + shard.substr(0, 1) + ".vcf"), shard);
+        BOOST_REQUIRE(sharded.shard());
+        BOOST_CHECK(sharded.search_regions() != unsharded.search_regions());
+        BOOST_REQUIRE(sharded.reads_profile());
+        check_equal(*sharded.reads_profile(), *unsharded.reads_profile());
+        BOOST_CHECK_EQUAL(sharded.read_buffer_size(), unsharded.read_buffer_size());
+        cleanup(sharded);
+    }
+    cleanup(unsharded);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
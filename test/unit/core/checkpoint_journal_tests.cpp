@@ -0,0 +1,247 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_record.hpp"
+#include "exceptions/error.hpp"
+#include "core/checkpoint_journal.hpp"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(checkpoint_journal)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+const std::size_t inputs_hash {0xc0ffee};
+
+void check_progress(const CheckpointJournal& journal, const std::string& contig,
+                    const fs::path& calls_file, const GenomicRegion::Position end, const std::size_t num_records)
+{
+    const auto progress = journal.progress(contig);
+    BOOST_REQUIRE(progress.calls_file);
+    BOOST_CHECK_EQUAL(*progress.calls_file, calls_file);
+    BOOST_CHECK_EQUAL(progress.end, end);
+    BOOST_CHECK_EQUAL(progress.num_records, num_records);
+}
+
+// Two contigs, with two windows recorded on contig 1 and one on contig 2
+void record_windows(const fs::path& directory)
+{
+    CheckpointJournal journal {directory, inputs_hash, CheckpointJournal::Mode::create};
+    journal.record_calls_file("1", directory / "1.bcf");
+    journal.record_window(GenomicRegion {"1", 0, 100}, 3);
+    journal.record_calls_file("2", directory / "2.bcf");
+    journal.record_window(GenomicRegion {"1", 100, 250}, 2);
+    journal.record_window(GenomicRegion {"2", 0, 50}, 0);
+}
+
+std::string make_calls(const unsigned num_records)
+{
+    std::ostringstream ss {};
+    ss << "##fileformat=VCFv4.3\n##contig=<ID=1,length=1000>\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+    for (unsigned i {1}; i <= num_records; ++i) {
+        ss << "1\t" << 10 * i << "\t.\tA\tC\t50\tPASS\t.\n";
+    }
+    return ss.str();
+}
+
+std::vector<GenomicRegion::Position> read_positions(const fs::path& calls_file)
+{
+    const VcfReader reader {calls_file};
+    std::vector<GenomicRegion::Position> result {};
+    for (const auto& record : reader.fetch_records()) result.push_back(record.pos());
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(recorded_windows_are_loaded_on_resume)
+{
+    const TempDirectory temp {};
+    record_windows(temp.path);
+    const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    BOOST_CHECK(journal.is_resumed());
+    check_progress(journal, "1", temp.path / "1.bcf", 250, 5);
+    check_progress(journal, "2", temp.path / "2.bcf", 50, 0);
+    const auto unrecorded = journal.progress("3");
+    BOOST_CHECK(!unrecorded.calls_file);
+    BOOST_CHECK_EQUAL(unrecorded.end, 0);
+    BOOST_CHECK_EQUAL(unrecorded.num_records, 0);
+}
+
+BOOST_AUTO_TEST_CASE(a_resumed_journal_can_be_resumed_again)
+{
+    const TempDirectory temp {};
+    record_windows(temp.path);
+    {
+        CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+        journal.record_window(GenomicRegion {"1", 250, 400}, 4);
+    }
+    const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    check_progress(journal, "1", temp.path / "1.bcf", 400, 9);
+    check_progress(journal, "2", temp.path / "2.bcf", 50, 0);
+}
+
+BOOST_AUTO_TEST_CASE(creating_a_journal_discards_recorded_windows)
+{
+    const TempDirectory temp {};
+    record_windows(temp.path);
+    {
+        const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::create};
+        BOOST_CHECK(!journal.is_resumed());
+        BOOST_CHECK(!journal.progress("1").calls_file);
+    }
+    const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    BOOST_CHECK(!journal.progress("1").calls_file);
+}
+
+BOOST_AUTO_TEST_CASE(resuming_without_a_journal_starts_from_the_beginning)
+{
+    const TempDirectory temp {};
+    const CheckpointJournal journal {temp.path / "checkpoint", inputs_hash, CheckpointJournal::Mode::resume};
+    BOOST_CHECK(!journal.is_resumed());
+    BOOST_CHECK(!journal.progress("1").calls_file);
+    BOOST_CHECK(fs::exists(temp.path / "checkpoint" / "journal"));
+}
+
+BOOST_AUTO_TEST_CASE(resuming_with_different_inputs_is_rejected)
+{
+    const TempDirectory temp {};
+    record_windows(temp.path);
+    BOOST_CHECK_THROW((CheckpointJournal {temp.path, inputs_hash + 1, CheckpointJournal::Mode::resume}), Error);
+    // The journal is left for a resume with the original inputs
+    const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    check_progress(journal, "1", temp.path / "1.bcf", 250, 5);
+}
+
+BOOST_AUTO_TEST_CASE(malformed_journals_are_rejected)
+{
+    const TempDirectory temp {};
+    const auto journal_path = temp.path / "journal";
+    std::ostringstream header {};
+    header << "octopus-checkpoint\t1\t" << std::hex << inputs_hash << '\n';
+    for (const std::string contents : {std::string {}, std::string {"not a journal\n"},
+                                       header.str() + "window\t1\t0\tzero\t1\n", header.str() + "unknown\n"}) {
+        write_file(journal_path, contents);
+        BOOST_CHECK_THROW((CheckpointJournal {temp.path, inputs_hash, CheckpointJournal::Mode::resume}), Error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(an_interrupted_journal_resumes_from_the_last_complete_window)
+{
+    const TempDirectory temp {};
+    record_windows(temp.path);
+    {
+        std::ofstream journal {(temp.path / "journal").string(), std::ios::app};
+        journal << "window\t1\t250\t400\t1"; // no newline
+    }
+    const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    check_progress(journal, "1", temp.path / "1.bcf", 250, 5);
+}
+
+BOOST_AUTO_TEST_CASE(windows_without_a_calls_file_are_dropped)
+{
+    const TempDirectory temp {};
+    {
+        CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::create};
+        journal.record_window(GenomicRegion {"1", 0, 100}, 3);
+    }
+    const CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    BOOST_CHECK_EQUAL(journal.progress("1").end, 0);
+}
+
+BOOST_AUTO_TEST_CASE(clear_removes_the_journal_and_calls_files)
+{
+    const TempDirectory temp {};
+    record_windows(temp.path);
+    write_file(temp.path / "1.bcf", "calls");
+    write_file(temp.path / "1.bcf.csi", "index");
+    write_file(temp.path / "other", "other");
+    CheckpointJournal journal {temp.path, inputs_hash, CheckpointJournal::Mode::resume};
+    journal.clear();
+    BOOST_CHECK(!fs::exists(temp.path / "journal"));
+    BOOST_CHECK(!fs::exists(temp.path / "1.bcf"));
+    BOOST_CHECK(!fs::exists(temp.path / "1.bcf.csi"));
+    BOOST_CHECK(fs::exists(temp.path / "other"));
+    BOOST_CHECK(!journal.progress("1").calls_file);
+}
+
+BOOST_AUTO_TEST_CASE(remove_recorded_windows_keeps_regions_after_the_last_recorded_window)
+{
+    const InputRegionMap::mapped_type regions {
+        GenomicRegion {"1", 0, 100}, GenomicRegion {"1", 150, 300}, GenomicRegion {"1", 400, 500}
+    };
+    CheckpointJournal::ContigProgress progress {};
+    auto remaining = regions;
+    remove_recorded_windows(remaining, progress);
+    BOOST_CHECK(remaining == regions);
+    progress.end = 200;
+    remove_recorded_windows(remaining, progress);
+    BOOST_CHECK((remaining == InputRegionMap::mapped_type {GenomicRegion {"1", 200, 300}, GenomicRegion {"1", 400, 500}}));
+    progress.end = 300;
+    remaining = regions;
+    remove_recorded_windows(remaining, progress);
+    BOOST_CHECK((remaining == InputRegionMap::mapped_type {GenomicRegion {"1", 400, 500}}));
+    progress.end = 500;
+    remaining = regions;
+    remove_recorded_windows(remaining, progress);
+    BOOST_CHECK(remaining.empty());
+}
+
+BOOST_AUTO_TEST_CASE(restore_temp_output_file_truncates_to_the_recorded_records)
+{
+    const TempDirectory temp {};
+    const auto calls_file = temp.path / "calls.vcf";
+    write_file(calls_file, make_calls(5));
+    auto writer = restore_temp_output_file(calls_file, 3);
+    BOOST_CHECK(!writer.is_open());
+    BOOST_CHECK(!fs::exists(temp.path / "calls.vcf.old"));
+    BOOST_CHECK((read_positions(calls_file) == std::vector<GenomicRegion::Position> {10, 20, 30}));
+    // Restoring all records keeps them all
+    restore_temp_output_file(calls_file, 3);
+    BOOST_CHECK_EQUAL(read_positions(calls_file).size(), 3);
+    restore_temp_output_file(calls_file, 0);
+    BOOST_CHECK(read_positions(calls_file).empty());
+}
+
+BOOST_AUTO_TEST_CASE(restore_temp_output_file_resumes_an_interrupted_restore)
+{
+    const TempDirectory temp {};
+    const auto calls_file = temp.path / "calls.vcf";
+    // The calls file was moved aside and partly rewritten before the interruption
+    write_file(temp.path / "calls.vcf.old", make_calls(5));
+    write_file(calls_file, make_calls(1));
+    restore_temp_output_file(calls_file, 4);
+    BOOST_CHECK(!fs::exists(temp.path / "calls.vcf.old"));
+    BOOST_CHECK_EQUAL(read_positions(calls_file).size(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(restore_temp_output_file_throws_when_records_are_missing)
+{
+    const TempDirectory temp {};
+    const auto calls_file = temp.path / "calls.vcf";
+    BOOST_CHECK_THROW(restore_temp_output_file(calls_file, 0), std::runtime_error);
+    write_file(calls_file, make_calls(2));
+    BOOST_CHECK_THROW(restore_temp_output_file(calls_file, 3), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
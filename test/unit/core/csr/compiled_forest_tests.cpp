@@ -0,0 +1,166 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <stdexcept>
+#include <cstddef>
+
+#include <boost/filesystem.hpp>
+
+#include "ranger/ForestClassification.h"
+#include "ranger/ForestProbability.h"
+#include "ranger/CompiledForest.h"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(csr)
+BOOST_AUTO_TEST_SUITE(compiled_forest)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+const std::vector<std::string> variable_names {"x1", "x2", "x3", "category"};
+
+// Rows of the independent variables, in variable_names order. Values are multiples of 0.25, so they
+// are read back exactly from the text data files ranger uses.
+std::vector<std::vector<double>> make_rows(const std::size_t num_rows, std::mt19937& generator)
+{
+    std::uniform_int_distribution<int> value_dist {-40, 40}, category_dist {1, 4};
+    std::vector<std::vector<double>> result(num_rows);
+    for (auto& row : result) {
+        for (std::size_t i {0}; i < 3; ++i) row.push_back(value_dist(generator) / 4.0);
+        row.push_back(category_dist(generator));
+    }
+    return result;
+}
+
+// Three classes depending on all the variables, with some noise
+double classify(const std::vector<double>& row, std::mt19937& generator)
+{
+    std::bernoulli_distribution noise {0.1};
+    if (noise(generator)) return 2;
+    if (row[3] == 2 || row[3] == 4) return row[0] > 2 ? 1 : 2;
+    return row[1] + row[2] > 0 ? 0 : 1;
+}
+
+// ranger expects the dependent variable in prediction data too, although it is not used
+void write_data(const fs::path& path, const std::vector<std::vector<double>>& rows, const std::vector<double>& classes)
+{
+    std::ofstream file {path.string()};
+    for (const auto& name : variable_names) file << name << ' ';
+    file << "y\n";
+    for (std::size_t i {0}; i < rows.size(); ++i) {
+        for (const auto value : rows[i]) file << value << ' ';
+        file << classes[i] << '\n';
+    }
+}
+
+void run_forest(ranger::ForestProbability& forest, const fs::path& data, const fs::path& output_prefix,
+                const std::string& forest_file, const unsigned num_trees)
+{
+    // The dependent variable name is read from the forest file when predicting
+    const auto dependent_variable_name = forest_file.empty() ? "y" : "";
+    forest.initCpp(dependent_variable_name, ranger::MemoryMode::MEM_DOUBLE, data.string(), 0, output_prefix.string(), num_trees, nullptr,
+                   42, 1, forest_file, ranger::ImportanceMode::IMP_NONE, 5, "", {}, "", true, {"category"}, false,
+                   ranger::SplitRule::LOGRANK, "", false, 0, ranger::DEFAULT_ALPHA, ranger::DEFAULT_MINPROP, false,
+                   ranger::PredictionType::RESPONSE, ranger::DEFAULT_NUM_RANDOM_SPLITS, ranger::DEFAULT_MAXDEPTH);
+    forest.run(false, false);
+}
+
+// Trains and saves a probability forest, returning the forest file
+fs::path train_forest(const fs::path& directory, const unsigned num_trees, std::mt19937& generator)
+{
+    const auto rows = make_rows(500, generator);
+    std::vector<double> classes {};
+    for (const auto& row : rows) classes.push_back(classify(row, generator));
+    const auto data = directory / "train.dat";
+    write_data(data, rows, classes);
+    ranger::ForestProbability forest {};
+    run_forest(forest, data, directory / "trained", "", num_trees);
+    forest.saveToFile();
+    return directory / "trained.forest";
+}
+
+void check_predictions_match(const fs::path& forest_file, const std::vector<std::vector<double>>& rows)
+{
+    const auto data = forest_file.parent_path() / "predict.dat";
+    write_data(data, rows, std::vector<double>(rows.size(), 0));
+    ranger::ForestProbability forest {};
+    run_forest(forest, data, forest_file.parent_path() / "predicted", forest_file.string(), 0);
+    const auto& expected = forest.getPredictions().at(0);
+    const ranger::CompiledForestProbability compiled {forest_file.string()};
+    BOOST_REQUIRE_EQUAL(compiled.getNumTrees(), forest.getNumTrees());
+    BOOST_REQUIRE_EQUAL(compiled.getNumIndependentVariables(), variable_names.size());
+    BOOST_REQUIRE(compiled.getClassValues() == forest.getClassValues());
+    std::vector<double> flat_rows {};
+    for (const auto& row : rows) flat_rows.insert(flat_rows.end(), row.cbegin(), row.cend());
+    const auto predictions = compiled.predict(flat_rows);
+    const auto num_classes = compiled.getClassValues().size();
+    BOOST_REQUIRE_EQUAL(predictions.size(), rows.size() * num_classes);
+    BOOST_REQUIRE_EQUAL(expected.size(), rows.size());
+    for (std::size_t row {0}; row < rows.size(); ++row) {
+        BOOST_REQUIRE_EQUAL(expected[row].size(), num_classes);
+        for (std::size_t class_idx {0}; class_idx < num_classes; ++class_idx) {
+            BOOST_CHECK_CLOSE(predictions[row * num_classes + class_idx], expected[row][class_idx], 1e-9);
+        }
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(compiled_forest_predictions_match_ranger)
+{
+    const TempDirectory temp {};
+    std::mt19937 generator {42};
+    const auto forest_file = train_forest(temp.path, 20, generator);
+    // Enough rows for several prediction blocks, with a partial last block
+    check_predictions_match(forest_file, make_rows(101, generator));
+    check_predictions_match(forest_file, make_rows(1, generator));
+}
+
+BOOST_AUTO_TEST_CASE(compiled_forest_class_index_is_the_class_value_position)
+{
+    const TempDirectory temp {};
+    std::mt19937 generator {42};
+    const ranger::CompiledForestProbability compiled {train_forest(temp.path, 1, generator).string()};
+    const auto& class_values = compiled.getClassValues();
+    BOOST_REQUIRE_EQUAL(class_values.size(), 3);
+    for (std::size_t i {0}; i < class_values.size(); ++i) {
+        BOOST_CHECK_EQUAL(compiled.getClassIndex(class_values[i]), i);
+    }
+    BOOST_CHECK_EQUAL(compiled.getClassIndex(7), class_values.size());
+}
+
+BOOST_AUTO_TEST_CASE(compiled_forest_rejects_forests_that_are_not_probability_forests)
+{
+    const TempDirectory temp {};
+    std::mt19937 generator {42};
+    const auto rows = make_rows(50, generator);
+    std::vector<double> classes {};
+    for (const auto& row : rows) classes.push_back(classify(row, generator));
+    write_data(temp.path / "train.dat", rows, classes);
+    ranger::ForestClassification forest {};
+    forest.initCpp("y", ranger::MemoryMode::MEM_DOUBLE, (temp.path / "train.dat").string(), 0, (temp.path / "trained").string(),
+                   1, nullptr, 42, 1, "", ranger::ImportanceMode::IMP_NONE, 1, "", {}, "", true, {}, false,
+                   ranger::SplitRule::LOGRANK, "", false, 0, ranger::DEFAULT_ALPHA, ranger::DEFAULT_MINPROP, false,
+                   ranger::PredictionType::RESPONSE, ranger::DEFAULT_NUM_RANDOM_SPLITS, ranger::DEFAULT_MAXDEPTH);
+    forest.run(false, false);
+    forest.saveToFile();
+    BOOST_CHECK_THROW(ranger::CompiledForestProbability {(temp.path / "trained.forest").string()}, std::runtime_error);
+    BOOST_CHECK_THROW(ranger::CompiledForestProbability {(temp.path / "missing.forest").string()}, std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,169 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+#include "core/models/genotype/best_first_join.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(model)
+BOOST_AUTO_TEST_SUITE(best_first_join)
+
+namespace {
+
+using octopus::model::PrunedJoints;
+using octopus::model::join_best_first;
+
+struct Component
+{
+    std::size_t id;
+    double probability;
+};
+
+struct Joint
+{
+    double log_probability;
+    std::size_t first, second;
+};
+
+bool operator<(const Joint& lhs, const Joint& rhs) noexcept
+{
+    return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+}
+
+bool operator==(const Joint& lhs, const Joint& rhs) noexcept
+{
+    return lhs.first == rhs.first && lhs.second == rhs.second && lhs.log_probability == rhs.log_probability;
+}
+
+std::vector<Component> make_components(const std::size_t n, std::mt19937& generator)
+{
+    std::uniform_real_distribution<double> dist {-30.0, 0.0};
+    std::vector<Component> result(n);
+    for (std::size_t i {0}; i < n; ++i) result[i] = {i, dist(generator)};
+    return result;
+}
+
+// Like the inheritance term of a joint genotype, the penalty is a log probability
+std::vector<double> make_penalties(const std::size_t n1, const std::size_t n2, std::mt19937& generator)
+{
+    std::exponential_distribution<double> dist {0.2};
+    std::vector<double> result(n1 * n2);
+    for (auto& penalty : result) penalty = -dist(generator);
+    return result;
+}
+
+struct JointMaker
+{
+    const std::vector<double>& penalties;
+    std::size_t n2;
+    Joint operator()(const Component& c1, const Component& c2) const
+    {
+        return {c1.probability + c2.probability + penalties[c1.id * n2 + c2.id], c1.id, c2.id};
+    }
+};
+
+std::vector<Joint> join_exhaustively(const std::vector<Component>& first, const std::vector<Component>& second,
+                                     const JointMaker& make_joint)
+{
+    std::vector<Joint> result {};
+    for (const auto& c1 : first) {
+        for (const auto& c2 : second) {
+            result.push_back(make_joint(c1, c2));
+        }
+    }
+    return result;
+}
+
+auto max_log_probability(const std::vector<Joint>& joints)
+{
+    return std::max_element(std::cbegin(joints), std::cend(joints), [] (const auto& lhs, const auto& rhs) {
+        return lhs.log_probability < rhs.log_probability;
+    })->log_probability;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(join_best_first_is_exhaustive_without_a_ratio)
+{
+    std::mt19937 generator {42};
+    for (std::size_t n1 {1}; n1 <= 6; ++n1) {
+        for (std::size_t n2 {1}; n2 <= 6; ++n2) {
+            const auto first = make_components(n1, generator), second = make_components(n2, generator);
+            const auto penalties = make_penalties(n1, n2, generator);
+            const JointMaker make_joint {penalties, n2};
+            auto expected = join_exhaustively(first, second, make_joint);
+            std::vector<Joint> result {};
+            PrunedJoints pruned {};
+            join_best_first(std::cbegin(first), std::cend(first), std::cbegin(second), std::cend(second), make_joint,
+                            -std::numeric_limits<double>::infinity(), result, pruned);
+            BOOST_CHECK_EQUAL(pruned.count, 0);
+            std::sort(std::begin(result), std::end(result));
+            std::sort(std::begin(expected), std::end(expected));
+            BOOST_CHECK(result == expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(join_best_first_keeps_every_joint_within_the_ratio_of_the_best)
+{
+    std::mt19937 generator {7};
+    const double ratio {-10};
+    unsigned num_pruned_trials {0};
+    for (unsigned trial {0}; trial < 100; ++trial) {
+        const std::size_t n1 {1 + trial % 8}, n2 {1 + (trial / 8) % 8};
+        const auto first = make_components(n1, generator), second = make_components(n2, generator);
+        const auto penalties = make_penalties(n1, n2, generator);
+        const JointMaker make_joint {penalties, n2};
+        const auto exhaustive = join_exhaustively(first, second, make_joint);
+        std::vector<Joint> result {};
+        PrunedJoints pruned {};
+        join_best_first(std::cbegin(first), std::cend(first), std::cbegin(second), std::cend(second), make_joint,
+                        ratio, result, pruned);
+        BOOST_REQUIRE(!result.empty());
+        BOOST_CHECK_EQUAL(result.size() + pruned.count, exhaustive.size());
+        if (pruned.count > 0) ++num_pruned_trials;
+        const auto best = max_log_probability(exhaustive);
+        BOOST_CHECK_EQUAL(max_log_probability(result), best);
+        std::sort(std::begin(result), std::end(result));
+        for (const auto& joint : exhaustive) {
+            const auto visited = std::binary_search(std::cbegin(result), std::cend(result), joint);
+            if (joint.log_probability >= best + ratio) {
+                BOOST_CHECK(visited);
+            } else if (!visited) {
+                // The pruned bound covers every joint that was not evaluated
+                BOOST_CHECK_LE(joint.log_probability, pruned.max_log_probability);
+            }
+        }
+    }
+    BOOST_CHECK_GT(num_pruned_trials, 0);
+}
+
+BOOST_AUTO_TEST_CASE(join_best_first_does_nothing_for_empty_ranges)
+{
+    const std::vector<Component> first {{0, -1.0}}, empty {};
+    const std::vector<double> penalties {0.0};
+    std::vector<Joint> result {};
+    PrunedJoints pruned {};
+    join_best_first(std::cbegin(first), std::cend(first), std::cbegin(empty), std::cend(empty), JointMaker {penalties, 0},
+                    -10.0, result, pruned);
+    join_best_first(std::cbegin(empty), std::cend(empty), std::cbegin(first), std::cend(first), JointMaker {penalties, 1},
+                    -10.0, result, pruned);
+    BOOST_CHECK(result.empty());
+    BOOST_CHECK_EQUAL(pruned.count, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
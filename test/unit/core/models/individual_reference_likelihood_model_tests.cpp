@@ -0,0 +1,183 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstddef>
+
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "basics/read_pileup.hpp"
+#include "core/types/allele.hpp"
+#include "core/models/reference/individual_reference_likelihood_model.hpp"
+#include "utils/maths.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(model)
+BOOST_AUTO_TEST_SUITE(individual_reference_likelihood_model)
+
+namespace {
+
+using octopus::model::compute_homozygous_reference_posterior;
+
+const std::string bases {"ACGT"};
+
+AlignedRead make_read(const GenomicRegion::Position begin, const std::string& sequence,
+                      AlignedRead::BaseQualityVector base_qualities, const std::string& cigar)
+{
+    auto parsed_cigar = parse_cigar(cigar);
+    const GenomicRegion region {"1", begin, begin + reference_size(parsed_cigar)};
+    return AlignedRead {"read", region, sequence, std::move(base_qualities), std::move(parsed_cigar),
+                        60, AlignedRead::Flags {}, "", ""};
+}
+
+// Reads over the reference, with errors and deletions, and base qualities from 0 to 60
+std::vector<AlignedRead> make_random_reads(const std::string& reference, const std::size_t n, const double error_rate,
+                                           std::mt19937& generator)
+{
+    std::uniform_int_distribution<GenomicRegion::Position> begin_dist {0, static_cast<GenomicRegion::Position>(reference.size() - 30)};
+    std::uniform_int_distribution<std::size_t> base_dist {0, 3}, op_size_dist {1, 10}, num_ops_dist {0, 1};
+    std::uniform_int_distribution<unsigned> quality_dist {0, 60};
+    std::bernoulli_distribution error_dist {error_rate};
+    std::vector<AlignedRead> result {};
+    for (std::size_t i {0}; i < n; ++i) {
+        const auto begin = begin_dist(generator);
+        std::string cigar {std::to_string(op_size_dist(generator)) + "M"};
+        for (auto num_ops = num_ops_dist(generator); num_ops > 0; --num_ops) {
+            cigar += std::to_string(op_size_dist(generator)) + "D";
+            cigar += std::to_string(op_size_dist(generator)) + "M";
+        }
+        std::string sequence {};
+        auto position = begin;
+        for (const auto& op : parse_cigar(cigar)) {
+            if (advances_sequence(op)) {
+                for (unsigned j {0}; j < op.size(); ++j) {
+                    sequence += error_dist(generator) ? bases[base_dist(generator)] : reference[position + j];
+                }
+            }
+            position += op.size();
+        }
+        AlignedRead::BaseQualityVector base_qualities(sequence.size());
+        for (auto& base_quality : base_qualities) base_quality = quality_dist(generator);
+        result.push_back(make_read(begin, sequence, std::move(base_qualities), cigar));
+    }
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+ReadPileups make_pileups(const std::vector<AlignedRead>& reads, const ContigRegion& region)
+{
+    ReadPileups::Builder builder {region};
+    for (const auto& read : reads) builder.add(read);
+    return builder.build();
+}
+
+// The posterior computed by the individual refcaller before the pileups were columnar
+Phred<double> compute_posterior_from_sliced_qualities(const Allele& allele, const std::vector<AlignedRead>& reads)
+{
+    std::vector<AlignedRead::BaseQuality> reference_qualities {}, non_reference_qualities {};
+    for (auto position = mapped_begin(allele); position < mapped_end(allele); ++position) {
+        const GenomicRegion region {"1", position, position + 1};
+        const std::string reference_sequence(1, allele.sequence()[position - mapped_begin(allele)]);
+        for (const auto& read : reads) {
+            if (!overlaps(read, region)) continue;
+            const auto base_qualities = copy_base_qualities(read, region);
+            auto& qualities = copy_sequence(read, region) == reference_sequence ? reference_qualities : non_reference_qualities;
+            qualities.insert(std::cend(qualities), std::cbegin(base_qualities), std::cend(base_qualities));
+        }
+    }
+    const auto depth = reference_qualities.size() + non_reference_qualities.size();
+    if (depth == 0) return Phred<double> {3.0};
+    for (auto& q : reference_qualities) q = std::max(q, AlignedRead::BaseQuality {1});
+    for (auto& q : non_reference_qualities) q = std::max(q, AlignedRead::BaseQuality {1});
+    std::vector<double> reference_ln_likelihoods(depth), non_reference_ln_likelihoods(depth);
+    const auto phred_to_ln = [] (auto phred) { return phred * -maths::constants::ln10Div10<>; };
+    const auto phred_to_not_ln = [] (auto phred) { return std::log(1.0 - std::pow(10.0, -phred / 10.0)); };
+    auto itr = std::transform(std::cbegin(reference_qualities), std::cend(reference_qualities),
+                              std::begin(reference_ln_likelihoods), phred_to_not_ln);
+    std::transform(std::cbegin(non_reference_qualities), std::cend(non_reference_qualities), itr, phred_to_ln);
+    itr = std::transform(std::cbegin(reference_qualities), std::cend(reference_qualities),
+                         std::begin(non_reference_ln_likelihoods), phred_to_ln);
+    std::transform(std::cbegin(non_reference_qualities), std::cend(non_reference_qualities), itr, phred_to_not_ln);
+    auto hom_ref_ln_likelihood = std::accumulate(std::cbegin(reference_ln_likelihoods), std::cend(reference_ln_likelihoods), 0.0);
+    auto het_alt_ln_likelihood = std::inner_product(std::cbegin(reference_ln_likelihoods), std::cend(reference_ln_likelihoods),
+                                                    std::cbegin(non_reference_ln_likelihoods), 0.0, std::plus<> {},
+                                                    [] (auto ref, auto alt) { return maths::log_sum_exp(ref, alt) - std::log(2); });
+    const auto het_ln_posterior = het_alt_ln_likelihood - maths::log_sum_exp(hom_ref_ln_likelihood, het_alt_ln_likelihood);
+    return log_probability_false_to_phred(het_ln_posterior);
+}
+
+void check_close(const Phred<double> lhs, const Phred<double> rhs)
+{
+    if (std::isinf(lhs.score()) || std::isinf(rhs.score())) {
+        BOOST_CHECK_EQUAL(lhs.score(), rhs.score());
+    } else {
+        BOOST_CHECK_CLOSE(lhs.score(), rhs.score(), 1e-6);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(posterior_matches_the_sliced_base_quality_computation)
+{
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<std::size_t> base_dist {0, 3};
+    std::string reference(200, 'N');
+    for (auto& base : reference) base = bases[base_dist(generator)];
+    const ContigRegion pileup_region {50, 150};
+    for (const double error_rate : {0.0, 0.01, 0.2, 0.5}) {
+        for (const std::size_t num_reads : {1, 10, 100}) {
+            const auto reads = make_random_reads(reference, num_reads, error_rate, generator);
+            const auto pileups = make_pileups(reads, pileup_region);
+            for (const auto allele_size : {1, 2, 5}) {
+                for (auto begin = pileup_region.begin(); begin + allele_size <= pileup_region.end(); begin += 7) {
+                    const Allele allele {GenomicRegion {"1", begin, begin + allele_size}, reference.substr(begin, allele_size)};
+                    check_close(compute_homozygous_reference_posterior(allele, pileups),
+                                compute_posterior_from_sliced_qualities(allele, reads));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(posterior_is_uninformative_without_observations)
+{
+    const std::vector<AlignedRead> reads {make_read(10, "ACGT", {20, 20, 20, 20}, "2M3D2M")};
+    const auto pileups = make_pileups(reads, ContigRegion {0, 20});
+    BOOST_CHECK_EQUAL(compute_homozygous_reference_posterior(Allele {GenomicRegion {"1", 12, 14}, "AA"}, pileups).score(), 3.0);
+    BOOST_CHECK_EQUAL(compute_homozygous_reference_posterior(Allele {GenomicRegion {"1", 0, 5}, "AAAAA"}, pileups).score(), 3.0);
+}
+
+BOOST_AUTO_TEST_CASE(posterior_increases_with_reference_support)
+{
+    std::vector<AlignedRead> reads {};
+    Phred<double> prev_posterior {0.0};
+    for (unsigned depth {1}; depth <= 10; ++depth) {
+        reads.push_back(make_read(10, "ACGT", {30, 30, 30, 30}, "4M"));
+        const auto posterior = compute_homozygous_reference_posterior(Allele {GenomicRegion {"1", 10, 14}, "ACGT"},
+                                                                      make_pileups(reads, ContigRegion {10, 14}));
+        BOOST_CHECK_GT(posterior.score(), prev_posterior.score());
+        prev_posterior = posterior;
+    }
+    reads.push_back(make_read(10, "TTTT", {30, 30, 30, 30}, "4M"));
+    const auto posterior = compute_homozygous_reference_posterior(Allele {GenomicRegion {"1", 10, 14}, "ACGT"},
+                                                                  make_pileups(reads, ContigRegion {10, 14}));
+    BOOST_CHECK_LT(posterior.score(), prev_posterior.score());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
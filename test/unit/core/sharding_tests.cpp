@@ -0,0 +1,237 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "io/reference/reference_genome.hpp"
+#include "io/read/read_manager.hpp"
+#include "io/variant/vcf_header.hpp"
+#include "io/variant/vcf_record.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_writer.hpp"
+#include "core/sharding.hpp"
+#include "mock/mock_reference.hpp"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(core)
+BOOST_AUTO_TEST_SUITE(sharding)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+InputRegionMap make_regions(const std::vector<GenomicRegion>& regions)
+{
+    InputRegionMap result {};
+    for (const auto& region : regions) {
+        result[region.contig_name()].emplace(region);
+    }
+    return result;
+}
+
+VcfRecord make_call(const GenomicRegion::ContigName& contig, const GenomicRegion::Position pos,
+                    std::string ref, std::string alt, std::string id)
+{
+    VcfRecord::Builder builder {};
+    builder.set_chrom(contig).set_pos(pos).set_id(std::move(id)).set_ref(std::move(ref)).set_alt(std::move(alt)).set_passed();
+    return builder.build_once();
+}
+
+// A deletion of the bases [begin, end)
+VcfRecord make_deletion(const GenomicRegion::ContigName& contig, const GenomicRegion::Position begin,
+                        const GenomicRegion::Position end, std::string id)
+{
+    return make_call(contig, begin + 1, std::string(end - begin, 'A'), "A", std::move(id));
+}
+
+// An SNV at the base position
+VcfRecord make_snv(const GenomicRegion::ContigName& contig, const GenomicRegion::Position position, std::string id)
+{
+    return make_call(contig, position + 1, "A", "C", std::move(id));
+}
+
+void write_shard(const fs::path& path, const Shard& shard, const std::vector<VcfRecord>& calls)
+{
+    auto builder = get_default_header_builder();
+    builder.add_contig("1").add_contig("2");
+    add_shard_field(shard, builder);
+    VcfWriter writer {path, builder.build_once()};
+    for (const auto& call : calls) writer << call;
+    writer.close();
+}
+
+std::vector<std::string> merge_ids(const std::vector<fs::path>& shard_paths, const fs::path& merged_path)
+{
+    std::vector<VcfReader> shards {};
+    for (const auto& path : shard_paths) shards.emplace_back(path);
+    VcfWriter merged {merged_path};
+    merge_shards(shards, merged);
+    merged.close();
+    std::vector<std::string> result {};
+    for (const auto& call : VcfReader {merged_path}.fetch_records()) {
+        result.push_back(call.id());
+    }
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(make_shard_splits_the_search_regions_into_adjacent_shards)
+{
+    const ReferenceGenome reference {std::make_unique<mock::MockReference>()};
+    const ReadManager reads {};
+    const auto regions = make_regions({GenomicRegion {"1", 0, 400}, GenomicRegion {"2", 0, 400}});
+    const std::vector<GenomicRegion::ContigName> contigs {"1", "2"};
+    const unsigned num_shards {4};
+    std::vector<Shard> shards {};
+    for (unsigned i {1}; i <= num_shards; ++i) {
+        shards.push_back(make_shard(i, num_shards, regions, contigs, reference, reads));
+    }
+    BOOST_CHECK(!shards.front().begin);
+    BOOST_CHECK(!shards.back().end);
+    for (unsigned i {1}; i < num_shards; ++i) {
+        BOOST_REQUIRE(shards[i - 1].end);
+        BOOST_REQUIRE(shards[i].begin);
+        BOOST_CHECK_EQUAL(shards[i - 1].end->contig, shards[i].begin->contig);
+        BOOST_CHECK_EQUAL(shards[i - 1].end->position, shards[i].begin->position);
+    }
+    // Without reads every base costs the same, up to rounding
+    BOOST_CHECK_EQUAL(shards[1].begin->contig, "1");
+    BOOST_CHECK_CLOSE(static_cast<double>(shards[1].begin->position), 200.0, 1.0);
+    BOOST_CHECK_EQUAL(shards[3].begin->contig, "2");
+    BOOST_CHECK_CLOSE(static_cast<double>(shards[3].begin->position), 200.0, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(make_shard_throws_on_bad_shard_indices)
+{
+    const ReferenceGenome reference {std::make_unique<mock::MockReference>()};
+    const ReadManager reads {};
+    const auto regions = make_regions({GenomicRegion {"1", 0, 400}});
+    const std::vector<GenomicRegion::ContigName> contigs {"1"};
+    BOOST_CHECK_THROW(make_shard(0, 2, regions, contigs, reference, reads), std::invalid_argument);
+    BOOST_CHECK_THROW(make_shard(3, 2, regions, contigs, reference, reads), std::invalid_argument);
+    const auto shard = make_shard(1, 1, regions, contigs, reference, reads);
+    BOOST_CHECK(!shard.begin && !shard.end);
+}
+
+BOOST_AUTO_TEST_CASE(make_shard_cuts_regions_with_no_calling_cost)
+{
+    const ReferenceGenome reference {std::make_unique<mock::MockReference>()};
+    const ReadManager reads {};
+    const std::vector<GenomicRegion::ContigName> contigs {"1", "2"};
+    // Empty regions have no cost, so every boundary falls at the end of the last region
+    const auto empty_regions = make_regions({GenomicRegion {"1", 100, 100}, GenomicRegion {"2", 50, 50}});
+    const unsigned num_shards {3};
+    for (unsigned i {1}; i <= num_shards; ++i) {
+        const auto shard = make_shard(i, num_shards, empty_regions, contigs, reference, reads);
+        BOOST_CHECK_EQUAL(static_cast<bool>(shard.begin), i > 1);
+        BOOST_CHECK_EQUAL(static_cast<bool>(shard.end), i < num_shards);
+        for (const auto& boundary : {shard.begin, shard.end}) {
+            if (boundary) {
+                BOOST_CHECK_EQUAL(boundary->contig, "2");
+                BOOST_CHECK_EQUAL(boundary->position, 50);
+            }
+        }
+    }
+    // Empty regions do not move the boundaries of the regions that have a cost
+    const auto mixed_regions = make_regions({GenomicRegion {"1", 100, 100}, GenomicRegion {"2", 0, 400}});
+    const auto shard = make_shard(1, 2, mixed_regions, contigs, reference, reads);
+    BOOST_REQUIRE(shard.end);
+    BOOST_CHECK_EQUAL(shard.end->contig, "2");
+    BOOST_CHECK_CLOSE(static_cast<double>(shard.end->position), 200.0, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(get_shard_regions_adds_overlap_either_side_of_the_boundaries)
+{
+    const auto regions = make_regions({GenomicRegion {"1", 0, 400}, GenomicRegion {"2", 50, 100},
+                                       GenomicRegion {"2", 300, 400}, GenomicRegion {"3", 0, 100}});
+    const std::vector<GenomicRegion::ContigName> contigs {"1", "2", "3"};
+    Shard shard {2, 3, ShardBoundary {"1", 200}, ShardBoundary {"2", 120}};
+    const auto shard_regions = get_shard_regions(shard, regions, contigs, 30);
+    BOOST_REQUIRE_EQUAL(shard_regions.size(), 2);
+    BOOST_REQUIRE_EQUAL(shard_regions.at("1").size(), 1);
+    BOOST_CHECK_EQUAL(shard_regions.at("1").front(), GenomicRegion("1", 170, 400));
+    BOOST_REQUIRE_EQUAL(shard_regions.at("2").size(), 1);
+    BOOST_CHECK_EQUAL(shard_regions.at("2").front(), GenomicRegion("2", 50, 100));
+
+    // The overlap is clipped to the contig and search regions
+    shard = Shard {1, 3, boost::none, ShardBoundary {"1", 390}};
+    const auto first_shard_regions = get_shard_regions(shard, regions, contigs, 30);
+    BOOST_REQUIRE_EQUAL(first_shard_regions.size(), 1);
+    BOOST_CHECK_EQUAL(first_shard_regions.at("1").front(), GenomicRegion("1", 0, 400));
+    shard = Shard {3, 3, ShardBoundary {"2", 10}, boost::none};
+    const auto last_shard_regions = get_shard_regions(shard, regions, contigs, 30);
+    BOOST_REQUIRE_EQUAL(last_shard_regions.size(), 2);
+    BOOST_CHECK_EQUAL(last_shard_regions.at("2").size(), 2);
+    BOOST_CHECK_EQUAL(last_shard_regions.at("2").front(), GenomicRegion("2", 50, 100));
+    BOOST_CHECK_EQUAL(last_shard_regions.at("3").front(), GenomicRegion("3", 0, 100));
+}
+
+BOOST_AUTO_TEST_CASE(merge_shards_keeps_each_call_once)
+{
+    const TempDirectory temp {};
+    const std::vector<fs::path> shard_paths {temp.path / "shard1.vcf", temp.path / "shard2.vcf"};
+    const ShardBoundary boundary {"1", 280};
+    write_shard(shard_paths[0], Shard {1, 2, boost::none, boundary},
+                {make_snv("1", 50, "a"), make_snv("1", 270, "b"), make_snv("1", 290, "x")});
+    write_shard(shard_paths[1], Shard {2, 2, boundary, boost::none},
+                {make_snv("1", 270, "y"), make_snv("1", 290, "c"), make_snv("2", 10, "d")});
+    const auto ids = merge_ids(shard_paths, temp.path / "merged.vcf");
+    const std::vector<std::string> expected_ids {"a", "b", "c", "d"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(std::cbegin(ids), std::cend(ids), std::cbegin(expected_ids), std::cend(expected_ids));
+}
+
+BOOST_AUTO_TEST_CASE(merge_shards_keeps_calls_inside_calls_that_cross_a_boundary)
+{
+    const TempDirectory temp {};
+    const std::vector<fs::path> shard_paths {temp.path / "shard1.vcf", temp.path / "shard2.vcf"};
+    const ShardBoundary boundary {"1", 280};
+    write_shard(shard_paths[0], Shard {1, 2, boost::none, boundary},
+                {make_snv("1", 50, "a"), make_snv("1", 150, "x"), make_deletion("1", 200, 290, "y")});
+    write_shard(shard_paths[1], Shard {2, 2, boundary, boost::none},
+                {make_snv("1", 20, "z"), make_deletion("1", 100, 300, "b"), make_snv("1", 150, "c"), make_snv("1", 400, "d")});
+    const auto ids = merge_ids(shard_paths, temp.path / "merged.vcf");
+    const std::vector<std::string> expected_ids {"a", "b", "c", "d"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(std::cbegin(ids), std::cend(ids), std::cbegin(expected_ids), std::cend(expected_ids));
+}
+
+BOOST_AUTO_TEST_CASE(merge_shards_keeps_left_shard_calls_when_the_right_shard_has_none_past_the_boundary)
+{
+    const TempDirectory temp {};
+    const std::vector<fs::path> shard_paths {temp.path / "shard1.vcf", temp.path / "shard2.vcf"};
+    const ShardBoundary boundary {"1", 280};
+    write_shard(shard_paths[0], Shard {1, 2, boost::none, boundary},
+                {make_snv("1", 50, "a"), make_deletion("1", 270, 290, "b")});
+    write_shard(shard_paths[1], Shard {2, 2, boundary, boost::none},
+                {make_snv("1", 50, "x"), make_snv("2", 10, "c")});
+    const auto ids = merge_ids(shard_paths, temp.path / "merged.vcf");
+    const std::vector<std::string> expected_ids {"a", "b", "c"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(std::cbegin(ids), std::cend(ids), std::cbegin(expected_ids), std::cend(expected_ids));
+}
+
+BOOST_AUTO_TEST_CASE(merge_shards_throws_if_shards_are_out_of_order)
+{
+    const TempDirectory temp {};
+    const std::vector<fs::path> shard_paths {temp.path / "shard2.vcf", temp.path / "shard1.vcf"};
+    const ShardBoundary boundary {"1", 280};
+    write_shard(shard_paths[1], Shard {1, 2, boost::none, boundary}, {make_snv("1", 50, "a")});
+    write_shard(shard_paths[0], Shard {2, 2, boundary, boost::none}, {make_snv("1", 300, "b")});
+    BOOST_CHECK_THROW(merge_ids(shard_paths, temp.path / "merged.vcf"), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
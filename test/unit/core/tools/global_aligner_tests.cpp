@@ -4,6 +4,10 @@
 #include <boost/test/unit_test.hpp>
 
 #include <string>
+#include <utility>
+#include <random>
+#include <algorithm>
+#include <limits>
 
 #include "core/tools/vargen/utils/global_aligner.hpp"
 
@@ -56,6 +60,235 @@ BOOST_AUTO_TEST_CASE(align_returns_the_optimal_global_alignmenet)
     BOOST_CHECK_EQUAL(alignment.score, 2 * defaultModel.match + defaultModel.gap_open);
 }
 
+namespace {
+
+int score(const std::string& target, const std::string& query, const CigarString& cigar, const coretools::Model& model)
+{
+    int result {0};
+    std::size_t target_idx {0}, query_idx {0};
+    for (const auto& op : cigar) {
+        if (is_match_or_substitution(op)) {
+            for (unsigned n {0}; n < op.size(); ++n, ++target_idx, ++query_idx) {
+                result += target.at(target_idx) == query.at(query_idx) ? model.match : model.mismatch;
+            }
+        } else {
+            result += model.gap_open + static_cast<int>(op.size() - 1) * model.gap_extend;
+            if (is_deletion(op)) {
+                target_idx += op.size();
+            } else {
+                query_idx += op.size();
+            }
+        }
+    }
+    return result;
+}
+
+bool is_valid_alignment(const std::string& target, const std::string& query, const coretools::Alignment& alignment,
+                        const coretools::Model& model)
+{
+    return reference_size<std::size_t>(alignment.cigar) == target.size()
+        && sequence_size<std::size_t>(alignment.cigar) == query.size()
+        && score(target, query, alignment.cigar, model) == alignment.score;
+}
+
+template <typename RandomGenerator>
+std::string random_sequence(const std::size_t length, RandomGenerator& generator)
+{
+    static const std::string bases {"ACGT"};
+    std::uniform_int_distribution<std::size_t> base_dist {0, 3};
+    std::string result(length, 'N');
+    std::generate(std::begin(result), std::end(result), [&] () { return bases[base_dist(generator)]; });
+    return result;
+}
+
+template <typename RandomGenerator>
+std::string mutate(std::string sequence, const unsigned num_mutations, RandomGenerator& generator)
+{
+    std::uniform_int_distribution<int> type_dist {0, 2}, indel_size_dist {1, 5};
+    for (unsigned n {0}; n < num_mutations; ++n) {
+        std::uniform_int_distribution<std::size_t> position_dist {0, sequence.size()};
+        const auto position = position_dist(generator);
+        const auto type = type_dist(generator);
+        if (type == 0 && position < sequence.size()) {
+            sequence[position] = sequence[position] == 'A' ? 'C' : 'A';
+        } else if (type == 1) {
+            sequence.insert(position, random_sequence(indel_size_dist(generator), generator));
+        } else {
+            sequence.erase(position, indel_size_dist(generator));
+        }
+    }
+    return sequence;
+}
+
+// True if the alignment path stays within min_band_size of the diagonals spanned by the length difference
+bool is_inside_band(const CigarString& cigar, const std::string& target, const std::string& query,
+                    const unsigned min_band_size)
+{
+    const auto length_difference = static_cast<int>(query.size()) - static_cast<int>(target.size());
+    const auto min_diagonal = std::min(0, length_difference) - static_cast<int>(min_band_size);
+    const auto max_diagonal = std::max(0, length_difference) + static_cast<int>(min_band_size);
+    int diagonal {0};
+    for (const auto& op : cigar) {
+        if (is_deletion(op)) {
+            diagonal -= static_cast<int>(op.size());
+        } else if (is_insertion(op)) {
+            diagonal += static_cast<int>(op.size());
+        }
+        if (diagonal < min_diagonal || diagonal > max_diagonal) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(banded_align_matches_align_when_the_band_covers_the_matrix)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<std::size_t> length_dist {1, 60};
+    std::uniform_int_distribution<unsigned> num_mutations_dist {0, 6};
+    for (int trial {0}; trial < 500; ++trial) {
+        const auto target = random_sequence(length_dist(generator), generator);
+        auto query = mutate(target, num_mutations_dist(generator), generator);
+        if (query.empty()) query = "A";
+        const auto alignment = align(target, query, defaultModel);
+        BOOST_REQUIRE(is_valid_alignment(target, query, alignment, defaultModel));
+        const auto max_size = static_cast<unsigned>(std::max(target.size(), query.size()));
+        const auto banded_alignment = align(target, query, defaultModel, max_size);
+        BOOST_CHECK(is_valid_alignment(target, query, banded_alignment, defaultModel));
+        BOOST_CHECK_EQUAL(banded_alignment.cigar, alignment.cigar);
+        BOOST_CHECK_EQUAL(banded_alignment.score, alignment.score);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(banded_align_matches_align_when_the_alignment_is_inside_the_band)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    std::mt19937 generator {3};
+    std::uniform_int_distribution<std::size_t> length_dist {1, 100};
+    std::uniform_int_distribution<unsigned> num_mutations_dist {0, 10};
+    unsigned num_inside {0}, num_outside {0};
+    for (int trial {0}; trial < 500; ++trial) {
+        const auto target = random_sequence(length_dist(generator), generator);
+        auto query = mutate(target, num_mutations_dist(generator), generator);
+        if (query.empty()) query = "A";
+        const auto alignment = align(target, query, defaultModel);
+        for (unsigned band_size : {0u, 1u, 3u, 8u}) {
+            const auto banded_alignment = align(target, query, defaultModel, band_size);
+            BOOST_CHECK(is_valid_alignment(target, query, banded_alignment, defaultModel));
+            if (is_inside_band(alignment.cigar, target, query, band_size)) {
+                BOOST_CHECK_EQUAL(banded_alignment.cigar, alignment.cigar);
+                BOOST_CHECK_EQUAL(banded_alignment.score, alignment.score);
+                ++num_inside;
+            } else {
+                BOOST_CHECK_LE(banded_alignment.score, alignment.score);
+                ++num_outside;
+            }
+        }
+    }
+    BOOST_CHECK_GT(num_inside, 0);
+    BOOST_CHECK_GT(num_outside, 0);
+}
+
+BOOST_AUTO_TEST_CASE(banded_align_is_suboptimal_when_the_alignment_does_not_fit_in_the_band)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    std::mt19937 generator {5};
+    // The same length, but the optimal alignment deletes 10 bases at the start and inserts 10 at the end
+    const auto target = random_sequence(80, generator);
+    const auto query = target.substr(10) + random_sequence(10, generator);
+    const auto alignment = align(target, query, defaultModel);
+    BOOST_REQUIRE(!is_inside_band(alignment.cigar, target, query, 2));
+    const auto banded_alignment = align(target, query, defaultModel, 2);
+    BOOST_CHECK(is_valid_alignment(target, query, banded_alignment, defaultModel));
+    BOOST_CHECK_LT(banded_alignment.score, alignment.score);
+    // A band wide enough for the detour finds it
+    const auto wide_alignment = align(target, query, defaultModel, 10);
+    BOOST_CHECK_EQUAL(wide_alignment.cigar, alignment.cigar);
+    BOOST_CHECK_EQUAL(wide_alignment.score, alignment.score);
+}
+
+BOOST_AUTO_TEST_CASE(banded_align_returns_valid_alignments_for_any_band_size)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    std::mt19937 generator {7};
+    std::uniform_int_distribution<std::size_t> length_dist {1, 100};
+    std::uniform_int_distribution<unsigned> num_mutations_dist {0, 10};
+    for (int trial {0}; trial < 500; ++trial) {
+        const auto target = random_sequence(length_dist(generator), generator);
+        auto query = mutate(target, num_mutations_dist(generator), generator);
+        if (query.empty()) query = "A";
+        const auto alignment = align(target, query, defaultModel);
+        for (unsigned band_size : {0u, 1u, 3u, 8u, 20u}) {
+            const auto banded_alignment = align(target, query, defaultModel, band_size);
+            BOOST_CHECK(is_valid_alignment(target, query, banded_alignment, defaultModel));
+            BOOST_CHECK_LE(banded_alignment.score, alignment.score);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(banded_align_handles_bands_narrower_than_the_length_difference)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    const std::string target {"ACGTTGCAACGTAGCTAGCTTACGATCGATCGGATCCATGCATGCAAGT"};
+    const std::string short_query {"ACGTTGCAACGTAGCTAGCTTGCATGCAAGT"}, long_query {target + "TTTTTTTTTTTTTTTTTTTT"};
+    for (const auto& query : {short_query, long_query}) {
+        const auto alignment = align(target, query, defaultModel);
+        for (unsigned band_size : {0u, 1u, 2u}) {
+            const auto banded_alignment = align(target, query, defaultModel, band_size);
+            BOOST_CHECK(is_valid_alignment(target, query, banded_alignment, defaultModel));
+            BOOST_CHECK_EQUAL(banded_alignment.score, alignment.score);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(banded_align_handles_empty_sequences)
+{
+    using coretools::align;
+    
+    constexpr coretools::Model defaultModel {};
+    const std::string empty {}, nonempty {"ACGT"};
+    for (unsigned band_size : {0u, 4u}) {
+        for (const auto& sequences : {std::make_pair(empty, empty), std::make_pair(empty, nonempty), std::make_pair(nonempty, empty)}) {
+            const auto alignment = align(sequences.first, sequences.second, defaultModel);
+            const auto banded_alignment = align(sequences.first, sequences.second, defaultModel, band_size);
+            BOOST_CHECK_EQUAL(banded_alignment.cigar, alignment.cigar);
+            BOOST_CHECK_EQUAL(banded_alignment.score, alignment.score);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(banded_align_falls_back_to_scalar_scores_when_scores_may_overflow)
+{
+    using coretools::align;
+    
+    // Scores this large cannot be held in 16 bits for these sequence lengths
+    constexpr coretools::Model largeModel {200, -300, -800, -100};
+    std::mt19937 generator {11};
+    for (int trial {0}; trial < 20; ++trial) {
+        const auto target = random_sequence(300, generator);
+        const auto query = mutate(target, 8, generator);
+        const auto alignment = align(target, query, largeModel);
+        BOOST_REQUIRE_GT(alignment.score, std::numeric_limits<short>::max());
+        for (unsigned band_size : {0u, 8u, 400u}) {
+            const auto banded_alignment = align(target, query, largeModel, band_size);
+            BOOST_CHECK(is_valid_alignment(target, query, banded_alignment, largeModel));
+            BOOST_CHECK_LE(banded_alignment.score, alignment.score);
+            if (band_size == 400) BOOST_CHECK_EQUAL(banded_alignment.score, alignment.score);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
     
@@ -0,0 +1,168 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "io/read/read_manifest.hpp"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(io)
+BOOST_AUTO_TEST_SUITE(read_manifest)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+using octopus::io::ReadManifest;
+
+ReadManifest::FileSummary make_summary()
+{
+    return {{"NA12878", "NA12891"}, {GenomicRegion {"1", 0, 1000}, GenomicRegion {"X", 10, 20}}};
+}
+
+bool is_same(const ReadManifest::FileSummary& lhs, const ReadManifest::FileSummary& rhs)
+{
+    return lhs.samples == rhs.samples && lhs.possible_regions == rhs.possible_regions;
+}
+
+unsigned count_files(const fs::path& directory)
+{
+    return std::distance(fs::directory_iterator {directory}, fs::directory_iterator {});
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(a_missing_manifest_is_empty)
+{
+    const TempDirectory temp {};
+    const auto bam = temp.path / "reads.bam";
+    write_file(bam, "reads");
+    const ReadManifest manifest {temp.path / "manifest"};
+    BOOST_CHECK(!manifest.find(bam));
+}
+
+BOOST_AUTO_TEST_CASE(written_entries_are_found_when_loaded)
+{
+    const TempDirectory temp {};
+    const auto bam1 = temp.path / "reads1.bam", bam2 = temp.path / "reads2.bam";
+    write_file(bam1, "reads1");
+    write_file(bam1.string() + ".bai", "index1");
+    write_file(bam2, "reads2");
+    const auto manifest_path = temp.path / "manifest";
+    ReadManifest manifest {manifest_path};
+    manifest.update(bam1, make_summary());
+    manifest.update(bam2, ReadManifest::FileSummary {{"NA12892"}, {}});
+    BOOST_REQUIRE(manifest.write());
+    // No temporary files are left behind
+    BOOST_CHECK_EQUAL(count_files(temp.path), 4);
+    const ReadManifest loaded {manifest_path};
+    const auto summary1 = loaded.find(bam1), summary2 = loaded.find(bam2);
+    BOOST_REQUIRE(summary1);
+    BOOST_CHECK(is_same(*summary1, make_summary()));
+    BOOST_REQUIRE(summary2);
+    BOOST_CHECK(is_same(*summary2, ReadManifest::FileSummary {{"NA12892"}, {}}));
+    BOOST_CHECK(!loaded.find(temp.path / "reads3.bam"));
+}
+
+BOOST_AUTO_TEST_CASE(entries_are_ignored_when_the_read_file_changes)
+{
+    const TempDirectory temp {};
+    const auto bam = temp.path / "reads.bam";
+    write_file(bam, "reads");
+    ReadManifest manifest {temp.path / "manifest"};
+    manifest.update(bam, make_summary());
+    BOOST_REQUIRE(manifest.find(bam));
+    write_file(bam, "more reads");
+    BOOST_CHECK(!manifest.find(bam));
+    fs::remove(bam);
+    BOOST_CHECK(!manifest.find(bam));
+}
+
+BOOST_AUTO_TEST_CASE(entries_are_ignored_when_the_index_changes)
+{
+    const TempDirectory temp {};
+    const auto bam = temp.path / "reads.bam";
+    const auto bai = temp.path / "reads.bam.bai";
+    write_file(bam, "reads");
+    ReadManifest manifest {temp.path / "manifest"};
+    manifest.update(bam, make_summary());
+    BOOST_REQUIRE(manifest.find(bam));
+    // Indexing a file changes which regions can be fetched
+    write_file(bai, "index");
+    BOOST_CHECK(!manifest.find(bam));
+    manifest.update(bam, make_summary());
+    BOOST_REQUIRE(manifest.find(bam));
+    write_file(bai, "new index");
+    BOOST_CHECK(!manifest.find(bam));
+    manifest.update(bam, make_summary());
+    BOOST_REQUIRE(manifest.find(bam));
+    fs::remove(bai);
+    BOOST_CHECK(!manifest.find(bam));
+    // Indices with the extension replaced are also found
+    write_file(temp.path / "reads.bai", "index");
+    manifest.update(bam, make_summary());
+    BOOST_REQUIRE(manifest.find(bam));
+    write_file(temp.path / "reads.bai", "new index");
+    BOOST_CHECK(!manifest.find(bam));
+}
+
+BOOST_AUTO_TEST_CASE(corrupt_manifests_are_ignored)
+{
+    const TempDirectory temp {};
+    const auto bam = temp.path / "reads.bam";
+    write_file(bam, "reads");
+    const auto manifest_path = temp.path / "manifest";
+    ReadManifest manifest {manifest_path};
+    manifest.update(bam, make_summary());
+    BOOST_REQUIRE(manifest.write());
+    std::string contents {};
+    {
+        std::ifstream file {manifest_path.string()};
+        contents.assign(std::istreambuf_iterator<char> {file}, std::istreambuf_iterator<char> {});
+    }
+    BOOST_REQUIRE(ReadManifest {manifest_path}.find(bam));
+
+    const std::vector<std::string> corruptions {
+        "",
+        "not a manifest\n",
+        "octopus-read-manifest\t1\n" + contents.substr(contents.find('\n') + 1), // old version
+        contents.substr(0, contents.find("samples")) + "samples\n" + "regions\t1\t0\n", // truncated region
+        contents.substr(0, contents.find("regions")) + "regions\t1\tzero\t1000\n", // bad number
+        contents.substr(0, contents.find("file")) + "file\t" + bam.string() + "\t-\t-\t-\t-\n"
+            + contents.substr(contents.find("samples")), // missing file state
+    };
+    for (const auto& corruption : corruptions) {
+        write_file(manifest_path, corruption);
+        BOOST_CHECK(!ReadManifest {manifest_path}.find(bam));
+    }
+    // Truncated entries are dropped
+    write_file(manifest_path, contents.substr(0, contents.find("regions")));
+    BOOST_CHECK(!ReadManifest {manifest_path}.find(bam));
+}
+
+BOOST_AUTO_TEST_CASE(write_fails_when_the_manifest_cannot_be_created)
+{
+    const ReadManifest manifest {};
+    BOOST_CHECK(!manifest.write());
+    const TempDirectory temp {};
+    const ReadManifest unwritable {temp.path / "missing" / "manifest"};
+    BOOST_CHECK(!unwritable.write());
+    BOOST_CHECK_EQUAL(count_files(temp.path), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
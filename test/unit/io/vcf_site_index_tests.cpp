@@ -0,0 +1,149 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+
+#include "basics/genomic_region.hpp"
+#include "io/variant/vcf_reader.hpp"
+#include "io/variant/vcf_record.hpp"
+#include "io/variant/vcf_site_index.hpp"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(io)
+BOOST_AUTO_TEST_SUITE(vcf_site_index)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+struct ExpectedSite
+{
+    GenomicRegion region;
+    std::string ref, alt;
+    boost::optional<VcfRecord::QualityType> qual;
+    bool is_filtered;
+};
+
+const std::string long_ref(60, 'A');
+
+// Contig 1 has a 60 base REF allele at position 100, so queries starting inside it must look back
+// further than the short alleles around it
+std::string make_vcf()
+{
+    std::ostringstream ss {};
+    ss << "##fileformat=VCFv4.3\n"
+       << "##contig=<ID=1,length=1000>\n##contig=<ID=2,length=1000>\n"
+       << "##FILTER=<ID=q10,Description=\"Quality below 10\">\n"
+       << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n"
+       << "1\t10\t.\tA\tC\t50\tPASS\t.\n"
+       << "1\t20\t.\tAC\tA,ACC\t30\tPASS\t.\n"
+       << "1\t20\t.\tA\tT\t.\t.\t.\n"
+       << "1\t40\t.\tG\t*,T\t5\tq10\t.\n"
+       << "1\t100\t.\t" << long_ref << "\tA\t40\tPASS\t.\n"
+       << "1\t110\t.\tA\tG\t20\tPASS\t.\n"
+       << "1\t200\t.\tT\t.\t.\t.\t.\n"
+       << "1\t300\t.\tCAT\tC\t60\tPASS\t.\n"
+       << "2\t5\t.\tA\tG\t10\tPASS\t.\n"
+       << "2\t500\t.\tTT\tT\t15\tPASS\t.\n";
+    return ss.str();
+}
+
+// The records VcfReader reads, with one site per indexable ALT allele
+std::vector<ExpectedSite> read_sites(const VcfReader& reader)
+{
+    std::vector<ExpectedSite> result {};
+    for (const auto& record : reader.fetch_records(VcfReader::UnpackPolicy::sites)) {
+        for (const auto& alt : record.alt()) {
+            if (alt == "." || alt == "*") continue;
+            const GenomicRegion region {record.chrom(), record.pos() - 1, record.pos() - 1 + record.ref().size()};
+            result.push_back({region, record.ref(), alt, record.qual(), is_filtered(record)});
+        }
+    }
+    return result;
+}
+
+void check_fetch_matches(const VcfSiteIndex& index, const std::vector<ExpectedSite>& sites, const GenomicRegion& region)
+{
+    std::vector<ExpectedSite> expected {};
+    std::copy_if(std::cbegin(sites), std::cend(sites), std::back_inserter(expected),
+                 [&] (const ExpectedSite& site) { return overlaps(site.region, region); });
+    const auto fetched = index.fetch(region);
+    BOOST_REQUIRE_EQUAL(fetched.size(), expected.size());
+    for (std::size_t i {0}; i < fetched.size(); ++i) {
+        BOOST_CHECK_EQUAL(fetched[i].pos, expected[i].region.begin() + 1);
+        BOOST_CHECK_EQUAL(fetched[i].ref.to_string(), expected[i].ref);
+        BOOST_CHECK_EQUAL(fetched[i].alt.to_string(), expected[i].alt);
+        BOOST_CHECK(fetched[i].qual == expected[i].qual);
+        BOOST_CHECK_EQUAL(fetched[i].is_filtered, expected[i].is_filtered);
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fetched_sites_match_vcf_records)
+{
+    const TempDirectory temp {};
+    const auto vcf_path = temp.path / "calls.vcf";
+    write_file(vcf_path, make_vcf());
+    const VcfReader reader {vcf_path};
+    const auto index_path = get_site_index_path(vcf_path);
+    make_site_index(reader, index_path);
+    BOOST_CHECK(has_current_site_index(vcf_path));
+    const VcfSiteIndex index {index_path};
+    const auto sites = read_sites(reader);
+    BOOST_CHECK_EQUAL(index.count_sites(), sites.size());
+    for (const GenomicRegion::ContigName contig : {"1", "2"}) {
+        for (GenomicRegion::Position begin {0}; begin < 600; begin += 3) {
+            for (const GenomicRegion::Size size : {1, 2, 10, 100}) {
+                check_fetch_matches(index, sites, GenomicRegion {contig, begin, begin + size});
+            }
+        }
+    }
+    BOOST_CHECK(index.fetch(GenomicRegion {"3", 0, 1000}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(fetch_finds_long_alleles_that_begin_before_the_query)
+{
+    const TempDirectory temp {};
+    const auto vcf_path = temp.path / "calls.vcf";
+    write_file(vcf_path, make_vcf());
+    const VcfReader reader {vcf_path};
+    make_site_index(reader, get_site_index_path(vcf_path));
+    const VcfSiteIndex index {get_site_index_path(vcf_path)};
+    // The query starts inside the long REF allele, after the 110 record
+    const auto sites = index.fetch(GenomicRegion {"1", 150, 155});
+    BOOST_REQUIRE_EQUAL(sites.size(), 1);
+    BOOST_CHECK_EQUAL(sites.front().pos, 100);
+    BOOST_CHECK_EQUAL(sites.front().ref.to_string(), long_ref);
+    BOOST_CHECK_EQUAL(index.fetch(GenomicRegion {"1", 158, 159}).size(), 1);
+    BOOST_CHECK(index.fetch(GenomicRegion {"1", 159, 170}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(site_indices_older_than_the_vcf_are_not_current)
+{
+    const TempDirectory temp {};
+    const auto vcf_path = temp.path / "calls.vcf";
+    write_file(vcf_path, make_vcf());
+    BOOST_CHECK(!has_current_site_index(vcf_path));
+    make_site_index(VcfReader {vcf_path}, get_site_index_path(vcf_path));
+    BOOST_CHECK(has_current_site_index(vcf_path));
+    fs::last_write_time(vcf_path, fs::last_write_time(get_site_index_path(vcf_path)) + 10);
+    BOOST_CHECK(!has_current_site_index(vcf_path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -1,4 +1,77 @@
 // Copyright (c) 2017 Daniel Cooke
 // Use of this source code is governed by the MIT license that can be found in the LICENSE file.
 
-#include <stdio.h>
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "basics/cigar_string.hpp"
+#include "basics/aligned_read.hpp"
+#include "readpipe/downsampling/downsampler.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(readpipe)
+BOOST_AUTO_TEST_SUITE(downsampler)
+
+namespace {
+
+AlignedRead make_read(const std::string& name, const GenomicRegion::Position begin, const GenomicRegion::Position end)
+{
+    const auto length = end - begin;
+    return AlignedRead {
+        name, GenomicRegion {"1", begin, end}, std::string(length, 'A'),
+        AlignedRead::BaseQualityVector(length, 30), parse_cigar(std::to_string(length) + "M"),
+        60, AlignedRead::Flags {}, "", ""
+    };
+}
+
+unsigned count_coverage(const ReadContainer& reads, const GenomicRegion::Position position)
+{
+    return std::count_if(std::cbegin(reads), std::cend(reads), [position] (const AlignedRead& read) {
+        return read.mapped_region().begin() <= position && position < read.mapped_region().end();
+    });
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(downsample_does_nothing_when_coverage_is_below_the_trigger)
+{
+    ReadContainer reads {};
+    reads.insert(make_read("r1", 0, 100));
+    reads.insert(make_read("r2", 50, 150));
+    const octopus::readpipe::Downsampler downsampler {3, 2};
+    const auto report = downsampler.downsample(reads);
+    BOOST_CHECK(report.downsampled_regions.empty());
+    BOOST_CHECK_EQUAL(reads.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(downsample_handles_reads_that_end_after_the_target_region)
+{
+    ReadContainer reads {};
+    reads.insert(make_read("r1", 0, 100));
+    reads.insert(make_read("r2", 0, 100));
+    reads.insert(make_read("r3", 0, 100));
+    reads.insert(make_read("r4", 50, 150));
+    reads.insert(make_read("r5", 60, 90));
+    const octopus::readpipe::Downsampler downsampler {3, 2};
+    const auto report = downsampler.downsample(reads);
+    BOOST_REQUIRE_EQUAL(report.downsampled_regions.size(), 1);
+    const auto& target = *std::cbegin(report.downsampled_regions);
+    BOOST_CHECK_EQUAL(target.num_reads() + reads.size(), 5);
+    BOOST_CHECK(std::is_sorted(std::cbegin(reads), std::cend(reads)));
+    for (GenomicRegion::Position position {0}; position < 100; ++position) {
+        const auto coverage = count_coverage(reads, position);
+        BOOST_CHECK_GE(coverage, 2);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
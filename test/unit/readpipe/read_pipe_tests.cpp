@@ -1,16 +1,137 @@
-// Copyright (c) 2017 Daniel Cooke
+// Copyright (c) 2015-2020 Daniel Cooke
 // Use of this source code is governed by the MIT license that can be found in the LICENSE file.
 
-#define BOOST_TEST_DYN_LINK
-
 #include <boost/test/unit_test.hpp>
 
+#include <string>
+#include <vector>
+#include <random>
+#include <sstream>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+
+#include "config/common.hpp"
+#include "basics/genomic_region.hpp"
+#include "io/read/read_manager.hpp"
 #include "readpipe/read_pipe.hpp"
+#include "readpipe/filtering/read_filter.hpp"
+#include "utils/thread_pool.hpp"
+#include "mock/temp_files.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(readpipe)
+BOOST_AUTO_TEST_SUITE(read_pipe)
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+const GenomicRegion::Position contig_size {2000};
+const GenomicRegion::Size read_length {50};
+
+// Reads for each of the samples, which all share one file, with a hotspot that triggers downsampling
+void write_reads(const fs::path& bam, const std::vector<SampleName>& samples, std::mt19937& generator)
+{
+    std::uniform_int_distribution<GenomicRegion::Position> pos_dist {0, contig_size - read_length};
+    std::uniform_int_distribution<GenomicRegion::Position> hotspot_dist {1000, 1050};
+    std::uniform_int_distribution<unsigned> mapping_quality_dist {0, 3};
+    std::vector<std::pair<GenomicRegion::Position, std::string>> reads {};
+    for (const auto& sample : samples) {
+        for (unsigned i {0}; i < 300; ++i) {
+            reads.emplace_back(i % 3 == 0 ? hotspot_dist(generator) : pos_dist(generator), sample);
+        }
+    }
+    std::sort(std::begin(reads), std::end(reads));
+    std::ostringstream sam {};
+    sam << "@HD\tVN:1.6\tSO:coordinate\n@SQ\tSN:1\tLN:" << contig_size << '\n';
+    for (const auto& sample : samples) sam << "@RG\tID:" << sample << "\tSM:" << sample << '\n';
+    unsigned read_id {0};
+    for (const auto& read : reads) {
+        sam << "read" << read_id++ << "\t0\t1\t" << read.first + 1 << '\t' << 20 * mapping_quality_dist(generator)
+            << '\t' << read_length << "M\t*\t0\t0\t" << std::string(read_length, 'A') << '\t'
+            << std::string(read_length, 'I') << "\tRG:Z:" << read.second << '\n';
+    }
+    write_bam(bam, sam.str());
+}
+
+ReadPipe make_pipe(const ReadManager& source, const std::vector<SampleName>& samples)
+{
+    ReadPipe::ReadFilterer filterer {};
+    filterer.add(std::make_unique<octopus::readpipe::IsGoodMappingQuality>(20));
+    return ReadPipe {source, {}, std::move(filterer), ReadPipe::Downsampler {50, 30}, samples};
+}
+
+void check_equal(const ReadPipe::Report::DepthMap& lhs, const ReadPipe::Report::DepthMap& rhs,
+                 const GenomicRegion& region)
+{
+    BOOST_REQUIRE_EQUAL(lhs.size(), rhs.size());
+    for (const auto& p : lhs) {
+        BOOST_REQUIRE_EQUAL(rhs.count(p.first), 1);
+        BOOST_CHECK(p.second.get(region) == rhs.at(p.first).get(region));
+    }
+}
+
+void check_equal(const ReadPipe::Report& lhs, const ReadPipe::Report& rhs, const GenomicRegion& region)
+{
+    check_equal(lhs.raw_depths, rhs.raw_depths, region);
+    check_equal(lhs.mapping_quality_zero_depths, rhs.mapping_quality_zero_depths, region);
+    BOOST_REQUIRE_EQUAL(lhs.downsample_report.size(), rhs.downsample_report.size());
+    for (const auto& p : lhs.downsample_report) {
+        BOOST_REQUIRE_EQUAL(rhs.downsample_report.count(p.first), 1);
+        const auto& lhs_regions = p.second.downsampled_regions;
+        const auto& rhs_regions = rhs.downsample_report.at(p.first).downsampled_regions;
+        BOOST_REQUIRE_EQUAL(lhs_regions.size(), rhs_regions.size());
+        for (auto lhs_itr = std::cbegin(lhs_regions), rhs_itr = std::cbegin(rhs_regions);
+             lhs_itr != std::cend(lhs_regions); ++lhs_itr, ++rhs_itr) {
+            BOOST_CHECK_EQUAL(mapped_region(*lhs_itr), mapped_region(*rhs_itr));
+            BOOST_CHECK_EQUAL(lhs_itr->num_reads(), rhs_itr->num_reads());
+        }
+    }
+}
+
+} // namespace
 
-BOOST_AUTO_TEST_SUITE(Components)
-BOOST_AUTO_TEST_SUITE(IO)
+BOOST_AUTO_TEST_CASE(parallel_fetch_matches_serial_fetch)
+{
+    const TempDirectory temp {};
+    std::mt19937 generator {42};
+    // S1 and S2 share a file, so are fetched in one batch
+    write_reads(temp.path / "a.bam", {"S1", "S2"}, generator);
+    write_reads(temp.path / "b.bam", {"S3"}, generator);
+    write_reads(temp.path / "c.bam", {"S4"}, generator);
+    const ReadManager source {{temp.path / "a.bam", temp.path / "b.bam", temp.path / "c.bam"}, 3};
+    const std::vector<SampleName> samples {"S4", "S1", "S3", "S2"};
+    const auto serial = make_pipe(source, samples);
+    auto parallel = make_pipe(source, samples);
+    parallel.set_workers(std::make_shared<ThreadPool>(3));
+    const GenomicRegion region {"1", 0, contig_size};
+    for (const auto& fetch_region : {region, GenomicRegion {"1", 900, 1100}, GenomicRegion {"1", 1500, 1500}}) {
+        ReadPipe::Report serial_report {}, parallel_report {};
+        const auto serial_reads = serial.fetch_reads(fetch_region, serial_report);
+        const auto parallel_reads = parallel.fetch_reads(fetch_region, parallel_report);
+        BOOST_CHECK_EQUAL(parallel_reads.size(), samples.size());
+        BOOST_CHECK(parallel_reads == serial_reads);
+        check_equal(parallel_report, serial_report, region);
+        BOOST_CHECK(parallel.fetch_reads(fetch_region) == serial_reads);
+    }
+    // The full region is downsampled in each sample
+    ReadPipe::Report report {};
+    parallel.fetch_reads(region, report);
+    BOOST_CHECK_EQUAL(report.downsample_report.size(), samples.size());
+    for (const auto& p : report.downsample_report) {
+        BOOST_CHECK(!p.second.downsampled_regions.empty());
+    }
+    const std::vector<GenomicRegion> regions {GenomicRegion {"1", 100, 200}, GenomicRegion {"1", 1000, 1020}};
+    BOOST_CHECK(parallel.fetch_reads(regions) == serial.fetch_reads(regions));
+}
 
-// TODO
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
 
-BOOST_AUTO_TEST_SUITE_END() // IO
-BOOST_AUTO_TEST_SUITE_END() // Components
+} // namespace test
+} // namespace octopus
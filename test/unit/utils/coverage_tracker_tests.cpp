@@ -0,0 +1,248 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "basics/contig_region.hpp"
+#include "basics/genomic_region.hpp"
+#include "utils/coverage_tracker.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(coverage_tracker)
+
+namespace {
+
+using Position = ContigRegion::Position;
+
+const Position max_position {250};
+
+// Per-position depths, queried like the per-position tracker it replaced: statistics other than median
+// are over the part of the query inside the tracked region, and median pads the query with zeros
+struct BruteForceCoverage
+{
+    std::vector<unsigned> depths = std::vector<unsigned>(max_position, 0);
+    Position tracked_begin = max_position, tracked_end = 0;
+
+    void add(const ContigRegion& region)
+    {
+        if (is_empty(region)) return;
+        for (auto position = region.begin(); position < region.end(); ++position) ++depths[position];
+        tracked_begin = std::min(tracked_begin, region.begin());
+        tracked_end = std::max(tracked_end, region.end());
+    }
+
+    std::vector<unsigned> tracked(const ContigRegion& region) const
+    {
+        const auto first = std::max(region.begin(), tracked_begin), last = std::min(region.end(), tracked_end);
+        if (first >= last) return {};
+        return {std::next(std::cbegin(depths), first), std::next(std::cbegin(depths), last)};
+    }
+
+    std::vector<unsigned> get(const ContigRegion& region) const
+    {
+        return {std::next(std::cbegin(depths), region.begin()), std::next(std::cbegin(depths), region.end())};
+    }
+
+    std::vector<ContigRegion> covered_regions(const ContigRegion& region) const
+    {
+        std::vector<ContigRegion> result {};
+        for (auto position = region.begin(); position < region.end(); ++position) {
+            if (depths[position] == 0) continue;
+            if (!result.empty() && result.back().end() == position) {
+                result.back() = ContigRegion {result.back().begin(), position + 1};
+            } else {
+                result.emplace_back(position, position + 1);
+            }
+        }
+        return result;
+    }
+};
+
+double mean(const std::vector<unsigned>& depths)
+{
+    if (depths.empty()) return 0;
+    return static_cast<double>(std::accumulate(std::cbegin(depths), std::cend(depths), std::size_t {0})) / depths.size();
+}
+
+double stdev(const std::vector<unsigned>& depths)
+{
+    if (depths.empty()) return 0;
+    const auto m = mean(depths);
+    double ss {0};
+    for (const auto depth : depths) ss += std::pow(depth - m, 2);
+    return std::sqrt(ss / depths.size());
+}
+
+double median(std::vector<unsigned> depths)
+{
+    if (depths.empty()) return 0;
+    std::sort(std::begin(depths), std::end(depths));
+    const auto n = depths.size();
+    return n % 2 == 1 ? depths[n / 2] : (static_cast<double>(depths[n / 2 - 1]) + depths[n / 2]) / 2;
+}
+
+void check_matches(const CoverageTracker<ContigRegion>& tracker, const BruteForceCoverage& expected, const ContigRegion& region)
+{
+    const auto tracked = expected.tracked(region);
+    BOOST_CHECK_EQUAL(tracker.any(region), std::any_of(std::cbegin(tracked), std::cend(tracked), [] (auto depth) { return depth > 0; }));
+    BOOST_CHECK_EQUAL(tracker.sum(region), std::accumulate(std::cbegin(tracked), std::cend(tracked), std::size_t {0}));
+    BOOST_CHECK_EQUAL(tracker.max(region), tracked.empty() ? 0 : *std::max_element(std::cbegin(tracked), std::cend(tracked)));
+    BOOST_CHECK_EQUAL(tracker.min(region), tracked.empty() ? 0 : *std::min_element(std::cbegin(tracked), std::cend(tracked)));
+    BOOST_CHECK_EQUAL(tracker.mean(region), mean(tracked));
+    BOOST_CHECK_SMALL(tracker.stdev(region) - stdev(tracked), 1e-9);
+    BOOST_CHECK_EQUAL(tracker.median(region), median(expected.get(region)));
+    BOOST_CHECK(tracker.get(region) == expected.get(region));
+    BOOST_CHECK(get_covered_regions(tracker, region) == expected.covered_regions(region));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(queries_match_per_position_depths)
+{
+    const std::vector<ContigRegion> reads {
+        ContigRegion {10, 20}, ContigRegion {15, 30}, ContigRegion {15, 30}, ContigRegion {40, 50},
+        ContigRegion {45, 45}, ContigRegion {48, 60}
+    };
+    CoverageTracker<ContigRegion> tracker {};
+    BruteForceCoverage expected {};
+    for (const auto& read : reads) {
+        tracker.add(read);
+        expected.add(read);
+    }
+    BOOST_CHECK_EQUAL(tracker.num_tracked(), 5); // the empty read is not tracked
+    BOOST_REQUIRE(tracker.encompassing_region());
+    BOOST_CHECK_EQUAL(*tracker.encompassing_region(), (ContigRegion {10, 60}));
+    BOOST_CHECK((tracker.get(ContigRegion {8, 22}) == std::vector<unsigned> {0, 0, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 2, 2}));
+    BOOST_CHECK_EQUAL(tracker.max(), 3);
+    BOOST_CHECK_EQUAL(tracker.min(), 0); // the gap between 30 and 40
+    BOOST_CHECK_EQUAL(tracker.sum(), 10 + 2 * 15 + 10 + 12);
+    BOOST_CHECK_EQUAL(tracker.mean(), (10.0 + 2 * 15 + 10 + 12) / 50);
+    BOOST_CHECK((get_covered_regions(tracker) == std::vector<ContigRegion> {ContigRegion {10, 30}, ContigRegion {40, 60}}));
+    for (Position begin {0}; begin <= 70; begin += 3) {
+        for (Position end {begin}; end <= 75; end += 4) {
+            check_matches(tracker, expected, ContigRegion {begin, end});
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(queries_match_per_position_depths_on_random_reads)
+{
+    std::mt19937 generator {42};
+    std::uniform_int_distribution<Position> begin_dist {20, 180}, size_dist {0, 40};
+    for (unsigned trial {0}; trial < 50; ++trial) {
+        std::vector<ContigRegion> reads {};
+        for (unsigned i {0}; i < 1 + trial; ++i) {
+            const auto begin = begin_dist(generator);
+            reads.emplace_back(begin, begin + size_dist(generator));
+        }
+        // Reads usually arrive sorted, but not always
+        if (trial % 2 == 0) std::sort(std::begin(reads), std::end(reads));
+        CoverageTracker<ContigRegion> tracker {};
+        BruteForceCoverage expected {};
+        for (std::size_t i {0}; i < reads.size(); ++i) {
+            tracker.add(reads[i]);
+            expected.add(reads[i]);
+            // Querying between adds materialises part of the reads
+            if (i == reads.size() / 2) check_matches(tracker, expected, ContigRegion {0, max_position});
+        }
+        for (unsigned query {0}; query < 20; ++query) {
+            std::uniform_int_distribution<Position> query_begin_dist {0, max_position};
+            const auto begin = query_begin_dist(generator);
+            std::uniform_int_distribution<Position> query_end_dist {begin, max_position};
+            check_matches(tracker, expected, ContigRegion {begin, query_end_dist(generator)});
+        }
+        if (tracker.encompassing_region()) check_matches(tracker, expected, *tracker.encompassing_region());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(queries_outside_the_tracked_region_are_zero)
+{
+    CoverageTracker<ContigRegion> tracker {};
+    tracker.add(ContigRegion {100, 110});
+    const ContigRegion outside {200, 210};
+    BOOST_CHECK(!tracker.any(outside));
+    BOOST_CHECK_EQUAL(tracker.sum(outside), 0);
+    BOOST_CHECK_EQUAL(tracker.max(outside), 0);
+    BOOST_CHECK_EQUAL(tracker.min(outside), 0);
+    // The per-position tracker returned NaN here
+    BOOST_CHECK_EQUAL(tracker.mean(outside), 0);
+    BOOST_CHECK_EQUAL(tracker.stdev(outside), 0);
+    BOOST_CHECK_EQUAL(tracker.median(outside), 0);
+    BOOST_CHECK((tracker.get(outside) == std::vector<unsigned>(10, 0)));
+    BOOST_CHECK(get_covered_regions(tracker, outside).empty());
+    // Queries partly outside are restricted to the tracked region, except for median
+    const ContigRegion overhanging {105, 125};
+    BOOST_CHECK_EQUAL(tracker.mean(overhanging), 1);
+    BOOST_CHECK_EQUAL(tracker.min(overhanging), 1);
+    BOOST_CHECK_EQUAL(tracker.median(overhanging), 0);
+}
+
+BOOST_AUTO_TEST_CASE(empty_trackers_and_regions_are_zero)
+{
+    CoverageTracker<ContigRegion> tracker {};
+    BOOST_CHECK(tracker.is_empty());
+    BOOST_CHECK(!tracker.any());
+    BOOST_CHECK(!tracker.encompassing_region());
+    BOOST_CHECK_EQUAL(tracker.sum(), 0);
+    BOOST_CHECK_EQUAL(tracker.max(), 0);
+    BOOST_CHECK_EQUAL(tracker.min(), 0);
+    BOOST_CHECK_EQUAL(tracker.mean(), 0);
+    BOOST_CHECK_EQUAL(tracker.stdev(), 0);
+    BOOST_CHECK_EQUAL(tracker.median(), 0);
+    BOOST_CHECK(get_covered_regions(tracker).empty());
+    tracker.add(ContigRegion {5, 5});
+    BOOST_CHECK(tracker.is_empty());
+    tracker.add(ContigRegion {5, 15});
+    BOOST_CHECK(!tracker.is_empty());
+    BOOST_CHECK(tracker.any());
+    const ContigRegion empty {10, 10};
+    BOOST_CHECK(!tracker.any(empty));
+    BOOST_CHECK_EQUAL(tracker.sum(empty), 0);
+    BOOST_CHECK_EQUAL(tracker.max(empty), 0);
+    BOOST_CHECK_EQUAL(tracker.mean(empty), 0);
+    BOOST_CHECK_EQUAL(tracker.stdev(empty), 0);
+    BOOST_CHECK_EQUAL(tracker.median(empty), 0);
+    BOOST_CHECK(tracker.get(empty).empty());
+    BOOST_CHECK(get_covered_regions(tracker, empty).empty());
+    tracker.clear();
+    BOOST_CHECK(tracker.is_empty());
+    BOOST_CHECK(!tracker.any());
+    BOOST_CHECK_EQUAL(tracker.max(ContigRegion {5, 15}), 0);
+}
+
+BOOST_AUTO_TEST_CASE(genomic_regions_on_other_contigs_are_not_covered)
+{
+    CoverageTracker<GenomicRegion> tracker {};
+    tracker.add(GenomicRegion {"1", 10, 20});
+    BOOST_CHECK_THROW(tracker.add(GenomicRegion {"2", 10, 20}), std::runtime_error);
+    BOOST_CHECK_EQUAL(tracker.num_tracked(), 1);
+    const GenomicRegion other {"2", 10, 20};
+    BOOST_CHECK(!tracker.any(other));
+    BOOST_CHECK_EQUAL(tracker.sum(other), 0);
+    BOOST_CHECK_EQUAL(tracker.mean(other), 0);
+    BOOST_CHECK((get_covered_regions(tracker) == std::vector<GenomicRegion> {GenomicRegion {"1", 10, 20}}));
+}
+
+BOOST_AUTO_TEST_CASE(overflow_is_detected_when_checked)
+{
+    CoverageTracker<ContigRegion, std::uint8_t> tracker {true};
+    for (unsigned i {0}; i < 256; ++i) tracker.add(ContigRegion {0, 10});
+    BOOST_CHECK_THROW(tracker.max(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
@@ -0,0 +1,142 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <sstream>
+
+#include <boost/optional.hpp>
+
+#include "utils/memory_governor.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(memory_governor)
+
+namespace {
+
+using Stage = MemoryGovernor::Stage;
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(reservations_are_released_on_destruction)
+{
+    MemoryGovernor governor {100};
+    {
+        const auto reservation = governor.reserve(Stage::reads, 60);
+        BOOST_CHECK_EQUAL(reservation.footprint().bytes(), 60);
+        BOOST_CHECK(reservation.stage() == Stage::reads);
+        BOOST_CHECK_EQUAL(governor.usage().bytes(), 60);
+        BOOST_CHECK_EQUAL(governor.usage(Stage::reads).bytes(), 60);
+        BOOST_CHECK_EQUAL(governor.available().bytes(), 40);
+    }
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 0);
+    BOOST_CHECK_EQUAL(governor.usage(Stage::reads).bytes(), 0);
+    BOOST_CHECK_EQUAL(governor.available().bytes(), 100);
+    BOOST_CHECK_EQUAL(governor.peak_usage().bytes(), 60);
+}
+
+BOOST_AUTO_TEST_CASE(moved_reservations_are_released_once)
+{
+    MemoryGovernor governor {100};
+    auto reservation1 = governor.reserve(Stage::reads, 30);
+    auto reservation2 = std::move(reservation1);
+    BOOST_CHECK_EQUAL(reservation1.footprint().bytes(), 0);
+    reservation1.release();
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 30);
+    // Assigning over a reservation releases it
+    reservation2 = governor.reserve(Stage::haplotypes, 20);
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 20);
+    BOOST_CHECK_EQUAL(governor.usage(Stage::reads).bytes(), 0);
+    BOOST_CHECK_EQUAL(governor.usage(Stage::haplotypes).bytes(), 20);
+    reservation2.release();
+    reservation2.release();
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(reserve_blocks_until_another_thread_releases)
+{
+    MemoryGovernor governor {100};
+    auto held = governor.reserve(Stage::reads, 80);
+    std::atomic<bool> reserved {false};
+    boost::optional<MemoryGovernor::Reservation> waiting {};
+    std::thread waiter {[&] () {
+        waiting = governor.reserve(Stage::likelihoods, 50);
+        reserved = true;
+    }};
+    std::this_thread::sleep_for(std::chrono::milliseconds {100});
+    BOOST_CHECK(!reserved);
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 80);
+    held.release();
+    waiter.join();
+    BOOST_CHECK(reserved);
+    BOOST_REQUIRE(waiting);
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 50);
+    BOOST_CHECK_EQUAL(governor.usage(Stage::likelihoods).bytes(), 50);
+    BOOST_CHECK_EQUAL(governor.peak_usage().bytes(), 80);
+}
+
+BOOST_AUTO_TEST_CASE(reserve_grants_requests_larger_than_the_limit_when_nothing_else_is_reserved)
+{
+    MemoryGovernor governor {100};
+    const auto reservation = governor.reserve(Stage::genotypes, 250);
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 250);
+    BOOST_CHECK_EQUAL(governor.available().bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(try_reserve_fails_without_side_effects)
+{
+    MemoryGovernor governor {100};
+    const auto held = governor.reserve(Stage::reads, 80);
+    BOOST_CHECK(!governor.try_reserve(Stage::haplotypes, 30));
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 80);
+    BOOST_CHECK_EQUAL(governor.usage(Stage::haplotypes).bytes(), 0);
+    BOOST_CHECK_EQUAL(governor.peak_usage().bytes(), 80);
+    BOOST_CHECK_EQUAL(governor.peak_usage(Stage::haplotypes).bytes(), 0);
+    const auto reservation = governor.try_reserve(Stage::haplotypes, 20);
+    BOOST_REQUIRE(reservation);
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 100);
+    BOOST_CHECK_EQUAL(governor.available().bytes(), 0);
+    // Unlike reserve, try_reserve does not grant oversized requests on an idle governor
+    MemoryGovernor idle {100};
+    BOOST_CHECK(!idle.try_reserve(Stage::reads, 101));
+    BOOST_CHECK_EQUAL(idle.peak_usage().bytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(force_reserve_goes_over_the_limit_and_is_counted_in_peaks)
+{
+    MemoryGovernor governor {100};
+    {
+        const auto reads = governor.reserve(Stage::reads, 80);
+        const auto likelihoods = governor.force_reserve(Stage::likelihoods, 50);
+        BOOST_CHECK_EQUAL(governor.usage().bytes(), 130);
+        BOOST_CHECK_EQUAL(governor.available().bytes(), 0);
+        BOOST_CHECK(!governor.try_reserve(Stage::genotypes, 1));
+        {
+            const auto more_likelihoods = governor.force_reserve(Stage::likelihoods, 10);
+            BOOST_CHECK_EQUAL(governor.usage(Stage::likelihoods).bytes(), 60);
+        }
+        const auto genotypes = governor.force_reserve(Stage::genotypes, 5);
+        BOOST_CHECK_EQUAL(governor.usage().bytes(), 135);
+    }
+    BOOST_CHECK_EQUAL(governor.usage().bytes(), 0);
+    BOOST_CHECK_EQUAL(governor.peak_usage().bytes(), 140);
+    BOOST_CHECK_EQUAL(governor.peak_usage(Stage::reads).bytes(), 80);
+    BOOST_CHECK_EQUAL(governor.peak_usage(Stage::likelihoods).bytes(), 60);
+    BOOST_CHECK_EQUAL(governor.peak_usage(Stage::genotypes).bytes(), 5);
+    BOOST_CHECK_EQUAL(governor.peak_usage(Stage::haplotypes).bytes(), 0);
+    std::ostringstream ss {};
+    print_peak_usage(ss, governor);
+    BOOST_CHECK(ss.str().find("likelihoods") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus
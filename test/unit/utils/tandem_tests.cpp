@@ -0,0 +1,135 @@
+// Copyright (c) 2015-2020 Daniel Cooke
+// Use of this source code is governed by the MIT license that can be found in the LICENSE file.
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <tuple>
+#include <random>
+#include <cstdint>
+#include <algorithm>
+
+#include "tandem/tandem.hpp"
+
+namespace octopus { namespace test {
+
+BOOST_AUTO_TEST_SUITE(utils)
+BOOST_AUTO_TEST_SUITE(tandem)
+
+namespace {
+
+using RepeatTuple = std::tuple<std::uint32_t, std::uint32_t, std::uint32_t>; // pos, length, period
+using RepeatSet = std::set<RepeatTuple>;
+
+RepeatSet to_set(const std::vector<::tandem::Repeat>& repeats)
+{
+    RepeatSet result {};
+    for (const auto& repeat : repeats) result.emplace(repeat.pos, repeat.length, repeat.period);
+    return result;
+}
+
+bool has_period(const std::string& str, const std::size_t pos, const std::size_t length, const std::size_t period)
+{
+    for (auto i = pos; i + period < pos + length; ++i) {
+        if (str[i] != str[i + period]) return false;
+    }
+    return true;
+}
+
+// Every maximal run of length at least twice its smallest period
+RepeatSet brute_force_maximal_repetitions(const std::string& str, const std::uint32_t max_period)
+{
+    RepeatSet result {};
+    const auto n = str.size();
+    for (std::size_t pos {0}; pos < n; ++pos) {
+        for (auto end = pos + 2; end <= n; ++end) {
+            const auto length = end - pos;
+            std::size_t period {1};
+            while (!has_period(str, pos, length, period)) ++period;
+            if (period > max_period || length < 2 * period) continue;
+            const bool left_maximal {pos == 0 || str[pos - 1] != str[pos - 1 + period]};
+            const bool right_maximal {end == n || str[end] != str[end - period]};
+            if (left_maximal && right_maximal) {
+                result.emplace(pos, length, period);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> make_random_sequences(const unsigned num_sequences, const std::size_t length)
+{
+    std::mt19937 generator {42};
+    const std::string bases {"ACGT"};
+    std::vector<std::string> result(num_sequences, std::string(length, 'A'));
+    for (unsigned i {0}; i < num_sequences; ++i) {
+        // Low complexity sequences have many more repeats
+        std::uniform_int_distribution<std::size_t> base_dist {0, i % 2 == 0 ? 1u : 3u};
+        for (auto& base : result[i]) base = bases[base_dist(generator)];
+    }
+    return result;
+}
+
+bool is_contained(const RepeatTuple& repeat, const RepeatSet& repeats)
+{
+    return std::any_of(std::cbegin(repeats), std::cend(repeats), [&] (const RepeatTuple& other) {
+        return std::get<2>(other) == std::get<2>(repeat)
+            && std::get<0>(other) <= std::get<0>(repeat)
+            && std::get<0>(repeat) + std::get<1>(repeat) <= std::get<0>(other) + std::get<1>(other);
+    });
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(direct_extraction_finds_exactly_the_maximal_repetitions)
+{
+    for (const auto& sequence : make_random_sequences(100, 60)) {
+        for (std::uint32_t max_period {4}; max_period <= 8; ++max_period) {
+            const auto repeats = ::tandem::extract_exact_tandem_repeats(sequence, 1, max_period);
+            BOOST_CHECK(to_set(repeats) == brute_force_maximal_repetitions(sequence, max_period));
+            BOOST_CHECK(std::is_sorted(std::cbegin(repeats), std::cend(repeats),
+                                       [] (const auto& lhs, const auto& rhs) { return lhs.pos < rhs.pos; }));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(direct_extraction_matches_naive_extraction_for_homopolymers_and_dinucleotide_repeats)
+{
+    for (const auto& sequence : make_random_sequences(200, 200)) {
+        BOOST_CHECK(to_set(::tandem::detail::extract_exact_tandem_repeats_direct(sequence, 1, 2))
+                    == to_set(::tandem::detail::extract_exact_tandem_repeats_naive(sequence, 1, 2)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(direct_extraction_covers_every_repeat_the_lz_extraction_finds)
+{
+    // The LZ algorithm, which was used for periods 4-8, can report non-maximal fragments of a repeat
+    // and can miss repeats. The direct algorithm reports the maximal repeat containing each fragment.
+    for (const auto& sequence : make_random_sequences(200, 200)) {
+        const auto direct_repeats = to_set(::tandem::detail::extract_exact_tandem_repeats_direct(sequence, 1, 5));
+        for (const auto& repeat : to_set(::tandem::detail::extract_exact_tandem_repeats_lz(sequence, 1, 5))) {
+            BOOST_CHECK(is_contained(repeat, direct_repeats));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(direct_extraction_handles_edge_cases)
+{
+    using ::tandem::extract_exact_tandem_repeats;
+    BOOST_CHECK(extract_exact_tandem_repeats(std::string {}, 1, 5).empty());
+    BOOST_CHECK(extract_exact_tandem_repeats(std::string {"ACGT"}, 1, 5).empty());
+    const RepeatSet homopolymer {RepeatTuple {0, 4, 1}};
+    BOOST_CHECK(to_set(extract_exact_tandem_repeats(std::string {"AAAA"}, 1, 5)) == homopolymer);
+    // ACAC has period 2, so is not reported as a period 4 repeat
+    BOOST_CHECK(extract_exact_tandem_repeats(std::string {"ACACACAC"}, 4, 5).empty());
+    const RepeatSet tetranucleotide {RepeatTuple {0, 12, 4}};
+    BOOST_CHECK(to_set(extract_exact_tandem_repeats(std::string {"TACGTACGTACGG"}, 4, 5)) == tetranucleotide);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace test
+} // namespace octopus